@@ -0,0 +1,48 @@
+#ifndef VK_BEGINS_BENCHMARK_H
+#define VK_BEGINS_BENCHMARK_H
+
+#include <cppUtils/cppUtils.hpp>
+
+// Returns the scenario's score in the unit it was registered with
+typedef double (*vkb_BenchmarkFn)();
+
+struct vkb_Benchmark
+{
+	const char* name;
+	const char* unit;
+	bool higherIsBetter;
+	// Scenarios that draw need the headless app, it's initialized before the first of them runs
+	bool needsRenderer;
+	vkb_BenchmarkFn fn;
+};
+
+void vkb_benchmark_register(const char* name, const char* unit, bool higherIsBetter, bool needsRenderer, vkb_BenchmarkFn fn);
+
+// Call from a scenario that can't run on this machine, for a feature the device
+// doesn't support. Whatever it returns is ignored and it's reported as skipped.
+void vkb_benchmark_skip(const char* reason);
+
+// The reason the last scenario skipped itself, or nullptr. Clears it.
+const char* vkb_benchmark_takeSkipReason();
+
+uint32 vkb_benchmark_count();
+
+const vkb_Benchmark& vkb_benchmark_get(uint32 index);
+
+// Every group of scenarios lives in its own file and registers itself here
+void vkb_benchmark_registerRenderScenarios();
+void vkb_benchmark_registerTransformScenarios();
+void vkb_benchmark_registerJobScenarios();
+void vkb_benchmark_registerDrawQueueScenarios();
+void vkb_benchmark_registerMeshLodScenarios();
+void vkb_benchmark_registerBvhScenarios();
+void vkb_benchmark_registerOcclusionScenarios();
+void vkb_benchmark_registerLightingScenarios();
+void vkb_benchmark_registerParticleScenarios();
+void vkb_benchmark_registerSpriteScenarios();
+void vkb_benchmark_registerBindlessScenarios();
+
+// Monotonic time in seconds, subtract two readings to time something
+double vkb_benchmark_now();
+
+#endif
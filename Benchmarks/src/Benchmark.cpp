@@ -0,0 +1,43 @@
+#include "Benchmarks/Benchmark.h"
+
+#include <chrono>
+
+// ------------ Internal Variables ------------
+static constexpr uint32 maxBenchmarks = 128;
+static vkb_Benchmark benchmarks[maxBenchmarks];
+static uint32 numBenchmarks = 0;
+static const char* skipReason = nullptr;
+
+// ------------ Public Functions ------------
+void vkb_benchmark_register(const char* name, const char* unit, bool higherIsBetter, bool needsRenderer, vkb_BenchmarkFn fn)
+{
+	g_logger_assert(numBenchmarks < maxBenchmarks, "Too many benchmarks registered.");
+	benchmarks[numBenchmarks++] = vkb_Benchmark{ name, unit, higherIsBetter, needsRenderer, fn };
+}
+
+void vkb_benchmark_skip(const char* reason)
+{
+	skipReason = reason;
+}
+
+const char* vkb_benchmark_takeSkipReason()
+{
+	const char* reason = skipReason;
+	skipReason = nullptr;
+	return reason;
+}
+
+uint32 vkb_benchmark_count()
+{
+	return numBenchmarks;
+}
+
+const vkb_Benchmark& vkb_benchmark_get(uint32 index)
+{
+	return benchmarks[index];
+}
+
+double vkb_benchmark_now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
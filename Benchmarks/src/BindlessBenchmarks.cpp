@@ -0,0 +1,166 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/App.h"
+#include "VulkanBegins/DrawQueue.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/DeviceCaps.h"
+#include "VulkanBegins/Residency.h"
+
+// ------------ Internal Variables ------------
+static constexpr uint32 warmupFrames = 10;
+static constexpr uint32 measuredFrames = 100;
+static constexpr uint32 drawsPerFrame = 10000;
+static constexpr uint32 numMaterials = 1024;
+static constexpr uint32 residencyFrames = 60;
+
+// ------------ Internal Functions ------------
+static void endMaterials()
+{
+	vkb_app_setMaterials(0, false);
+	vkb_app_setDrawsPerFrame(1, false);
+	vkb_app_setRetainedCommandBuffers(true);
+}
+
+// Returns false if the materials, or the heap for the bindless ones, couldn't
+// be created. The scenario should skip then.
+static bool beginMaterials(bool bindless)
+{
+	// Recording every frame keeps the binding cost in the measurement
+	vkb_app_setRetainedCommandBuffers(false);
+	vkb_app_setDrawsPerFrame(drawsPerFrame, false);
+	vkb_app_setMaterials(numMaterials, bindless);
+
+	// Without the heap the bindless variants would quietly measure per set binding
+	const vkb_AppConfig& config = vkb_app_getConfig();
+	if (config.numMaterials == 0 || (bindless && (vkb_app_getBindlessHeap() == nullptr || !config.bindlessMaterials)))
+	{
+		endMaterials();
+		return false;
+	}
+
+	for (uint32 i = 0; i < warmupFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+	return true;
+}
+
+static const char* skipReason(bool bindless)
+{
+	return bindless ? "bindless materials aren't supported" : "materials aren't supported";
+}
+
+static double materialDrawsPerSecond(bool bindless)
+{
+	if (!beginMaterials(bindless))
+	{
+		vkb_benchmark_skip(skipReason(bindless));
+		return 0.0;
+	}
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < measuredFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+	double frameTime = (vkb_benchmark_now() - start) / measuredFrames;
+
+	endMaterials();
+
+	return drawsPerFrame / frameTime;
+}
+
+// Descriptor set binds in one frame of drawsPerFrame draws cycling through the materials
+static double materialDescriptorBinds(bool bindless)
+{
+	if (!beginMaterials(bindless))
+	{
+		vkb_benchmark_skip(skipReason(bindless));
+		return 0.0;
+	}
+
+	vkb_DrawStats stats = vkb_app_getDrawStats();
+	endMaterials();
+
+	return (double)stats.descriptorSetBinds;
+}
+
+static double perSetDrawsPerSecond()
+{
+	return materialDrawsPerSecond(false);
+}
+
+static double bindlessDrawsPerSecond()
+{
+	return materialDrawsPerSecond(true);
+}
+
+static double perSetDescriptorBinds()
+{
+	return materialDescriptorBinds(false);
+}
+
+static double bindlessDescriptorBinds()
+{
+	return materialDescriptorBinds(true);
+}
+
+// Worst frame while the material textures' heap is capped just under its usage,
+// so the residency manager has to drop their mips or evict them. Errors if it
+// didn't, and warns if lifting the cap didn't bring any back.
+static double forcedEvictionWorstFrameMs()
+{
+	if (!beginMaterials(false))
+	{
+		vkb_benchmark_skip(skipReason(false));
+		return 0.0;
+	}
+
+	const vkb_DeviceCaps& caps = *vkb_app_getContext().caps;
+	uint32 memoryType = vkb_deviceCaps_findMemoryType(caps, UINT32_MAX, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	uint32 heapIndex = caps.memoryProperties.memoryTypes[memoryType].heapIndex;
+	vkb_ResidencyStats before = vkb_residency_getStats();
+	vkb_residency_setBudgetLimit(heapIndex, before.heaps[heapIndex].usage / 100 * 95);
+
+	double worstFrame = 0.0;
+	for (uint32 i = 0; i < residencyFrames; i++)
+	{
+		double start = vkb_benchmark_now();
+		vkb_app_drawFrame();
+		vkb_app_waitIdle();
+		double frameTime = vkb_benchmark_now() - start;
+		worstFrame = frameTime > worstFrame ? frameTime : worstFrame;
+	}
+	vkb_ResidencyStats evicted = vkb_residency_getStats();
+
+	vkb_residency_setBudgetLimit(heapIndex, 0);
+	for (uint32 i = 0; i < residencyFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+	vkb_ResidencyStats restored = vkb_residency_getStats();
+	endMaterials();
+
+	if (evicted.numMipsDropped == before.numMipsDropped)
+	{
+		g_logger_error("Capping heap %d's budget didn't drop any material texture mips.", heapIndex);
+		return 0.0;
+	}
+	if (restored.numMipsRestored == evicted.numMipsRestored)
+	{
+		g_logger_warning("No material texture mips were restored after lifting the budget cap, heap %d is still above the restore threshold.", heapIndex);
+	}
+	return worstFrame * 1000.0;
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerBindlessScenarios()
+{
+	vkb_benchmark_register("materials_1k_per_set_draws_per_sec", "draws/s", true, true, perSetDrawsPerSecond);
+	vkb_benchmark_register("materials_1k_bindless_draws_per_sec", "draws/s", true, true, bindlessDrawsPerSecond);
+	vkb_benchmark_register("materials_1k_per_set_descriptor_binds", "binds", false, true, perSetDescriptorBinds);
+	vkb_benchmark_register("materials_1k_bindless_descriptor_binds", "binds", false, true, bindlessDescriptorBinds);
+	vkb_benchmark_register("materials_1k_forced_eviction_worst_frame_ms", "ms", false, true, forcedEvictionWorstFrameMs);
+}
@@ -0,0 +1,168 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/Bvh.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// ------------ Internal Variables ------------
+static constexpr uint32 numStaticObjects = 1000000;
+static constexpr uint32 numDynamicObjects = 10000;
+static constexpr uint32 numObjects = numStaticObjects + numDynamicObjects;
+static constexpr uint32 iterations = 20;
+
+// ------------ Internal Functions ------------
+static uint32 nextRandom(uint32* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static float randomFloat(uint32* state, float min, float max)
+{
+	return min + (max - min) * (float)(nextRandom(state) & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+// Static objects scattered over a 2km square, dynamic ones after them
+static vkb_Aabb* createScene()
+{
+	uint32 state = 0x9E3779B9;
+	vkb_Aabb* bounds = (vkb_Aabb*)g_memory_allocate(sizeof(vkb_Aabb) * numObjects);
+	for (uint32 i = 0; i < numObjects; i++)
+	{
+		glm::vec3 center(randomFloat(&state, -1000.0f, 1000.0f), randomFloat(&state, 0.0f, 20.0f), randomFloat(&state, -1000.0f, 1000.0f));
+		glm::vec3 halfExtent(randomFloat(&state, 0.5f, 4.0f));
+		bounds[i] = { center - halfExtent, center + halfExtent };
+	}
+	return bounds;
+}
+
+static void moveDynamicObjects(vkb_Bvh& bvh, vkb_Aabb* bounds, uint32 frame)
+{
+	glm::vec3 offset((float)(frame % 2 == 0 ? 1.0f : -1.0f), 0.0f, 0.5f);
+	for (uint32 i = numStaticObjects; i < numObjects; i++)
+	{
+		bounds[i].min = bounds[i].min + offset;
+		bounds[i].max = bounds[i].max + offset;
+		vkb_bvh_update(bvh, i, bounds[i]);
+	}
+}
+
+static vkb_Frustum benchmarkFrustum()
+{
+	glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 30.0f, 0.0f), glm::vec3(200.0f, 0.0f, 200.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	return vkb_frustum_fromViewProj(proj * view);
+}
+
+static double buildMs()
+{
+	vkb_Aabb* bounds = createScene();
+
+	double start = vkb_benchmark_now();
+	vkb_Bvh bvh = vkb_bvh_build(bounds, numObjects);
+	double elapsed = vkb_benchmark_now() - start;
+
+	vkb_bvh_free(bvh);
+	g_memory_free(bounds);
+	return elapsed * 1000.0;
+}
+
+static double refitDynamicMs()
+{
+	vkb_Aabb* bounds = createScene();
+	vkb_Bvh bvh = vkb_bvh_build(bounds, numObjects);
+
+	double elapsed = 0.0;
+	for (uint32 i = 0; i < iterations; i++)
+	{
+		double start = vkb_benchmark_now();
+		moveDynamicObjects(bvh, bounds, i);
+		vkb_bvh_refit(bvh);
+		elapsed += vkb_benchmark_now() - start;
+	}
+
+	vkb_bvh_free(bvh);
+	g_memory_free(bounds);
+	return elapsed * 1000.0 / iterations;
+}
+
+static double timeCull(vkb_TransformKernel kernel)
+{
+	vkb_Aabb* bounds = createScene();
+	vkb_Bvh bvh = vkb_bvh_build(bounds, numObjects);
+	vkb_Frustum frustum = benchmarkFrustum();
+	uint32* visibleIds = (uint32*)g_memory_allocate(sizeof(uint32) * numObjects);
+
+	// Dynamic objects keep moving so the culled tree is a refit one, like in a real frame
+	double elapsed = 0.0;
+	for (uint32 i = 0; i < iterations; i++)
+	{
+		moveDynamicObjects(bvh, bounds, i);
+		vkb_bvh_refit(bvh);
+
+		double start = vkb_benchmark_now();
+		vkb_bvh_cullFrustum(bvh, frustum, visibleIds, kernel);
+		elapsed += vkb_benchmark_now() - start;
+	}
+
+	g_memory_free(visibleIds);
+	vkb_bvh_free(bvh);
+	g_memory_free(bounds);
+	return elapsed * 1000.0 / iterations;
+}
+
+static double cullScalarMs()
+{
+	return timeCull(vkb_TransformKernel::Scalar);
+}
+
+static double cullBestMs()
+{
+	return timeCull(vkb_TransformKernel::Best);
+}
+
+// Every box against every plane, what culling costs without the BVH
+static double cullLinearMs()
+{
+	vkb_Aabb* bounds = createScene();
+	vkb_Frustum frustum = benchmarkFrustum();
+	uint32* visibleIds = (uint32*)g_memory_allocate(sizeof(uint32) * numObjects);
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < iterations; i++)
+	{
+		uint32 count = 0;
+		for (uint32 object = 0; object < numObjects; object++)
+		{
+			const vkb_Aabb& box = bounds[object];
+			bool outside = false;
+			for (uint32 p = 0; p < 6 && !outside; p++)
+			{
+				const glm::vec4& plane = frustum.planes[p];
+				float positive = plane.w +
+					plane.x * (plane.x >= 0.0f ? box.max.x : box.min.x) +
+					plane.y * (plane.y >= 0.0f ? box.max.y : box.min.y) +
+					plane.z * (plane.z >= 0.0f ? box.max.z : box.min.z);
+				outside = positive < 0.0f;
+			}
+			visibleIds[count] = object;
+			count += outside ? 0 : 1;
+		}
+	}
+	double elapsed = vkb_benchmark_now() - start;
+
+	g_memory_free(visibleIds);
+	g_memory_free(bounds);
+	return elapsed * 1000.0 / iterations;
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerBvhScenarios()
+{
+	vkb_benchmark_register("bvh_build_1m", "ms", false, false, buildMs);
+	vkb_benchmark_register("bvh_refit_10k_dynamic", "ms", false, false, refitDynamicMs);
+	vkb_benchmark_register("bvh_cull_scalar", "ms", false, false, cullScalarMs);
+	vkb_benchmark_register("bvh_cull_simd", "ms", false, false, cullBestMs);
+	vkb_benchmark_register("bvh_cull_linear", "ms", false, false, cullLinearMs);
+}
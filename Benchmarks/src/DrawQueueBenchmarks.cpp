@@ -0,0 +1,62 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/DrawQueue.h"
+
+// ------------ Internal Variables ------------
+static constexpr uint32 numDraws = 1000000;
+static constexpr uint32 numPipelines = 32;
+static constexpr uint32 numMaterials = 512;
+static constexpr uint32 numMeshes = 4096;
+static constexpr uint32 iterations = 5;
+
+// ------------ Internal Functions ------------
+static uint32 nextRandom(uint32* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+// Keys spread like a scene's would be: few pipelines, more materials, many meshes
+static void fillQueue(vkb_DrawQueue& queue)
+{
+	uint32 state = 0x9E3779B9;
+	vkb_DrawCommand draw = {};
+	draw.vertexCount = 3;
+	draw.instanceCount = 1;
+
+	vkb_drawQueue_clear(queue);
+	for (uint32 i = 0; i < numDraws; i++)
+	{
+		uint32 pass = nextRandom(&state) % 3;
+		uint32 pipeline = nextRandom(&state) % numPipelines;
+		uint32 material = nextRandom(&state) % numMaterials;
+		uint32 mesh = nextRandom(&state) % numMeshes;
+		float depth = (float)(nextRandom(&state) & 0xFFFF) / 65535.0f;
+		vkb_drawQueue_push(queue, vkb_drawKey_make(pass, pipeline, material, mesh, depth), draw);
+	}
+}
+
+static double sortMillionKeysPerSecond()
+{
+	vkb_DrawQueue queue = vkb_drawQueue_create(numDraws);
+
+	double elapsed = 0.0;
+	for (uint32 i = 0; i < iterations; i++)
+	{
+		fillQueue(queue);
+
+		double start = vkb_benchmark_now();
+		vkb_drawQueue_sort(queue);
+		elapsed += vkb_benchmark_now() - start;
+	}
+
+	vkb_drawQueue_free(queue);
+	return (double)numDraws * iterations / elapsed / 1000000.0;
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerDrawQueueScenarios()
+{
+	vkb_benchmark_register("draw_queue_sort_1m", "Mkeys/s", true, false, sortMillionKeysPerSecond);
+}
@@ -0,0 +1,102 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/JobSystem.h"
+
+// ------------ Internal Variables ------------
+static constexpr uint32 numItems = 1 << 20;
+static constexpr uint32 itemBatchSize = 1024;
+static constexpr uint32 numEmptyJobs = 2048;
+static constexpr uint32 emptyJobRounds = 100;
+
+static float* itemResults = nullptr;
+
+// ------------ Internal Functions ------------
+// Enough ALU work per item that the scheduler isn't the bottleneck
+static void computeItems(uint32 start, uint32 end, void*)
+{
+	for (uint32 i = start; i < end; i++)
+	{
+		uint32 state = i * 2654435761u + 1;
+		float value = 0.0f;
+		for (uint32 j = 0; j < 64; j++)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			value = value * 0.5f + (float)(state & 0xFFFF);
+		}
+		itemResults[i] = value;
+	}
+}
+
+static void emptyJob(void*)
+{
+}
+
+// Runs on NumThreads threads, the calling one helps while it waits and the
+// rest are workers. The others sit the scenario out.
+template<uint32 NumThreads>
+static double parallelForMitemsPerSecond()
+{
+	vkb_jobs_setActiveWorkers(NumThreads - 1);
+	itemResults = (float*)g_memory_allocate(sizeof(float) * numItems);
+
+	double start = vkb_benchmark_now();
+	vkb_JobCounter counter = {};
+	vkb_jobs_parallelFor(numItems, itemBatchSize, computeItems, nullptr, &counter);
+	vkb_jobs_wait(&counter);
+	double elapsed = vkb_benchmark_now() - start;
+
+	g_memory_free(itemResults);
+	itemResults = nullptr;
+	vkb_jobs_setActiveWorkers(vkb_jobs_numThreads() - 1);
+
+	return numItems / elapsed / 1000000.0;
+}
+
+static double emptyJobMicroseconds()
+{
+	double start = vkb_benchmark_now();
+	for (uint32 round = 0; round < emptyJobRounds; round++)
+	{
+		vkb_JobCounter counter = {};
+		for (uint32 i = 0; i < numEmptyJobs; i++)
+		{
+			vkb_jobs_run(emptyJob, nullptr, &counter);
+		}
+		vkb_jobs_wait(&counter);
+	}
+	double elapsed = vkb_benchmark_now() - start;
+
+	return elapsed * 1000000.0 / (emptyJobRounds * numEmptyJobs);
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerJobScenarios()
+{
+	struct Scenario
+	{
+		const char* name;
+		uint32 numThreads;
+		vkb_BenchmarkFn fn;
+	};
+
+	static const Scenario scalingScenarios[] = {
+		{ "jobs_parallel_for_1t", 1, parallelForMitemsPerSecond<1> },
+		{ "jobs_parallel_for_2t", 2, parallelForMitemsPerSecond<2> },
+		{ "jobs_parallel_for_4t", 4, parallelForMitemsPerSecond<4> },
+		{ "jobs_parallel_for_8t", 8, parallelForMitemsPerSecond<8> },
+		{ "jobs_parallel_for_16t", 16, parallelForMitemsPerSecond<16> },
+		{ "jobs_parallel_for_32t", 32, parallelForMitemsPerSecond<32> },
+	};
+
+	// Only scale up to the scheduler's threads, which vkb_jobs_init sizes to the machine
+	for (const Scenario& scenario : scalingScenarios)
+	{
+		if (scenario.numThreads <= vkb_jobs_numThreads())
+		{
+			vkb_benchmark_register(scenario.name, "Mitems/s", true, false, scenario.fn);
+		}
+	}
+
+	vkb_benchmark_register("jobs_empty_job_overhead", "us/job", false, false, emptyJobMicroseconds);
+}
@@ -0,0 +1,79 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/App.h"
+
+// ------------ Internal Variables ------------
+static constexpr uint32 warmupFrames = 10;
+static constexpr uint32 measuredFrames = 100;
+
+// ------------ Internal Functions ------------
+// Average GPU time of the cull pass plus the lit draws in milliseconds. Skips
+// if the device can't light or the queue can't write timestamps.
+static double lightingMs(uint32 numLights)
+{
+	vkb_app_setClusteredLighting(true);
+	if (!vkb_app_getConfig().clusteredLighting)
+	{
+		vkb_benchmark_skip("clustered lighting isn't supported");
+		return 0.0;
+	}
+	vkb_app_setLightCount(numLights);
+	vkb_app_setRetainedCommandBuffers(false);
+
+	for (uint32 i = 0; i < warmupFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+
+	double gpuMs = 0.0;
+	bool timingSupported = true;
+	for (uint32 i = 0; i < measuredFrames; i++)
+	{
+		vkb_app_drawFrame();
+
+		// Stats trail by a frame, which doesn't matter once the light count is steady
+		vkb_ClusteredLightingStats stats = vkb_app_getLightingStats();
+		timingSupported = timingSupported && stats.timingSupported;
+		gpuMs += stats.cullMs + stats.shadingMs;
+	}
+	vkb_app_waitIdle();
+
+	vkb_app_setRetainedCommandBuffers(true);
+	vkb_app_setClusteredLighting(false);
+
+	if (!timingSupported)
+	{
+		vkb_benchmark_skip("the queue can't write timestamps");
+		return 0.0;
+	}
+	return gpuMs / measuredFrames;
+}
+
+static double lightingMs100()
+{
+	return lightingMs(100);
+}
+
+static double lightingMs1000()
+{
+	return lightingMs(1000);
+}
+
+static double lightingMs5000()
+{
+	return lightingMs(5000);
+}
+
+static double lightingMs10000()
+{
+	return lightingMs(10000);
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerLightingScenarios()
+{
+	vkb_benchmark_register("lighting_gpu_ms_100", "ms", false, true, lightingMs100);
+	vkb_benchmark_register("lighting_gpu_ms_1000", "ms", false, true, lightingMs1000);
+	vkb_benchmark_register("lighting_gpu_ms_5000", "ms", false, true, lightingMs5000);
+	vkb_benchmark_register("lighting_gpu_ms_10000", "ms", false, true, lightingMs10000);
+}
@@ -0,0 +1,273 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/Mesh.h"
+#include "VulkanBegins/MeshLod.h"
+#include "VulkanBegins/MeshSimplify.h"
+#include "VulkanBegins/Transforms.h"
+#include "VulkanBegins/App.h"
+
+#include <math.h>
+
+// ------------ Internal Variables ------------
+static constexpr uint32 numInstances = 100000;
+static constexpr uint32 sphereStacks = 64;
+static constexpr uint32 sphereSlices = 128;
+static constexpr uint32 cubeCells = 16;
+static constexpr uint32 iterations = 20;
+static constexpr uint32 warmupFrames = 10;
+static constexpr uint32 measuredFrames = 100;
+
+// ------------ Internal Functions ------------
+// UV sphere with a uv seam down one side, 2 * stacks * slices triangles
+static vkb_MeshData createSphere()
+{
+	vkb_MeshData mesh = vkb_mesh_create((sphereStacks + 1) * (sphereSlices + 1), sphereStacks * sphereSlices * 6);
+	const float pi = 3.14159265f;
+
+	uint32 vertex = 0;
+	for (uint32 stack = 0; stack <= sphereStacks; stack++)
+	{
+		float theta = pi * (float)stack / (float)sphereStacks;
+		for (uint32 slice = 0; slice <= sphereSlices; slice++)
+		{
+			// The last column shares the first one's positions exactly
+			float phi = 2.0f * pi * (float)(slice % sphereSlices) / (float)sphereSlices;
+			vkb_MeshVertex& dst = mesh.vertices[vertex++];
+			dst.position[0] = stack == 0 || stack == sphereStacks ? 0.0f : sinf(theta) * cosf(phi);
+			dst.position[1] = cosf(theta);
+			dst.position[2] = stack == 0 || stack == sphereStacks ? 0.0f : sinf(theta) * sinf(phi);
+			dst.normal[0] = dst.position[0];
+			dst.normal[1] = dst.position[1];
+			dst.normal[2] = dst.position[2];
+			dst.uv[0] = (float)slice / (float)sphereSlices;
+			dst.uv[1] = (float)stack / (float)sphereStacks;
+		}
+	}
+
+	uint32 index = 0;
+	for (uint32 stack = 0; stack < sphereStacks; stack++)
+	{
+		for (uint32 slice = 0; slice < sphereSlices; slice++)
+		{
+			uint32 a = stack * (sphereSlices + 1) + slice;
+			uint32 b = a + sphereSlices + 1;
+			mesh.indices[index++] = a;
+			mesh.indices[index++] = b;
+			mesh.indices[index++] = a + 1;
+			mesh.indices[index++] = a + 1;
+			mesh.indices[index++] = b;
+			mesh.indices[index++] = b + 1;
+		}
+	}
+
+	vkb_mesh_computeBounds(mesh);
+	return mesh;
+}
+
+// Flat-shaded cube, each face a cells x cells grid with its own vertices, so
+// every edge of the cube is a normal seam and every corner is where three meet
+static vkb_MeshData createFlatCube()
+{
+	const uint32 faceVertices = (cubeCells + 1) * (cubeCells + 1);
+	vkb_MeshData mesh = vkb_mesh_create(6 * faceVertices, 6 * cubeCells * cubeCells * 6);
+
+	uint32 vertex = 0;
+	uint32 index = 0;
+	for (uint32 face = 0; face < 6; face++)
+	{
+		// Face normal along one axis, u and v along the other two with u x v = normal
+		uint32 axis = face / 2;
+		float sign = face % 2 == 0 ? 1.0f : -1.0f;
+		uint32 uAxis = (axis + 1) % 3;
+		uint32 vAxis = (axis + 2) % 3;
+
+		uint32 first = vertex;
+		for (uint32 row = 0; row <= cubeCells; row++)
+		{
+			for (uint32 column = 0; column <= cubeCells; column++)
+			{
+				vkb_MeshVertex& dst = mesh.vertices[vertex++];
+				float u = (float)column / (float)cubeCells;
+				float v = (float)row / (float)cubeCells;
+				dst.position[axis] = sign;
+				dst.position[uAxis] = (u * 2.0f - 1.0f) * sign;
+				dst.position[vAxis] = v * 2.0f - 1.0f;
+				dst.normal[axis] = sign;
+				dst.normal[uAxis] = 0.0f;
+				dst.normal[vAxis] = 0.0f;
+				dst.uv[0] = u;
+				dst.uv[1] = v;
+			}
+		}
+
+		for (uint32 row = 0; row < cubeCells; row++)
+		{
+			for (uint32 column = 0; column < cubeCells; column++)
+			{
+				uint32 a = first + row * (cubeCells + 1) + column;
+				uint32 b = a + cubeCells + 1;
+				mesh.indices[index++] = a;
+				mesh.indices[index++] = a + 1;
+				mesh.indices[index++] = b;
+				mesh.indices[index++] = a + 1;
+				mesh.indices[index++] = b + 1;
+				mesh.indices[index++] = b;
+			}
+		}
+	}
+
+	vkb_mesh_computeBounds(mesh);
+	return mesh;
+}
+
+static double simplifySphereMs()
+{
+	double elapsed = 0.0;
+	for (uint32 i = 0; i < 3; i++)
+	{
+		vkb_MeshData mesh = createSphere();
+
+		double start = vkb_benchmark_now();
+		vkb_meshSimplify_generateLods(mesh, vkb_maxMeshLods, 0.5f, 64);
+		elapsed += vkb_benchmark_now() - start;
+
+		vkb_mesh_free(mesh);
+	}
+	return elapsed * 1000.0 / 3.0;
+}
+
+// Triangles in the coarsest LOD of the flat-shaded cube. Its faces are flat, so
+// this only stays at the full count if the seams between them stop collapses.
+static double flatCubeLodTriangles()
+{
+	vkb_MeshData mesh = createFlatCube();
+	uint32 fullTriangles = mesh.numIndices / 3;
+	vkb_meshSimplify_generateLods(mesh, vkb_maxMeshLods, 0.5f, 12);
+	uint32 lodTriangles = mesh.lods[mesh.numLods - 1].indexCount / 3;
+	vkb_mesh_free(mesh);
+
+	if (lodTriangles >= fullTriangles)
+	{
+		g_logger_error("Simplifying the flat-shaded cube didn't remove any of its %u triangles.", fullTriangles);
+		return 0.0;
+	}
+	return (double)lodTriangles;
+}
+
+// A field of spheres stretching away from the camera so every LOD gets used
+static double bucketMillionInstancesPerSecond()
+{
+	vkb_MeshData mesh = createSphere();
+	vkb_meshSimplify_generateLods(mesh, vkb_maxMeshLods, 0.5f, 64);
+
+	vkb_TransformSystem transforms = vkb_transforms_create(numInstances);
+	for (uint32 i = 0; i < numInstances; i++)
+	{
+		glm::vec3 position((float)(i % 100) * 3.0f - 150.0f, 0.0f, -(float)(i / 100) * 3.0f);
+		vkb_transforms_add(transforms, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+	}
+
+	vkb_MeshLodView view = {};
+	view.cameraPosition = glm::vec3(0.0f, 5.0f, 10.0f);
+	view.fovY = 1.0f;
+	view.viewportHeight = 1080.0f;
+	view.maxPixelError = 1.0f;
+
+	uint32* instanceOrder = (uint32*)g_memory_allocate(sizeof(uint32) * numInstances);
+	uint32 lodOffsets[vkb_maxMeshLods + 1];
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < iterations; i++)
+	{
+		vkb_meshLod_bucketInstances(mesh, transforms, view, instanceOrder, lodOffsets, nullptr);
+	}
+	double elapsed = vkb_benchmark_now() - start;
+
+	g_memory_free(instanceOrder);
+	vkb_transforms_free(transforms);
+	vkb_mesh_free(mesh);
+	return (double)numInstances * iterations / elapsed / 1000000.0;
+}
+
+// Turns on the app's instanced scene drawn with the sphere's LODs. Returns
+// false if no frame drew any mesh instances.
+static bool beginSceneMesh()
+{
+	vkb_MeshData mesh = createSphere();
+	// The scene places instances sized for its triangle, which fits in a radius of about 0.5
+	for (uint32 i = 0; i < mesh.numVertices; i++)
+	{
+		mesh.vertices[i].position[0] *= 0.5f;
+		mesh.vertices[i].position[1] *= 0.5f;
+		mesh.vertices[i].position[2] *= 0.5f;
+	}
+	vkb_mesh_computeBounds(mesh);
+	vkb_meshSimplify_generateLods(mesh, vkb_maxMeshLods, 0.5f, 64);
+
+	// The app keeps its own copy on the GPU
+	vkb_app_setSceneMesh(&mesh);
+	vkb_mesh_free(mesh);
+	vkb_app_setInstancedScene(true);
+
+	for (uint32 i = 0; i < warmupFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+
+	if (vkb_app_getMeshLodStats().numInstances == 0)
+	{
+		g_logger_error("The scene mesh didn't draw any instances.");
+		return false;
+	}
+	return true;
+}
+
+static void endSceneMesh()
+{
+	vkb_app_setInstancedScene(false);
+	vkb_app_setSceneMesh(nullptr);
+}
+
+static double sceneMeshFrameTimeMs()
+{
+	if (!beginSceneMesh())
+	{
+		endSceneMesh();
+		return 0.0;
+	}
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < measuredFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+	double frameTime = (vkb_benchmark_now() - start) / measuredFrames;
+
+	endSceneMesh();
+	return frameTime * 1000.0;
+}
+
+// Triangles one frame of the scene draws, out of trianglesFullDetail at LOD 0
+static double sceneMeshTriangles()
+{
+	if (!beginSceneMesh())
+	{
+		endSceneMesh();
+		return 0.0;
+	}
+
+	vkb_MeshLodStats stats = vkb_app_getMeshLodStats();
+	endSceneMesh();
+	return (double)stats.trianglesDrawn;
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerMeshLodScenarios()
+{
+	vkb_benchmark_register("mesh_simplify_sphere", "ms", false, false, simplifySphereMs);
+	vkb_benchmark_register("mesh_simplify_flat_cube_triangles", "triangles", false, false, flatCubeLodTriangles);
+	vkb_benchmark_register("mesh_lod_bucket", "Minst/s", true, false, bucketMillionInstancesPerSecond);
+	vkb_benchmark_register("mesh_lod_scene_frame_time", "ms", false, true, sceneMeshFrameTimeMs);
+	vkb_benchmark_register("mesh_lod_scene_triangles", "triangles", false, true, sceneMeshTriangles);
+}
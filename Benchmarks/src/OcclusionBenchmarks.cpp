@@ -0,0 +1,73 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/App.h"
+#include "VulkanBegins/OcclusionCulling.h"
+
+// ------------ Internal Variables ------------
+static constexpr uint32 warmupFrames = 10;
+static constexpr uint32 measuredFrames = 100;
+
+// ------------ Internal Functions ------------
+// Returns false if the device can't cull, the scenario should skip then
+static bool beginOcclusion()
+{
+	vkb_app_setOcclusionCulling(true);
+	if (!vkb_app_getConfig().occlusionCulling)
+	{
+		return false;
+	}
+
+	// The culler's stats trail the GPU by a frame
+	for (uint32 i = 0; i < warmupFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+	return true;
+}
+
+static double occlusionFrameTimeMs()
+{
+	if (!beginOcclusion())
+	{
+		vkb_benchmark_skip("occlusion culling isn't supported");
+		return 0.0;
+	}
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < measuredFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+	double frameTime = (vkb_benchmark_now() - start) / measuredFrames;
+
+	vkb_app_setOcclusionCulling(false);
+	return frameTime * 1000.0;
+}
+
+// Instances the Hi-Z test rejected behind the scene's occluder wall
+static double occludedInstances()
+{
+	if (!beginOcclusion())
+	{
+		vkb_benchmark_skip("occlusion culling isn't supported");
+		return 0.0;
+	}
+
+	vkb_OcclusionStats stats = vkb_app_getOcclusionStats();
+	vkb_app_setOcclusionCulling(false);
+
+	if (stats.numOccluded == 0)
+	{
+		g_logger_error("Occlusion culling didn't cull anything out of %d instances.", stats.numInstances);
+		return 0.0;
+	}
+	return (double)stats.numOccluded;
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerOcclusionScenarios()
+{
+	vkb_benchmark_register("occlusion_frame_time", "ms", false, true, occlusionFrameTimeMs);
+	vkb_benchmark_register("occlusion_occluded_instances", "instances", true, true, occludedInstances);
+}
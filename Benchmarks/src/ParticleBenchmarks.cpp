@@ -0,0 +1,54 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/App.h"
+
+// ------------ Internal Variables ------------
+// Long enough for the fountain to fill up to its steady state
+static constexpr uint32 warmupFrames = 120;
+static constexpr uint32 measuredFrames = 100;
+
+// ------------ Internal Functions ------------
+// Average GPU time of the compute passes plus the draw in milliseconds, with
+// the app's default million particles. Skips if the device can't run them or
+// the queue can't write timestamps.
+static double particlesGpuMs()
+{
+	vkb_app_setParticles(true);
+	if (!vkb_app_getConfig().particles)
+	{
+		vkb_benchmark_skip("GPU particles aren't supported");
+		return 0.0;
+	}
+
+	for (uint32 i = 0; i < warmupFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+
+	double gpuMs = 0.0;
+	bool timingSupported = true;
+	for (uint32 i = 0; i < measuredFrames; i++)
+	{
+		vkb_app_drawFrame();
+
+		vkb_ParticleStats stats = vkb_app_getParticleStats();
+		timingSupported = timingSupported && stats.timingSupported;
+		gpuMs += stats.simulateMs + stats.drawMs;
+	}
+	vkb_app_waitIdle();
+
+	vkb_app_setParticles(false);
+
+	if (!timingSupported)
+	{
+		vkb_benchmark_skip("the queue can't write timestamps");
+		return 0.0;
+	}
+	return gpuMs / measuredFrames;
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerParticleScenarios()
+{
+	vkb_benchmark_register("particles_1m_gpu_ms", "ms", false, true, particlesGpuMs);
+}
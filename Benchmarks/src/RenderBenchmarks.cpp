@@ -0,0 +1,217 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/App.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/FrameCapture.h"
+
+// ------------ Internal Variables ------------
+static constexpr uint32 warmupFrames = 10;
+static constexpr uint32 measuredFrames = 100;
+static constexpr uint32 drawsPerFrame = 10000;
+// Pipeline, viewport and scissor
+static constexpr uint32 stateChangesPerDraw = 3;
+static constexpr VkDeviceSize uploadBufferSize = 64 * 1024 * 1024;
+static constexpr uint32 numUploads = 8;
+static constexpr uint32 defaultWidth = 1280;
+static constexpr uint32 defaultHeight = 720;
+// Every one is written to disk, keep it short
+static constexpr uint32 capturedFrames = 30;
+
+// ------------ Internal Functions ------------
+// Returns the average frame time in seconds
+static double timeFrames(uint32 numFrames)
+{
+	for (uint32 i = 0; i < warmupFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < numFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+
+	return (vkb_benchmark_now() - start) / numFrames;
+}
+
+// Records every frame, so this measures command recording throughput
+static double drawsPerSecond()
+{
+	vkb_app_setRetainedCommandBuffers(false);
+	vkb_app_setDrawsPerFrame(drawsPerFrame, false);
+	double frameTime = timeFrames(measuredFrames);
+	vkb_app_setDrawsPerFrame(1, false);
+	vkb_app_setRetainedCommandBuffers(true);
+
+	return drawsPerFrame / frameTime;
+}
+
+// Same frames, but recorded once per image and resubmitted after that
+static double drawsPerSecondRetained()
+{
+	vkb_app_setDrawsPerFrame(drawsPerFrame, false);
+	double frameTime = timeFrames(measuredFrames);
+	vkb_app_setDrawsPerFrame(1, false);
+
+	return drawsPerFrame / frameTime;
+}
+
+static double stateChangesPerSecond()
+{
+	vkb_app_setRetainedCommandBuffers(false);
+	vkb_app_setDrawsPerFrame(drawsPerFrame, true);
+	double frameTime = timeFrames(measuredFrames);
+	vkb_app_setDrawsPerFrame(1, false);
+	vkb_app_setRetainedCommandBuffers(true);
+
+	return (drawsPerFrame * stateChangesPerDraw) / frameTime;
+}
+
+static double uploadMegabytesPerSecond()
+{
+	const vkb_Context& ctx = vkb_app_getContext();
+	vkb_Buffer dst = vkb_buffer_create(ctx, uploadBufferSize,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	uint8* data = (uint8*)g_memory_allocate(uploadBufferSize);
+	for (VkDeviceSize i = 0; i < uploadBufferSize; i++)
+	{
+		data[i] = (uint8)(i * 31);
+	}
+
+	// Warm up so the first flush doesn't pay for page faults in the staging buffer
+	vkb_staging_upload(ctx, dst, 0, data, uploadBufferSize);
+	vkb_staging_flush(ctx);
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < numUploads; i++)
+	{
+		vkb_staging_upload(ctx, dst, 0, data, uploadBufferSize);
+	}
+	vkb_staging_flush(ctx);
+	double elapsed = vkb_benchmark_now() - start;
+
+	g_memory_free(data);
+	vkb_buffer_free(ctx, dst);
+
+	return (numUploads * (double)uploadBufferSize / (1024.0 * 1024.0)) / elapsed;
+}
+
+static double pipelineCreateColdMs()
+{
+	double coldMs = vkb_app_rebuildPipeline(false);
+	// The cold build leaves the variants without a pipeline cache, later scenarios need it back
+	vkb_app_rebuildPipeline(true);
+	return coldMs;
+}
+
+static double pipelineCreateCachedMs()
+{
+	// Make sure the cache has seen this pipeline before timing the hit
+	vkb_app_rebuildPipeline(true);
+	return vkb_app_rebuildPipeline(true);
+}
+
+static double frameTimeMsAt(uint32 width, uint32 height)
+{
+	vkb_app_resize(width, height);
+	double frameTime = timeFrames(measuredFrames);
+	vkb_app_resize(defaultWidth, defaultHeight);
+
+	return frameTime * 1000.0;
+}
+
+static double frameTimeMs720p()
+{
+	return frameTimeMsAt(1280, 720);
+}
+
+static double frameTimeMs1080p()
+{
+	return frameTimeMsAt(1920, 1080);
+}
+
+static double frameTimeMs1440p()
+{
+	return frameTimeMsAt(2560, 1440);
+}
+
+static double frameTimeMs2160p()
+{
+	return frameTimeMsAt(3840, 2160);
+}
+
+// Same frames as frame_time_2160p, with the scene rendered at whatever scale
+// keeps the GPU under the dynamic resolution target and blitted up
+static double dynamicResolutionFrameTimeMs2160p()
+{
+	vkb_app_setDynamicResolution(true);
+	if (!vkb_app_getConfig().dynamicResolution)
+	{
+		vkb_benchmark_skip("dynamic resolution isn't supported");
+		return 0.0;
+	}
+
+	double frameTimeMs = frameTimeMsAt(3840, 2160);
+	vkb_app_setDynamicResolution(false);
+
+	return frameTimeMs;
+}
+
+// The scale the controller settles on for the scene above
+static double dynamicResolutionScale2160p()
+{
+	vkb_app_setDynamicResolution(true);
+	if (!vkb_app_getConfig().dynamicResolution)
+	{
+		vkb_benchmark_skip("dynamic resolution isn't supported");
+		return 0.0;
+	}
+
+	vkb_app_resize(3840, 2160);
+	timeFrames(measuredFrames);
+	double scale = vkb_app_getRenderScale();
+	vkb_app_resize(defaultWidth, defaultHeight);
+	vkb_app_setDynamicResolution(false);
+
+	return scale;
+}
+
+// Frames per second while every frame is read back and written out
+static double captureFramesPerSecond()
+{
+	uint32 capturedBefore = vkb_frameCapture_getStats().numCaptured;
+	vkb_app_setFrameCapture(true);
+	double frameTime = timeFrames(capturedFrames);
+	vkb_app_setFrameCapture(false);
+
+	uint32 numCaptured = vkb_frameCapture_getStats().numCaptured - capturedBefore;
+	if (numCaptured == 0)
+	{
+		g_logger_error("Frame capture didn't capture any frames.");
+		return 0.0;
+	}
+	return 1.0 / frameTime;
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerRenderScenarios()
+{
+	vkb_benchmark_register("draws_per_second", "draws/s", true, true, drawsPerSecond);
+	vkb_benchmark_register("draws_per_second_retained", "draws/s", true, true, drawsPerSecondRetained);
+	vkb_benchmark_register("state_changes_per_second", "changes/s", true, true, stateChangesPerSecond);
+	vkb_benchmark_register("staging_upload", "MB/s", true, true, uploadMegabytesPerSecond);
+	vkb_benchmark_register("pipeline_create_cold", "ms", false, true, pipelineCreateColdMs);
+	vkb_benchmark_register("pipeline_create_cached", "ms", false, true, pipelineCreateCachedMs);
+	vkb_benchmark_register("frame_time_720p", "ms", false, true, frameTimeMs720p);
+	vkb_benchmark_register("frame_time_1080p", "ms", false, true, frameTimeMs1080p);
+	vkb_benchmark_register("frame_time_1440p", "ms", false, true, frameTimeMs1440p);
+	vkb_benchmark_register("frame_time_2160p", "ms", false, true, frameTimeMs2160p);
+	vkb_benchmark_register("dynamic_resolution_frame_time_2160p", "ms", false, true, dynamicResolutionFrameTimeMs2160p);
+	vkb_benchmark_register("dynamic_resolution_scale_2160p", "scale", true, true, dynamicResolutionScale2160p);
+	vkb_benchmark_register("frame_capture_fps", "frames/s", true, true, captureFramesPerSecond);
+}
@@ -0,0 +1,90 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/App.h"
+
+// ------------ Internal Variables ------------
+// Long enough for every image to be uploaded, so no sprite is skipped
+static constexpr uint32 warmupFrames = 30;
+static constexpr uint32 measuredFrames = 100;
+static constexpr uint32 numSprites = 10000;
+
+// ------------ Internal Functions ------------
+// Returns false if the device can't draw sprites, the scenario should skip then
+static bool beginSprites()
+{
+	vkb_app_setSprites(true, numSprites);
+	if (!vkb_app_getConfig().sprites)
+	{
+		return false;
+	}
+
+	for (uint32 i = 0; i < warmupFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+	return true;
+}
+
+// The last warmup frame's stats, then turns the sprites back off
+static vkb_SpriteStats endSprites()
+{
+	vkb_SpriteStats stats = vkb_app_getSpriteStats();
+	vkb_app_setSprites(false, numSprites);
+
+	g_logger_assert(stats.numSprites > 0, "No sprites were drawn out of the %d asked for.", numSprites);
+	return stats;
+}
+
+// Average wall time of a frame drawing numSprites sprites in milliseconds
+static double spritesFrameMs()
+{
+	if (!beginSprites())
+	{
+		vkb_benchmark_skip("sprites aren't supported");
+		return 0.0;
+	}
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < measuredFrames; i++)
+	{
+		vkb_app_drawFrame();
+	}
+	vkb_app_waitIdle();
+	double wallMs = (vkb_benchmark_now() - start) * 1000.0;
+
+	endSprites();
+
+	return wallMs / measuredFrames;
+}
+
+// Draws the batcher issues for numSprites sprites
+static double spritesDrawsBatched()
+{
+	if (!beginSprites())
+	{
+		vkb_benchmark_skip("sprites aren't supported");
+		return 0.0;
+	}
+
+	return (double)endSprites().drawsAfterBatching;
+}
+
+// Draws numSprites sprites would take unbatched, one per resident sprite
+static double spritesDrawsUnbatched()
+{
+	if (!beginSprites())
+	{
+		vkb_benchmark_skip("sprites aren't supported");
+		return 0.0;
+	}
+
+	return (double)endSprites().drawsBeforeBatching;
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerSpriteScenarios()
+{
+	vkb_benchmark_register("sprites_10k_frame_ms", "ms", false, true, spritesFrameMs);
+	vkb_benchmark_register("sprites_10k_draws", "draws", false, true, spritesDrawsBatched);
+	vkb_benchmark_register("sprites_10k_draws_unbatched", "draws", false, true, spritesDrawsUnbatched);
+}
@@ -0,0 +1,178 @@
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/Transforms.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/App.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// ------------ Internal structures ------------
+// What the transforms would look like without the SoA system
+struct NaiveTransform
+{
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 numObjects = 100000;
+static constexpr uint32 iterations = 20;
+
+// ------------ Internal Functions ------------
+static glm::mat4 benchmarkViewProj()
+{
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 10.0f, -50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	return proj * view;
+}
+
+static void fillTransform(uint32 i, glm::vec3* position, glm::quat* rotation, glm::vec3* scale)
+{
+	float angle = (float)i * 0.01f;
+	*position = glm::vec3((float)(i % 100), (float)((i / 100) % 100), (float)(i / 10000));
+	*rotation = glm::angleAxis(angle, glm::normalize(glm::vec3(0.3f, 1.0f, 0.2f)));
+	*scale = glm::vec3(1.0f + (float)(i % 3), 1.0f, 0.5f);
+}
+
+static vkb_TransformSystem createBenchmarkTransforms()
+{
+	vkb_TransformSystem transforms = vkb_transforms_create(numObjects);
+	for (uint32 i = 0; i < numObjects; i++)
+	{
+		glm::vec3 position, scale;
+		glm::quat rotation;
+		fillTransform(i, &position, &rotation, &scale);
+		vkb_transforms_add(transforms, position, rotation, scale);
+	}
+
+	return transforms;
+}
+
+// Returns milliseconds per pass over every object
+static double timeKernel(vkb_TransformKernel kernel, vkb_InstanceData* dst)
+{
+	vkb_TransformSystem transforms = createBenchmarkTransforms();
+	glm::mat4 viewProj = benchmarkViewProj();
+
+	vkb_transforms_computeInstances(transforms, viewProj, dst, kernel);
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < iterations; i++)
+	{
+		vkb_transforms_computeInstances(transforms, viewProj, dst, kernel);
+	}
+	double elapsed = vkb_benchmark_now() - start;
+
+	vkb_transforms_free(transforms);
+	return elapsed * 1000.0 / iterations;
+}
+
+static double timeKernelToHeap(vkb_TransformKernel kernel)
+{
+	vkb_InstanceData* dst = (vkb_InstanceData*)g_memory_allocate(sizeof(vkb_InstanceData) * numObjects);
+	double result = timeKernel(kernel, dst);
+	g_memory_free(dst);
+	return result;
+}
+
+static double glmNaiveMs()
+{
+	NaiveTransform* transforms = (NaiveTransform*)g_memory_allocate(sizeof(NaiveTransform) * numObjects);
+	for (uint32 i = 0; i < numObjects; i++)
+	{
+		fillTransform(i, &transforms[i].position, &transforms[i].rotation, &transforms[i].scale);
+	}
+
+	vkb_InstanceData* dst = (vkb_InstanceData*)g_memory_allocate(sizeof(vkb_InstanceData) * numObjects);
+	glm::mat4 viewProj = benchmarkViewProj();
+
+	double start = vkb_benchmark_now();
+	for (uint32 iteration = 0; iteration < iterations; iteration++)
+	{
+		for (uint32 i = 0; i < numObjects; i++)
+		{
+			const NaiveTransform& transform = transforms[i];
+			glm::mat4 world = glm::translate(glm::mat4(1.0f), transform.position) *
+				glm::mat4_cast(transform.rotation) *
+				glm::scale(glm::mat4(1.0f), transform.scale);
+			dst[i].world = world;
+			dst[i].worldViewProj = viewProj * world;
+		}
+	}
+	double elapsed = vkb_benchmark_now() - start;
+
+	g_memory_free(dst);
+	g_memory_free(transforms);
+	return elapsed * 1000.0 / iterations;
+}
+
+static double scalarMs()
+{
+	return timeKernelToHeap(vkb_TransformKernel::Scalar);
+}
+
+static double sseMs()
+{
+	if (!vkb_transforms_isKernelSupported(vkb_TransformKernel::SSE))
+	{
+		g_logger_warning("SSE transform kernel isn't supported, timing the scalar fallback.");
+		return timeKernelToHeap(vkb_TransformKernel::Scalar);
+	}
+
+	return timeKernelToHeap(vkb_TransformKernel::SSE);
+}
+
+static double avx2Ms()
+{
+	if (!vkb_transforms_isKernelSupported(vkb_TransformKernel::AVX2))
+	{
+		g_logger_warning("AVX2 transform kernel isn't supported, timing the best available kernel.");
+	}
+
+	return timeKernelToHeap(vkb_TransformKernel::Best);
+}
+
+static double parallelMs()
+{
+	vkb_TransformSystem transforms = createBenchmarkTransforms();
+	vkb_InstanceData* dst = (vkb_InstanceData*)g_memory_allocate(sizeof(vkb_InstanceData) * numObjects);
+	glm::mat4 viewProj = benchmarkViewProj();
+
+	vkb_transforms_computeInstancesParallel(transforms, viewProj, dst);
+
+	double start = vkb_benchmark_now();
+	for (uint32 i = 0; i < iterations; i++)
+	{
+		vkb_transforms_computeInstancesParallel(transforms, viewProj, dst);
+	}
+	double elapsed = vkb_benchmark_now() - start;
+
+	g_memory_free(dst);
+	vkb_transforms_free(transforms);
+	return elapsed * 1000.0 / iterations;
+}
+
+static double mappedInstanceBufferMs()
+{
+	const vkb_Context& ctx = vkb_app_getContext();
+	vkb_Buffer instanceBuffer = vkb_buffer_create(ctx, sizeof(vkb_InstanceData) * numObjects,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	double result = timeKernel(vkb_TransformKernel::Best, (vkb_InstanceData*)instanceBuffer.mapped);
+
+	vkb_buffer_free(ctx, instanceBuffer);
+	return result;
+}
+
+// ------------ Public Functions ------------
+void vkb_benchmark_registerTransformScenarios()
+{
+	vkb_benchmark_register("transforms_glm_naive", "ms/100k", false, false, glmNaiveMs);
+	vkb_benchmark_register("transforms_scalar", "ms/100k", false, false, scalarMs);
+	vkb_benchmark_register("transforms_sse", "ms/100k", false, false, sseMs);
+	vkb_benchmark_register("transforms_avx2", "ms/100k", false, false, avx2Ms);
+	vkb_benchmark_register("transforms_parallel", "ms/100k", false, false, parallelMs);
+	vkb_benchmark_register("transforms_mapped_buffer", "ms/100k", false, true, mappedInstanceBufferMs);
+}
@@ -0,0 +1,320 @@
+#include <cppUtils/cppUtils.hpp>
+#include "Benchmarks/Benchmark.h"
+#include "VulkanBegins/App.h"
+#include "VulkanBegins/File.h"
+#include "VulkanBegins/VulkanAllocator.h"
+#include "VulkanBegins/JobSystem.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+// Runs every registered scenario headless and compares it against a stored
+// baseline. On CI point the loader at lavapipe (VK_ICD_FILENAMES=.../lvp_icd.x86_64.json)
+// and set MESA_SHADER_CACHE_DISABLE=true so cold pipeline numbers stay cold.
+//
+//   Benchmarks [--baseline file] [--threshold 0.1] [--repeats 3] [--filter name] [--update-baseline] [--out file] [--capture-dir dir]
+//              [--capture-commands file] [--capture-frames 60]
+//
+// --capture-commands records the first rendering scenario's frames for Replay, pick
+// the scenario with --filter.
+//
+// Exits with 1 if any scenario regressed by more than the threshold.
+
+// ------------ Internal structures ------------
+struct BenchmarkOptions
+{
+	const char* baselineFilename;
+	const char* outputFilename;
+	const char* filter;
+	// Where frame_capture_fps writes its frames
+	const char* captureDirectory;
+	// Command stream of the first rendering scenario, nullptr to not capture one
+	const char* commandCaptureFilename;
+	uint32 commandCaptureFrames;
+	double threshold;
+	uint32 repeats;
+	bool updateBaseline;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 maxRepeats = 32;
+static constexpr uint32 benchmarkWidth = 1280;
+static constexpr uint32 benchmarkHeight = 720;
+
+// ------------ Internal Functions ------------
+static BenchmarkOptions parseOptions(int argc, char** argv)
+{
+	BenchmarkOptions options = {};
+	options.baselineFilename = "Benchmarks/baseline.json";
+	options.outputFilename = "benchmark_results.json";
+	options.filter = nullptr;
+	options.captureDirectory = ".";
+	options.commandCaptureFilename = nullptr;
+	options.commandCaptureFrames = 60;
+	options.threshold = 0.1;
+	options.repeats = 3;
+	options.updateBaseline = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--baseline") == 0 && hasValue)
+		{
+			options.baselineFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--out") == 0 && hasValue)
+		{
+			options.outputFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--filter") == 0 && hasValue)
+		{
+			options.filter = argv[++i];
+		}
+		else if (strcmp(argv[i], "--capture-dir") == 0 && hasValue)
+		{
+			options.captureDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--capture-commands") == 0 && hasValue)
+		{
+			options.commandCaptureFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--capture-frames") == 0 && hasValue)
+		{
+			options.commandCaptureFrames = (uint32)atoi(argv[++i]);
+			options.commandCaptureFrames = options.commandCaptureFrames < 1 ? 1 : options.commandCaptureFrames;
+		}
+		else if (strcmp(argv[i], "--threshold") == 0 && hasValue)
+		{
+			options.threshold = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--repeats") == 0 && hasValue)
+		{
+			options.repeats = (uint32)atoi(argv[++i]);
+			options.repeats = options.repeats < 1 ? 1 : (options.repeats > maxRepeats ? maxRepeats : options.repeats);
+		}
+		else if (strcmp(argv[i], "--update-baseline") == 0)
+		{
+			options.updateBaseline = true;
+		}
+		else
+		{
+			g_logger_warning("Unknown benchmark argument '%s'", argv[i]);
+		}
+	}
+
+	return options;
+}
+
+// The baseline is a flat JSON object of "scenario": score pairs, which is all
+// this looks for. Returns false if the scenario isn't in it.
+static bool findBaselineValue(const vkb_FileContents& baseline, const char* name, double* value)
+{
+	if (baseline.data == nullptr)
+	{
+		return false;
+	}
+
+	char key[128];
+	snprintf(key, sizeof(key), "\"%s\"", name);
+	size_t keyLength = strlen(key);
+
+	const char* text = (const char*)baseline.data;
+	for (uint32 i = 0; i + keyLength <= baseline.size; i++)
+	{
+		if (memcmp(text + i, key, keyLength) != 0)
+		{
+			continue;
+		}
+
+		uint32 cursor = i + (uint32)keyLength;
+		while (cursor < baseline.size && (text[cursor] == ' ' || text[cursor] == ':' || text[cursor] == '\t'))
+		{
+			cursor++;
+		}
+
+		// Copy out the number, the file contents aren't null terminated
+		char number[64];
+		uint32 length = 0;
+		while (cursor < baseline.size && length < sizeof(number) - 1 && strchr("0123456789+-.eE", text[cursor]) != nullptr)
+		{
+			number[length++] = text[cursor++];
+		}
+		number[length] = '\0';
+
+		if (length == 0)
+		{
+			return false;
+		}
+
+		*value = strtod(number, nullptr);
+		return true;
+	}
+
+	return false;
+}
+
+static void writeResults(const char* filename, const char** names, const double* scores, uint32 numResults)
+{
+	FILE* fp = fopen(filename, "wb");
+	if (fp == nullptr)
+	{
+		g_logger_error("Could not open file '%s' for writing", filename);
+		return;
+	}
+
+	fprintf(fp, "{\n");
+	for (uint32 i = 0; i < numResults; i++)
+	{
+		fprintf(fp, "  \"%s\": %.6g%s\n", names[i], scores[i], i + 1 < numResults ? "," : "");
+	}
+	fprintf(fp, "}\n");
+
+	fclose(fp);
+}
+
+// Returns false if the scenario skipped itself, skipReason says why
+static bool runScenario(const vkb_Benchmark& benchmark, uint32 repeats, double* score, const char** skipReason)
+{
+	// Median of the repeats, a single slow run shouldn't fail the job
+	double samples[maxRepeats];
+	for (uint32 i = 0; i < repeats; i++)
+	{
+		samples[i] = benchmark.fn();
+		*skipReason = vkb_benchmark_takeSkipReason();
+		if (*skipReason != nullptr)
+		{
+			return false;
+		}
+	}
+
+	std::sort(samples, samples + repeats);
+	*score = samples[repeats / 2];
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	g_memory_init(false);
+	vkb_jobs_init();
+
+	BenchmarkOptions options = parseOptions(argc, argv);
+
+	vkb_benchmark_registerRenderScenarios();
+	vkb_benchmark_registerTransformScenarios();
+	vkb_benchmark_registerJobScenarios();
+	vkb_benchmark_registerDrawQueueScenarios();
+	vkb_benchmark_registerMeshLodScenarios();
+	vkb_benchmark_registerBvhScenarios();
+	vkb_benchmark_registerOcclusionScenarios();
+	vkb_benchmark_registerLightingScenarios();
+	vkb_benchmark_registerParticleScenarios();
+	vkb_benchmark_registerSpriteScenarios();
+	vkb_benchmark_registerBindlessScenarios();
+
+	vkb_FileContents baseline = { nullptr, 0 };
+	if (!options.updateBaseline)
+	{
+		if (vkb_file_exists(options.baselineFilename))
+		{
+			baseline = vkb_file_read(options.baselineFilename);
+		}
+		else
+		{
+			g_logger_warning("No baseline at '%s', run with --update-baseline to record one.", options.baselineFilename);
+		}
+	}
+
+	uint32 numBenchmarks = vkb_benchmark_count();
+	const char** names = (const char**)g_memory_allocate(sizeof(const char*) * numBenchmarks);
+	double* scores = (double*)g_memory_allocate(sizeof(double) * numBenchmarks);
+	uint32 numResults = 0;
+	uint32 numRegressions = 0;
+	bool rendererInitialized = false;
+	bool commandCaptureRequested = false;
+
+	for (uint32 i = 0; i < numBenchmarks; i++)
+	{
+		const vkb_Benchmark& benchmark = vkb_benchmark_get(i);
+		if (options.filter != nullptr && strstr(benchmark.name, options.filter) == nullptr)
+		{
+			continue;
+		}
+
+		if (benchmark.needsRenderer && !rendererInitialized)
+		{
+			vkb_AppConfig config = vkb_app_defaultConfig();
+			config.headless = true;
+			config.width = benchmarkWidth;
+			config.height = benchmarkHeight;
+			config.capture.outputDirectory = options.captureDirectory;
+			vkb_app_init(config);
+			rendererInitialized = true;
+		}
+
+		// Starts with the scenario's first frame, after it has turned its features on
+		if (benchmark.needsRenderer && options.commandCaptureFilename != nullptr && !commandCaptureRequested)
+		{
+			vkb_app_captureCommands(options.commandCaptureFilename, options.commandCaptureFrames);
+			commandCaptureRequested = true;
+		}
+
+		double score;
+		const char* skipReason;
+		if (!runScenario(benchmark, options.repeats, &score, &skipReason))
+		{
+			g_logger_info("%-32s skipped, %s", benchmark.name, skipReason);
+			continue;
+		}
+		names[numResults] = benchmark.name;
+		scores[numResults] = score;
+		numResults++;
+
+		double baselineScore;
+		if (!findBaselineValue(baseline, benchmark.name, &baselineScore) || baselineScore == 0.0)
+		{
+			g_logger_info("%-32s %12.3f %-10s (no baseline)", benchmark.name, score, benchmark.unit);
+			continue;
+		}
+
+		// Positive change is always an improvement, whichever direction is better
+		double change = (score - baselineScore) / baselineScore;
+		if (!benchmark.higherIsBetter)
+		{
+			change = -change;
+		}
+
+		if (change < -options.threshold)
+		{
+			g_logger_error("%-32s %12.3f %-10s baseline %12.3f (%+.1f%%) REGRESSION", benchmark.name, score, benchmark.unit, baselineScore, change * 100.0);
+			numRegressions++;
+		}
+		else
+		{
+			g_logger_info("%-32s %12.3f %-10s baseline %12.3f (%+.1f%%)", benchmark.name, score, benchmark.unit, baselineScore, change * 100.0);
+		}
+	}
+
+	writeResults(options.updateBaseline ? options.baselineFilename : options.outputFilename, names, scores, numResults);
+
+	if (rendererInitialized)
+	{
+		vkb_app_free();
+	}
+
+	vkb_file_free(baseline);
+	g_memory_free(names);
+	g_memory_free(scores);
+
+	vkb_jobs_free();
+	vkb_vulkanAllocator_free();
+	g_memory_dumpMemoryLeaks();
+
+	if (numRegressions > 0)
+	{
+		g_logger_error("%d scenarios regressed by more than %.1f%%.", numRegressions, options.threshold * 100.0);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,390 @@
+#include <cppUtils/cppUtils.hpp>
+#include "VulkanBegins/File.h"
+#include "VulkanBegins/Mesh.h"
+#include "VulkanBegins/MeshSimplify.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+// Converts a Wavefront .obj into a .vkbmesh with its LOD chain baked in.
+//
+//   MeshConverter input.obj output.vkbmesh [--lods 8] [--ratio 0.5] [--min-triangles 64]
+//
+// Faces are fan triangulated, groups and materials are ignored, and meshes
+// without normals get smooth ones.
+
+// ------------ Internal structures ------------
+struct ConverterOptions
+{
+	const char* inputFilename;
+	const char* outputFilename;
+	uint32 maxLods;
+	float reductionRatio;
+	uint32 minTriangles;
+};
+
+// One face corner's position, uv and normal indices, 0 when missing
+struct ObjCorner
+{
+	int32 position;
+	int32 uv;
+	int32 normal;
+	uint32 index;
+};
+
+struct ObjData
+{
+	float* positions;
+	uint32 numPositions;
+	float* uvs;
+	uint32 numUvs;
+	float* normals;
+	uint32 numNormals;
+	ObjCorner* corners;
+	uint32 numCorners;
+};
+
+// ------------ Internal Functions ------------
+template<typename T>
+static void pushValue(T** array, uint32* count, uint32* capacity, const T& value)
+{
+	if (*count == *capacity)
+	{
+		*capacity = *capacity > 0 ? *capacity * 2 : 1024;
+		*array = (T*)g_memory_realloc(*array, sizeof(T) * *capacity);
+	}
+	(*array)[(*count)++] = value;
+}
+
+// OBJ indices are 1-based, negative ones count back from the latest element
+static int32 resolveObjIndex(long index, uint32 count)
+{
+	if (index < 0)
+	{
+		return (int32)count + (int32)index + 1;
+	}
+	return (int32)index;
+}
+
+static char* parseCorner(char* cursor, const ObjData& obj, ObjCorner* corner)
+{
+	char* end;
+	*corner = {};
+	corner->position = resolveObjIndex(strtol(cursor, &end, 10), obj.numPositions / 3);
+	cursor = end;
+	if (*cursor == '/')
+	{
+		cursor++;
+		if (*cursor != '/')
+		{
+			corner->uv = resolveObjIndex(strtol(cursor, &end, 10), obj.numUvs / 2);
+			cursor = end;
+		}
+		if (*cursor == '/')
+		{
+			cursor++;
+			corner->normal = resolveObjIndex(strtol(cursor, &end, 10), obj.numNormals / 3);
+			cursor = end;
+		}
+	}
+	return cursor;
+}
+
+static bool parseObj(const vkb_FileContents& contents, ObjData* obj)
+{
+	*obj = {};
+	uint32 positionsCapacity = 0;
+	uint32 uvsCapacity = 0;
+	uint32 normalsCapacity = 0;
+	uint32 cornersCapacity = 0;
+
+	// Copied so strtof and friends always find a terminator
+	char* text = (char*)g_memory_allocate(contents.size + 1);
+	memcpy(text, contents.data, contents.size);
+	text[contents.size] = '\0';
+
+	uint32 lineNumber = 0;
+	char* line = text;
+	bool result = true;
+	while (line != nullptr && *line != '\0' && result)
+	{
+		lineNumber++;
+		char* next = strchr(line, '\n');
+		if (next != nullptr)
+		{
+			*next = '\0';
+			next++;
+		}
+
+		char* cursor = line;
+		if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t'))
+		{
+			cursor += 2;
+			for (uint32 i = 0; i < 3; i++)
+			{
+				pushValue(&obj->positions, &obj->numPositions, &positionsCapacity, strtof(cursor, &cursor));
+			}
+		}
+		else if (cursor[0] == 'v' && cursor[1] == 't')
+		{
+			cursor += 2;
+			for (uint32 i = 0; i < 2; i++)
+			{
+				pushValue(&obj->uvs, &obj->numUvs, &uvsCapacity, strtof(cursor, &cursor));
+			}
+		}
+		else if (cursor[0] == 'v' && cursor[1] == 'n')
+		{
+			cursor += 2;
+			for (uint32 i = 0; i < 3; i++)
+			{
+				pushValue(&obj->normals, &obj->numNormals, &normalsCapacity, strtof(cursor, &cursor));
+			}
+		}
+		else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t'))
+		{
+			cursor += 2;
+			ObjCorner face[3];
+			uint32 numFaceCorners = 0;
+			while (true)
+			{
+				while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')
+				{
+					cursor++;
+				}
+				if (*cursor == '\0')
+				{
+					break;
+				}
+
+				ObjCorner corner;
+				cursor = parseCorner(cursor, *obj, &corner);
+				if (corner.position <= 0 || corner.position > (int32)(obj->numPositions / 3) ||
+					corner.uv < 0 || corner.uv > (int32)(obj->numUvs / 2) ||
+					corner.normal < 0 || corner.normal > (int32)(obj->numNormals / 3))
+				{
+					g_logger_error("Line %d: face index out of range.", lineNumber);
+					result = false;
+					break;
+				}
+
+				// Fan triangulation around the first corner
+				if (numFaceCorners < 2)
+				{
+					face[numFaceCorners] = corner;
+				}
+				else
+				{
+					face[2] = corner;
+					for (uint32 i = 0; i < 3; i++)
+					{
+						pushValue(&obj->corners, &obj->numCorners, &cornersCapacity, face[i]);
+					}
+					face[1] = corner;
+				}
+				numFaceCorners++;
+			}
+		}
+
+		line = next;
+	}
+
+	g_memory_free(text);
+	return result;
+}
+
+// Every distinct position/uv/normal combination becomes one vertex
+static vkb_MeshData buildMesh(ObjData& obj)
+{
+	for (uint32 i = 0; i < obj.numCorners; i++)
+	{
+		obj.corners[i].index = i;
+	}
+
+	ObjCorner* sorted = (ObjCorner*)g_memory_allocate(sizeof(ObjCorner) * obj.numCorners);
+	memcpy(sorted, obj.corners, sizeof(ObjCorner) * obj.numCorners);
+	std::sort(sorted, sorted + obj.numCorners, [](const ObjCorner& a, const ObjCorner& b)
+		{
+			if (a.position != b.position) return a.position < b.position;
+			if (a.uv != b.uv) return a.uv < b.uv;
+			return a.normal < b.normal;
+		});
+
+	uint32 numVertices = 0;
+	for (uint32 i = 0; i < obj.numCorners; i++)
+	{
+		if (i == 0 || sorted[i].position != sorted[i - 1].position || sorted[i].uv != sorted[i - 1].uv || sorted[i].normal != sorted[i - 1].normal)
+		{
+			numVertices++;
+		}
+	}
+
+	vkb_MeshData mesh = vkb_mesh_create(numVertices, obj.numCorners);
+	uint32 vertex = 0;
+	for (uint32 i = 0; i < obj.numCorners; i++)
+	{
+		const ObjCorner& corner = sorted[i];
+		bool isNew = i == 0 || corner.position != sorted[i - 1].position || corner.uv != sorted[i - 1].uv || corner.normal != sorted[i - 1].normal;
+		if (isNew)
+		{
+			vkb_MeshVertex& dst = mesh.vertices[vertex++];
+			memcpy(dst.position, obj.positions + (corner.position - 1) * 3, sizeof(dst.position));
+			if (corner.uv > 0)
+			{
+				memcpy(dst.uv, obj.uvs + (corner.uv - 1) * 2, sizeof(dst.uv));
+			}
+			else
+			{
+				dst.uv[0] = dst.uv[1] = 0.0f;
+			}
+			if (corner.normal > 0)
+			{
+				memcpy(dst.normal, obj.normals + (corner.normal - 1) * 3, sizeof(dst.normal));
+			}
+			else
+			{
+				dst.normal[0] = dst.normal[1] = dst.normal[2] = 0.0f;
+			}
+		}
+		mesh.indices[corner.index] = vertex - 1;
+	}
+
+	g_memory_free(sorted);
+	return mesh;
+}
+
+// Area weighted face normals summed per position, for meshes that came without any
+static void generateSmoothNormals(vkb_MeshData& mesh, const ObjData& obj)
+{
+	float* accumulated = (float*)g_memory_allocate(sizeof(float) * obj.numPositions);
+	memset(accumulated, 0, sizeof(float) * obj.numPositions);
+	for (uint32 i = 0; i < obj.numCorners; i += 3)
+	{
+		const float* p0 = obj.positions + (obj.corners[i].position - 1) * 3;
+		const float* p1 = obj.positions + (obj.corners[i + 1].position - 1) * 3;
+		const float* p2 = obj.positions + (obj.corners[i + 2].position - 1) * 3;
+		float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float normal[3] = {
+			e0[1] * e1[2] - e0[2] * e1[1],
+			e0[2] * e1[0] - e0[0] * e1[2],
+			e0[0] * e1[1] - e0[1] * e1[0]
+		};
+		for (uint32 corner = 0; corner < 3; corner++)
+		{
+			float* dst = accumulated + (obj.corners[i + corner].position - 1) * 3;
+			dst[0] += normal[0];
+			dst[1] += normal[1];
+			dst[2] += normal[2];
+		}
+	}
+
+	for (uint32 i = 0; i < obj.numCorners; i++)
+	{
+		if (obj.corners[i].normal != 0)
+		{
+			continue;
+		}
+
+		const float* normal = accumulated + (obj.corners[i].position - 1) * 3;
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float* dst = mesh.vertices[mesh.indices[i]].normal;
+		for (uint32 axis = 0; axis < 3; axis++)
+		{
+			dst[axis] = length > 0.0f ? normal[axis] / length : 0.0f;
+		}
+	}
+
+	g_memory_free(accumulated);
+}
+
+static bool parseOptions(int argc, char** argv, ConverterOptions* options)
+{
+	if (argc < 3)
+	{
+		return false;
+	}
+
+	options->inputFilename = argv[1];
+	options->outputFilename = argv[2];
+	options->maxLods = vkb_maxMeshLods;
+	options->reductionRatio = 0.5f;
+	options->minTriangles = 64;
+
+	for (int i = 3; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--lods") == 0 && hasValue)
+		{
+			options->maxLods = (uint32)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--ratio") == 0 && hasValue)
+		{
+			options->reductionRatio = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--min-triangles") == 0 && hasValue)
+		{
+			options->minTriangles = (uint32)atoi(argv[++i]);
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return options->maxLods >= 1 && options->reductionRatio > 0.0f && options->reductionRatio < 1.0f;
+}
+
+// ------------ Public Functions ------------
+int main(int argc, char** argv)
+{
+	g_memory_init(false);
+
+	ConverterOptions options = {};
+	if (!parseOptions(argc, argv, &options))
+	{
+		g_logger_info("Usage: MeshConverter input.obj output.vkbmesh [--lods 8] [--ratio 0.5] [--min-triangles 64]");
+		return 1;
+	}
+
+	if (!vkb_file_exists(options.inputFilename))
+	{
+		g_logger_error("'%s' doesn't exist.", options.inputFilename);
+		return 1;
+	}
+
+	vkb_FileContents contents = vkb_file_read(options.inputFilename);
+	ObjData obj;
+	bool parsed = parseObj(contents, &obj);
+	vkb_file_free(contents);
+	if (!parsed || obj.numCorners == 0)
+	{
+		g_logger_error("'%s' has no triangles that could be read.", options.inputFilename);
+		return 1;
+	}
+
+	vkb_MeshData mesh = buildMesh(obj);
+	generateSmoothNormals(mesh, obj);
+	vkb_mesh_computeBounds(mesh);
+	vkb_meshSimplify_generateLods(mesh, options.maxLods, options.reductionRatio, options.minTriangles);
+
+	for (uint32 lod = 0; lod < mesh.numLods; lod++)
+	{
+		g_logger_info("LOD %d: %d triangles, error %f", lod, mesh.lods[lod].indexCount / 3, mesh.lods[lod].error);
+	}
+
+	bool written = vkb_mesh_write(options.outputFilename, mesh);
+	if (!written)
+	{
+		g_logger_error("Could not write '%s'.", options.outputFilename);
+	}
+
+	vkb_mesh_free(mesh);
+	g_memory_free(obj.positions);
+	g_memory_free(obj.uvs);
+	g_memory_free(obj.normals);
+	g_memory_free(obj.corners);
+	return written ? 0 : 1;
+}
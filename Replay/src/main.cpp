@@ -0,0 +1,94 @@
+#include <cppUtils/cppUtils.hpp>
+#include "VulkanBegins/App.h"
+#include "VulkanBegins/CommandStream.h"
+#include "VulkanBegins/VulkanAllocator.h"
+#include "VulkanBegins/JobSystem.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+// Replays a command capture (see CommandStream.h) headless and reports how fast
+// it ran, so a workload captured from the app can be benchmarked or bisected
+// without the app that produced it.
+//
+//   Replay capture.vkbc [--loops 10]
+
+// ------------ Internal Functions ------------
+static void printUsage()
+{
+	g_logger_info("Usage: Replay capture.vkbc [--loops 10]");
+}
+
+int main(int argc, char** argv)
+{
+	g_memory_init(false);
+	vkb_jobs_init();
+
+	const char* filename = nullptr;
+	uint32 loops = 10;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc)
+		{
+			int value = atoi(argv[++i]);
+			loops = value > 0 ? (uint32)value : 1;
+		}
+		else if (filename == nullptr)
+		{
+			filename = argv[i];
+		}
+		else
+		{
+			g_logger_warning("Unknown replay argument '%s'", argv[i]);
+		}
+	}
+
+	if (filename == nullptr)
+	{
+		printUsage();
+		return 1;
+	}
+
+	vkb_CommandStream* stream = vkb_commandStream_load(filename);
+	if (stream == nullptr)
+	{
+		return 1;
+	}
+
+	// The captured features own the objects the stream names
+	VkExtent2D extent = vkb_commandStream_getExtent(stream);
+	vkb_app_init(vkb_app_replayConfig(stream));
+
+	vkb_commandStream_createResources(vkb_app_getContext(), stream);
+
+	// One untimed pass creates every shader variant the stream uses
+	uint32 numFrames = vkb_commandStream_getFrameCount(stream);
+	for (uint32 frame = 0; frame < numFrames; frame++)
+	{
+		vkb_app_drawReplayFrame(stream, frame);
+	}
+	vkb_app_waitIdle();
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32 loop = 0; loop < loops; loop++)
+	{
+		for (uint32 frame = 0; frame < numFrames; frame++)
+		{
+			vkb_app_drawReplayFrame(stream, frame);
+		}
+	}
+	vkb_app_waitIdle();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint32 framesDrawn = numFrames * loops;
+	g_logger_info("Replayed %d frames of '%s' (%dx%d) in %.3f s, %.1f frames/s, %.3f ms/frame.",
+		framesDrawn, filename, extent.width, extent.height, seconds, (double)framesDrawn / seconds, seconds * 1000.0 / (double)framesDrawn);
+
+	vkb_commandStream_free(vkb_app_getContext(), stream);
+	vkb_app_free();
+	vkb_jobs_free();
+
+	vkb_vulkanAllocator_free();
+	return 0;
+}
@@ -1,10 +1,225 @@
 #ifndef VK_BEGINS_APP_H
 #define VK_BEGINS_APP_H
 
+#include <cppUtils/cppUtils.hpp>
+#include "VulkanBegins/DrawQueue.h"
+#include "VulkanBegins/FrameCapture.h"
+#include "VulkanBegins/DynamicResolution.h"
+#include "VulkanBegins/ShaderVariants.h"
+#include "VulkanBegins/OcclusionCulling.h"
+#include "VulkanBegins/ClusteredLighting.h"
+#include "VulkanBegins/ParticleSystem.h"
+#include "VulkanBegins/SpriteRenderer.h"
+#include "VulkanBegins/MeshLod.h"
+
+struct vkb_Context;
+struct vkb_CommandStream;
+struct vkb_BindlessHeap;
+
+// Feature toggles for the frame's shaders. Bit i is the specialization
+// constant with constant_id i in shader.vert and shader.frag. Bit 1 is free,
+// it was a texturing toggle that had no texture to sample, and stays unused so
+// the variant keys in existing command captures keep their meaning.
+enum vkb_ShaderFeature : uint32
+{
+	vkb_ShaderFeature_VertexColor = 1 << 0,
+	vkb_ShaderFeature_Fog = 1 << 2,
+	// Places each instance with its matrices from the scene's instance buffer
+	vkb_ShaderFeature_Instancing = 1 << 3,
+	// Instance ids come from the scene's frustum cull or the occlusion culler, set by the app
+	vkb_ShaderFeature_CulledInstances = 1 << 4,
+	// Lights the scene from the clustered light grid, set by the app while it's on
+	vkb_ShaderFeature_ClusteredLighting = 1 << 5,
+	// Pulls the scene mesh's vertices by index in place of the triangle, set by the app while it's on
+	vkb_ShaderFeature_MeshVertices = 1 << 6,
+
+	vkb_ShaderFeature_Count = 7
+};
+
+struct vkb_AppConfig
+{
+	// Render into offscreen images instead of a window's swap chain. No window,
+	// surface or presentation is created, so this runs on ICDs like lavapipe.
+	bool headless;
+	uint32 width;
+	uint32 height;
+
+	// How many times the frame's draw is issued and whether the pipeline,
+	// viewport and scissor get rebound before each one
+	uint32 drawsPerFrame;
+	bool rebindStatePerDraw;
+
+	// vkb_ShaderFeature bits the frame is drawn with. The pipeline for each
+	// combination is created the first time it's used.
+	uint32 shaderFeatures;
+
+	// Record each swap chain image's command buffer once and resubmit it until
+	// its content changes, instead of recording every frame
+	bool retainedCommandBuffers;
+
+	// Read frames back and write them to disk, see FrameCapture.h. Headless
+	// captures are sized for the initial resolution, larger frames are skipped.
+	bool captureFrames;
+	vkb_FrameCaptureConfig capture;
+
+	// Render the scene offscreen at a scale picked from measured GPU time and
+	// blit it up to the swap chain image. Scales above 1 aren't supported.
+	bool dynamicResolution;
+	vkb_DynamicResolutionConfig dynamicResolutionConfig;
+
+	// Draw sceneInstances instances of the triangle, placed by a transform
+	// system (see Transforms.h), in place of drawsPerFrame draws. Their matrices
+	// are computed on the CPU every frame straight into a mapped instance buffer.
+	// A few large triangles stand in front of them, hiding part of the field.
+	bool instancedScene;
+	uint32 sceneInstances;
+
+	// Draw the instanced scene through the two phase Hi-Z culler in
+	// OcclusionCulling.h, whether or not instancedScene is set. Not supported
+	// together with dynamic resolution.
+	bool occlusionCulling;
+
+	// Light the scene with numLights point lights through the clustered
+	// renderer in ClusteredLighting.h. The lit scene is laid out as a floor
+	// stretching away from the camera so the lights have depth to spread over.
+	bool clusteredLighting;
+	uint32 numLights;
+
+	// Simulate and draw up to maxParticles GPU particles, see ParticleSystem.h
+	bool particles;
+	uint32 maxParticles;
+
+	// Draw numSprites batched 2D sprites over the scene, see SpriteRenderer.h
+	bool sprites;
+	uint32 numSprites;
+
+	// Spread drawsPerFrame draws over numMaterials textured materials, see
+	// MaterialLibrary.h. With bindlessMaterials they're reached through the
+	// bindless heap by index instead of one descriptor set each, which needs
+	// descriptor indexing. Only the draw queue path draws materials, not
+	// rebindStatePerDraw or occlusion culling, and they take the instanced
+	// scene's place.
+	uint32 numMaterials;
+	bool bindlessMaterials;
+};
+
+vkb_AppConfig vkb_app_defaultConfig();
+
 void vkb_app_init();
 
+void vkb_app_init(const vkb_AppConfig& config);
+
 void vkb_app_run();
 
+void vkb_app_drawFrame();
+
+// Blocks until the GPU has finished every submitted frame
+void vkb_app_waitIdle();
+
+// Records the next numFrames frames' commands to filename, see CommandStream.h.
+// Safe to call from any thread. Retained command buffers are re-recorded while
+// capturing. The features that are on are stored with the capture. A scene
+// drawn with a mesh can't be captured.
+void vkb_app_captureCommands(const char* filename, uint32 numFrames);
+
+// A headless config at the stream's extent with the features it was captured
+// with, so the objects it names exist once the app is initialized with it
+vkb_AppConfig vkb_app_replayConfig(const vkb_CommandStream* stream);
+
+// Draws one frame of a loaded command stream instead of the app's own scene.
+// Headless only, init the app with vkb_app_replayConfig and create the
+// stream's resources before the first one.
+void vkb_app_drawReplayFrame(vkb_CommandStream* stream, uint32 frameIndex);
+
+void vkb_app_setDrawsPerFrame(uint32 drawsPerFrame, bool rebindStatePerDraw);
+
+void vkb_app_setRetainedCommandBuffers(bool retained);
+
+void vkb_app_setShaderFeatures(uint32 shaderFeatures);
+
+// The scene is created the first time it's turned on, with the config's sceneInstances
+void vkb_app_setInstancedScene(bool enabled);
+
+// Created the first time it's turned on, along with the scene if it hasn't
+// been. Can't be combined with dynamic resolution.
+void vkb_app_setOcclusionCulling(bool enabled);
+
+// Draws the instanced scene's field, not the occluders, with mesh in place of
+// triangles: one instanced draw per LOD, each instance at the LOD its screen
+// space error picks. The mesh needs its LOD chain (see MeshSimplify.h) and is
+// uploaded the first time, later calls only turn it back on. nullptr goes back
+// to triangles. Uploads on the calling thread, so only call it headless.
+// The occlusion culled scene keeps drawing triangles.
+void vkb_app_setSceneMesh(const vkb_MeshData* mesh);
+
+void vkb_app_setClusteredLighting(bool enabled);
+
+void vkb_app_setParticles(bool enabled);
+
+// Sprites are streamed every frame, so retained command buffers are re-recorded while they're on
+void vkb_app_setSprites(bool enabled, uint32 numSprites);
+
+// Only supported headless. Can't be combined with occlusion culling.
+void vkb_app_setDynamicResolution(bool enabled);
+
+// Starts or stops reading frames back with the config's capture settings. It
+// can only be turned on after init headless, a window's swap chain has to be
+// created with capture on.
+void vkb_app_setFrameCapture(bool enabled);
+
+// 0 materials draws the plain scene again. Falls back to a descriptor set per
+// material if bindless is asked for but descriptor indexing isn't supported.
+void vkb_app_setMaterials(uint32 numMaterials, bool bindless);
+
+// Only has an effect while clustered lighting is on
+void vkb_app_setLightCount(uint32 numLights);
+
+// Only supported headless, the swap chain follows the window. The old targets
+// are destroyed once the frames using them finish, this doesn't stall.
+void vkb_app_resize(uint32 width, uint32 height);
+
+// Recreates the graphics pipeline for the current shader features, with or
+// without the pipeline cache, and returns how long creation took in
+// milliseconds. Every old variant is retired through the deletion queue.
+float vkb_app_rebuildPipeline(bool usePipelineCache);
+
+const vkb_Context& vkb_app_getContext();
+
+// The config as it stands, features that couldn't be turned on read as off
+const vkb_AppConfig& vkb_app_getConfig();
+
+// Every texture and storage buffer reachable by index, nullptr if the device
+// doesn't support descriptor indexing. See Bindless.h.
+vkb_BindlessHeap* vkb_app_getBindlessHeap();
+
+// Binds issued and elided by the most recent command buffer recording. With
+// retained command buffers that's not necessarily the last frame.
+vkb_DrawStats vkb_app_getDrawStats();
+
+vkb_ShaderVariantStats vkb_app_getShaderVariantStats();
+
+// Culling results of the last finished frame, all zero unless occlusion culling is on
+vkb_OcclusionStats vkb_app_getOcclusionStats();
+
+// Light binning and timings of the last finished frame, all zero unless clustered lighting is on
+vkb_ClusteredLightingStats vkb_app_getLightingStats();
+
+// Particle counts and timings of the last finished frame, all zero unless particles are on
+vkb_ParticleStats vkb_app_getParticleStats();
+
+// Batching and uploads of the most recent command buffer recording, all zero unless sprites are on
+vkb_SpriteStats vkb_app_getSpriteStats();
+
+// LOD selection of the most recent frame, all zero unless the scene mesh is on
+vkb_MeshLodStats vkb_app_getMeshLodStats();
+
+// Retire value to queue deletions with (see DeletionQueue.h). Objects tagged
+// with it are destroyed once every frame that could have used them has finished.
+uint64 vkb_app_getFrameSerial();
+
+// Scale the scene is currently rendered at, 1 unless dynamic resolution is on
+float vkb_app_getRenderScale();
+
 void vkb_app_free();
 
-#endif 
\ No newline at end of file
+#endif
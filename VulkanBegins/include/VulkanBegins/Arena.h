@@ -0,0 +1,94 @@
+#ifndef VK_BEGINS_ARENA_H
+#define VK_BEGINS_ARENA_H
+
+#include <cppUtils/cppUtils.hpp>
+
+// Linear (bump) allocator. Allocations are never freed individually, the whole
+// arena is reset at once or popped back to a marker.
+//
+// If an allocation doesn't fit, the arena falls back to a heap block which is
+// released on the next reset. Every fallback is counted in numHeapAllocations,
+// and the next reset grows the arena so the same workload fits without them.
+struct vkb_ArenaOverflowBlock;
+
+struct vkb_Arena
+{
+	uint8* memory;
+	size_t size;
+	size_t offset;
+
+	vkb_ArenaOverflowBlock* overflowBlocks;
+	size_t overflowBytes;
+
+	// Stats since the last reset
+	uint32 numAllocations;
+	uint32 numHeapAllocations;
+	size_t highWaterMark;
+};
+
+struct vkb_ArenaMarker
+{
+	size_t offset;
+	vkb_ArenaOverflowBlock* overflowBlocks;
+	size_t overflowBytes;
+};
+
+vkb_Arena vkb_arena_create(size_t size);
+
+void* vkb_arena_allocate(vkb_Arena& arena, size_t numBytes, size_t alignment = 16);
+
+template<typename T>
+T* vkb_arena_allocateArray(vkb_Arena& arena, size_t count)
+{
+	return (T*)vkb_arena_allocate(arena, sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16);
+}
+
+vkb_ArenaMarker vkb_arena_mark(const vkb_Arena& arena);
+
+void vkb_arena_popTo(vkb_Arena& arena, const vkb_ArenaMarker& marker);
+
+void vkb_arena_reset(vkb_Arena& arena);
+
+void vkb_arena_free(vkb_Arena& arena);
+
+// ------------ Per-frame arenas ------------
+// One arena per frame in flight. A frame's arena is reset in
+// vkb_frameArena_beginFrame, which must only be called once the GPU work that
+// last used that frame slot has retired (after its in-flight fence wait).
+//
+// A frame runs from one beginFrame call to the next, on the thread that makes
+// them. That thread's scratch arena is counted along with the frame arena, so
+// numHeapAllocations is every general heap allocation either of them made.
+struct vkb_FrameArenaStats
+{
+	uint32 numAllocations;
+	uint32 numHeapAllocations;
+	size_t bytesUsed;
+};
+
+void vkb_frameArena_init(size_t sizePerFrame, uint32 framesInFlight);
+
+void vkb_frameArena_beginFrame(uint32 frameSlot);
+
+vkb_Arena& vkb_frameArena_get();
+
+// Stats of the most recently retired frame
+vkb_FrameArenaStats vkb_frameArena_getLastFrameStats();
+
+void vkb_frameArena_free();
+
+// ------------ Thread-local scratch ------------
+// Short-lived temporary memory for the calling thread. Always pair
+// vkb_scratch_begin with vkb_scratch_end, everything allocated in between is
+// released at the end call.
+vkb_Arena& vkb_scratch_get();
+
+vkb_ArenaMarker vkb_scratch_begin();
+
+void vkb_scratch_end(const vkb_ArenaMarker& marker);
+
+// Frees the calling thread's scratch arena. Threads that used scratch memory
+// must call this before exiting.
+void vkb_scratch_free();
+
+#endif
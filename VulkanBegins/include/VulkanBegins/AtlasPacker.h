@@ -0,0 +1,43 @@
+#ifndef VK_BEGINS_ATLAS_PACKER_H
+#define VK_BEGINS_ATLAS_PACKER_H
+
+#include <cppUtils/cppUtils.hpp>
+
+// Skyline rectangle packer for texture atlases. The packed area is tracked as
+// the skyline along its top edge, a list of horizontal segments, and every
+// rectangle goes wherever its top ends up lowest (bottom-left heuristic).
+// Space under an overhang is never reused, which is what keeps it fast enough
+// to pack images one at a time as they show up.
+struct vkb_SkylineNode
+{
+	uint32 x;
+	uint32 y;
+	uint32 width;
+};
+
+struct vkb_AtlasPacker
+{
+	uint32 width;
+	uint32 height;
+
+	// Sorted by x, together they always span the whole width
+	vkb_SkylineNode* nodes;
+	uint32 numNodes;
+	uint32 nodeCapacity;
+
+	uint64 usedArea;
+};
+
+vkb_AtlasPacker vkb_atlasPacker_create(uint32 width, uint32 height);
+
+// Returns false if the rectangle doesn't fit anywhere, the packer is left untouched then
+bool vkb_atlasPacker_pack(vkb_AtlasPacker& packer, uint32 width, uint32 height, uint32* x, uint32* y);
+
+// Fraction of the atlas covered by packed rectangles
+float vkb_atlasPacker_getOccupancy(const vkb_AtlasPacker& packer);
+
+void vkb_atlasPacker_reset(vkb_AtlasPacker& packer);
+
+void vkb_atlasPacker_free(vkb_AtlasPacker& packer);
+
+#endif
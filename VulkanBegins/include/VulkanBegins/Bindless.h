@@ -0,0 +1,70 @@
+#ifndef VK_BEGINS_BINDLESS_H
+#define VK_BEGINS_BINDLESS_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+
+// One descriptor set that holds every texture and storage buffer, so a frame
+// binds it once and draws pick their resources by index, usually through push
+// constants. Needs VK_EXT_descriptor_indexing, see vkb_Context.
+//
+//   binding 0: sampler2D textures[maxTextures]
+//   binding 1: readonly buffer { ... } buffers[maxBuffers]
+//
+// Both arrays are partially bound, so only the slots a draw actually reads
+// have to be written, and update after bind, so new resources can be added
+// while the set is bound in command buffers that haven't been submitted or
+// are still running. A released slot is only reused once every frame that
+// could have read it has finished.
+typedef uint32 vkb_BindlessIndex;
+static constexpr vkb_BindlessIndex vkb_invalidBindlessIndex = UINT32_MAX;
+
+struct vkb_BindlessHeapDesc
+{
+	// Clamped to the device's update after bind limits
+	uint32 maxTextures;
+	uint32 maxBuffers;
+	VkShaderStageFlags stages;
+};
+
+struct vkb_BindlessStats
+{
+	uint32 maxTextures;
+	uint32 maxBuffers;
+	uint32 numTextures;
+	uint32 numBuffers;
+	// Released, waiting for the frames that could still read them
+	uint32 numRetiring;
+};
+
+struct vkb_BindlessHeap;
+
+vkb_BindlessHeap* vkb_bindlessHeap_create(const vkb_Context& ctx, const vkb_BindlessHeapDesc& desc);
+
+// For pipeline layouts, the heap can be bound as any set
+VkDescriptorSetLayout vkb_bindlessHeap_getSetLayout(const vkb_BindlessHeap* heap);
+
+// The image has to be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL whenever a
+// draw reads it. Returns vkb_invalidBindlessIndex if every slot is taken.
+vkb_BindlessIndex vkb_bindlessHeap_addTexture(vkb_BindlessHeap* heap, VkImageView imageView, VkSampler sampler);
+
+vkb_BindlessIndex vkb_bindlessHeap_addBuffer(vkb_BindlessHeap* heap, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+// The slot is reused once collect is called with retireValue or later (see DeletionQueue.h)
+void vkb_bindlessHeap_releaseTexture(vkb_BindlessHeap* heap, vkb_BindlessIndex index, uint64 retireValue);
+
+void vkb_bindlessHeap_releaseBuffer(vkb_BindlessHeap* heap, vkb_BindlessIndex index, uint64 retireValue);
+
+// Frees the slots of every release whose retire value is at most completedValue
+void vkb_bindlessHeap_collect(vkb_BindlessHeap* heap, uint64 completedValue);
+
+void vkb_bindlessHeap_bind(const vkb_BindlessHeap* heap, VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32 set);
+
+vkb_BindlessStats vkb_bindlessHeap_getStats(const vkb_BindlessHeap* heap);
+
+// The device must be idle
+void vkb_bindlessHeap_free(const vkb_Context& ctx, vkb_BindlessHeap* heap);
+
+#endif
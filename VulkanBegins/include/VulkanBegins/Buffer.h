@@ -0,0 +1,54 @@
+#ifndef VK_BEGINS_BUFFER_H
+#define VK_BEGINS_BUFFER_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+#include "VulkanBegins/Residency.h"
+
+struct vkb_Context;
+
+struct vkb_Buffer
+{
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	// Only set for host visible buffers, which stay mapped for their lifetime
+	void* mapped;
+	// Only set for buffers created with vkb_buffer_createResident
+	bool resident;
+	vkb_ResidentResource residentResource;
+	uint32 memoryTypeIndex;
+	VkDeviceSize allocationSize;
+};
+
+vkb_Buffer vkb_buffer_create(const vkb_Context& ctx, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties);
+
+// Allocates through the residency manager and registers the buffer as a
+// Critical resource, so it counts against its heap's budget and streamed
+// resources make room for it. Mark it used every frame it's drawn with.
+vkb_Buffer vkb_buffer_createResident(const vkb_Context& ctx, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties);
+
+void vkb_buffer_free(const vkb_Context& ctx, vkb_Buffer& buffer);
+
+// Hands the buffer to the deletion queue instead of destroying it right away
+void vkb_buffer_freeDeferred(vkb_Buffer& buffer, uint64 retireValue);
+
+// Uploads to device local memory go through one persistently mapped staging
+// buffer. Copies are batched into a single command buffer until the staging
+// buffer fills up or vkb_staging_flush is called.
+//
+// Submits to the graphics queue, so only call these from the thread that owns
+// it: the render thread while vkb_app_run is running.
+void vkb_staging_init(const vkb_Context& ctx, VkDeviceSize capacity);
+
+// dst needs VK_BUFFER_USAGE_TRANSFER_DST_BIT. data is copied immediately, the
+// GPU copy only happens on the next flush.
+void vkb_staging_upload(const vkb_Context& ctx, vkb_Buffer& dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+// Submits every pending copy on the graphics queue and waits for them to finish
+void vkb_staging_flush(const vkb_Context& ctx);
+
+void vkb_staging_free(const vkb_Context& ctx);
+
+#endif
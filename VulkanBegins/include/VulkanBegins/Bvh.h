@@ -0,0 +1,112 @@
+#ifndef VK_BEGINS_BVH_H
+#define VK_BEGINS_BVH_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "VulkanBegins/Transforms.h"
+
+// Scene index over object bounds for frustum culling and picking. It's a
+// 4-wide BVH: every node stores its children's boxes as SoA so one SSE register
+// holds the same coordinate of all 4, and leaves hold up to 8 objects whose
+// boxes live in SoA arrays so a whole leaf is one AVX2 test.
+//
+// Objects are stored in tree order, so any subtree's objects are one
+// contiguous range. Subtrees fully inside the frustum are copied out whole.
+//
+// Moving objects update their box and the tree is refit, which keeps the
+// topology. Rebuild once objects have moved far enough for the tree to get loose.
+static constexpr uint32 vkb_bvhLeafSize = 8;
+
+struct vkb_Aabb
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// Inward facing planes, xyz is the normal and w the distance, so a point is
+// inside when dot(plane.xyz, point) + plane.w >= 0
+struct vkb_Frustum
+{
+	glm::vec4 planes[6];
+};
+
+struct vkb_BvhNode
+{
+	float minX[4];
+	float minY[4];
+	float minZ[4];
+	float maxX[4];
+	float maxY[4];
+	float maxZ[4];
+	// Node index of internal children, first object slot of leaves
+	uint32 child[4];
+	// Objects in each leaf child, 0 for internal children
+	uint8 leafCount[4];
+	uint8 numChildren;
+	// Set by vkb_bvh_update, cleared by vkb_bvh_refit
+	bool dirty;
+
+	uint32 parent;
+	// The subtree's objects are slots firstObject up to firstObject + numObjects
+	uint32 firstObject;
+	uint32 numObjects;
+};
+
+struct vkb_Bvh
+{
+	// Parents always come before their children, the root is node 0
+	vkb_BvhNode* nodes;
+	uint32 numNodes;
+	uint32 nodeCapacity;
+
+	// Object boxes in slot order, padded so a leaf can always load 8 lanes
+	float* minX;
+	float* minY;
+	float* minZ;
+	float* maxX;
+	float* maxY;
+	float* maxZ;
+	uint32* slotObjects;
+	uint32* objectSlots;
+	// Node index * 4 + child index of the leaf holding each slot
+	uint32* slotLeaves;
+	uint32 numObjects;
+};
+
+struct vkb_BvhRayHit
+{
+	uint32 objectId;
+	// Where the ray enters the object's box, in units of direction's length
+	float distance;
+};
+
+// Planes of a Vulkan clip space frustum (depth 0 to 1) in the space viewProj
+// transforms from
+vkb_Frustum vkb_frustum_fromViewProj(const glm::mat4& viewProj);
+
+// Object ids are indices into bounds
+vkb_Bvh vkb_bvh_build(const vkb_Aabb* bounds, uint32 numObjects);
+
+// Takes effect on the next vkb_bvh_refit
+void vkb_bvh_update(vkb_Bvh& bvh, uint32 objectId, const vkb_Aabb& bounds);
+
+// Refits every node above an updated object, bottom up
+void vkb_bvh_refit(vkb_Bvh& bvh);
+
+// Writes the ids of objects that intersect the frustum to visibleIds and
+// returns how many there are. visibleIds needs room for every object, and can
+// point straight at a mapped instance id buffer.
+uint32 vkb_bvh_cullFrustum(const vkb_Bvh& bvh, const vkb_Frustum& frustum, uint32* visibleIds, vkb_TransformKernel kernel = vkb_TransformKernel::Best);
+
+// Writes up to maxIds ids of objects whose boxes overlap box and returns how many it wrote
+uint32 vkb_bvh_queryBox(const vkb_Bvh& bvh, const vkb_Aabb& box, uint32* ids, uint32 maxIds);
+
+// Nearest object box the ray enters within maxDistance
+bool vkb_bvh_raycast(const vkb_Bvh& bvh, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, vkb_BvhRayHit* hit);
+
+void vkb_bvh_free(vkb_Bvh& bvh);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef VK_BEGINS_CLUSTERED_LIGHTING_H
+#define VK_BEGINS_CLUSTERED_LIGHTING_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+struct vkb_FileContents;
+
+// Clustered forward lighting. The view frustum is split into a grid of
+// clusters, screen tiles in x and y and exponential depth slices in z, and a
+// compute pass bins every light into the clusters its sphere touches:
+//
+//   lightGrid[cluster]  offset and count into lightIndices
+//   lightIndices[]      the cluster's lights, packed back to back
+//
+// The fragment shader finds its cluster from gl_FragCoord and its view depth
+// and only loops over those lights, so the cost per pixel follows how many
+// lights actually reach it instead of how many are in the scene.
+//
+// Lights and the grid live in view space. Everything is rebuilt every frame.
+static constexpr uint32 vkb_clusterGridX = 16;
+static constexpr uint32 vkb_clusterGridY = 9;
+static constexpr uint32 vkb_clusterGridZ = 24;
+static constexpr uint32 vkb_numClusters = vkb_clusterGridX * vkb_clusterGridY * vkb_clusterGridZ;
+
+// Matches PointLight in light_cull.comp and shader.frag
+struct vkb_PointLight
+{
+	float position[3];
+	// Light falls off to nothing at this distance
+	float radius;
+	float color[3];
+	float intensity;
+};
+
+// Projection the grid is built for. The camera looks down -z.
+struct vkb_ClusterView
+{
+	uint32 width;
+	uint32 height;
+	float tanHalfFovX;
+	float tanHalfFovY;
+	float nearZ;
+	float farZ;
+};
+
+struct vkb_ClusteredLightingDesc
+{
+	uint32 maxLights;
+	// Lights past this in one cluster are dropped
+	uint32 maxLightsPerCluster;
+	// Size of the shared index list every cluster's lights are packed into
+	uint32 maxLightIndices;
+	// Layout of the lighting descriptor set, shared by the cull pass and the
+	// draws. The bindings are the ones at the top of light_cull.comp.
+	VkDescriptorSetLayout lightingSetLayout;
+	// SPIR-V for light_cull.comp
+	const vkb_FileContents* cullShader;
+	VkPipelineCache pipelineCache;
+};
+
+// Results of the last frame that finished
+struct vkb_ClusteredLightingStats
+{
+	uint32 numLights;
+	uint32 numLightIndices;
+	uint32 maxLightsInCluster;
+	// Clusters that lost lights to maxLightsPerCluster or maxLightIndices
+	uint32 numTruncatedClusters;
+
+	// GPU time of the cull pass and of the draws between the shading markers.
+	// Both are zero if the queue can't write timestamps.
+	bool timingSupported;
+	float cullMs;
+	float shadingMs;
+};
+
+struct vkb_ClusteredLighting;
+
+vkb_ClusteredLighting* vkb_clusteredLighting_create(const vkb_Context& ctx, const vkb_ClusteredLightingDesc& desc);
+
+// Writes the lights and the view straight into mapped memory, so only call
+// this once the previous frame using them has finished
+void vkb_clusteredLighting_update(vkb_ClusteredLighting* lighting, const vkb_PointLight* lights, uint32 numLights, const vkb_ClusterView& view);
+
+// Records outside a render pass, before the draws that read the grid
+void vkb_clusteredLighting_recordCull(vkb_ClusteredLighting* lighting, VkCommandBuffer commandBuffer);
+
+// Binds the lighting set to set of pipelineLayout
+void vkb_clusteredLighting_bind(const vkb_ClusteredLighting* lighting, VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32 set);
+
+// Optional, times the lit draws in between for the stats
+void vkb_clusteredLighting_beginShading(const vkb_ClusteredLighting* lighting, VkCommandBuffer commandBuffer);
+
+void vkb_clusteredLighting_endShading(const vkb_ClusteredLighting* lighting, VkCommandBuffer commandBuffer);
+
+// Marks the light, grid and index buffers used, see vkb_residency_markUsed
+void vkb_clusteredLighting_markUsed(const vkb_ClusteredLighting* lighting, uint64 frameIndex);
+
+// Only call once the frame's fence has signaled
+vkb_ClusteredLightingStats vkb_clusteredLighting_readStats(const vkb_Context& ctx, const vkb_ClusteredLighting* lighting);
+
+// The device must be idle
+void vkb_clusteredLighting_free(const vkb_Context& ctx, vkb_ClusteredLighting* lighting);
+
+#endif
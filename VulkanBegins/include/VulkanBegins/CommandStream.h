@@ -0,0 +1,204 @@
+#ifndef VK_BEGINS_COMMAND_STREAM_H
+#define VK_BEGINS_COMMAND_STREAM_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+
+// Captures what the renderer records over a window of frames into a compact
+// binary file, then replays it headless so a production workload can be
+// benchmarked or bisected on its own.
+//
+// Handles mean nothing in another run, so the stream names every object by a
+// key its owner registers it with (see vkb_captureKey). The replay inits the
+// app with the features the capture was made with, which registers the same
+// keys, and the stream resolves them to the replay's own objects. Buffers the
+// CPU writes are tracked with their contents. A capture starts with every
+// tracked buffer's current contents, followed by each frame's ops:
+//
+//   header | app state | CreateBuffer... | frame 0 ops... EndFrame | frame 1 ops... EndFrame | ...
+//
+// Each op is a one byte opcode followed by a fixed payload, plus the data for
+// buffer creates and updates, push constants and barriers. What the GPU writes
+// itself isn't captured, it starts from the replay's own init. Timestamp
+// queries aren't captured either.
+enum class vkb_CaptureOp : uint8
+{
+	CreateBuffer,
+	UpdateBuffer,
+	BeginRenderPass,
+	SetViewport,
+	SetScissor,
+	BindPipeline,
+	BindDescriptorSet,
+	PushConstants,
+	BindVertexBuffer,
+	BindIndexBuffer,
+	Draw,
+	DrawIndexed,
+	DrawIndirect,
+	Dispatch,
+	DispatchIndirect,
+	CopyBuffer,
+	FillBuffer,
+	CmdUpdateBuffer,
+	PipelineBarrier,
+	ClearColorImage,
+	CopyBufferToImage,
+	BlitImage,
+	EndRenderPass,
+	EndFrame,
+
+	Count
+};
+
+// The top byte of a key says who registered the object, so every owner can
+// number its objects from 0
+enum class vkb_CaptureOwner : uint8
+{
+	// Key 0 is the frame's target: the render pass, framebuffers and color
+	// images a frame ends up in, which the replay supplies itself
+	Target = 0,
+	App,
+	ShaderVariants,
+	OcclusionCuller,
+	ClusteredLighting,
+	ParticleSystem,
+	SpriteRenderer,
+	MaterialLibrary,
+	Bindless
+};
+
+inline uint32 vkb_captureKey(vkb_CaptureOwner owner, uint32 index)
+{
+	return ((uint32)owner << 24) | index;
+}
+
+// ------------ Registration ------------
+// Called wherever the objects are created, captured or not, so a replaying
+// process knows them by the same keys. Safe to call from any thread. Registering a handle again changes its
+// key, and a key registered again resolves to its newest object.
+void vkb_commandCapture_registerObject(VkObjectType type, uint64 handle, uint32 key);
+
+// Non-dispatchable handles are pointers on 64-bit and uint64 on 32-bit
+// platforms, this takes either
+template<typename T>
+inline void vkb_commandCapture_registerObject(VkObjectType type, T handle, uint32 key)
+{
+	vkb_commandCapture_registerObject(type, (uint64)handle, key);
+}
+
+// Buffers the CPU writes through a mapping have to be tracked too, so captures
+// start from their contents and replays can write them. The buffer must stay
+// mapped at mapped until it's untracked.
+void vkb_commandCapture_trackBuffer(VkBuffer buffer, uint32 key, VkDeviceSize size, VkBufferUsageFlags usage, void* mapped);
+
+void vkb_commandCapture_untrackBuffer(VkBuffer buffer);
+
+// Call after every CPU write to a tracked buffer. Only copies anything while capturing.
+void vkb_commandCapture_updateBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+
+// ------------ Capture ------------
+// Everything below is called from the thread that records frames.
+
+// Captures the next numFrames frames and writes them to filename once the last
+// one is submitted. extent and colorFormat are what the replay has to render to,
+// appState is whatever the app needs to init itself the same way again.
+void vkb_commandCapture_start(const char* filename, uint32 numFrames, VkExtent2D extent, VkFormat colorFormat, const void* appState, uint32 appStateSize);
+
+bool vkb_commandCapture_isActive();
+
+void vkb_commandCapture_beginRenderPass(const VkRenderPassBeginInfo& beginInfo);
+
+void vkb_commandCapture_setViewport(const VkViewport& viewport);
+
+void vkb_commandCapture_setScissor(const VkRect2D& scissor);
+
+void vkb_commandCapture_bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+
+void vkb_commandCapture_bindDescriptorSet(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32 set, VkDescriptorSet descriptorSet);
+
+void vkb_commandCapture_pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32 offset, uint32 size, const void* values);
+
+void vkb_commandCapture_bindVertexBuffer(VkBuffer buffer, VkDeviceSize offset);
+
+// Index buffers are always 32-bit
+void vkb_commandCapture_bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset);
+
+void vkb_commandCapture_draw(uint32 vertexCount, uint32 instanceCount, uint32 firstVertex, uint32 firstInstance);
+
+void vkb_commandCapture_drawIndexed(uint32 indexCount, uint32 instanceCount, uint32 firstIndex, int32 vertexOffset, uint32 firstInstance);
+
+void vkb_commandCapture_drawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32 drawCount, uint32 stride);
+
+void vkb_commandCapture_dispatch(uint32 groupCountX, uint32 groupCountY, uint32 groupCountZ);
+
+void vkb_commandCapture_dispatchIndirect(VkBuffer buffer, VkDeviceSize offset);
+
+void vkb_commandCapture_copyBuffer(VkBuffer src, VkBuffer dst, const VkBufferCopy& region);
+
+void vkb_commandCapture_fillBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, uint32 data);
+
+// vkCmdUpdateBuffer, as opposed to a CPU write to a tracked buffer
+void vkb_commandCapture_cmdUpdateBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const void* data);
+
+void vkb_commandCapture_pipelineBarrier(VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages, VkDependencyFlags dependencyFlags,
+	uint32 numMemoryBarriers, const VkMemoryBarrier* memoryBarriers, uint32 numBufferBarriers, const VkBufferMemoryBarrier* bufferBarriers,
+	uint32 numImageBarriers, const VkImageMemoryBarrier* imageBarriers);
+
+void vkb_commandCapture_clearColorImage(VkImage image, VkImageLayout layout, const VkClearColorValue& color, const VkImageSubresourceRange& range);
+
+void vkb_commandCapture_copyBufferToImage(VkBuffer buffer, VkImage image, VkImageLayout layout, const VkBufferImageCopy& region);
+
+void vkb_commandCapture_blitImage(VkImage src, VkImageLayout srcLayout, VkImage dst, VkImageLayout dstLayout, const VkImageBlit& region, VkFilter filter);
+
+void vkb_commandCapture_endRenderPass();
+
+// Ends the frame that was just submitted, and the capture after its last frame
+void vkb_commandCapture_endFrame();
+
+// Drops a capture in progress, every registered object and every tracked buffer
+void vkb_commandCapture_free();
+
+// ------------ Replay ------------
+struct vkb_CommandStream;
+
+// Creates the pipeline for a shader variant key that hasn't been asked for yet
+typedef VkPipeline (*vkb_ReplayPipelineFn)(uint32 variantKey, void* userData);
+
+// The frame's target, what the stream's key 0 objects resolve to
+struct vkb_ReplayTarget
+{
+	VkRenderPass renderPass;
+	VkFramebuffer framebuffer;
+	VkImage image;
+};
+
+// Returns nullptr if the file is missing or isn't a capture of this version
+vkb_CommandStream* vkb_commandStream_load(const char* filename);
+
+uint32 vkb_commandStream_getFrameCount(const vkb_CommandStream* stream);
+
+VkExtent2D vkb_commandStream_getExtent(const vkb_CommandStream* stream);
+
+VkFormat vkb_commandStream_getColorFormat(const vkb_CommandStream* stream);
+
+// The app state the capture was started with, appStateSize is set to its size
+const void* vkb_commandStream_getAppState(const vkb_CommandStream* stream, uint32* appStateSize);
+
+// Finds the replay's tracked buffer for every captured one, and creates a host
+// visible buffer for those nothing in this process registered. Call once the
+// app is initialized the way the app state asks for.
+void vkb_commandStream_createResources(const vkb_Context& ctx, vkb_CommandStream* stream);
+
+// Records one captured frame into commandBuffer, which has to be recording
+// already. Buffer updates are written straight to the mapped buffers, so the
+// GPU must be done with the previous frame. Frame 0 restores every buffer's
+// initial contents so looping replays stay deterministic.
+void vkb_commandStream_recordFrame(vkb_CommandStream* stream, uint32 frameIndex, VkCommandBuffer commandBuffer, const vkb_ReplayTarget& target, vkb_ReplayPipelineFn getPipeline, void* userData);
+
+// The device must be idle
+void vkb_commandStream_free(const vkb_Context& ctx, vkb_CommandStream* stream);
+
+#endif
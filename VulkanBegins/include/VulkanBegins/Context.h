@@ -0,0 +1,30 @@
+#ifndef VK_BEGINS_CONTEXT_H
+#define VK_BEGINS_CONTEXT_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_DeviceCaps;
+
+// The handles a subsystem outside of App.cpp needs to create and submit work.
+// Owned by the app, valid between vkb_app_init and vkb_app_free.
+struct vkb_Context
+{
+	const VkAllocationCallbacks* allocator;
+	VkInstance instance;
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	const vkb_DeviceCaps* caps;
+
+	VkQueue graphicsQueue;
+	uint32 graphicsFamily;
+
+	// Optional device extensions that were found and enabled
+	bool memoryBudgetEnabled;
+	bool memoryPriorityEnabled;
+	// VK_EXT_descriptor_indexing with the update after bind and partially bound
+	// features the bindless heap needs, see Bindless.h
+	bool descriptorIndexingEnabled;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef VK_BEGINS_DELETION_QUEUE_H
+#define VK_BEGINS_DELETION_QUEUE_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+
+// Destroys Vulkan objects once the GPU work that last used them has finished,
+// so nothing has to wait for the device to go idle to free a resource.
+//
+// Every handle is tagged with a retire value, which is whatever counter the
+// caller tracks GPU progress with (the app uses its frame serial, see
+// vkb_app_getFrameSerial). The handle is destroyed by the first collect called
+// with a completed value at or past it.
+void vkb_deletionQueue_init(const vkb_Context& ctx, uint32 initialCapacity = 256);
+
+// Safe to call from any thread
+void vkb_deletionQueue_push(VkObjectType type, uint64 handle, uint64 retireValue);
+
+// Non-dispatchable handles are pointers on 64-bit and uint64 on 32-bit
+// platforms, this takes either
+template<typename T>
+inline void vkb_deletionQueue_push(VkObjectType type, T handle, uint64 retireValue)
+{
+	vkb_deletionQueue_push(type, (uint64)handle, retireValue);
+}
+
+// Destroys everything whose retire value is <= completedValue, returns how
+// many objects were destroyed
+uint32 vkb_deletionQueue_collect(uint64 completedValue);
+
+// Destroys everything regardless of retire value. Only call once the device is idle.
+uint32 vkb_deletionQueue_flush();
+
+uint32 vkb_deletionQueue_numPending();
+
+void vkb_deletionQueue_free();
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef VK_BEGINS_DEVICE_CAPS_H
+#define VK_BEGINS_DEVICE_CAPS_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+constexpr uint32 NullQueueFamily = UINT32_MAX;
+
+// Everything we need to know about a physical device, queried once and then
+// read by every subsystem instead of re-enumerating.
+//
+// The surface independent parts (features, memory, queue families and
+// extensions) can be persisted to disk. They're keyed by vendor, device, driver
+// version and pipeline cache UUID, so a driver update invalidates them.
+struct vkb_DeviceCaps
+{
+	VkPhysicalDevice physicalDevice;
+	VkPhysicalDeviceProperties properties;
+	VkPhysicalDeviceFeatures features;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+
+	VkQueueFamilyProperties* queueFamilies;
+	uint32 queueFamilyCount;
+	VkExtensionProperties* extensions;
+	uint32 extensionCount;
+
+	// Surface dependent, always queried live
+	VkBool32* presentSupport;
+	VkSurfaceCapabilitiesKHR surfaceCapabilities;
+	VkSurfaceFormatKHR* surfaceFormats;
+	uint32 surfaceFormatCount;
+	VkPresentModeKHR* presentModes;
+	uint32 presentModeCount;
+
+	uint32 graphicsFamily;
+	uint32 presentFamily;
+
+	bool loadedFromDisk;
+};
+
+// Pass VK_NULL_HANDLE as the surface for headless use, in which case the present
+// family is the graphics family. cacheDirectory can be nullptr to disable the
+// on-disk cache.
+vkb_DeviceCaps vkb_deviceCaps_query(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, const char* cacheDirectory);
+
+// Surface capabilities change with the window, re-query them before recreating a swap chain
+void vkb_deviceCaps_refreshSurfaceCapabilities(vkb_DeviceCaps& caps, VkSurfaceKHR surface);
+
+bool vkb_deviceCaps_hasExtension(const vkb_DeviceCaps& caps, const char* extensionName);
+
+// Returns UINT32_MAX if no memory type matches
+uint32 vkb_deviceCaps_findMemoryType(const vkb_DeviceCaps& caps, uint32 memoryTypeBits, VkMemoryPropertyFlags properties);
+
+// Format support isn't cached, there are too many formats to query up front
+bool vkb_deviceCaps_supportsFormatFeatures(const vkb_DeviceCaps& caps, VkFormat format, VkFormatFeatureFlags optimalTilingFeatures);
+
+void vkb_deviceCaps_free(vkb_DeviceCaps& caps);
+
+#endif
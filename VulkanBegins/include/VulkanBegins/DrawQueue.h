@@ -0,0 +1,90 @@
+#ifndef VK_BEGINS_DRAW_QUEUE_H
+#define VK_BEGINS_DRAW_QUEUE_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+// Draws are submitted in any order with a 64-bit sort key, radix sorted, then
+// recorded with every bind that matches what's already bound skipped.
+//
+// Key layout, most significant bits first, so sorting groups draws by the most
+// expensive state change first:
+//   pass (4) | pipeline (12) | material (16) | mesh (16) | depth (16)
+static constexpr uint32 vkb_drawPushConstantCount = 2;
+
+struct vkb_DrawCommand
+{
+	VkPipeline pipeline;
+	VkPipelineLayout pipelineLayout;
+	// VK_NULL_HANDLE if the draw doesn't use one
+	VkDescriptorSet descriptorSet;
+	// Pushed at offset 0 before the draw, e.g. the indices of a bindless
+	// material (see Bindless.h). 0 if the draw doesn't push any.
+	VkShaderStageFlags pushConstantStages;
+	uint32 pushConstants[vkb_drawPushConstantCount];
+	VkBuffer vertexBuffer;
+	VkDeviceSize vertexBufferOffset;
+	// Indexed draws use indexCount, firstIndex and vertexOffset in place of
+	// vertexCount and firstVertex. VK_NULL_HANDLE for non-indexed draws.
+	VkBuffer indexBuffer;
+
+	uint32 vertexCount;
+	uint32 instanceCount;
+	uint32 firstVertex;
+	uint32 firstInstance;
+	uint32 indexCount;
+	uint32 firstIndex;
+	int32 vertexOffset;
+};
+
+struct vkb_DrawStats
+{
+	uint32 numDraws;
+	uint32 pipelineBinds;
+	uint32 pipelineBindsElided;
+	uint32 descriptorSetBinds;
+	uint32 descriptorSetBindsElided;
+	uint32 pushConstantUpdates;
+	uint32 pushConstantUpdatesElided;
+	uint32 vertexBufferBinds;
+	uint32 vertexBufferBindsElided;
+	uint32 indexBufferBinds;
+	uint32 indexBufferBindsElided;
+};
+
+struct vkb_DrawSortEntry
+{
+	uint64 key;
+	uint32 commandIndex;
+};
+
+struct vkb_DrawQueue
+{
+	vkb_DrawCommand* commands;
+	vkb_DrawSortEntry* entries;
+	// Ping-pong buffer for the radix sort
+	vkb_DrawSortEntry* sortScratch;
+	uint32 count;
+	uint32 capacity;
+};
+
+// depth is expected in [0, 1] and is clamped, smaller sorts first
+uint64 vkb_drawKey_make(uint32 pass, uint32 pipeline, uint32 material, uint32 mesh, float depth);
+
+vkb_DrawQueue vkb_drawQueue_create(uint32 initialCapacity);
+
+void vkb_drawQueue_clear(vkb_DrawQueue& queue);
+
+// Grows the queue if it's full
+void vkb_drawQueue_push(vkb_DrawQueue& queue, uint64 key, const vkb_DrawCommand& command);
+
+// Stable LSD radix sort on the keys. Large queues are split across the job system.
+void vkb_drawQueue_sort(vkb_DrawQueue& queue);
+
+// Records every draw in sorted order into a command buffer that's inside a
+// render pass. Stats are added to, not overwritten, and may be nullptr.
+void vkb_drawQueue_record(const vkb_DrawQueue& queue, VkCommandBuffer commandBuffer, vkb_DrawStats* stats);
+
+void vkb_drawQueue_free(vkb_DrawQueue& queue);
+
+#endif
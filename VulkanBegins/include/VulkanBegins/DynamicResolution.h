@@ -0,0 +1,31 @@
+#ifndef VK_BEGINS_DYNAMIC_RESOLUTION_H
+#define VK_BEGINS_DYNAMIC_RESOLUTION_H
+
+#include <cppUtils/cppUtils.hpp>
+
+// Picks the scene's render scale from measured GPU frame times so the GPU
+// stays under a frame time target. Scale applies to each axis.
+struct vkb_DynamicResolutionConfig
+{
+	float targetFrameMs;
+	float minScale;
+	float maxScale;
+};
+
+struct vkb_DynamicResolution
+{
+	vkb_DynamicResolutionConfig config;
+	float scale;
+	float smoothedGpuMs;
+	uint32 framesSinceChange;
+};
+
+vkb_DynamicResolutionConfig vkb_dynamicResolution_defaultConfig();
+
+vkb_DynamicResolution vkb_dynamicResolution_create(const vkb_DynamicResolutionConfig& config);
+
+// Feed in the latest GPU frame time, returns the scale to render the next frame at.
+// The scale only moves in steps, so it stays put while the GPU time is steady.
+float vkb_dynamicResolution_update(vkb_DynamicResolution& controller, float gpuFrameMs);
+
+#endif
@@ -13,4 +13,8 @@ vkb_FileContents vkb_file_read(const char* filename);
 
 void vkb_file_free(vkb_FileContents& fileContents);
 
+bool vkb_file_write(const char* filename, const void* data, size_t size);
+
+bool vkb_file_exists(const char* filename);
+
 #endif 
\ No newline at end of file
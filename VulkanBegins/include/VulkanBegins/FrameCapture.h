@@ -0,0 +1,58 @@
+#ifndef VK_BEGINS_FRAME_CAPTURE_H
+#define VK_BEGINS_FRAME_CAPTURE_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+
+// Copies rendered frames into a ring of host visible buffers and writes them to
+// disk from the job system. The render thread never waits on a capture: a slot
+// is only read once the frame that filled it is known to have finished, and if
+// every slot is still busy the frame just isn't captured.
+enum class vkb_FrameCaptureFormat : uint8
+{
+	// One PNG per frame, needs stb_image_write.h on the include path
+	PNG,
+	// One raw I420 (BT.601) file per frame, concatenate them for a video stream
+	YUV420
+};
+
+struct vkb_FrameCaptureConfig
+{
+	const char* outputDirectory;
+	vkb_FrameCaptureFormat format;
+	// 1 captures every frame
+	uint32 everyNthFrame;
+	// Slots in the readback ring, at most 8
+	uint32 ringSize;
+};
+
+struct vkb_FrameCaptureStats
+{
+	uint32 numCaptured;
+	uint32 numWritten;
+	// Frames that should have been captured but had no free slot
+	uint32 numDropped;
+};
+
+vkb_FrameCaptureConfig vkb_frameCapture_defaultConfig();
+
+// Buffers are sized for maxWidth x maxHeight, larger frames are skipped
+void vkb_frameCapture_init(const vkb_Context& ctx, const vkb_FrameCaptureConfig& config, uint32 maxWidth, uint32 maxHeight, VkFormat format);
+
+// Records the copy of image (currently in imageLayout, and left in it) into
+// the next free slot. Returns the command buffer to submit right after the
+// frame's own, or VK_NULL_HANDLE if this frame isn't captured. frameSerial is
+// whatever the caller later passes to collect once the frame has finished.
+VkCommandBuffer vkb_frameCapture_record(VkImage image, VkImageLayout imageLayout, VkExtent2D extent, uint64 frameSerial);
+
+// Hands every slot whose frame serial is <= completedSerial to a job to encode
+void vkb_frameCapture_collect(uint64 completedSerial);
+
+vkb_FrameCaptureStats vkb_frameCapture_getStats();
+
+// Waits for pending writes. The device must be idle.
+void vkb_frameCapture_free();
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef VK_BEGINS_FRAME_PACKET_H
+#define VK_BEGINS_FRAME_PACKET_H
+
+#include <cppUtils/cppUtils.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// Everything the render thread needs from the simulation to draw one frame.
+// The render thread only ever reads the packet, it never reaches back into
+// simulation state.
+struct vkb_FramePacket
+{
+	uint64 frameIndex;
+	double simulationTime;
+
+	float clearColor[4];
+	uint32 drawsPerFrame;
+	bool rebindStatePerDraw;
+	uint32 shaderFeatures;
+	bool instancedScene;
+	bool occlusionCulling;
+	bool sceneMesh;
+	uint32 numLights;
+	bool particles;
+	uint32 numSprites;
+	uint32 numMaterials;
+	bool bindlessMaterials;
+};
+
+// Lock-free triple buffer between one producer (simulation) and one consumer
+// (render thread). The producer always has a slot to write into and the
+// consumer always reads the most recently published packet. Swapping slots
+// never blocks, the mutex is only there for a consumer that sleeps until the
+// next packet and a producer that sleeps until it's taken, instead of polling.
+struct vkb_FramePacketBuffer
+{
+	vkb_FramePacket packets[3];
+	// Index of the slot between the two threads, plus a bit for whether it
+	// holds a packet the consumer hasn't seen yet
+	std::atomic<uint32> middle;
+	uint32 writeIndex;
+	uint32 readIndex;
+
+	std::mutex waitMutex;
+	std::condition_variable published;
+	std::condition_variable taken;
+	bool closed;
+};
+
+void vkb_framePacket_init(vkb_FramePacketBuffer& buffer);
+
+// Producer side. Fill the returned packet, then publish it.
+vkb_FramePacket& vkb_framePacket_beginWrite(vkb_FramePacketBuffer& buffer);
+
+void vkb_framePacket_publish(vkb_FramePacketBuffer& buffer);
+
+// True while a published packet hasn't been picked up by the consumer yet
+bool vkb_framePacket_isPending(const vkb_FramePacketBuffer& buffer);
+
+// Producer side. Sleeps until the consumer has taken the last published packet
+// or the buffer is closed.
+void vkb_framePacket_waitTaken(vkb_FramePacketBuffer& buffer);
+
+// Wakes a waiting consumer for good, once the producer won't publish anymore
+void vkb_framePacket_close(vkb_FramePacketBuffer& buffer);
+
+// Consumer side. Returns nullptr if nothing new was published since the last call.
+const vkb_FramePacket* vkb_framePacket_acquireLatest(vkb_FramePacketBuffer& buffer);
+
+// Consumer side. Sleeps until a packet is pending or the buffer is closed, and
+// returns false once it's closed.
+bool vkb_framePacket_wait(vkb_FramePacketBuffer& buffer);
+
+#endif
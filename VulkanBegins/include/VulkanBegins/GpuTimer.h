@@ -0,0 +1,35 @@
+#ifndef VK_BEGINS_GPU_TIMER_H
+#define VK_BEGINS_GPU_TIMER_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+
+// Timestamp query pairs for timing GPU work. Each scope is a begin and end
+// timestamp, results are read back without waiting once the work has finished.
+struct vkb_GpuTimer
+{
+	VkQueryPool queryPool;
+	uint32 numScopes;
+	float timestampPeriodNs;
+	uint64 timestampMask;
+	// False if the graphics queue can't write timestamps, every call is a no-op then
+	bool supported;
+};
+
+vkb_GpuTimer vkb_gpuTimer_create(const vkb_Context& ctx, uint32 numScopes);
+
+// Queries have to be reset before they're written again. Records outside a render pass.
+void vkb_gpuTimer_reset(const vkb_GpuTimer& timer, VkCommandBuffer commandBuffer);
+
+void vkb_gpuTimer_begin(const vkb_GpuTimer& timer, VkCommandBuffer commandBuffer, uint32 scope);
+
+void vkb_gpuTimer_end(const vkb_GpuTimer& timer, VkCommandBuffer commandBuffer, uint32 scope);
+
+// Returns false if the scope's results aren't available yet
+bool vkb_gpuTimer_read(const vkb_Context& ctx, const vkb_GpuTimer& timer, uint32 scope, float* milliseconds);
+
+void vkb_gpuTimer_free(const vkb_Context& ctx, vkb_GpuTimer& timer);
+
+#endif
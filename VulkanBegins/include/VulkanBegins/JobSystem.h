@@ -0,0 +1,55 @@
+#ifndef VK_BEGINS_JOB_SYSTEM_H
+#define VK_BEGINS_JOB_SYSTEM_H
+
+#include <cppUtils/cppUtils.hpp>
+
+#include <atomic>
+
+// Work-stealing job scheduler shared by everything that goes wide: startup
+// tasks, transform updates, draw sorting and frame capture writes.
+//
+// Every thread that submits jobs gets its own deque. The owner pushes and pops
+// at the bottom, idle threads steal from the top of someone else's. Waiting on
+// a counter runs other jobs instead of blocking, so jobs can wait on jobs.
+typedef void (*vkb_JobFn)(void* userData);
+typedef void (*vkb_JobRangeFn)(uint32 start, uint32 end, void* userData);
+
+// Counts jobs that haven't finished yet. Zero initialize it before use.
+struct vkb_JobCounter
+{
+	std::atomic<uint32> value;
+};
+
+// numWorkers doesn't include the calling thread, which takes part in the work
+// whenever it waits. Negative uses one worker per remaining hardware thread.
+void vkb_jobs_init(int32 numWorkers = -1);
+
+// counter may be nullptr for fire and forget jobs
+void vkb_jobs_run(vkb_JobFn fn, void* userData, vkb_JobCounter* counter);
+
+// Splits [0, count) into jobs of at most batchSize items
+void vkb_jobs_parallelFor(uint32 count, uint32 batchSize, vkb_JobRangeFn fn, void* userData, vkb_JobCounter* counter);
+
+// Runs queued jobs on the calling thread until the counter hits zero
+void vkb_jobs_wait(vkb_JobCounter* counter);
+
+// Runs one queued job on the calling thread if there is one, for loops that
+// need to do their own thing between jobs
+bool vkb_jobs_runPending();
+
+// Only the first count workers pick up jobs, the rest sleep until it's raised
+// again. Starts out at every worker. Lets benchmarks measure scaling without
+// restarting the scheduler.
+void vkb_jobs_setActiveWorkers(uint32 count);
+
+// Workers plus the thread that called vkb_jobs_init
+uint32 vkb_jobs_numThreads();
+
+// Index of the calling thread's deque, 0 is the thread that called vkb_jobs_init.
+// It stays the same for the thread's lifetime and is reused once the thread exits.
+uint32 vkb_jobs_threadIndex();
+
+// Waits for every worker to finish its current job and joins them
+void vkb_jobs_free();
+
+#endif
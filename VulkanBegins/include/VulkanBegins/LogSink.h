@@ -0,0 +1,45 @@
+#ifndef VK_BEGINS_LOG_SINK_H
+#define VK_BEGINS_LOG_SINK_H
+
+#include <cppUtils/cppUtils.hpp>
+
+// Asynchronous log sink for messages raised on threads we don't own, like the
+// validation layer's debug callback.
+//
+// Producers only copy the message into a lock-free ring, a background thread
+// formats and prints it. Identical messages are only printed once and each
+// message ID is rate limited, everything that got suppressed is summarised
+// when the sink is freed.
+enum class vkb_LogSeverity : uint8
+{
+	Verbose,
+	Info,
+	Warning,
+	Error
+};
+
+struct vkb_LogSinkStats
+{
+	uint64 numPushed;
+	// Ring was full, the message was never seen by the sink thread
+	uint64 numDropped;
+	// Identical to a message already printed for the same ID
+	uint64 numDuplicates;
+	// Over the per ID or global messages per second budget
+	uint64 numRateLimited;
+};
+
+// Messages are printed as "<name>: <message>". capacity is rounded up to a power of two.
+void vkb_logSink_init(const char* name, uint32 capacity = 256);
+
+// Lock-free and safe to call from any thread. Messages longer than the slot size
+// are truncated. If the sink isn't running the message is logged synchronously.
+void vkb_logSink_push(vkb_LogSeverity severity, int32 messageId, const char* messageIdName, const char* message);
+
+vkb_LogSinkStats vkb_logSink_getStats();
+
+// Drains whatever is left in the ring, prints the suppression summary and joins
+// the sink thread. Nothing may be pushing while this runs.
+void vkb_logSink_free();
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef VK_BEGINS_MATERIAL_LIBRARY_H
+#define VK_BEGINS_MATERIAL_LIBRARY_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+struct vkb_FileContents;
+struct vkb_DrawQueue;
+struct vkb_BindlessHeap;
+
+// A set of simple materials, each a mipped texture plus a tint in a storage
+// buffer, that can be drawn either way a renderer binds materials:
+//
+//   PerMaterialSet: every material has its own descriptor set, so the draw
+//                   queue rebinds a set whenever the material changes
+//   Bindless:       every texture and tint lives in the bindless heap (see
+//                   Bindless.h), which is bound once, and draws only differ by
+//                   the two indices they push
+//
+// The textures go through the residency manager (see Residency.h) at Normal or
+// Low priority, so they lose mips, or are evicted outright, when their heap is
+// over budget.
+enum class vkb_MaterialBinding : uint8
+{
+	PerMaterialSet,
+	Bindless,
+
+	Count
+};
+
+struct vkb_MaterialLibraryDesc
+{
+	uint32 numMaterials;
+	// nullptr if descriptor indexing isn't supported, only PerMaterialSet works then
+	vkb_BindlessHeap* bindlessHeap;
+	// SPIR-V for material.vert, material.frag and material_bindless.frag. The
+	// bindless one is only needed with a heap.
+	const vkb_FileContents* vertShader;
+	const vkb_FileContents* fragShader;
+	const vkb_FileContents* bindlessFragShader;
+	// The materials are drawn in subpass 0 of render passes compatible with this one
+	VkRenderPass renderPass;
+	VkPipelineCache pipelineCache;
+};
+
+struct vkb_MaterialLibrary;
+
+// Waits for the graphics queue to fill the textures
+vkb_MaterialLibrary* vkb_materialLibrary_create(const vkb_Context& ctx, const vkb_MaterialLibraryDesc& desc);
+
+bool vkb_materialLibrary_supportsBinding(const vkb_MaterialLibrary* materials, vkb_MaterialBinding binding);
+
+// With Bindless the heap has to be bound as set 0 of this layout before the draws are recorded
+VkPipelineLayout vkb_materialLibrary_getPipelineLayout(const vkb_MaterialLibrary* materials, vkb_MaterialBinding binding);
+
+// Pushes numDraws draws that cycle through the first numMaterials materials.
+// Each draw is one triangle placed by its index.
+void vkb_materialLibrary_pushDraws(const vkb_MaterialLibrary* materials, vkb_DrawQueue& queue, vkb_MaterialBinding binding, uint32 numDraws, uint32 numMaterials);
+
+// Fills the textures residency changes rebuilt since the last call. Records
+// outside a render pass, before the draws.
+void vkb_materialLibrary_recordUploads(vkb_MaterialLibrary* materials, VkCommandBuffer commandBuffer);
+
+// Marks the first numMaterials textures used, see vkb_residency_markUsed
+void vkb_materialLibrary_markUsed(const vkb_MaterialLibrary* materials, uint32 numMaterials, uint64 frameIndex);
+
+uint32 vkb_materialLibrary_getNumMaterials(const vkb_MaterialLibrary* materials);
+
+// The device must be idle. Releases the materials' heap slots, the heap itself stays.
+void vkb_materialLibrary_free(const vkb_Context& ctx, vkb_MaterialLibrary* materials);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef VK_BEGINS_MESH_H
+#define VK_BEGINS_MESH_H
+
+#include <cppUtils/cppUtils.hpp>
+
+// Meshes are converted offline by the MeshConverter tool into .vkbmesh files:
+// one vertex buffer shared by every level of detail, and one index buffer with
+// each LOD's triangles stored one after the other, full detail first.
+static constexpr uint32 vkb_maxMeshLods = 8;
+
+struct vkb_MeshVertex
+{
+	float position[3];
+	float normal[3];
+	float uv[2];
+};
+
+struct vkb_MeshLod
+{
+	uint32 firstIndex;
+	uint32 indexCount;
+	// Object space distance from the full detail surface, 0 for LOD 0
+	float error;
+};
+
+struct vkb_MeshData
+{
+	vkb_MeshVertex* vertices;
+	uint32 numVertices;
+	uint32* indices;
+	uint32 numIndices;
+
+	vkb_MeshLod lods[vkb_maxMeshLods];
+	uint32 numLods;
+
+	// Bounding sphere in object space
+	float boundsCenter[3];
+	float boundsRadius;
+};
+
+// Allocates the vertex and index arrays, the rest is left zeroed
+vkb_MeshData vkb_mesh_create(uint32 numVertices, uint32 numIndices);
+
+// Recomputes the bounding sphere from the vertices
+void vkb_mesh_computeBounds(vkb_MeshData& mesh);
+
+bool vkb_mesh_write(const char* filename, const vkb_MeshData& mesh);
+
+// Returns false and leaves mesh empty if the file is missing or isn't a
+// .vkbmesh of the current version
+bool vkb_mesh_read(const char* filename, vkb_MeshData* mesh);
+
+void vkb_mesh_free(vkb_MeshData& mesh);
+
+#endif
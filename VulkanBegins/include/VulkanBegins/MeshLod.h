@@ -0,0 +1,59 @@
+#ifndef VK_BEGINS_MESH_LOD_H
+#define VK_BEGINS_MESH_LOD_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <glm/vec3.hpp>
+
+#include "VulkanBegins/Mesh.h"
+
+struct vkb_TransformSystem;
+struct vkb_DrawQueue;
+struct vkb_DrawCommand;
+
+// Per instance LOD selection by screen space error. Each instance gets the
+// coarsest LOD whose error, projected at the instance's distance, stays under
+// maxPixelError. Instances are then grouped by LOD so every LOD is a single
+// instanced draw.
+struct vkb_MeshLodView
+{
+	glm::vec3 cameraPosition;
+	// Vertical field of view in radians
+	float fovY;
+	float viewportHeight;
+	float maxPixelError;
+};
+
+struct vkb_MeshLodStats
+{
+	uint32 numInstances;
+	uint32 instancesPerLod[vkb_maxMeshLods];
+	uint64 trianglesDrawn;
+	// What drawing every instance at LOD 0 would have cost
+	uint64 trianglesFullDetail;
+};
+
+// Pixels per world unit at distance 1 from the camera
+float vkb_meshLod_projectionScale(const vkb_MeshLodView& view);
+
+// distance is from the camera to the nearest point of the instance's bounds,
+// scale the instance's largest axis scale
+uint32 vkb_meshLod_select(const vkb_MeshData& mesh, float distance, float scale, float projectionScale, float maxPixelError);
+
+// Picks a LOD for every transform and writes the transform indices to
+// instanceOrder grouped by LOD, LOD 0 first. LOD i's instances are
+// instanceOrder[lodOffsets[i]] up to instanceOrder[lodOffsets[i + 1]], so
+// lodOffsets needs vkb_maxMeshLods + 1 entries. stats may be nullptr.
+void vkb_meshLod_bucketInstances(const vkb_MeshData& mesh, const vkb_TransformSystem& transforms, const vkb_MeshLodView& view, uint32* instanceOrder, uint32* lodOffsets, vkb_MeshLodStats* stats);
+
+// Same as above for only the transforms whose indices are in subset, e.g. the
+// ones that survived culling. instanceOrder still holds transform indices.
+void vkb_meshLod_bucketSubset(const vkb_MeshData& mesh, const vkb_TransformSystem& transforms, const uint32* subset, uint32 subsetCount, const vkb_MeshLodView& view, uint32* instanceOrder, uint32* lodOffsets, vkb_MeshLodStats* stats);
+
+// Pushes one indexed, instanced draw per non-empty LOD. Each draw's firstInstance
+// is its LOD's offset in instanceOrder, so the instance buffer has to be
+// written in that order. drawTemplate supplies everything but the index range
+// and instances, and has to reference the mesh's index buffer. LODs take mesh
+// keys meshKey * vkb_maxMeshLods + lod.
+void vkb_meshLod_pushDraws(vkb_DrawQueue& queue, const vkb_MeshData& mesh, const uint32* lodOffsets, const vkb_DrawCommand& drawTemplate, uint32 pass, uint32 pipeline, uint32 material, uint32 meshKey);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef VK_BEGINS_MESH_SIMPLIFY_H
+#define VK_BEGINS_MESH_SIMPLIFY_H
+
+#include <cppUtils/cppUtils.hpp>
+
+struct vkb_MeshVertex;
+struct vkb_MeshData;
+
+// Quadric error simplification by half-edge collapse: a vertex is only ever
+// merged into one of its neighbours, never moved, so every LOD indexes the same
+// vertex buffer. The two vertices on either side of an attribute seam (same
+// position, different normals or uvs) collapse together along the seam, where
+// seams meet they stay put, and open borders only collapse along themselves.
+//
+// Writes the simplified triangles to dstIndices, which needs room for
+// numIndices, and returns how many indices it wrote. Stops early when no
+// collapse is left that wouldn't flip a triangle, so the result can have more
+// than targetIndexCount indices. error receives the object space distance the
+// surface moved by, at most.
+uint32 vkb_meshSimplify_run(uint32* dstIndices, const uint32* indices, uint32 numIndices, const vkb_MeshVertex* vertices, uint32 numVertices, uint32 targetIndexCount, float* error);
+
+// Replaces mesh.indices, which has to hold only full detail triangles, with the
+// full LOD chain. Each LOD aims for reductionRatio of the previous one's
+// triangles and is simplified from full detail so errors don't compound. The
+// chain ends at maxLods, at minTriangles, or when simplification gets stuck.
+void vkb_meshSimplify_generateLods(vkb_MeshData& mesh, uint32 maxLods, float reductionRatio, uint32 minTriangles);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef VK_BEGINS_OCCLUSION_CULLING_H
+#define VK_BEGINS_OCCLUSION_CULLING_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+#include <glm/mat4x4.hpp>
+
+struct vkb_Context;
+struct vkb_FileContents;
+
+// GPU occlusion culling against a hierarchical depth (Hi-Z) pyramid, where each
+// mip keeps the farthest depth of the texels it covers. Instances are culled in
+// two phases every frame:
+//
+//   Early: instances visible last frame are tested against last frame's
+//          pyramid and the survivors are drawn. That depth is the occluder set.
+//   Late:  the pyramid is rebuilt from the early depth and every instance is
+//          tested against it. Visible instances the early phase didn't draw
+//          (disoccluded ones) are drawn on top, and the results become next
+//          frame's visibility.
+//
+// Both phases write the ids of the instances that pass into a buffer the draw's
+// vertex shader reads through gl_InstanceIndex, and the instance count of an
+// indirect draw, so the CPU never sees the results except as stats.
+static constexpr uint32 vkb_maxHiZLevels = 16;
+
+// Bounding sphere in the space viewProj transforms from
+struct vkb_OcclusionInstance
+{
+	float center[3];
+	float radius;
+};
+
+enum class vkb_OcclusionPhase : uint8
+{
+	Early,
+	Late
+};
+
+struct vkb_OcclusionCullerDesc
+{
+	uint32 maxInstances;
+	// Vertices drawn per instance
+	uint32 vertexCount;
+	// Layout of the draw's descriptor set. Binding 0 has to be a storage buffer
+	// of uint instance ids, indexed with gl_InstanceIndex.
+	VkDescriptorSetLayout instanceSetLayout;
+	// SPIR-V for hiz_downsample.comp and occlusion_cull.comp
+	const vkb_FileContents* downsampleShader;
+	const vkb_FileContents* cullShader;
+	VkPipelineCache pipelineCache;
+};
+
+// Results of the last frame that finished
+struct vkb_OcclusionStats
+{
+	uint32 numInstances;
+	uint32 numDrawnEarly;
+	uint32 numDrawnLate;
+	uint32 numOccluded;
+	uint32 numOutsideFrustum;
+};
+
+struct vkb_OcclusionCuller;
+
+// depthView is sampled while it's in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+// so the early render pass has to leave it there. Waits for the graphics queue
+// to clear the pyramid.
+vkb_OcclusionCuller* vkb_occlusionCuller_create(const vkb_Context& ctx, const vkb_OcclusionCullerDesc& desc, VkImageView depthView, VkExtent2D depthExtent);
+
+// Goes through the staging buffer, flush it before the next frame draws. Every
+// instance starts out as not visible last frame.
+void vkb_occlusionCuller_setInstances(const vkb_Context& ctx, vkb_OcclusionCuller* culler, const vkb_OcclusionInstance* instances, uint32 numInstances);
+
+// Rebuilds the pyramid for a new depth target. The old one is retired through
+// the deletion queue, but this waits for the graphics queue to clear the new one.
+void vkb_occlusionCuller_setDepthTarget(const vkb_Context& ctx, vkb_OcclusionCuller* culler, VkImageView depthView, VkExtent2D depthExtent, uint64 retireValue);
+
+// Records outside a render pass. The early phase also resets the frame's draws and stats.
+void vkb_occlusionCuller_recordCull(vkb_OcclusionCuller* culler, VkCommandBuffer commandBuffer, vkb_OcclusionPhase phase, const glm::mat4& viewProj);
+
+// Records inside a render pass with the draw's pipeline bound. Binds the
+// instance set to set 0 of pipelineLayout.
+void vkb_occlusionCuller_recordDraw(vkb_OcclusionCuller* culler, VkCommandBuffer commandBuffer, vkb_OcclusionPhase phase, VkPipelineLayout pipelineLayout);
+
+// Records between the early and late phases, after the early render pass
+void vkb_occlusionCuller_recordBuildPyramid(vkb_OcclusionCuller* culler, VkCommandBuffer commandBuffer);
+
+// Only call once the frame's fence has signaled
+vkb_OcclusionStats vkb_occlusionCuller_readStats(const vkb_OcclusionCuller* culler);
+
+// The device must be idle
+void vkb_occlusionCuller_free(const vkb_Context& ctx, vkb_OcclusionCuller* culler);
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef VK_BEGINS_PARTICLE_SYSTEM_H
+#define VK_BEGINS_PARTICLE_SYSTEM_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+struct vkb_FileContents;
+
+// Particles that live entirely on the GPU. Their state is kept as structure of
+// arrays in storage buffers and every frame runs through compute:
+//
+//   Prepare:  snapshots last frame's alive count into the simulate dispatch's
+//             indirect arguments and flips which alive list is appended to
+//   Emit:     pops free particles off the dead list and appends them
+//   Simulate: ages and moves every particle of last frame's alive list, pushes
+//             the ones that died back onto the dead list and compacts the rest
+//             into this frame's alive list
+//
+// The compacted count is the instance count of an indirect draw, so the CPU
+// only ever records the same few commands and writes a small uniform buffer.
+// Everything lives in view space like the rest of the scene.
+struct vkb_ParticleEmitterDesc
+{
+	float position[3];
+	// Initial velocity, each particle adds up to spread in every axis on top
+	float velocity[3];
+	float spread;
+	float gravity[3];
+	// Particles live between lifetime and lifetime + lifetimeJitter seconds
+	float lifetime;
+	float lifetimeJitter;
+	// Half the width of a particle's quad
+	float size;
+	// Particles emitted per second, emission stops while none are free
+	float emissionRate;
+};
+
+// Projection the particles are drawn with. The camera looks down -z.
+struct vkb_ParticleView
+{
+	float tanHalfFovX;
+	float tanHalfFovY;
+	float nearZ;
+	float farZ;
+};
+
+struct vkb_ParticleSystemDesc
+{
+	uint32 maxParticles;
+	// Emission is clamped to this many particles per frame, it bounds the
+	// emit dispatch, which doesn't depend on the frame's emission
+	uint32 maxEmitPerFrame;
+	vkb_ParticleEmitterDesc emitter;
+	// SPIR-V for particles.comp, particle.vert and particle.frag
+	const vkb_FileContents* computeShader;
+	const vkb_FileContents* vertShader;
+	const vkb_FileContents* fragShader;
+	// The particles are drawn in subpass 0 of render passes compatible with this
+	// one. It needs a depth attachment, which they test against without writing.
+	VkRenderPass renderPass;
+	VkPipelineCache pipelineCache;
+};
+
+// Results of the last frame that finished
+struct vkb_ParticleStats
+{
+	uint32 numAlive;
+	uint32 numFree;
+	uint32 numEmitted;
+	uint32 numDied;
+
+	// GPU time of the compute passes and of the draw. Both are zero if the
+	// queue can't write timestamps.
+	bool timingSupported;
+	float simulateMs;
+	float drawMs;
+};
+
+struct vkb_ParticleSystem;
+
+// Waits for the graphics queue to fill the dead list
+vkb_ParticleSystem* vkb_particleSystem_create(const vkb_Context& ctx, const vkb_ParticleSystemDesc& desc);
+
+// Writes the frame's parameters straight into mapped memory, so only call this
+// once the previous frame using them has finished
+void vkb_particleSystem_update(vkb_ParticleSystem* particles, float deltaTime, const vkb_ParticleView& view);
+
+// Records outside a render pass, before the draw. Doesn't depend on anything
+// passed to update, so the commands can be recorded once and resubmitted.
+void vkb_particleSystem_recordSimulate(vkb_ParticleSystem* particles, VkCommandBuffer commandBuffer);
+
+// Records inside the render pass, viewport and scissor have to be set
+void vkb_particleSystem_recordDraw(vkb_ParticleSystem* particles, VkCommandBuffer commandBuffer);
+
+// Marks the per particle buffers used, see vkb_residency_markUsed
+void vkb_particleSystem_markUsed(const vkb_ParticleSystem* particles, uint64 frameIndex);
+
+// Only call once the frame's fence has signaled
+vkb_ParticleStats vkb_particleSystem_readStats(const vkb_Context& ctx, const vkb_ParticleSystem* particles);
+
+// The device must be idle
+void vkb_particleSystem_free(const vkb_Context& ctx, vkb_ParticleSystem* particles);
+
+#endif
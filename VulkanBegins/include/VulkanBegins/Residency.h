@@ -0,0 +1,118 @@
+#ifndef VK_BEGINS_RESIDENCY_H
+#define VK_BEGINS_RESIDENCY_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+
+// Tracks device memory usage per heap against its budget and keeps streamed
+// resources inside it. When a heap goes over budget the least important, least
+// recently used resources give memory back: textures drop their top mip one at
+// a time and meshes are evicted outright. Once there's room again, resources
+// that are still being used get their detail back in the opposite order.
+//
+// The budget comes from VK_EXT_memory_budget when it's enabled. Without it we
+// only know about memory allocated through vkb_residency_allocateMemory and
+// assume a fixed fraction of each heap is ours to use.
+enum class vkb_StreamingPriority : uint8
+{
+	Low,
+	Normal,
+	High,
+	// Never evicted or downgraded
+	Critical
+};
+
+// Frees or reloads the resource's data so only mips firstResidentMip and below
+// are resident. firstResidentMip == numMips means nothing is resident. Returns
+// how many bytes the resource occupies afterwards.
+typedef VkDeviceSize (*vkb_ResidencyChangeFn)(uint32 firstResidentMip, void* userData);
+
+struct vkb_ResidentResourceDesc
+{
+	vkb_StreamingPriority priority;
+	uint32 memoryTypeIndex;
+	// Meshes have one
+	uint32 numMips;
+	// Size with every mip resident
+	VkDeviceSize fullSize;
+	// Never called for Critical resources, they can leave it null
+	vkb_ResidencyChangeFn changeResidency;
+	void* userData;
+};
+
+struct vkb_ResidencyConfig
+{
+	// Usage is brought back down to this fraction of the budget once it's exceeded
+	float targetUsage;
+	// Detail is only restored while usage is below this fraction of the budget
+	float restoreBelow;
+	// Fraction of each heap assumed to be ours without VK_EXT_memory_budget
+	float fallbackBudget;
+	// Resources unused for this many frames aren't restored
+	uint32 restoreWindowFrames;
+};
+
+struct vkb_ResidencyHeapStats
+{
+	VkDeviceSize usage;
+	VkDeviceSize budget;
+	VkDeviceSize size;
+};
+
+struct vkb_ResidencyStats
+{
+	vkb_ResidencyHeapStats heaps[VK_MAX_MEMORY_HEAPS];
+	uint32 numHeaps;
+	// False when the budget is the fallback estimate
+	bool budgetFromDriver;
+
+	uint32 numResources;
+	uint32 numDowngraded;
+	uint32 numEvicted;
+	// Totals since init
+	uint32 numMipsDropped;
+	uint32 numMipsRestored;
+};
+
+typedef uint32 vkb_ResidentResource;
+constexpr vkb_ResidentResource vkb_nullResidentResource = UINT32_MAX;
+
+vkb_ResidencyConfig vkb_residency_defaultConfig();
+
+void vkb_residency_init(const vkb_Context& ctx, const vkb_ResidencyConfig& config);
+
+// Allocates memory with a VK_EXT_memory_priority hint for priority when it's
+// enabled, and counts it against the heap for the fallback budget
+VkResult vkb_residency_allocateMemory(const vkb_Context& ctx, const VkMemoryAllocateInfo& allocInfo, vkb_StreamingPriority priority, VkDeviceMemory* memory);
+
+// Frees through the deletion queue, evicted data may still be in use by frames
+// in flight. The heap's tracked usage drops right away.
+void vkb_residency_freeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32 memoryTypeIndex, uint64 retireValue);
+
+// The resource starts out fully resident
+vkb_ResidentResource vkb_residency_register(const vkb_ResidentResourceDesc& desc);
+
+void vkb_residency_unregister(vkb_ResidentResource resource);
+
+// Call for every resource a frame draws with. Frame indices are the app's
+// frame serial, see vkb_app_getFrameSerial.
+void vkb_residency_markUsed(vkb_ResidentResource resource, uint64 frameIndex);
+
+uint32 vkb_residency_getFirstResidentMip(vkb_ResidentResource resource);
+
+// Refreshes the budgets and evicts or restores to fit them. Call once a frame
+// from the thread that owns the resources.
+void vkb_residency_update(uint64 frameIndex);
+
+vkb_ResidencyStats vkb_residency_getStats();
+
+// Caps the heap's budget at limit bytes, 0 lifts the cap. For forcing eviction
+// on a device with plenty of memory.
+void vkb_residency_setBudgetLimit(uint32 heapIndex, VkDeviceSize limit);
+
+// Every resource must be unregistered first
+void vkb_residency_free();
+
+#endif
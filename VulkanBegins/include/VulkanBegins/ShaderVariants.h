@@ -0,0 +1,56 @@
+#ifndef VK_BEGINS_SHADER_VARIANTS_H
+#define VK_BEGINS_SHADER_VARIANTS_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+
+// Shader feature toggles compiled in with specialization constants instead of
+// branched on at runtime. A variant is a bitmask of features, where feature i
+// is the bool specialization constant with constant_id i in every stage that
+// declares it. Pipelines are only created the first time a variant is asked
+// for, so the driver constant folds the unused paths of just the combinations
+// that actually get drawn.
+static constexpr uint32 vkb_maxShaderFeatures = 32;
+
+// Creates the pipeline for one variant. specialization goes in every stage's
+// pSpecializationInfo and is only valid during the call.
+typedef VkPipeline (*vkb_PipelineVariantCreateFn)(const VkSpecializationInfo& specialization, void* userData);
+
+struct vkb_ShaderSpecialization
+{
+	VkSpecializationMapEntry entries[vkb_maxShaderFeatures];
+	VkBool32 values[vkb_maxShaderFeatures];
+	VkSpecializationInfo info;
+};
+
+struct vkb_ShaderVariantStats
+{
+	uint32 numVariants;
+	uint32 numHits;
+	uint32 numMisses;
+	// Total time spent creating variant pipelines
+	float compileMs;
+};
+
+struct vkb_ShaderVariantCache;
+
+// Fills in the specialization constants for a variant. info points into specialization.
+void vkb_shaderVariant_makeSpecialization(uint32 numFeatures, uint32 features, vkb_ShaderSpecialization* specialization);
+
+vkb_ShaderVariantCache* vkb_shaderVariantCache_create(const char* name, uint32 numFeatures, vkb_PipelineVariantCreateFn createFn, void* userData = nullptr);
+
+// Returns the variant's pipeline, creating it on first use. Thread safe.
+VkPipeline vkb_shaderVariantCache_get(vkb_ShaderVariantCache* cache, uint32 features);
+
+// Hands every cached pipeline to the deletion queue, they're created again the
+// next time they're asked for
+void vkb_shaderVariantCache_retireAll(vkb_ShaderVariantCache* cache, uint64 retireValue);
+
+vkb_ShaderVariantStats vkb_shaderVariantCache_getStats(vkb_ShaderVariantCache* cache);
+
+// Destroys the cached pipelines. The device must be idle.
+void vkb_shaderVariantCache_free(const vkb_Context& ctx, vkb_ShaderVariantCache* cache);
+
+#endif
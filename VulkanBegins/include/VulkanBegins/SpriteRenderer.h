@@ -0,0 +1,105 @@
+#ifndef VK_BEGINS_SPRITE_RENDERER_H
+#define VK_BEGINS_SPRITE_RENDERER_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+struct vkb_Context;
+struct vkb_FileContents;
+
+// Batched 2D sprites for UI and overlays. Images are packed into a few large
+// atlas textures as they're added (see AtlasPacker.h) and uploaded a budget's
+// worth at a time into just the region they were packed into. Each frame's
+// sprites are streamed into one vertex buffer and sorted by layer, blend mode
+// and atlas, so every run of sprites that shares an atlas and a blend mode is
+// a single draw.
+//
+// Sprites are in pixels with the origin at the top left of the render target.
+// Order only holds between layers, sprites within a layer can be reordered to
+// batch them.
+typedef uint32 vkb_SpriteImageId;
+static constexpr vkb_SpriteImageId vkb_invalidSpriteImage = UINT32_MAX;
+
+enum class vkb_SpriteBlend : uint8
+{
+	// Premultiplied alpha
+	Alpha,
+	Additive,
+
+	Count
+};
+
+struct vkb_Sprite
+{
+	float position[2];
+	float size[2];
+	// RGBA8, red in the lowest byte, multiplied with the image
+	uint32 color;
+	vkb_SpriteImageId image;
+	vkb_SpriteBlend blend;
+	uint8 layer;
+};
+
+struct vkb_SpriteRendererDesc
+{
+	// Width and height of every atlas, images larger than this can't be added
+	uint32 atlasSize;
+	uint32 maxAtlases;
+	uint32 maxImages;
+	uint32 maxSpritesPerFrame;
+	// Size of the upload staging buffer, images that don't fit in one frame's
+	// budget wait for the next
+	VkDeviceSize uploadBytesPerFrame;
+	// SPIR-V for sprite.vert and sprite.frag
+	const vkb_FileContents* vertShader;
+	const vkb_FileContents* fragShader;
+	// The sprites are drawn in subpass 0 of render passes compatible with this one
+	VkRenderPass renderPass;
+	VkPipelineCache pipelineCache;
+};
+
+// Results of the last recorded frame
+struct vkb_SpriteStats
+{
+	uint32 numSprites;
+	// One draw per sprite is what drawing them one by one would have cost
+	uint32 drawsBeforeBatching;
+	uint32 drawsAfterBatching;
+	// Sprites skipped because their image wasn't uploaded yet
+	uint32 numNotResident;
+	uint32 numAtlases;
+	uint32 numPendingUploads;
+	uint64 uploadedBytes;
+};
+
+struct vkb_SpriteRenderer;
+
+vkb_SpriteRenderer* vkb_spriteRenderer_create(const vkb_Context& ctx, const vkb_SpriteRendererDesc& desc);
+
+// Copies pixels, tightly packed RGBA8 with premultiplied alpha, and packs the
+// image into an atlas. It's drawable once a later recordUploads has uploaded
+// it. Returns vkb_invalidSpriteImage if there's no room left.
+vkb_SpriteImageId vkb_spriteRenderer_addImage(const vkb_Context& ctx, vkb_SpriteRenderer* sprites, const uint8* pixels, uint32 width, uint32 height);
+
+// Starts a new frame's sprites. The streamed vertices and the staging buffer
+// are written in place, so only call this once the previous frame has finished.
+void vkb_spriteRenderer_beginFrame(vkb_SpriteRenderer* sprites);
+
+// Sprites past maxSpritesPerFrame are dropped
+void vkb_spriteRenderer_draw(vkb_SpriteRenderer* sprites, const vkb_Sprite& sprite);
+
+// Records outside a render pass, before the draw
+void vkb_spriteRenderer_recordUploads(vkb_SpriteRenderer* sprites, VkCommandBuffer commandBuffer);
+
+// Records inside the render pass, viewport and scissor have to be set to targetExtent
+void vkb_spriteRenderer_recordDraw(vkb_SpriteRenderer* sprites, VkCommandBuffer commandBuffer, VkExtent2D targetExtent);
+
+// Marks every atlas used, see vkb_residency_markUsed
+void vkb_spriteRenderer_markUsed(const vkb_SpriteRenderer* sprites, uint64 frameIndex);
+
+vkb_SpriteStats vkb_spriteRenderer_getStats(const vkb_SpriteRenderer* sprites);
+
+// The device must be idle
+void vkb_spriteRenderer_free(const vkb_Context& ctx, vkb_SpriteRenderer* sprites);
+
+#endif
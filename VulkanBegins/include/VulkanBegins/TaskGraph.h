@@ -0,0 +1,31 @@
+#ifndef VK_BEGINS_TASK_GRAPH_H
+#define VK_BEGINS_TASK_GRAPH_H
+
+#include <cppUtils/cppUtils.hpp>
+
+// A one-shot dependency graph of tasks run on the job system. Every task
+// is timed, so after a run the graph can print or write out a timeline of
+// where the time went.
+typedef void (*vkb_TaskFn)(void* userData);
+
+struct vkb_TaskGraph;
+
+vkb_TaskGraph* vkb_taskGraph_create(const char* name, uint32 maxTasks);
+
+// Main thread tasks are only ever run by the thread that calls vkb_taskGraph_run
+uint32 vkb_taskGraph_addTask(vkb_TaskGraph* graph, const char* name, vkb_TaskFn fn, void* userData = nullptr, bool mainThreadOnly = false);
+
+void vkb_taskGraph_addDependency(vkb_TaskGraph* graph, uint32 task, uint32 dependsOn);
+
+// Blocks until every task has run, helping with queued jobs in the meantime.
+// Needs vkb_jobs_init.
+void vkb_taskGraph_run(vkb_TaskGraph* graph);
+
+void vkb_taskGraph_logTimeline(const vkb_TaskGraph* graph);
+
+// Writes the timeline in the Chrome trace event format (chrome://tracing, Perfetto)
+void vkb_taskGraph_writeTimeline(const vkb_TaskGraph* graph, const char* filename);
+
+void vkb_taskGraph_free(vkb_TaskGraph* graph);
+
+#endif
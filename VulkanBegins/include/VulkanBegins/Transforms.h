@@ -0,0 +1,64 @@
+#ifndef VK_BEGINS_TRANSFORMS_H
+#define VK_BEGINS_TRANSFORMS_H
+
+#include <cppUtils/cppUtils.hpp>
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Per-object transforms stored as structure of arrays so the matrix kernels can
+// compute 4 (SSE) or 8 (AVX2) objects per iteration.
+struct vkb_TransformSystem
+{
+	float* positionX;
+	float* positionY;
+	float* positionZ;
+	float* rotationX;
+	float* rotationY;
+	float* rotationZ;
+	float* rotationW;
+	float* scaleX;
+	float* scaleY;
+	float* scaleZ;
+
+	uint32 count;
+	uint32 capacity;
+};
+
+// Layout of one instance in the instance buffer
+struct vkb_InstanceData
+{
+	glm::mat4 world;
+	glm::mat4 worldViewProj;
+};
+
+enum class vkb_TransformKernel : uint8
+{
+	Scalar,
+	SSE,
+	// AVX2 with FMA3
+	AVX2,
+	// Widest kernel the CPU supports
+	Best
+};
+
+vkb_TransformSystem vkb_transforms_create(uint32 capacity);
+
+// Returns the new transform's index
+uint32 vkb_transforms_add(vkb_TransformSystem& transforms, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+void vkb_transforms_set(vkb_TransformSystem& transforms, uint32 index, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+// Writes world and world * viewProj for every transform into dst, which is
+// meant to be the mapped instance buffer. Matrices use glm's column major layout.
+void vkb_transforms_computeInstances(const vkb_TransformSystem& transforms, const glm::mat4& viewProj, vkb_InstanceData* dst, vkb_TransformKernel kernel = vkb_TransformKernel::Best);
+
+// Same as vkb_transforms_computeInstances, split into batches across the job system
+void vkb_transforms_computeInstancesParallel(const vkb_TransformSystem& transforms, const glm::mat4& viewProj, vkb_InstanceData* dst, vkb_TransformKernel kernel = vkb_TransformKernel::Best, uint32 batchSize = 4096);
+
+bool vkb_transforms_isKernelSupported(vkb_TransformKernel kernel);
+
+void vkb_transforms_free(vkb_TransformSystem& transforms);
+
+#endif
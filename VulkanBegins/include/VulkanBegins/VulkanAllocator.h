@@ -0,0 +1,43 @@
+#ifndef VK_BEGINS_VULKAN_ALLOCATOR_H
+#define VK_BEGINS_VULKAN_ALLOCATOR_H
+
+#include <cppUtils/cppUtils.hpp>
+#include <vulkan/vulkan.h>
+
+// Host allocation callbacks handed to the driver for every vkCreate*/vkDestroy*
+// call. Allocations are routed through g_memory_allocate and tracked per
+// VkSystemAllocationScope. Small command scope allocations (the driver's
+// short-lived scratch during a single call) are served from pooled size classes.
+struct vkb_VulkanAllocatorScopeStats
+{
+	uint64 numAllocations;
+	uint64 numReallocations;
+	uint64 numFrees;
+	uint64 numPooledAllocations;
+	uint64 liveAllocations;
+	size_t liveBytes;
+	size_t peakBytes;
+	size_t totalBytes;
+};
+
+struct vkb_VulkanAllocatorStats
+{
+	// Indexed by VkSystemAllocationScope
+	vkb_VulkanAllocatorScopeStats scopes[5];
+
+	// Allocations the driver made itself and only reported to us
+	uint64 numInternalAllocations;
+	size_t liveInternalBytes;
+};
+
+const VkAllocationCallbacks* vkb_vulkanAllocator_get();
+
+vkb_VulkanAllocatorStats vkb_vulkanAllocator_getStats();
+
+void vkb_vulkanAllocator_dumpStats();
+
+// Releases the size class pools. Only call this once every Vulkan object
+// created with these callbacks has been destroyed.
+void vkb_vulkanAllocator_free();
+
+#endif
@@ -1,5 +1,31 @@
 #include "VulkanBegins/App.h"
 #include "VulkanBegins/File.h"
+#include "VulkanBegins/Arena.h"
+#include "VulkanBegins/VulkanAllocator.h"
+#include "VulkanBegins/TaskGraph.h"
+#include "VulkanBegins/DeviceCaps.h"
+#include "VulkanBegins/LogSink.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/FramePacket.h"
+#include "VulkanBegins/DeletionQueue.h"
+#include "VulkanBegins/DrawQueue.h"
+#include "VulkanBegins/FrameCapture.h"
+#include "VulkanBegins/GpuTimer.h"
+#include "VulkanBegins/DynamicResolution.h"
+#include "VulkanBegins/ShaderVariants.h"
+#include "VulkanBegins/Residency.h"
+#include "VulkanBegins/OcclusionCulling.h"
+#include "VulkanBegins/CommandStream.h"
+#include "VulkanBegins/ClusteredLighting.h"
+#include "VulkanBegins/ParticleSystem.h"
+#include "VulkanBegins/SpriteRenderer.h"
+#include "VulkanBegins/Bindless.h"
+#include "VulkanBegins/MaterialLibrary.h"
+#include "VulkanBegins/Transforms.h"
+#include "VulkanBegins/Mesh.h"
+#include "VulkanBegins/MeshLod.h"
+#include "VulkanBegins/Bvh.h"
 
 #include <cppUtils/cppUtils.hpp>
 
@@ -10,39 +36,21 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
+#include <math.h>
 #include <array>
+#include <string.h>
+#include <atomic>
+#include <chrono>
 #include <vector>
-#include <set>
+#include <thread>
+#include <mutex>
 
 // NOTE: Look into dynamic rendering
 // NOTE: Consider getting rid of renderpasses and framebuffers and focusing on 
 // pipeline barriers in the beginning
 
-// ------------ Internal structures ------------
-constexpr uint32 NullQueueFamily = UINT32_MAX;
-
-struct QueueFamilyIndices
-{
-	uint32 graphicsFamily;
-	// TODO: The presentFamily typically ends up being equal to the graphicsFamily
-	// Instead of adding synchronization for these, don't support separate queue families
-	// or add extra logic to handle when they are the same
-	uint32 presentFamily;
-
-	inline bool isComplete()
-	{
-		return graphicsFamily != NullQueueFamily && presentFamily != NullQueueFamily;
-	}
-};
-
-struct SwapChainSupportDetails
-{
-	VkSurfaceCapabilitiesKHR capabilities;
-	std::vector<VkSurfaceFormatKHR> formats;
-	std::vector<VkPresentModeKHR> presentModes;
-};
-
 // ------------ Internal Variables ------------
 const std::array<const char*, 1> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
@@ -58,42 +66,298 @@ constexpr bool enableValidationLayers = true;
 constexpr bool enableValidationLayers = false;
 #endif
 
+// Per-frame scratch memory, reset once the frame using it has retired
+static constexpr size_t frameArenaSize = 64 * 1024;
+static constexpr uint32 framesInFlight = 1;
+
 // Window stuff
 static int constexpr windowWidth = 1920;
 static int constexpr windowHeight = 1080;
 static const char* windowTitle = "Vulkan Begins";
 static GLFWwindow* window;
 
+static vkb_AppConfig appConfig;
+
+// Threading stuff
+// NOTE: The main thread owns GLFW and the simulation, the render thread owns
+// every command buffer, submit and present. They share the frame packet triple
+// buffer going one way and the stats snapshot going the other.
+static vkb_FramePacketBuffer framePackets;
+static std::thread renderThread;
+// The render thread's last* stats, copied out once per submitted frame so the
+// getters never see a frame's stats half written
+struct FrameStats
+{
+	vkb_DrawStats draw;
+	vkb_OcclusionStats occlusion;
+	vkb_ClusteredLightingStats lighting;
+	vkb_ParticleStats particles;
+	vkb_SpriteStats sprites;
+	vkb_MeshLodStats meshLod;
+};
+static std::mutex frameStatsMutex;
+static FrameStats publishedFrameStats;
+static uint64 simulationFrameIndex = 0;
+static std::chrono::steady_clock::time_point simulationStart;
+
 // General vulkan stuff
+static const VkAllocationCallbacks* vkAllocator = nullptr;
 static VkInstance vkInstance;
 static VkDebugUtilsMessengerEXT debugMessenger;
+static vkb_Context context;
+static constexpr VkDeviceSize stagingBufferSize = 8 * 1024 * 1024;
+// Number of frames submitted so far, the deletion queue retires objects against it
+static std::atomic<uint64> submittedFrames;
+// Set when the instance supports it, the memory extensions below need it on a 1.0 instance
+static bool physicalDeviceProperties2Enabled = false;
 
 // Device stuff
+// NOTE: Everything we know about the physical device is queried once into
+// deviceCaps, read from there instead of calling vkGetPhysicalDevice* again.
+// TODO: The presentFamily typically ends up being equal to the graphicsFamily
+// Instead of adding synchronization for these, don't support separate queue families
+// or add extra logic to handle when they are the same
+static const char* deviceCapsCacheDirectory = ".";
+static vkb_DeviceCaps deviceCaps;
 static VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 static VkDevice logicalDevice;
+static bool memoryBudgetEnabled = false;
+static bool memoryPriorityEnabled = false;
+static bool descriptorIndexingEnabled = false;
 
 // Queue stuff
 static VkQueue graphicsQueue;
 static VkQueue presentQueue;
 
 // Swap chain stuff
-static VkSurfaceKHR surface;
-static VkSwapchainKHR swapChain;
+// NOTE: When headless, swapChainImages are offscreen images we own and there
+// is no surface or swap chain
+static VkSurfaceKHR surface = VK_NULL_HANDLE;
+static VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 static std::vector<VkImage> swapChainImages;
+static std::vector<VkDeviceMemory> offscreenImageMemory;
+static constexpr uint32 offscreenImageCount = 2;
+static uint32 offscreenImageIndex = 0;
 static VkFormat swapChainImageFormat;
 static VkExtent2D swapChainExtent;
 static std::vector<VkImageView> swapChainImageViews;
 static std::vector<VkFramebuffer> swapChainFramebuffers;
+static VkFormat depthFormat;
+static VkImage depthImage = VK_NULL_HANDLE;
+static VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
+static VkImageView depthImageView = VK_NULL_HANDLE;
+// Allocated through the residency manager, it's never evicted but counts against the budget
+static vkb_ResidentResource depthResident = vkb_nullResidentResource;
+static uint32 depthMemoryType = 0;
+static VkDeviceSize depthMemorySize = 0;
 
 // Pipeline stuff
+static const char* pipelineCacheFilename = "pipeline_cache.bin";
+static VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+static vkb_FileContents pipelineCacheData;
+static vkb_FileContents vertBytecode;
+static vkb_FileContents fragBytecode;
 static VkRenderPass renderPass;
 static VkPipelineLayout pipelineLayout;
-static VkPipeline graphicsPipeline;
+// Set 0 of pipelineLayout, the culled instance ids shader.vert reads
+static VkDescriptorSetLayout instanceSetLayout = VK_NULL_HANDLE;
+// NOTE: The shader modules outlive pipeline creation, variants are compiled
+// from them whenever a new feature combination is first drawn
+static VkShaderModule vertModule = VK_NULL_HANDLE;
+static VkShaderModule fragModule = VK_NULL_HANDLE;
+static vkb_ShaderVariantCache* shaderVariants = nullptr;
+// Pipeline cache the variants are created with, null to compile from scratch
+static VkPipelineCache variantPipelineCache = VK_NULL_HANDLE;
 
 // Command Pool stuff
 static VkCommandPool commandPool;
 static VkCommandBuffer commandBuffer;
 
+// Retained command buffers
+// NOTE: In retained mode every swap chain image keeps a command buffer that was
+// recorded for it and gets resubmitted as is. It's only re-recorded when the
+// frame packet asks for different content, when the render scale moves, or
+// when retainedGeneration moves because something every recording references
+// was recreated (framebuffers, pipeline). Re-recording in place is safe because drawFrame waits for the
+// previous frame first, this needs one buffer per frame in flight otherwise.
+struct RetainedCommandBuffer
+{
+	VkCommandBuffer commandBuffer;
+	uint64 generation;
+	float clearColor[4];
+	uint32 drawsPerFrame;
+	bool rebindStatePerDraw;
+	uint32 shaderFeatures;
+	bool instancedScene;
+	// The scene's draws are sized by what the BVH found in the frustum
+	uint32 sceneVisibleInstances;
+	bool particles;
+	uint32 numMaterials;
+	bool bindlessMaterials;
+	float renderScale;
+};
+static std::vector<RetainedCommandBuffer> retainedCommandBuffers;
+static uint64 retainedGeneration = 1;
+// Mips dropped and restored as of the last frame, textures rebuilt to fit the
+// memory budget move retainedGeneration
+static uint32 lastResidencyChanges = 0;
+
+// Frame capture, set up at init or the first time it's turned on headless
+static bool frameCaptureReady = false;
+
+// Draw submission
+static constexpr uint32 initialDrawQueueCapacity = 1024;
+static vkb_DrawQueue drawQueue;
+static vkb_DrawStats lastDrawStats;
+
+// Dynamic resolution
+// NOTE: The scene renders into the top left corner of a full size image and is
+// blitted up to the swap chain image. Only the render area follows the scale,
+// so changing it doesn't recreate anything. sceneRenderPass is compatible with
+// renderPass, the same pipeline is used for both.
+static VkImage sceneImage = VK_NULL_HANDLE;
+static VkDeviceMemory sceneImageMemory = VK_NULL_HANDLE;
+static VkImageView sceneImageView = VK_NULL_HANDLE;
+static VkRenderPass sceneRenderPass = VK_NULL_HANDLE;
+static VkFramebuffer sceneFramebuffer = VK_NULL_HANDLE;
+static vkb_GpuTimer frameTimer;
+static vkb_DynamicResolution resolutionController;
+static float renderScale = 1.0f;
+
+// Instanced scene
+// NOTE: The scene's world space is the view space the lit scene and particles
+// are placed in, so its camera sits at the origin looking down -z. The render
+// thread owns the transforms and writes every instance's matrices into the
+// mapped instance buffer each frame, shader.vert reads them through set 2.
+static constexpr float sceneHalfWidth = 24.0f;
+// Bounding sphere radius of the triangle at scale 1
+static constexpr float sceneTriangleRadius = 0.71f;
+// A wall of large triangles just in front of the field, alternately upright
+// and upside down so together they cover the middle of the view. They come
+// first in the instance list and don't spin.
+static constexpr uint32 sceneOccluders = 3;
+static constexpr float sceneOccluderSize = 2.0f;
+static constexpr float sceneOccluderZ = -1.5f;
+static vkb_TransformSystem sceneTransforms;
+static float* sceneInstanceSizes = nullptr;
+static vkb_Buffer sceneInstanceBuffer;
+// Set 2 of pipelineLayout
+static VkDescriptorSetLayout sceneSetLayout = VK_NULL_HANDLE;
+static VkDescriptorPool sceneDescriptorPool = VK_NULL_HANDLE;
+static VkDescriptorSet sceneSet = VK_NULL_HANDLE;
+static glm::mat4 sceneViewProj = glm::mat4(1.0f);
+// Ids of the instances a frame draws, the ones the BVH finds in the frustum,
+// read through set 0 like the culler's. Written in place every frame, like the
+// instance buffer.
+static vkb_Bvh sceneBvh = {};
+static vkb_Buffer sceneIdsBuffer;
+static VkDescriptorSet sceneIdsSet = VK_NULL_HANDLE;
+static uint32 sceneVisibleInstances = 0;
+
+// Scene mesh
+// NOTE: The field can be drawn with a mesh in place of the triangle. Its
+// vertices are pulled by index from a storage buffer at set 2 binding 1, so
+// the mesh gets its own set 2. Only the LOD table and bounds stay on the CPU.
+static constexpr float sceneMeshPixelError = 1.0f;
+static vkb_MeshData sceneMesh = {};
+static vkb_Buffer sceneMeshVertexBuffer;
+static vkb_Buffer sceneMeshIndexBuffer;
+static VkDescriptorSet sceneMeshSet = VK_NULL_HANDLE;
+static bool sceneMeshEnabled = false;
+static uint32 sceneLodOffsets[vkb_maxMeshLods + 1];
+static vkb_MeshLodStats lastMeshLodStats;
+
+// Occlusion culling
+static vkb_OcclusionCuller* occlusionCuller = nullptr;
+// Same attachments as renderPass. The early pass leaves depth to be sampled
+// and the late pass draws on top of it.
+static VkRenderPass earlyCullPass = VK_NULL_HANDLE;
+static VkRenderPass lateCullPass = VK_NULL_HANDLE;
+static vkb_OcclusionStats lastOcclusionStats;
+
+// Clustered lighting
+static constexpr uint32 maxClusteredLights = 16 * 1024;
+static constexpr uint32 maxLightsPerCluster = 512;
+static constexpr uint32 maxLightIndices = 1024 * 1024;
+// Projection of everything placed in view space, the lit scene and the particles
+static constexpr float viewFovY = 1.0471976f;
+static constexpr float viewNearZ = 0.1f;
+static constexpr float viewFarZ = 40.0f;
+// Where shader.vert lays the lit scene out in view space
+static constexpr float floorHeight = 1.5f;
+static constexpr float floorNear = 2.0f;
+static constexpr float floorDepth = 30.0f;
+static constexpr float floorHalfWidth = 12.0f;
+// Set 1 of the pipeline layout, the bindings are the ones at the top of light_cull.comp
+static VkDescriptorSetLayout lightingSetLayout = VK_NULL_HANDLE;
+static vkb_ClusteredLighting* clusteredLighting = nullptr;
+static vkb_ClusteredLightingStats lastLightingStats;
+
+// GPU particles, a fountain in the same view space as the lit scene
+static vkb_ParticleSystem* particleSystem = nullptr;
+static vkb_ParticleStats lastParticleStats;
+static double lastParticleTime = 0.0;
+
+// Sprites over the scene, drawn from a set of generated images
+static constexpr uint32 maxSpritesPerFrame = 64 * 1024;
+static constexpr uint32 numSpriteImages = 64;
+static vkb_SpriteRenderer* spriteRenderer = nullptr;
+static vkb_SpriteImageId spriteImages[numSpriteImages];
+static vkb_SpriteStats lastSpriteStats;
+
+// Bindless resources and the materials drawn through them
+// NOTE: The heap exists whenever the device supports descriptor indexing. The
+// material library is created the first time materials are turned on, with
+// room for maxMaterials, and numMaterials picks how many of them are used.
+static constexpr uint32 maxBindlessTextures = 16 * 1024;
+static constexpr uint32 maxBindlessBuffers = 16 * 1024;
+static constexpr uint32 maxMaterials = 1024;
+static vkb_BindlessHeap* bindlessHeap = nullptr;
+static vkb_MaterialLibrary* materialLibrary = nullptr;
+
+// Command capture requested from another thread, picked up by the next frame
+// NOTE: The app's objects go by these keys in captures. The frame's target,
+// renderPass and the swap chain's framebuffers and images, goes by key 0.
+enum CaptureObject : uint32
+{
+	CapturePipelineLayout,
+	CaptureSceneRenderPass,
+	CaptureSceneFramebuffer,
+	CaptureSceneImage,
+	CaptureEarlyCullPass,
+	CaptureLateCullPass,
+	CaptureSceneInstanceBuffer,
+	CaptureSceneIdsBuffer,
+	CaptureSceneSet,
+	CaptureSceneIdsSet
+};
+// Stored in captures so a replay inits the features that own the objects they name
+struct CapturedAppState
+{
+	uint32 shaderFeatures;
+	uint32 sceneInstances;
+	uint32 numLights;
+	uint32 maxParticles;
+	uint32 numSprites;
+	uint32 numMaterials;
+	vkb_DynamicResolutionConfig dynamicResolutionConfig;
+	uint8 dynamicResolution;
+	uint8 instancedScene;
+	uint8 occlusionCulling;
+	uint8 clusteredLighting;
+	uint8 particles;
+	uint8 sprites;
+	uint8 bindlessMaterials;
+	uint8 padding;
+};
+static constexpr uint32 maxCaptureFilenameLength = 260;
+static std::atomic<uint32> pendingCaptureFrames;
+static char pendingCaptureFilename[maxCaptureFilenameLength];
+
+// Set while vkb_app_drawReplayFrame has drawFrame record a captured frame
+static vkb_CommandStream* replayStream = nullptr;
+static uint32 replayFrameIndex = 0;
+
 // Sync stuff
 static VkSemaphore imageAvailableSemaphore;
 static VkSemaphore renderFinishedSemaphore;
@@ -102,41 +366,106 @@ static VkFence inFlightFence;
 // ------------ Internal Functions ------------
 static void initVulkan();
 
+// Startup
+static void createWindow();
+static void loadPipelineCacheData();
+static void createPipelineCache();
+static void savePipelineCache();
+
+// Simulation
+static void simulate(vkb_FramePacket& packet);
+
 // Render
-static void drawFrame();
+static void renderThreadLoop();
+static void drawFrame(const vkb_FramePacket& packet);
+static void markResourcesUsed(const vkb_FramePacket& packet);
+static void publishFrameStats();
 
 // Main functions
 static void createInstance();
 static void pickPhysicalDevice();
 static void createLogicalDevice();
 static void createSwapChain();
+static void createOffscreenImages();
+static void destroySwapChainTargets();
 static void createSurface();
 static void createImageViews();
-static void createGraphicsPipeline();
+static void createGraphicsPipeline(VkPipelineCache cache);
+static VkPipeline createPipelineVariant(const VkSpecializationInfo& specialization, void* userData);
 static void createRenderPass();
+static VkRenderPass createColorDepthRenderPass(VkAttachmentLoadOp loadOp, VkImageLayout colorInitialLayout, VkImageLayout colorFinalLayout,
+	VkImageLayout depthInitialLayout, VkImageLayout depthFinalLayout, const VkSubpassDependency* dependencies, uint32 numDependencies);
+static VkFormat chooseDepthFormat();
+static void createDepthTarget();
+static void retireDepthTarget(uint64 retireValue);
 static void createFramebuffers();
 static void createCommandPool();
 
+// Dynamic resolution
+static void initDynamicResolution();
+static void createSceneRenderPass();
+static void createSceneTarget();
+static void retireSceneTarget(uint64 retireValue);
+static void updateRenderScale();
+static void recordUpscale(VkCommandBuffer commandBuffer, uint32 imageIndex, VkExtent2D sceneExtent);
+static VkExtent2D getSceneExtent();
+
+// Clustered lighting
+static void initClusteredLighting();
+static void updateLights(const vkb_FramePacket& packet);
+
+// Particles
+static void initParticles();
+static void updateParticles(const vkb_FramePacket& packet);
+
+// Sprites
+static void initSprites();
+static void updateSprites(const vkb_FramePacket& packet);
+static void recordSpriteDraw(VkCommandBuffer commandBuffer, VkExtent2D targetExtent);
+
+// Bindless and materials
+static void initBindless();
+static void initMaterials();
+static void pushMaterialDraws(VkCommandBuffer commandBuffer, const vkb_FramePacket& packet);
+
+// Instanced scene
+static void initScene();
+static void initSceneMesh(const vkb_MeshData& mesh);
+static void buildSceneBvh();
+static void updateScene(const vkb_FramePacket& packet);
+static void bindScene(VkCommandBuffer commandBuffer);
+static void pushSceneDraws(VkCommandBuffer commandBuffer, const vkb_FramePacket& packet);
+
+// Occlusion culling
+static void initOcclusionCulling();
+static void recordCulledScene(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo& renderPassInfo, const vkb_FramePacket& packet,
+	const VkViewport& viewport, const VkRect2D& scissor);
+
+// Command capture and replay
+static void beginCommandCapture();
+static VkPipeline getReplayPipeline(uint32 variantKey, void* userData);
+static void recordReplayFrame(VkCommandBuffer commandBuffer, uint32 imageIndex);
+
 // Sync stuff
 static void createSyncObjects();
 
 // Command Pool Helpers
 static void createCommandBuffer();
-static void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32 imageIndex);
+static void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32 imageIndex, const vkb_FramePacket& packet);
+static VkCommandBuffer getRetainedCommandBuffer(uint32 imageIndex, const vkb_FramePacket& packet);
 
 // Shader functions
 static VkShaderModule createShaderModule(vkb_FileContents& fileContents);
 
-static bool isDeviceSuitable(VkPhysicalDevice device);
-static QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
-static bool checkForRequiredExts(const std::vector<const char*>& requiredExts);
+static bool isDeviceSuitable(const vkb_DeviceCaps& caps);
+static bool checkForRequiredExts(const char* const* requiredExts, uint32 requiredExtCount);
+static bool hasInstanceExtension(const char* extensionName);
 static bool checkValidationLayerSupport();
-static bool checkDeviceExtensionSupport(VkPhysicalDevice device);
-static SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
-static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-static VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+static bool checkDeviceExtensionSupport(const vkb_DeviceCaps& caps);
+static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const VkSurfaceFormatKHR* availableFormats, uint32 formatCount);
+static VkPresentModeKHR chooseSwapPresentMode(const VkPresentModeKHR* availablePresentModes, uint32 presentModeCount);
 static VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
-static std::vector<const char*> getRequiredExtensions();
+static const char** getRequiredExtensions(uint32* extensionCount);
 static void setupDebugMessenger();
 static void initDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 static VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);
@@ -147,345 +476,1398 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
 	void* pUserData);
 
+vkb_AppConfig vkb_app_defaultConfig()
+{
+	vkb_AppConfig config = {};
+	config.headless = false;
+	config.width = windowWidth;
+	config.height = windowHeight;
+	config.drawsPerFrame = 1;
+	config.rebindStatePerDraw = false;
+	config.shaderFeatures = vkb_ShaderFeature_VertexColor;
+	config.retainedCommandBuffers = true;
+	config.captureFrames = false;
+	config.capture = vkb_frameCapture_defaultConfig();
+	config.dynamicResolution = false;
+	config.dynamicResolutionConfig = vkb_dynamicResolution_defaultConfig();
+	config.instancedScene = false;
+	config.sceneInstances = 4096;
+	config.occlusionCulling = false;
+	config.clusteredLighting = false;
+	config.numLights = 1024;
+	config.particles = false;
+	config.maxParticles = 1024 * 1024;
+	config.sprites = false;
+	config.numSprites = 10000;
+	config.numMaterials = 0;
+	config.bindlessMaterials = false;
+	return config;
+}
+
 void vkb_app_init()
 {
-	glfwInit();
+	vkb_app_init(vkb_app_defaultConfig());
+}
 
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+void vkb_app_init(const vkb_AppConfig& config)
+{
+	appConfig = config;
 
-	window = glfwCreateWindow(windowWidth, windowHeight, windowTitle, nullptr, nullptr);
-	if (!window)
+	if (!appConfig.headless)
 	{
-		g_logger_error("Failed to create window.");
-		return;
+		glfwInit();
+
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 	}
 
 	initVulkan();
 
-	g_logger_info("Successfully initialized Vulkan.");
+	g_logger_info("Successfully initialized Vulkan%s.", appConfig.headless ? " (headless)" : "");
 }
 
 void vkb_app_run()
 {
+	g_logger_assert(!appConfig.headless, "Headless apps drive frames with vkb_app_drawFrame.");
+
+	vkb_framePacket_init(framePackets);
+	renderThread = std::thread(renderThreadLoop);
+
 	while (!glfwWindowShouldClose(window))
 	{
 		glfwPollEvents();
-		drawFrame();
+
+		vkb_FramePacket& packet = vkb_framePacket_beginWrite(framePackets);
+		simulate(packet);
+		vkb_framePacket_publish(framePackets);
+
+		// Simulating frame N+1 overlaps rendering frame N, but don't run further
+		// ahead than that or we'd simulate frames that never get drawn
+		vkb_framePacket_waitTaken(framePackets);
 	}
 
+	vkb_framePacket_close(framePackets);
+	renderThread.join();
+
 	vkDeviceWaitIdle(logicalDevice);
 }
 
-void vkb_app_free()
+void vkb_app_drawFrame()
 {
-	vkDestroySemaphore(logicalDevice, imageAvailableSemaphore, nullptr);
-	vkDestroySemaphore(logicalDevice, renderFinishedSemaphore, nullptr);
-	vkDestroyFence(logicalDevice, inFlightFence, nullptr);
+	// Headless frames are driven synchronously, simulate and draw on the caller's thread
+	vkb_FramePacket packet;
+	simulate(packet);
+	drawFrame(packet);
+}
 
-	vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+void vkb_app_waitIdle()
+{
+	vkDeviceWaitIdle(logicalDevice);
+}
 
-	for (int i = 0; i < swapChainFramebuffers.size(); i++)
+void vkb_app_captureCommands(const char* filename, uint32 numFrames)
+{
+	if (numFrames == 0 || strlen(filename) >= maxCaptureFilenameLength)
 	{
-		vkDestroyFramebuffer(logicalDevice, swapChainFramebuffers[i], nullptr);
+		g_logger_error("Invalid command capture '%s' of %d frames.", filename, numFrames);
+		return;
 	}
-	swapChainFramebuffers.clear();
-
-	vkDestroyPipeline(logicalDevice, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
-	vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
 
-	for (auto& swapChainImageView : swapChainImageViews)
+	// UINT32_MAX holds the slot while the filename is written
+	uint32 expected = 0;
+	if (!pendingCaptureFrames.compare_exchange_strong(expected, UINT32_MAX, std::memory_order_acquire))
 	{
-		vkDestroyImageView(logicalDevice, swapChainImageView, nullptr);
+		g_logger_warning("A command capture is already pending, '%s' wasn't requested.", filename);
+		return;
 	}
-	swapChainImageViews.clear();
 
-	vkDestroySwapchainKHR(logicalDevice, swapChain, nullptr);
-	vkDestroyDevice(logicalDevice, nullptr);
+	strcpy(pendingCaptureFilename, filename);
+	pendingCaptureFrames.store(numFrames, std::memory_order_release);
+}
 
-	if (enableValidationLayers)
+vkb_AppConfig vkb_app_replayConfig(const vkb_CommandStream* stream)
+{
+	VkExtent2D extent = vkb_commandStream_getExtent(stream);
+	vkb_AppConfig config = vkb_app_defaultConfig();
+	config.headless = true;
+	config.width = extent.width;
+	config.height = extent.height;
+	config.retainedCommandBuffers = false;
+
+	uint32 stateSize;
+	const void* stateData = vkb_commandStream_getAppState(stream, &stateSize);
+	if (stateSize != sizeof(CapturedAppState))
 	{
-		DestroyDebugUtilsMessengerEXT(vkInstance, debugMessenger, nullptr);
+		g_logger_warning("The command stream's app state is %d bytes instead of %d, replaying with the default features.", stateSize, (int)sizeof(CapturedAppState));
+		return config;
 	}
 
-	vkDestroySurfaceKHR(vkInstance, surface, nullptr);
-	vkDestroyInstance(vkInstance, nullptr);
-	glfwDestroyWindow(window);
-	glfwTerminate();
+	CapturedAppState state;
+	memcpy(&state, stateData, sizeof(state));
+	config.shaderFeatures = state.shaderFeatures;
+	config.sceneInstances = state.sceneInstances;
+	config.numLights = state.numLights;
+	config.maxParticles = state.maxParticles;
+	config.numSprites = state.numSprites;
+	config.numMaterials = state.numMaterials;
+	config.dynamicResolutionConfig = state.dynamicResolutionConfig;
+	config.dynamicResolution = state.dynamicResolution != 0;
+	config.instancedScene = state.instancedScene != 0;
+	config.occlusionCulling = state.occlusionCulling != 0;
+	config.clusteredLighting = state.clusteredLighting != 0;
+	config.particles = state.particles != 0;
+	config.sprites = state.sprites != 0;
+	config.bindlessMaterials = state.bindlessMaterials != 0;
+	return config;
 }
 
-// ------------ Internal Functions ------------
-static void initVulkan()
+void vkb_app_drawReplayFrame(vkb_CommandStream* stream, uint32 frameIndex)
 {
-	createInstance();
-	setupDebugMessenger();
-	createSurface();
-	pickPhysicalDevice();
-	createLogicalDevice();
-	createSwapChain();
-	createImageViews();
-	createRenderPass();
-	createGraphicsPipeline();
-	createFramebuffers();
-	createCommandPool();
-	createCommandBuffer();
-	createSyncObjects();
+	g_logger_assert(appConfig.headless, "Command streams are only replayed headless.");
+
+	replayStream = stream;
+	replayFrameIndex = frameIndex;
+	vkb_FramePacket packet = {};
+	drawFrame(packet);
+	replayStream = nullptr;
 }
 
-static void drawFrame()
+void vkb_app_setDrawsPerFrame(uint32 drawsPerFrame, bool rebindStatePerDraw)
 {
-	vkWaitForFences(logicalDevice, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-	vkResetFences(logicalDevice, 1, &inFlightFence);
-
-	uint32 imageIndex;
-	vkAcquireNextImageKHR(logicalDevice, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-
-	vkResetCommandBuffer(commandBuffer, 0);
-	recordCommandBuffer(commandBuffer, imageIndex);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
-
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
+	appConfig.drawsPerFrame = drawsPerFrame;
+	appConfig.rebindStatePerDraw = rebindStatePerDraw;
+}
 
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+void vkb_app_setRetainedCommandBuffers(bool retained)
+{
+	appConfig.retainedCommandBuffers = retained;
+}
 
-	uint32 res = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence);
-	if (res != VK_SUCCESS)
+void vkb_app_setInstancedScene(bool enabled)
+{
+	appConfig.instancedScene = enabled;
+	if (enabled && sceneInstanceBuffer.buffer == VK_NULL_HANDLE)
 	{
-		g_logger_error("Failed to submit queue.");
-		g_logger_assert(false, "");
+		initScene();
 	}
-
-	VkPresentInfoKHR presentInfo = {};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
-
-	VkSwapchainKHR swapChains[] = { swapChain };
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapChains;
-	presentInfo.pImageIndices = &imageIndex;
-	presentInfo.pResults = nullptr;
-
-	vkQueuePresentKHR(graphicsQueue, &presentInfo);
 }
 
-static void createInstance()
+void vkb_app_setSceneMesh(const vkb_MeshData* mesh)
 {
-	VkApplicationInfo appInfo{};
-	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-	appInfo.pApplicationName = "Vulkan Begins";
-	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.pEngineName = "No Engine";
-	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
-
-	VkInstanceCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-	createInfo.pApplicationInfo = &appInfo;
-
-	auto extensions = getRequiredExtensions();
-	g_logger_assert(checkForRequiredExts(extensions), "Missing required extensions.");
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-	createInfo.ppEnabledExtensionNames = extensions.data();
-
-	VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
-	if (enableValidationLayers)
+	if (mesh == nullptr)
 	{
-		g_logger_assert(checkValidationLayerSupport(), "Missing validation layers.");
-		createInfo.enabledLayerCount = validationLayers.size();
-		createInfo.ppEnabledLayerNames = validationLayers.data();
+		sceneMeshEnabled = false;
+		return;
+	}
 
-		initDebugMessengerCreateInfo(debugCreateInfo);
-		createInfo.pNext = (void*)&debugCreateInfo;
+	if (sceneInstanceBuffer.buffer == VK_NULL_HANDLE)
+	{
+		initScene();
 	}
-	else
+	if (sceneMeshSet == VK_NULL_HANDLE)
 	{
-		createInfo.enabledLayerCount = 0;
-		createInfo.pNext = nullptr;
+		initSceneMesh(*mesh);
 	}
-
-	VkResult result = vkCreateInstance(&createInfo, nullptr, &vkInstance);
-	g_logger_assert(result == VK_SUCCESS, "Failed to create vulkan instance.");
+	sceneMeshEnabled = true;
 }
 
-static void pickPhysicalDevice()
+void vkb_app_setOcclusionCulling(bool enabled)
 {
-	uint32 deviceCount = 0;
-	vkEnumeratePhysicalDevices(vkInstance, &deviceCount, nullptr);
-	g_logger_assert(deviceCount != 0, "No Graphics Cards found.");
-
-	VkPhysicalDevice* devices = (VkPhysicalDevice*)g_memory_allocate(sizeof(VkPhysicalDevice) * deviceCount);
-	vkEnumeratePhysicalDevices(vkInstance, &deviceCount, devices);
+	if (enabled && appConfig.dynamicResolution)
+	{
+		g_logger_warning("Occlusion culling isn't supported with dynamic resolution, it stays off.");
+		return;
+	}
 
-	for (uint32 devicei = 0; devicei < deviceCount; devicei++)
+	// Created the first time it's turned on, initOcclusionCulling turns it back off if it can't be
+	appConfig.occlusionCulling = enabled;
+	if (enabled && occlusionCuller == nullptr)
 	{
-		if (isDeviceSuitable(devices[devicei]))
+		if (sceneInstanceBuffer.buffer == VK_NULL_HANDLE)
 		{
-			physicalDevice = devices[devicei];
-			break;
+			initScene();
 		}
+		initOcclusionCulling();
 	}
+	retainedGeneration++;
+}
 
-	g_memory_free(devices);
-
-	g_logger_assert(physicalDevice != VK_NULL_HANDLE, "Failed to find suitable graphics card for Vulkan.");
-
-	VkPhysicalDeviceProperties deviceProperties;
-	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
-	g_logger_info("Found suitable device: '%s'", deviceProperties.deviceName);
+void vkb_app_setClusteredLighting(bool enabled)
+{
+	// Created the first time it's turned on, initClusteredLighting turns it back off if it can't be
+	appConfig.clusteredLighting = enabled;
+	if (enabled && clusteredLighting == nullptr)
+	{
+		initClusteredLighting();
+	}
 }
 
-static void createLogicalDevice()
+void vkb_app_setParticles(bool enabled)
 {
-	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	// Created the first time they're turned on, initParticles turns them back off if they can't be
+	appConfig.particles = enabled;
+	if (enabled && particleSystem == nullptr)
+	{
+		initParticles();
+	}
+}
 
-	std::set<uint32> uniqueIndices = { indices.graphicsFamily, indices.presentFamily };
+void vkb_app_setSprites(bool enabled, uint32 numSprites)
+{
+	// Created the first time they're turned on, initSprites turns them back off if they can't be
+	appConfig.sprites = enabled;
+	appConfig.numSprites = numSprites < maxSpritesPerFrame ? numSprites : maxSpritesPerFrame;
+	if (enabled && spriteRenderer == nullptr)
+	{
+		initSprites();
+	}
+}
 
+void vkb_app_setDynamicResolution(bool enabled)
+{
+	if (!appConfig.headless)
+	{
+		g_logger_warning("Dynamic resolution can only be switched headless, the window keeps its config.");
+		return;
+	}
+	if (enabled && appConfig.occlusionCulling)
+	{
+		g_logger_warning("Dynamic resolution isn't supported with occlusion culling, it stays off.");
+		return;
+	}
 
-	VkDeviceQueueCreateInfo* queueCreateInfos = (VkDeviceQueueCreateInfo*)g_memory_allocate(sizeof(VkDeviceQueueCreateInfo) * uniqueIndices.size());
+	// Set up the first time it's turned on, initDynamicResolution turns it back off if it can't be.
+	// After that every time it's turned on starts again from the max scale.
+	appConfig.dynamicResolution = enabled;
+	if (enabled && sceneRenderPass == VK_NULL_HANDLE)
+	{
+		initDynamicResolution();
+	}
+	else if (enabled)
+	{
+		resolutionController = vkb_dynamicResolution_create(resolutionController.config);
+		renderScale = resolutionController.scale;
+	}
+	else
+	{
+		renderScale = 1.0f;
+	}
+	retainedGeneration++;
+}
 
-	float queuePriority = 1.0f;
+void vkb_app_setFrameCapture(bool enabled)
+{
+	if (enabled && !frameCaptureReady)
 	{
-		int i = 0;
-		for (uint32 queueFamilyIndex : uniqueIndices)
+		// Offscreen images are always copyable, the swap chain's only are if capture was on when it was created
+		if (!appConfig.headless)
 		{
-			queueCreateInfos[i] = {};
-			queueCreateInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-			queueCreateInfos[i].queueFamilyIndex = queueFamilyIndex;
-			queueCreateInfos[i].queueCount = 1;
-			queueCreateInfos[i].pQueuePriorities = &queuePriority;
-			i++;
+			g_logger_warning("Frame capture has to be on in the config to capture the window, it stays off.");
+			return;
 		}
+		vkb_frameCapture_init(context, appConfig.capture, swapChainExtent.width, swapChainExtent.height, swapChainImageFormat);
+		frameCaptureReady = true;
 	}
+	appConfig.captureFrames = enabled;
+}
 
-	VkPhysicalDeviceFeatures deviceFeatures{};
-
-	VkDeviceCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	createInfo.pQueueCreateInfos = queueCreateInfos;
-	createInfo.queueCreateInfoCount = uniqueIndices.size();
-
-	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = requiredDeviceExtensions.size();
-	createInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
-
-	if (enableValidationLayers)
+void vkb_app_setMaterials(uint32 numMaterials, bool bindless)
+{
+	// Created the first time they're turned on, initMaterials turns them back off if they can't be
+	appConfig.numMaterials = numMaterials < maxMaterials ? numMaterials : maxMaterials;
+	appConfig.bindlessMaterials = bindless;
+	if (appConfig.numMaterials > 0 && materialLibrary == nullptr)
 	{
-		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-		createInfo.ppEnabledLayerNames = validationLayers.data();
+		initMaterials();
 	}
-	else
+	if (appConfig.bindlessMaterials && bindlessHeap == nullptr)
 	{
-		createInfo.enabledLayerCount = 0;
+		g_logger_warning("Descriptor indexing isn't supported, materials are bound with a descriptor set each.");
+		appConfig.bindlessMaterials = false;
 	}
+}
 
-	VkResult result = vkCreateDevice(physicalDevice, &createInfo, nullptr, &logicalDevice);
-	g_logger_assert(result == VK_SUCCESS, "failed to create logical device!");
-
-	// List of Queues
-	// Each queue family has a list of queues
-	// GraphicsFamilyQueue 
-	// {
-	//   Queue[n]
-	// }
-	// PresentFamilyQueue 
-	// {
-	//   Queue[n]
-	// }
-	vkGetDeviceQueue(logicalDevice, indices.graphicsFamily, 0, &graphicsQueue);
-	vkGetDeviceQueue(logicalDevice, indices.presentFamily, 0, &graphicsQueue);
-
-	g_memory_free(queueCreateInfos);
+void vkb_app_setLightCount(uint32 numLights)
+{
+	appConfig.numLights = numLights < maxClusteredLights ? numLights : maxClusteredLights;
 }
 
-static void createSwapChain()
+void vkb_app_setShaderFeatures(uint32 shaderFeatures)
 {
-	SwapChainSupportDetails details = querySwapChainSupport(physicalDevice);
+	appConfig.shaderFeatures = shaderFeatures;
+}
 
-	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(details.formats);
-	VkPresentModeKHR presentMode = chooseSwapPresentMode(details.presentModes);
-	swapChainExtent = chooseSwapExtent(details.capabilities);
-	swapChainImageFormat = surfaceFormat.format;
+void vkb_app_resize(uint32 width, uint32 height)
+{
+	if (!appConfig.headless)
+	{
+		g_logger_warning("Resizing is only supported headless.");
+		return;
+	}
 
-	uint32 imageCount = details.capabilities.minImageCount + 1;
-	if (details.capabilities.maxImageCount > 0 && imageCount > details.capabilities.maxImageCount)
+	// The old targets may still be in use by the last submitted frame
+	uint64 retireValue = vkb_app_getFrameSerial();
+	for (size_t i = 0; i < swapChainFramebuffers.size(); i++)
 	{
-		imageCount = details.capabilities.maxImageCount;
+		vkb_deletionQueue_push(VK_OBJECT_TYPE_FRAMEBUFFER, swapChainFramebuffers[i], retireValue);
+		vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE_VIEW, swapChainImageViews[i], retireValue);
+		vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE, swapChainImages[i], retireValue);
+		vkb_deletionQueue_push(VK_OBJECT_TYPE_DEVICE_MEMORY, offscreenImageMemory[i], retireValue);
 	}
+	swapChainFramebuffers.clear();
+	swapChainImageViews.clear();
+	swapChainImages.clear();
+	offscreenImageMemory.clear();
 
-	VkSwapchainCreateInfoKHR createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-	createInfo.surface = surface;
-	createInfo.minImageCount = imageCount;
-	createInfo.imageFormat = surfaceFormat.format;
-	createInfo.imageColorSpace = surfaceFormat.colorSpace;
-	createInfo.imageExtent = swapChainExtent;
-	createInfo.imageArrayLayers = 1;
-	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	retireDepthTarget(retireValue);
 
-	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-	uint32 queueFamilyIndices[] = { indices.graphicsFamily, indices.presentFamily };
-	if (indices.graphicsFamily != indices.presentFamily)
+	appConfig.width = width;
+	appConfig.height = height;
+	createOffscreenImages();
+	createImageViews();
+	createDepthTarget();
+	createFramebuffers();
+	// Kept at the right size while dynamic resolution is off, so turning it back on doesn't have to
+	if (sceneRenderPass != VK_NULL_HANDLE)
 	{
-		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-		createInfo.queueFamilyIndexCount = 2;
-		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+		retireSceneTarget(retireValue);
+		createSceneTarget();
 	}
-	else
+	if (occlusionCuller != nullptr)
 	{
-		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		vkb_occlusionCuller_setDepthTarget(context, occlusionCuller, depthImageView, swapChainExtent, retireValue);
 	}
+	retainedGeneration++;
+}
 
-	createInfo.preTransform = details.capabilities.currentTransform;
-	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	createInfo.presentMode = presentMode;
-	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
-
-	uint32 result = vkCreateSwapchainKHR(logicalDevice, &createInfo, nullptr, &swapChain);
-	g_logger_assert(result == VK_SUCCESS, "Failed to create swap chain.");
+float vkb_app_rebuildPipeline(bool usePipelineCache)
+{
+	uint64 retireValue = vkb_app_getFrameSerial();
+	vkb_shaderVariantCache_retireAll(shaderVariants, retireValue);
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout, retireValue);
+
+	auto start = std::chrono::steady_clock::now();
+	createGraphicsPipeline(usePipelineCache ? pipelineCache : VK_NULL_HANDLE);
+	retainedGeneration++;
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
-	uint32 numImages;
-	vkGetSwapchainImagesKHR(logicalDevice, swapChain, &numImages, nullptr);
+const vkb_Context& vkb_app_getContext()
+{
+	return context;
+}
 
-	swapChainImages.resize(numImages);
-	vkGetSwapchainImagesKHR(logicalDevice, swapChain, &numImages, swapChainImages.data());
+const vkb_AppConfig& vkb_app_getConfig()
+{
+	return appConfig;
 }
 
-static void createSurface()
+vkb_BindlessHeap* vkb_app_getBindlessHeap()
 {
-	uint32 result = glfwCreateWindowSurface(vkInstance, window, nullptr, &surface);
-	g_logger_assert(result == VK_SUCCESS, "Failed to create window surface.");
+	return bindlessHeap;
 }
 
-static void createImageViews()
+vkb_DrawStats vkb_app_getDrawStats()
 {
-	swapChainImageViews.resize(swapChainImages.size());
+	std::lock_guard<std::mutex> lock(frameStatsMutex);
+	return publishedFrameStats.draw;
+}
 
-	for (size_t i = 0; i < swapChainImages.size(); i++)
-	{
-		VkImageViewCreateInfo createInfo = {};
-		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		createInfo.image = swapChainImages[i];
-		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		createInfo.format = swapChainImageFormat;
+vkb_ShaderVariantStats vkb_app_getShaderVariantStats()
+{
+	return vkb_shaderVariantCache_getStats(shaderVariants);
+}
 
-		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+vkb_OcclusionStats vkb_app_getOcclusionStats()
+{
+	std::lock_guard<std::mutex> lock(frameStatsMutex);
+	return publishedFrameStats.occlusion;
+}
+
+vkb_ClusteredLightingStats vkb_app_getLightingStats()
+{
+	std::lock_guard<std::mutex> lock(frameStatsMutex);
+	return publishedFrameStats.lighting;
+}
+
+vkb_ParticleStats vkb_app_getParticleStats()
+{
+	std::lock_guard<std::mutex> lock(frameStatsMutex);
+	return publishedFrameStats.particles;
+}
+
+vkb_SpriteStats vkb_app_getSpriteStats()
+{
+	std::lock_guard<std::mutex> lock(frameStatsMutex);
+	return publishedFrameStats.sprites;
+}
+
+vkb_MeshLodStats vkb_app_getMeshLodStats()
+{
+	std::lock_guard<std::mutex> lock(frameStatsMutex);
+	return publishedFrameStats.meshLod;
+}
+
+uint64 vkb_app_getFrameSerial()
+{
+	// The frame being recorded, or the next one to be, may still reference
+	// whatever is being retired
+	return submittedFrames.load(std::memory_order_acquire) + 1;
+}
+
+float vkb_app_getRenderScale()
+{
+	return renderScale;
+}
+
+void vkb_app_free()
+{
+	vkDeviceWaitIdle(logicalDevice);
+	if (sceneRenderPass != VK_NULL_HANDLE)
+	{
+		retireSceneTarget(vkb_app_getFrameSerial());
+		vkDestroyRenderPass(logicalDevice, sceneRenderPass, vkAllocator);
+		vkb_gpuTimer_free(context, frameTimer);
+	}
+	if (occlusionCuller != nullptr)
+	{
+		vkb_occlusionCuller_free(context, occlusionCuller);
+		occlusionCuller = nullptr;
+		vkDestroyRenderPass(logicalDevice, earlyCullPass, vkAllocator);
+		vkDestroyRenderPass(logicalDevice, lateCullPass, vkAllocator);
+	}
+	if (clusteredLighting != nullptr)
+	{
+		vkb_clusteredLighting_free(context, clusteredLighting);
+		clusteredLighting = nullptr;
+	}
+	if (particleSystem != nullptr)
+	{
+		vkb_particleSystem_free(context, particleSystem);
+		particleSystem = nullptr;
+	}
+	if (spriteRenderer != nullptr)
+	{
+		vkb_spriteRenderer_free(context, spriteRenderer);
+		spriteRenderer = nullptr;
+	}
+	if (materialLibrary != nullptr)
+	{
+		vkb_materialLibrary_free(context, materialLibrary);
+		materialLibrary = nullptr;
+	}
+	if (sceneMeshSet != VK_NULL_HANDLE)
+	{
+		vkb_buffer_free(context, sceneMeshVertexBuffer);
+		vkb_buffer_free(context, sceneMeshIndexBuffer);
+		sceneMeshSet = VK_NULL_HANDLE;
+	}
+	if (sceneInstanceBuffer.buffer != VK_NULL_HANDLE)
+	{
+		vkb_commandCapture_untrackBuffer(sceneInstanceBuffer.buffer);
+		vkb_commandCapture_untrackBuffer(sceneIdsBuffer.buffer);
+		vkb_buffer_free(context, sceneInstanceBuffer);
+		vkb_buffer_free(context, sceneIdsBuffer);
+		vkb_bvh_free(sceneBvh);
+		vkDestroyDescriptorPool(logicalDevice, sceneDescriptorPool, vkAllocator);
+		vkb_transforms_free(sceneTransforms);
+		g_memory_free(sceneInstanceSizes);
+		sceneInstanceSizes = nullptr;
+	}
+	if (bindlessHeap != nullptr)
+	{
+		vkb_bindlessHeap_free(context, bindlessHeap);
+		bindlessHeap = nullptr;
+	}
+	retireDepthTarget(vkb_app_getFrameSerial());
+	vkb_deletionQueue_flush();
+	vkb_frameCapture_free();
+	vkb_commandCapture_free();
+	vkb_residency_free();
+	vkb_deletionQueue_free();
+
+	vkb_staging_free(context);
+	vkb_drawQueue_free(drawQueue);
+
+	vkDestroySemaphore(logicalDevice, imageAvailableSemaphore, vkAllocator);
+	vkDestroySemaphore(logicalDevice, renderFinishedSemaphore, vkAllocator);
+	vkDestroyFence(logicalDevice, inFlightFence, vkAllocator);
+
+	// Frees the retained command buffers along with it
+	vkDestroyCommandPool(logicalDevice, commandPool, vkAllocator);
+	retainedCommandBuffers.clear();
+
+	for (int i = 0; i < swapChainFramebuffers.size(); i++)
+	{
+		vkDestroyFramebuffer(logicalDevice, swapChainFramebuffers[i], vkAllocator);
+	}
+	swapChainFramebuffers.clear();
+
+	savePipelineCache();
+	vkDestroyPipelineCache(logicalDevice, pipelineCache, vkAllocator);
+
+	vkb_shaderVariantCache_free(context, shaderVariants);
+	shaderVariants = nullptr;
+	vkDestroyShaderModule(logicalDevice, vertModule, vkAllocator);
+	vkDestroyShaderModule(logicalDevice, fragModule, vkAllocator);
+	vkDestroyPipelineLayout(logicalDevice, pipelineLayout, vkAllocator);
+	vkDestroyDescriptorSetLayout(logicalDevice, instanceSetLayout, vkAllocator);
+	vkDestroyDescriptorSetLayout(logicalDevice, lightingSetLayout, vkAllocator);
+	vkDestroyDescriptorSetLayout(logicalDevice, sceneSetLayout, vkAllocator);
+	vkDestroyRenderPass(logicalDevice, renderPass, vkAllocator);
+	vkb_file_free(vertBytecode);
+	vkb_file_free(fragBytecode);
+
+	destroySwapChainTargets();
+	vkDestroyDevice(logicalDevice, vkAllocator);
+	vkb_deviceCaps_free(deviceCaps);
+
+	if (enableValidationLayers)
+	{
+		DestroyDebugUtilsMessengerEXT(vkInstance, debugMessenger, vkAllocator);
+	}
+
+	if (!appConfig.headless)
+	{
+		vkDestroySurfaceKHR(vkInstance, surface, vkAllocator);
+	}
+	vkDestroyInstance(vkInstance, vkAllocator);
+	if (!appConfig.headless)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+
+	if (enableValidationLayers)
+	{
+		vkb_logSink_free();
+	}
+
+	vkb_frameArena_free();
+	vkb_scratch_free();
+}
+
+// ------------ Internal Functions ------------
+static void initVulkan()
+{
+	vkb_frameArena_init(frameArenaSize, framesInFlight);
+	vkAllocator = vkb_vulkanAllocator_get();
+
+	// Validation messages are raised on driver threads, debugCallback only
+	// enqueues them and the sink's thread does the formatting and console IO
+	if (enableValidationLayers)
+	{
+		vkb_logSink_init("Validation Layer");
+	}
+
+	// NOTE: Startup runs as a dependency graph so file IO and independent Vulkan
+	// objects overlap instance and device creation. Anything touching the window
+	// has to stay on the main thread for GLFW.
+	vkb_TaskGraph* graph = vkb_taskGraph_create("Startup", 32);
+
+	uint32 windowTask = vkb_taskGraph_addTask(graph, "Create window", [](void*) { createWindow(); }, nullptr, true);
+	uint32 loadVertTask = vkb_taskGraph_addTask(graph, "Load vertex shader", [](void*) { vertBytecode = vkb_file_read("assets/shaders/bin/vert.spv"); });
+	uint32 loadFragTask = vkb_taskGraph_addTask(graph, "Load fragment shader", [](void*) { fragBytecode = vkb_file_read("assets/shaders/bin/frag.spv"); });
+	uint32 loadCacheTask = vkb_taskGraph_addTask(graph, "Load pipeline cache", [](void*) { loadPipelineCacheData(); });
+	uint32 instanceTask = vkb_taskGraph_addTask(graph, "Create instance", [](void*) { createInstance(); });
+	uint32 messengerTask = vkb_taskGraph_addTask(graph, "Setup debug messenger", [](void*) { setupDebugMessenger(); });
+	uint32 surfaceTask = vkb_taskGraph_addTask(graph, "Create surface", [](void*) { createSurface(); });
+	uint32 pickDeviceTask = vkb_taskGraph_addTask(graph, "Pick physical device", [](void*) { pickPhysicalDevice(); });
+	uint32 deviceTask = vkb_taskGraph_addTask(graph, "Create logical device", [](void*) { createLogicalDevice(); });
+	uint32 swapchainTask = vkb_taskGraph_addTask(graph, "Create swap chain", [](void*) { createSwapChain(); }, nullptr, true);
+	uint32 imageViewsTask = vkb_taskGraph_addTask(graph, "Create image views", [](void*) { createImageViews(); });
+	uint32 renderPassTask = vkb_taskGraph_addTask(graph, "Create render pass", [](void*) { createRenderPass(); });
+	uint32 cacheTask = vkb_taskGraph_addTask(graph, "Create pipeline cache", [](void*) { createPipelineCache(); });
+	uint32 pipelineTask = vkb_taskGraph_addTask(graph, "Create graphics pipeline", [](void*) { createGraphicsPipeline(pipelineCache); });
+	uint32 commandPoolTask = vkb_taskGraph_addTask(graph, "Create command pool", [](void*) { createCommandPool(); });
+	uint32 commandBufferTask = vkb_taskGraph_addTask(graph, "Create command buffer", [](void*) { createCommandBuffer(); });
+	uint32 syncTask = vkb_taskGraph_addTask(graph, "Create sync objects", [](void*) { createSyncObjects(); });
+
+	vkb_taskGraph_addDependency(graph, messengerTask, instanceTask);
+	vkb_taskGraph_addDependency(graph, surfaceTask, instanceTask);
+	vkb_taskGraph_addDependency(graph, surfaceTask, windowTask);
+	vkb_taskGraph_addDependency(graph, pickDeviceTask, surfaceTask);
+	vkb_taskGraph_addDependency(graph, deviceTask, pickDeviceTask);
+	vkb_taskGraph_addDependency(graph, swapchainTask, deviceTask);
+	vkb_taskGraph_addDependency(graph, imageViewsTask, swapchainTask);
+	vkb_taskGraph_addDependency(graph, renderPassTask, swapchainTask);
+	vkb_taskGraph_addDependency(graph, cacheTask, deviceTask);
+	vkb_taskGraph_addDependency(graph, cacheTask, loadCacheTask);
+	vkb_taskGraph_addDependency(graph, pipelineTask, renderPassTask);
+	vkb_taskGraph_addDependency(graph, pipelineTask, cacheTask);
+	vkb_taskGraph_addDependency(graph, pipelineTask, loadVertTask);
+	vkb_taskGraph_addDependency(graph, pipelineTask, loadFragTask);
+	vkb_taskGraph_addDependency(graph, commandPoolTask, deviceTask);
+	vkb_taskGraph_addDependency(graph, commandBufferTask, commandPoolTask);
+	vkb_taskGraph_addDependency(graph, syncTask, deviceTask);
+
+	vkb_taskGraph_run(graph);
+
+	vkb_taskGraph_logTimeline(graph);
+	vkb_taskGraph_writeTimeline(graph, "startup_timeline.json");
+	vkb_taskGraph_free(graph);
+
+	context.allocator = vkAllocator;
+	context.instance = vkInstance;
+	context.physicalDevice = physicalDevice;
+	context.device = logicalDevice;
+	context.caps = &deviceCaps;
+	context.graphicsQueue = graphicsQueue;
+	context.graphicsFamily = deviceCaps.graphicsFamily;
+	context.memoryBudgetEnabled = memoryBudgetEnabled;
+	context.memoryPriorityEnabled = memoryPriorityEnabled;
+	context.descriptorIndexingEnabled = descriptorIndexingEnabled;
+
+	vkb_staging_init(context, stagingBufferSize);
+	vkb_deletionQueue_init(context);
+	vkb_residency_init(context, vkb_residency_defaultConfig());
+	// After the graph, the depth target is allocated through the residency manager
+	createDepthTarget();
+	createFramebuffers();
+	drawQueue = vkb_drawQueue_create(initialDrawQueueCapacity);
+	initBindless();
+
+	if (appConfig.dynamicResolution)
+	{
+		initDynamicResolution();
+	}
+
+	if (appConfig.instancedScene || appConfig.occlusionCulling)
+	{
+		initScene();
+	}
+
+	if (appConfig.occlusionCulling)
+	{
+		initOcclusionCulling();
+	}
+
+	if (appConfig.clusteredLighting)
+	{
+		initClusteredLighting();
+	}
+
+	if (appConfig.particles)
+	{
+		initParticles();
+	}
+
+	if (appConfig.sprites)
+	{
+		initSprites();
+	}
+
+	if (appConfig.numMaterials > 0)
+	{
+		vkb_app_setMaterials(appConfig.numMaterials, appConfig.bindlessMaterials);
+	}
+
+	if (appConfig.captureFrames)
+	{
+		vkb_frameCapture_init(context, appConfig.capture, swapChainExtent.width, swapChainExtent.height, swapChainImageFormat);
+		frameCaptureReady = true;
+	}
+}
+
+static void createWindow()
+{
+	if (appConfig.headless)
+	{
+		return;
+	}
+
+	window = glfwCreateWindow(windowWidth, windowHeight, windowTitle, nullptr, nullptr);
+	g_logger_assert(window != nullptr, "Failed to create window.");
+}
+
+static void loadPipelineCacheData()
+{
+	pipelineCacheData = vkb_FileContents{ nullptr, 0 };
+	if (vkb_file_exists(pipelineCacheFilename))
+	{
+		pipelineCacheData = vkb_file_read(pipelineCacheFilename);
+	}
+}
+
+static void createPipelineCache()
+{
+	const VkPhysicalDeviceProperties& deviceProperties = deviceCaps.properties;
+
+	// Header layout is defined by the spec as VkPipelineCacheHeaderVersionOne. Drivers
+	// are supposed to reject foreign data themselves, but not all of them do.
+	constexpr size_t headerSize = 16 + VK_UUID_SIZE;
+	bool cacheValid = pipelineCacheData.data != nullptr && pipelineCacheData.size >= headerSize;
+	if (cacheValid)
+	{
+		uint32 header[4];
+		memcpy(header, pipelineCacheData.data, sizeof(header));
+		cacheValid = header[2] == deviceProperties.vendorID &&
+			header[3] == deviceProperties.deviceID &&
+			memcmp(pipelineCacheData.data + 16, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		if (!cacheValid)
+		{
+			g_logger_warning("Ignoring pipeline cache '%s', it was created by a different device or driver.", pipelineCacheFilename);
+		}
+	}
+
+	VkPipelineCacheCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = cacheValid ? pipelineCacheData.size : 0;
+	createInfo.pInitialData = cacheValid ? pipelineCacheData.data : nullptr;
+
+	uint32 result = vkCreatePipelineCache(logicalDevice, &createInfo, vkAllocator, &pipelineCache);
+	if (result != VK_SUCCESS)
+	{
+		g_logger_warning("Failed to create pipeline cache, pipelines will be compiled from scratch.");
+		pipelineCache = VK_NULL_HANDLE;
+	}
+
+	vkb_file_free(pipelineCacheData);
+}
+
+static void savePipelineCache()
+{
+	if (pipelineCache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize, nullptr);
+	if (dataSize == 0)
+	{
+		return;
+	}
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	void* data = vkb_arena_allocate(vkb_scratch_get(), dataSize);
+	if (vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize, data) == VK_SUCCESS)
+	{
+		vkb_file_write(pipelineCacheFilename, data, dataSize);
+	}
+	vkb_scratch_end(scratch);
+}
+
+static void simulate(vkb_FramePacket& packet)
+{
+	if (simulationFrameIndex == 0)
+	{
+		simulationStart = std::chrono::steady_clock::now();
+	}
+
+	packet.frameIndex = simulationFrameIndex++;
+	packet.simulationTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - simulationStart).count();
+
+	packet.clearColor[0] = 0.7f;
+	packet.clearColor[1] = 0.05f;
+	packet.clearColor[2] = 0.1f;
+	packet.clearColor[3] = 1.0f;
+	packet.drawsPerFrame = appConfig.drawsPerFrame;
+	packet.rebindStatePerDraw = appConfig.rebindStatePerDraw;
+	packet.shaderFeatures = appConfig.shaderFeatures;
+	packet.instancedScene = appConfig.instancedScene;
+	packet.occlusionCulling = appConfig.occlusionCulling;
+	packet.sceneMesh = sceneMeshEnabled;
+	packet.numLights = appConfig.numLights;
+	if (appConfig.clusteredLighting)
+	{
+		packet.shaderFeatures |= vkb_ShaderFeature_ClusteredLighting;
+	}
+	packet.particles = appConfig.particles;
+	packet.numSprites = appConfig.sprites ? appConfig.numSprites : 0;
+	packet.numMaterials = appConfig.numMaterials;
+	packet.bindlessMaterials = appConfig.bindlessMaterials;
+}
+
+static void renderThreadLoop()
+{
+	// Sleeps between frames instead of spinning, publish wakes it up
+	while (vkb_framePacket_wait(framePackets))
+	{
+		const vkb_FramePacket* packet = vkb_framePacket_acquireLatest(framePackets);
+		if (packet != nullptr)
+		{
+			drawFrame(*packet);
+		}
+	}
+
+	vkb_scratch_free();
+}
+
+static void drawFrame(const vkb_FramePacket& packet)
+{
+	vkWaitForFences(logicalDevice, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+	vkResetFences(logicalDevice, 1, &inFlightFence);
+
+	// The previous frame in this slot has retired, so its scratch memory can be
+	// recycled. Everything the frame allocates from here on is counted.
+	vkb_frameArena_beginFrame(0);
+#ifdef _DEBUG
+	vkb_FrameArenaStats frameStats = vkb_frameArena_getLastFrameStats();
+	if (frameStats.numHeapAllocations > 0)
+	{
+		g_logger_warning("Last frame made %d heap allocations (%d arena allocations, %d bytes).", frameStats.numHeapAllocations, frameStats.numAllocations, (int)frameStats.bytesUsed);
+	}
+#endif
+
+	// With one frame in flight, everything submitted so far has finished
+	vkb_deletionQueue_collect(submittedFrames.load(std::memory_order_relaxed));
+	if (bindlessHeap != nullptr)
+	{
+		vkb_bindlessHeap_collect(bindlessHeap, submittedFrames.load(std::memory_order_relaxed));
+	}
+	vkb_frameCapture_collect(submittedFrames.load(std::memory_order_relaxed));
+	markResourcesUsed(packet);
+	vkb_residency_update(vkb_app_getFrameSerial());
+	vkb_ResidencyStats residencyStats = vkb_residency_getStats();
+	uint32 residencyChanges = residencyStats.numMipsDropped + residencyStats.numMipsRestored;
+	if (residencyChanges != lastResidencyChanges)
+	{
+		lastResidencyChanges = residencyChanges;
+		retainedGeneration++;
+	}
+	updateRenderScale();
+	if (packet.occlusionCulling && submittedFrames.load(std::memory_order_relaxed) > 0)
+	{
+		lastOcclusionStats = vkb_occlusionCuller_readStats(occlusionCuller);
+	}
+	if (clusteredLighting != nullptr && submittedFrames.load(std::memory_order_relaxed) > 0)
+	{
+		lastLightingStats = vkb_clusteredLighting_readStats(context, clusteredLighting);
+	}
+	if (packet.instancedScene || packet.occlusionCulling)
+	{
+		updateScene(packet);
+	}
+	if ((packet.shaderFeatures & vkb_ShaderFeature_ClusteredLighting) != 0)
+	{
+		updateLights(packet);
+	}
+	if (particleSystem != nullptr && submittedFrames.load(std::memory_order_relaxed) > 0)
+	{
+		lastParticleStats = vkb_particleSystem_readStats(context, particleSystem);
+	}
+	if (packet.particles)
+	{
+		updateParticles(packet);
+	}
+	if (packet.numSprites > 0)
+	{
+		updateSprites(packet);
+	}
+
+	uint32 imageIndex;
+	if (appConfig.headless)
+	{
+		imageIndex = offscreenImageIndex;
+		offscreenImageIndex = (offscreenImageIndex + 1) % offscreenImageCount;
+	}
+	else
+	{
+		vkAcquireNextImageKHR(logicalDevice, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	}
+
+	beginCommandCapture();
+
+	// Retained command buffers would skip the recording a capture listens to, and
+	// the sprites' and the scene mesh's draws change every frame
+	VkCommandBuffer frameCommandBuffer = commandBuffer;
+	if (replayStream != nullptr)
+	{
+		vkResetCommandBuffer(commandBuffer, 0);
+		recordReplayFrame(commandBuffer, imageIndex);
+	}
+	else if (appConfig.retainedCommandBuffers && !vkb_commandCapture_isActive() && packet.numSprites == 0 && !packet.sceneMesh)
+	{
+		frameCommandBuffer = getRetainedCommandBuffer(imageIndex, packet);
+	}
+	else
+	{
+		vkResetCommandBuffer(commandBuffer, 0);
+		recordCommandBuffer(commandBuffer, imageIndex, packet);
+	}
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
+	// The upscale's first barrier waits on the color attachment stage too, see recordUpscale
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
+	if (!appConfig.headless)
+	{
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = waitSemaphores;
+		submitInfo.pWaitDstStageMask = waitStages;
+
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = signalSemaphores;
+	}
+
+	// The capture copy runs after the frame's own commands in the same submit
+	VkImageLayout presentedLayout = appConfig.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	VkCommandBuffer submitCommandBuffers[2] = { frameCommandBuffer, VK_NULL_HANDLE };
+	if (appConfig.captureFrames)
+	{
+		submitCommandBuffers[1] = vkb_frameCapture_record(swapChainImages[imageIndex], presentedLayout, swapChainExtent, vkb_app_getFrameSerial());
+	}
+
+	submitInfo.commandBufferCount = submitCommandBuffers[1] != VK_NULL_HANDLE ? 2 : 1;
+	submitInfo.pCommandBuffers = submitCommandBuffers;
+
+	uint32 res = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence);
+	if (res != VK_SUCCESS)
+	{
+		g_logger_error("Failed to submit queue.");
+		g_logger_assert(false, "");
+	}
+	submittedFrames.fetch_add(1, std::memory_order_release);
+	vkb_commandCapture_endFrame();
+	publishFrameStats();
+
+	if (appConfig.headless)
+	{
+		return;
+	}
+
+	VkPresentInfoKHR presentInfo = {};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = signalSemaphores;
+
+	VkSwapchainKHR swapChains[] = { swapChain };
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = swapChains;
+	presentInfo.pImageIndices = &imageIndex;
+	presentInfo.pResults = nullptr;
+
+	vkQueuePresentKHR(presentQueue, &presentInfo);
+}
+
+// Everything the frame is about to draw with that went through the residency manager
+static void markResourcesUsed(const vkb_FramePacket& packet)
+{
+	// A replay's packet is empty, its stream uses whatever the app was initialized with
+	bool replaying = replayStream != nullptr;
+	uint64 frameSerial = vkb_app_getFrameSerial();
+	vkb_residency_markUsed(depthResident, frameSerial);
+	if ((packet.shaderFeatures & vkb_ShaderFeature_ClusteredLighting) != 0 || (replaying && clusteredLighting != nullptr))
+	{
+		vkb_clusteredLighting_markUsed(clusteredLighting, frameSerial);
+	}
+	if (packet.particles || (replaying && particleSystem != nullptr))
+	{
+		vkb_particleSystem_markUsed(particleSystem, frameSerial);
+	}
+	if (packet.numSprites > 0 || (replaying && spriteRenderer != nullptr))
+	{
+		vkb_spriteRenderer_markUsed(spriteRenderer, frameSerial);
+	}
+	if (packet.numMaterials > 0 || (replaying && materialLibrary != nullptr))
+	{
+		uint32 numMaterials = replaying ? vkb_materialLibrary_getNumMaterials(materialLibrary) : packet.numMaterials;
+		vkb_materialLibrary_markUsed(materialLibrary, numMaterials, frameSerial);
+	}
+}
+
+static void publishFrameStats()
+{
+	std::lock_guard<std::mutex> lock(frameStatsMutex);
+	publishedFrameStats.draw = lastDrawStats;
+	publishedFrameStats.occlusion = lastOcclusionStats;
+	publishedFrameStats.lighting = lastLightingStats;
+	publishedFrameStats.particles = lastParticleStats;
+	publishedFrameStats.sprites = lastSpriteStats;
+	publishedFrameStats.meshLod = lastMeshLodStats;
+}
+
+static void createInstance()
+{
+	VkApplicationInfo appInfo{};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "Vulkan Begins";
+	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.pEngineName = "No Engine";
+	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	createInfo.pApplicationInfo = &appInfo;
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+
+	uint32 extensionCount;
+	const char** extensions = getRequiredExtensions(&extensionCount);
+	g_logger_assert(checkForRequiredExts(extensions, extensionCount), "Missing required extensions.");
+	physicalDeviceProperties2Enabled = hasInstanceExtension(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	if (physicalDeviceProperties2Enabled)
+	{
+		extensions[extensionCount++] = VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
+	}
+	createInfo.enabledExtensionCount = extensionCount;
+	createInfo.ppEnabledExtensionNames = extensions;
+
+	VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
+	if (enableValidationLayers)
+	{
+		g_logger_assert(checkValidationLayerSupport(), "Missing validation layers.");
+		createInfo.enabledLayerCount = validationLayers.size();
+		createInfo.ppEnabledLayerNames = validationLayers.data();
+
+		initDebugMessengerCreateInfo(debugCreateInfo);
+		createInfo.pNext = (void*)&debugCreateInfo;
+	}
+	else
+	{
+		createInfo.enabledLayerCount = 0;
+		createInfo.pNext = nullptr;
+	}
+
+	VkResult result = vkCreateInstance(&createInfo, vkAllocator, &vkInstance);
+	g_logger_assert(result == VK_SUCCESS, "Failed to create vulkan instance.");
+
+	vkb_scratch_end(scratch);
+}
+
+static void pickPhysicalDevice()
+{
+	uint32 deviceCount = 0;
+	vkEnumeratePhysicalDevices(vkInstance, &deviceCount, nullptr);
+	g_logger_assert(deviceCount != 0, "No Graphics Cards found.");
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	VkPhysicalDevice* devices = vkb_arena_allocateArray<VkPhysicalDevice>(vkb_scratch_get(), deviceCount);
+	vkEnumeratePhysicalDevices(vkInstance, &deviceCount, devices);
+
+	for (uint32 devicei = 0; devicei < deviceCount; devicei++)
+	{
+		vkb_DeviceCaps caps = vkb_deviceCaps_query(devices[devicei], surface, deviceCapsCacheDirectory);
+		if (isDeviceSuitable(caps))
+		{
+			physicalDevice = devices[devicei];
+			deviceCaps = caps;
+			break;
+		}
+
+		vkb_deviceCaps_free(caps);
+	}
+
+	vkb_scratch_end(scratch);
+
+	g_logger_assert(physicalDevice != VK_NULL_HANDLE, "Failed to find suitable graphics card for Vulkan.");
+
+	g_logger_info("Found suitable device: '%s'%s", deviceCaps.properties.deviceName, deviceCaps.loadedFromDisk ? " (capabilities loaded from cache)" : "");
+}
+
+static void createLogicalDevice()
+{
+	uint32 uniqueIndices[2] = { deviceCaps.graphicsFamily, deviceCaps.presentFamily };
+	uint32 numUniqueIndices = deviceCaps.graphicsFamily == deviceCaps.presentFamily ? 1 : 2;
+
+	VkDeviceQueueCreateInfo queueCreateInfos[2];
+
+	float queuePriority = 1.0f;
+	for (uint32 i = 0; i < numUniqueIndices; i++)
+	{
+		queueCreateInfos[i] = {};
+		queueCreateInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfos[i].queueFamilyIndex = uniqueIndices[i];
+		queueCreateInfos[i].queueCount = 1;
+		queueCreateInfos[i].pQueuePriorities = &queuePriority;
+	}
+
+	VkPhysicalDeviceFeatures deviceFeatures{};
+
+	VkDeviceCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pQueueCreateInfos = queueCreateInfos;
+	createInfo.queueCreateInfoCount = numUniqueIndices;
+
+	const char* enabledExtensions[8];
+	uint32 enabledExtensionCount = 0;
+	if (!appConfig.headless)
+	{
+		for (const char* requiredExt : requiredDeviceExtensions)
+		{
+			enabledExtensions[enabledExtensionCount++] = requiredExt;
+		}
+	}
+
+	// Residency extensions, see Residency.h. Both are optional.
+	memoryBudgetEnabled = physicalDeviceProperties2Enabled && vkb_deviceCaps_hasExtension(deviceCaps, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (memoryBudgetEnabled)
+	{
+		enabledExtensions[enabledExtensionCount++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+	}
+
+	VkPhysicalDeviceMemoryPriorityFeaturesEXT memoryPriorityFeatures = {};
+	memoryPriorityFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT;
+	auto getFeatures2 = physicalDeviceProperties2Enabled ?
+		(PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(vkInstance, "vkGetPhysicalDeviceFeatures2KHR") : nullptr;
+	if (getFeatures2 != nullptr && vkb_deviceCaps_hasExtension(deviceCaps, VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceFeatures2KHR features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &memoryPriorityFeatures;
+		getFeatures2(physicalDevice, &features2);
+	}
+	memoryPriorityEnabled = memoryPriorityFeatures.memoryPriority == VK_TRUE;
+	if (memoryPriorityEnabled)
+	{
+		enabledExtensions[enabledExtensionCount++] = VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME;
+		memoryPriorityFeatures.pNext = (void*)createInfo.pNext;
+		createInfo.pNext = &memoryPriorityFeatures;
+	}
+
+	// Bindless extensions, see Bindless.h. The instance is 1.0, where descriptor
+	// indexing is an extension that also needs maintenance3.
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT supportedIndexingFeatures = {};
+	supportedIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	if (getFeatures2 != nullptr && vkb_deviceCaps_hasExtension(deviceCaps, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+		vkb_deviceCaps_hasExtension(deviceCaps, VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceFeatures2KHR features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &supportedIndexingFeatures;
+		getFeatures2(physicalDevice, &features2);
+	}
+	descriptorIndexingEnabled = supportedIndexingFeatures.runtimeDescriptorArray == VK_TRUE &&
+		supportedIndexingFeatures.descriptorBindingPartiallyBound == VK_TRUE &&
+		supportedIndexingFeatures.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+		supportedIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+		supportedIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+		deviceCaps.features.shaderSampledImageArrayDynamicIndexing == VK_TRUE &&
+		deviceCaps.features.shaderStorageBufferArrayDynamicIndexing == VK_TRUE;
+	// Only what the heap uses is enabled
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	if (descriptorIndexingEnabled)
+	{
+		enabledExtensions[enabledExtensionCount++] = VK_KHR_MAINTENANCE3_EXTENSION_NAME;
+		enabledExtensions[enabledExtensionCount++] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+		indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+		indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+		indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+		indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+		// The bindless material shader indexes its texture and params arrays with push constants
+		deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+		deviceFeatures.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+		indexingFeatures.pNext = (void*)createInfo.pNext;
+		createInfo.pNext = &indexingFeatures;
+	}
+
+	createInfo.pEnabledFeatures = &deviceFeatures;
+	createInfo.enabledExtensionCount = enabledExtensionCount;
+	createInfo.ppEnabledExtensionNames = enabledExtensions;
+
+	if (enableValidationLayers)
+	{
+		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+		createInfo.ppEnabledLayerNames = validationLayers.data();
+	}
+	else
+	{
+		createInfo.enabledLayerCount = 0;
+	}
+
+	VkResult result = vkCreateDevice(physicalDevice, &createInfo, vkAllocator, &logicalDevice);
+	g_logger_assert(result == VK_SUCCESS, "failed to create logical device!");
+
+	// List of Queues
+	// Each queue family has a list of queues
+	// GraphicsFamilyQueue 
+	// {
+	//   Queue[n]
+	// }
+	// PresentFamilyQueue 
+	// {
+	//   Queue[n]
+	// }
+	vkGetDeviceQueue(logicalDevice, deviceCaps.graphicsFamily, 0, &graphicsQueue);
+	vkGetDeviceQueue(logicalDevice, deviceCaps.presentFamily, 0, &presentQueue);
+}
+
+static void createSwapChain()
+{
+	if (appConfig.headless)
+	{
+		createOffscreenImages();
+		return;
+	}
+
+	const VkSurfaceCapabilitiesKHR& capabilities = deviceCaps.surfaceCapabilities;
+
+	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(deviceCaps.surfaceFormats, deviceCaps.surfaceFormatCount);
+	VkPresentModeKHR presentMode = chooseSwapPresentMode(deviceCaps.presentModes, deviceCaps.presentModeCount);
+	swapChainExtent = chooseSwapExtent(capabilities);
+	swapChainImageFormat = surfaceFormat.format;
+
+	uint32 imageCount = capabilities.minImageCount + 1;
+	if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
+	{
+		imageCount = capabilities.maxImageCount;
+	}
+
+	VkSwapchainCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = surface;
+	createInfo.minImageCount = imageCount;
+	createInfo.imageFormat = surfaceFormat.format;
+	createInfo.imageColorSpace = surfaceFormat.colorSpace;
+	createInfo.imageExtent = swapChainExtent;
+	createInfo.imageArrayLayers = 1;
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	if (appConfig.captureFrames)
+	{
+		if (capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)
+		{
+			createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
+		else
+		{
+			g_logger_warning("Swap chain images can't be copied from on this device, frame capture is disabled.");
+			appConfig.captureFrames = false;
+		}
+	}
+	if (appConfig.dynamicResolution)
+	{
+		if (capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+		{
+			createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		}
+		else
+		{
+			g_logger_warning("Swap chain images can't be blitted to on this device, dynamic resolution is disabled.");
+			appConfig.dynamicResolution = false;
+		}
+	}
+
+	uint32 queueFamilyIndices[] = { deviceCaps.graphicsFamily, deviceCaps.presentFamily };
+	if (deviceCaps.graphicsFamily != deviceCaps.presentFamily)
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	createInfo.preTransform = capabilities.currentTransform;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	createInfo.presentMode = presentMode;
+	createInfo.clipped = VK_TRUE;
+	createInfo.oldSwapchain = VK_NULL_HANDLE;
+
+	uint32 result = vkCreateSwapchainKHR(logicalDevice, &createInfo, vkAllocator, &swapChain);
+	g_logger_assert(result == VK_SUCCESS, "Failed to create swap chain.");
+
+	uint32 numImages;
+	vkGetSwapchainImagesKHR(logicalDevice, swapChain, &numImages, nullptr);
+
+	swapChainImages.resize(numImages);
+	vkGetSwapchainImagesKHR(logicalDevice, swapChain, &numImages, swapChainImages.data());
+}
+
+static void createOffscreenImages()
+{
+	// NOTE: No surface to pick a format from, use the format we'd have preferred
+	swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+	swapChainExtent = { appConfig.width, appConfig.height };
+
+	swapChainImages.resize(offscreenImageCount);
+	offscreenImageMemory.resize(offscreenImageCount);
+	offscreenImageIndex = 0;
+
+	for (uint32 i = 0; i < offscreenImageCount; i++)
+	{
+		VkImageCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		createInfo.imageType = VK_IMAGE_TYPE_2D;
+		createInfo.format = swapChainImageFormat;
+		createInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+		createInfo.mipLevels = 1;
+		createInfo.arrayLayers = 1;
+		createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		// Always blittable to, dynamic resolution can be turned on headless at any point
+		createInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		uint32 result = vkCreateImage(logicalDevice, &createInfo, vkAllocator, &swapChainImages[i]);
+		g_logger_assert(result == VK_SUCCESS, "Failed to create offscreen image.");
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(logicalDevice, swapChainImages[i], &memoryRequirements);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memoryRequirements.size;
+		allocInfo.memoryTypeIndex = vkb_deviceCaps_findMemoryType(deviceCaps, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		g_logger_assert(allocInfo.memoryTypeIndex != UINT32_MAX, "No device local memory for offscreen images.");
+
+		result = vkAllocateMemory(logicalDevice, &allocInfo, vkAllocator, &offscreenImageMemory[i]);
+		g_logger_assert(result == VK_SUCCESS, "Failed to allocate offscreen image memory.");
+		vkBindImageMemory(logicalDevice, swapChainImages[i], offscreenImageMemory[i], 0);
+	}
+}
+
+static void destroySwapChainTargets()
+{
+	for (auto& swapChainImageView : swapChainImageViews)
+	{
+		vkDestroyImageView(logicalDevice, swapChainImageView, vkAllocator);
+	}
+	swapChainImageViews.clear();
+
+	if (appConfig.headless)
+	{
+		for (size_t i = 0; i < swapChainImages.size(); i++)
+		{
+			vkDestroyImage(logicalDevice, swapChainImages[i], vkAllocator);
+			vkFreeMemory(logicalDevice, offscreenImageMemory[i], vkAllocator);
+		}
+		offscreenImageMemory.clear();
+	}
+	else
+	{
+		vkDestroySwapchainKHR(logicalDevice, swapChain, vkAllocator);
+		swapChain = VK_NULL_HANDLE;
+	}
+	swapChainImages.clear();
+}
+
+static void createSurface()
+{
+	if (appConfig.headless)
+	{
+		return;
+	}
+
+	uint32 result = glfwCreateWindowSurface(vkInstance, window, vkAllocator, &surface);
+	g_logger_assert(result == VK_SUCCESS, "Failed to create window surface.");
+}
+
+static void createImageViews()
+{
+	swapChainImageViews.resize(swapChainImages.size());
+
+	for (size_t i = 0; i < swapChainImages.size(); i++)
+	{
+		VkImageViewCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = swapChainImages[i];
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = swapChainImageFormat;
+
+		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
 
 		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		createInfo.subresourceRange.baseMipLevel = 0;
@@ -493,256 +1875,1537 @@ static void createImageViews()
 		createInfo.subresourceRange.baseArrayLayer = 0;
 		createInfo.subresourceRange.layerCount = 1;
 
-		uint32 result = vkCreateImageView(logicalDevice, &createInfo, nullptr, &swapChainImageViews[i]);
-		g_logger_assert(result == VK_SUCCESS, "Failed to create swap chain image views.");
+		uint32 result = vkCreateImageView(logicalDevice, &createInfo, vkAllocator, &swapChainImageViews[i]);
+		g_logger_assert(result == VK_SUCCESS, "Failed to create swap chain image views.");
+		vkb_commandCapture_registerObject(VK_OBJECT_TYPE_IMAGE, swapChainImages[i], vkb_captureKey(vkb_CaptureOwner::Target, 0));
+	}
+}
+
+static void createGraphicsPipeline(VkPipelineCache cache)
+{
+	// NOTE: The shader bytecode is loaded by its own startup task
+	g_logger_assert(vertBytecode.data != nullptr && fragBytecode.data != nullptr, "Missing shader bytecode.");
+
+	// TODO: It may be necessary to add padding to ensure this is 4-byte aligned
+	/*if (vertBytecode.size % 4 != 0)
+	{
+		vertBytecode.size = ((vertBytecode.size / 4) + 1 * 4);
+	}*/
+
+	if (vertModule == VK_NULL_HANDLE)
+	{
+		vertModule = createShaderModule(vertBytecode);
+		fragModule = createShaderModule(fragBytecode);
+	}
+
+	if (instanceSetLayout == VK_NULL_HANDLE)
+	{
+		VkDescriptorSetLayoutBinding culledInstancesBinding = {};
+		culledInstancesBinding.binding = 0;
+		culledInstancesBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		culledInstancesBinding.descriptorCount = 1;
+		culledInstancesBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+		setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutCreateInfo.bindingCount = 1;
+		setLayoutCreateInfo.pBindings = &culledInstancesBinding;
+
+		uint32 result = vkCreateDescriptorSetLayout(logicalDevice, &setLayoutCreateInfo, vkAllocator, &instanceSetLayout);
+		g_logger_assert(result == VK_SUCCESS, "Failed to create the instance descriptor set layout.");
+	}
+
+	if (lightingSetLayout == VK_NULL_HANDLE)
+	{
+		// The cull pass shares the layout, so everything is visible to compute as well
+		VkShaderStageFlags lightingStages = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		VkDescriptorSetLayoutBinding lightingBindings[5] = {};
+		for (uint32 i = 0; i < 5; i++)
+		{
+			lightingBindings[i].binding = i;
+			lightingBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			lightingBindings[i].descriptorCount = 1;
+			lightingBindings[i].stageFlags = lightingStages;
+		}
+		lightingBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		lightingBindings[0].stageFlags = lightingStages | VK_SHADER_STAGE_VERTEX_BIT;
+		// The counters are only for the cull pass
+		lightingBindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+		setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutCreateInfo.bindingCount = 5;
+		setLayoutCreateInfo.pBindings = lightingBindings;
+
+		uint32 result = vkCreateDescriptorSetLayout(logicalDevice, &setLayoutCreateInfo, vkAllocator, &lightingSetLayout);
+		g_logger_assert(result == VK_SUCCESS, "Failed to create the lighting descriptor set layout.");
+	}
+
+	if (sceneSetLayout == VK_NULL_HANDLE)
+	{
+		// Instance data, then the scene mesh's vertices
+		VkDescriptorSetLayoutBinding sceneBindings[2] = {};
+		for (uint32 i = 0; i < 2; i++)
+		{
+			sceneBindings[i].binding = i;
+			sceneBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			sceneBindings[i].descriptorCount = 1;
+			sceneBindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+		setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutCreateInfo.bindingCount = 2;
+		setLayoutCreateInfo.pBindings = sceneBindings;
+
+		uint32 result = vkCreateDescriptorSetLayout(logicalDevice, &setLayoutCreateInfo, vkAllocator, &sceneSetLayout);
+		g_logger_assert(result == VK_SUCCESS, "Failed to create the scene descriptor set layout.");
+	}
+
+	// The viewport height shader.frag fades the fog over, see pushSceneConstants
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(float);
+
+	VkDescriptorSetLayout setLayouts[] = { instanceSetLayout, lightingSetLayout, sceneSetLayout };
+	VkPipelineLayoutCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineCreateInfo.setLayoutCount = 3;
+	pipelineCreateInfo.pSetLayouts = setLayouts;
+	pipelineCreateInfo.pushConstantRangeCount = 1;
+	pipelineCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	uint32 result = vkCreatePipelineLayout(logicalDevice, &pipelineCreateInfo, vkAllocator, &pipelineLayout);
+	if (result != VK_SUCCESS)
+	{
+		g_logger_assert(false, "Failed to create pipeline.");
+	}
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout, vkb_captureKey(vkb_CaptureOwner::App, CapturePipelineLayout));
+
+	if (shaderVariants == nullptr)
+	{
+		shaderVariants = vkb_shaderVariantCache_create("Triangle", vkb_ShaderFeature_Count, createPipelineVariant);
+	}
+	variantPipelineCache = cache;
+
+	// Compile the variant we start with now, any other is compiled the first time it's drawn
+	vkb_shaderVariantCache_get(shaderVariants, appConfig.shaderFeatures);
+}
+
+static VkPipeline createPipelineVariant(const VkSpecializationInfo& specialization, void*)
+{
+	// Create vertex shader and fragment shader stages
+	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertShaderStageInfo.module = vertModule;
+	vertShaderStageInfo.pName = "main";
+	vertShaderStageInfo.pSpecializationInfo = &specialization;
+
+	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	fragShaderStageInfo.module = fragModule;
+	fragShaderStageInfo.pName = "main";
+	fragShaderStageInfo.pSpecializationInfo = &specialization;
+
+	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 0;
+	vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
+	vertexInputInfo.vertexAttributeDescriptionCount = 0;
+	vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = swapChainExtent.width;
+	viewport.height = swapChainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissorRect;
+	scissorRect.offset = { 0, 0 };
+	scissorRect.extent = swapChainExtent;
+
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
+	dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateInfo.dynamicStateCount = 2;
+	dynamicStateInfo.pDynamicStates = dynamicStates;
+
+	VkPipelineViewportStateCreateInfo viewportInfo = {};
+	viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportInfo.viewportCount = 1;
+	viewportInfo.pViewports = &viewport;
+	viewportInfo.scissorCount = 1;
+	viewportInfo.pScissors = &scissorRect;
+
+	VkPipelineRasterizationStateCreateInfo rasterInfo = {};
+	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterInfo.depthClampEnable = VK_FALSE;
+	rasterInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterInfo.lineWidth = 1.0f;
+	rasterInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterInfo.depthBiasEnable = VK_FALSE;
+	rasterInfo.depthBiasConstantFactor = 0.0f; // Optional
+	rasterInfo.depthBiasClamp = 0.0f; // Optional
+	rasterInfo.depthBiasSlopeFactor = 0.0f; // Optional
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo = {};
+	multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleInfo.sampleShadingEnable = VK_FALSE;
+	multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleInfo.minSampleShading = 1.0f; // Optional
+	multisampleInfo.pSampleMask = nullptr; // Optional
+	multisampleInfo.alphaToCoverageEnable = VK_FALSE; // Optional
+	multisampleInfo.alphaToOneEnable = VK_FALSE; // Optional
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT |
+		VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
+
+	VkPipelineColorBlendStateCreateInfo blendInfo = {};
+	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blendInfo.attachmentCount = 1;
+	blendInfo.pAttachments = &colorBlendAttachment;
+	blendInfo.logicOpEnable = VK_FALSE;
+	blendInfo.logicOp = VK_LOGIC_OP_COPY;
+	blendInfo.blendConstants[0] = 0.0f;
+	blendInfo.blendConstants[1] = 0.0f;
+	blendInfo.blendConstants[2] = 0.0f;
+	blendInfo.blendConstants[3] = 0.0f;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilInfo = {};
+	depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilInfo.depthTestEnable = VK_TRUE;
+	depthStencilInfo.depthWriteEnable = VK_TRUE;
+	// Or equal so the stacked draws of the same triangle still show up
+	depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
+	depthStencilInfo.stencilTestEnable = VK_FALSE;
+
+	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
+	graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	graphicsPipelineCreateInfo.stageCount = 2;
+	graphicsPipelineCreateInfo.pStages = shaderStages;
+	graphicsPipelineCreateInfo.pVertexInputState = &vertexInputInfo;
+	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+	graphicsPipelineCreateInfo.pViewportState = &viewportInfo;
+	graphicsPipelineCreateInfo.pRasterizationState = &rasterInfo;
+	graphicsPipelineCreateInfo.pMultisampleState = &multisampleInfo;
+	graphicsPipelineCreateInfo.pDepthStencilState = &depthStencilInfo;
+	graphicsPipelineCreateInfo.pColorBlendState = &blendInfo;
+	graphicsPipelineCreateInfo.pDynamicState = &dynamicStateInfo;
+	graphicsPipelineCreateInfo.layout = pipelineLayout;
+	graphicsPipelineCreateInfo.renderPass = renderPass;
+	graphicsPipelineCreateInfo.subpass = 0;
+	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	graphicsPipelineCreateInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	uint32 result = vkCreateGraphicsPipelines(logicalDevice, variantPipelineCache, 1, &graphicsPipelineCreateInfo, vkAllocator, &pipeline);
+	if (result != VK_SUCCESS)
+	{
+		g_logger_assert(false, "Failed to create graphics pipeline.");
+	}
+
+	return pipeline;
+}
+
+static void createRenderPass()
+{
+	depthFormat = chooseDepthFormat();
+
+	// The last frame's depth writes have to finish before this one clears it
+	VkSubpassDependency subpassDep = {};
+	subpassDep.srcSubpass = VK_SUBPASS_EXTERNAL;
+	subpassDep.dstSubpass = 0;
+
+	subpassDep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDep.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	subpassDep.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	subpassDep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	// Offscreen images are left ready to be copied out
+	VkImageLayout finalLayout = appConfig.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	renderPass = createColorDepthRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR,
+		VK_IMAGE_LAYOUT_UNDEFINED, finalLayout,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		&subpassDep, 1);
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_RENDER_PASS, renderPass, vkb_captureKey(vkb_CaptureOwner::Target, 0));
+}
+
+// Every pass the scene is drawn in has the same attachments so they all stay
+// compatible with the pipeline, they only differ in the layouts around the pass
+static VkRenderPass createColorDepthRenderPass(VkAttachmentLoadOp loadOp, VkImageLayout colorInitialLayout, VkImageLayout colorFinalLayout,
+	VkImageLayout depthInitialLayout, VkImageLayout depthFinalLayout, const VkSubpassDependency* dependencies, uint32 numDependencies)
+{
+	VkAttachmentDescription attachments[2] = {};
+	VkAttachmentDescription& colorAttachment = attachments[0];
+	colorAttachment.format = swapChainImageFormat;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = loadOp;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = colorInitialLayout;
+	colorAttachment.finalLayout = colorFinalLayout;
+
+	VkAttachmentDescription& depthAttachment = attachments[1];
+	depthAttachment.format = depthFormat;
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = loadOp;
+	// Depth is only kept when it's sampled after the pass
+	depthAttachment.storeOp = depthFinalLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = depthInitialLayout;
+	depthAttachment.finalLayout = depthFinalLayout;
+
+	VkAttachmentReference colorAttachmentRef = {};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef = {};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	VkRenderPassCreateInfo renderPassCreateInfo = {};
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.attachmentCount = 2;
+	renderPassCreateInfo.pAttachments = attachments;
+	renderPassCreateInfo.subpassCount = 1;
+	renderPassCreateInfo.pSubpasses = &subpass;
+	renderPassCreateInfo.dependencyCount = numDependencies;
+	renderPassCreateInfo.pDependencies = dependencies;
+
+	VkRenderPass result;
+	uint32 res = vkCreateRenderPass(logicalDevice, &renderPassCreateInfo, vkAllocator, &result);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create render pass.");
+	return result;
+}
+
+static VkFormat chooseDepthFormat()
+{
+	// Has to be sampleable as well, the occlusion culler builds its pyramid from it
+	VkFormat candidates[] = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_X8_D24_UNORM_PACK32,
+		VK_FORMAT_D16_UNORM
+	};
+	VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+	for (VkFormat format : candidates)
+	{
+		if (vkb_deviceCaps_supportsFormatFeatures(deviceCaps, format, requiredFeatures))
+		{
+			return format;
+		}
+	}
+
+	g_logger_assert(false, "No sampleable depth format is supported.");
+	return VK_FORMAT_UNDEFINED;
+}
+
+static void createDepthTarget()
+{
+	VkImageCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	createInfo.imageType = VK_IMAGE_TYPE_2D;
+	createInfo.format = depthFormat;
+	createInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+	createInfo.mipLevels = 1;
+	createInfo.arrayLayers = 1;
+	createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	uint32 result = vkCreateImage(logicalDevice, &createInfo, vkAllocator, &depthImage);
+	g_logger_assert(result == VK_SUCCESS, "Failed to create depth image.");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(logicalDevice, depthImage, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = vkb_deviceCaps_findMemoryType(deviceCaps, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g_logger_assert(allocInfo.memoryTypeIndex != UINT32_MAX, "No device local memory for the depth image.");
+
+	result = vkb_residency_allocateMemory(context, allocInfo, vkb_StreamingPriority::Critical, &depthImageMemory);
+	g_logger_assert(result == VK_SUCCESS, "Failed to allocate depth image memory.");
+	vkBindImageMemory(logicalDevice, depthImage, depthImageMemory, 0);
+	depthMemoryType = allocInfo.memoryTypeIndex;
+	depthMemorySize = allocInfo.allocationSize;
+
+	vkb_ResidentResourceDesc residentDesc = {};
+	residentDesc.priority = vkb_StreamingPriority::Critical;
+	residentDesc.memoryTypeIndex = allocInfo.memoryTypeIndex;
+	residentDesc.numMips = 1;
+	residentDesc.fullSize = allocInfo.allocationSize;
+	depthResident = vkb_residency_register(residentDesc);
+
+	VkImageViewCreateInfo viewCreateInfo = {};
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.image = depthImage;
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = depthFormat;
+	viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	viewCreateInfo.subresourceRange.baseMipLevel = 0;
+	viewCreateInfo.subresourceRange.levelCount = 1;
+	viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	viewCreateInfo.subresourceRange.layerCount = 1;
+
+	result = vkCreateImageView(logicalDevice, &viewCreateInfo, vkAllocator, &depthImageView);
+	g_logger_assert(result == VK_SUCCESS, "Failed to create depth image view.");
+}
+
+static void retireDepthTarget(uint64 retireValue)
+{
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE_VIEW, depthImageView, retireValue);
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE, depthImage, retireValue);
+	vkb_residency_unregister(depthResident);
+	vkb_residency_freeMemory(depthImageMemory, depthMemorySize, depthMemoryType, retireValue);
+	depthResident = vkb_nullResidentResource;
+	depthImageView = VK_NULL_HANDLE;
+	depthImage = VK_NULL_HANDLE;
+	depthImageMemory = VK_NULL_HANDLE;
+}
+
+static void createFramebuffers()
+{
+	swapChainFramebuffers.resize(swapChainImageViews.size());
+
+	for (int i = 0; i < swapChainImageViews.size(); i++)
+	{
+		VkFramebufferCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		// Every image shares the depth buffer, only one frame is drawn at a time
+		VkImageView attachments[] = { swapChainImageViews[i], depthImageView };
+		createInfo.renderPass = renderPass;
+		createInfo.attachmentCount = 2;
+		createInfo.pAttachments = attachments;
+		createInfo.width = swapChainExtent.width;
+		createInfo.height = swapChainExtent.height;
+		createInfo.layers = 1;
+
+		uint32 res = vkCreateFramebuffer(logicalDevice, &createInfo, vkAllocator, &swapChainFramebuffers[i]);
+		if (res != VK_SUCCESS)
+		{
+			g_logger_error("Failed to create framebuffer[%d]", i);
+			g_logger_assert(false, "");
+		}
+		vkb_commandCapture_registerObject(VK_OBJECT_TYPE_FRAMEBUFFER, swapChainFramebuffers[i], vkb_captureKey(vkb_CaptureOwner::Target, 0));
+	}
+}
+
+static void createCommandPool()
+{
+	VkCommandPoolCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	createInfo.queueFamilyIndex = deviceCaps.graphicsFamily;
+
+	uint32 res = vkCreateCommandPool(logicalDevice, &createInfo, vkAllocator, &commandPool);
+	if (res != VK_SUCCESS)
+	{
+		g_logger_error("Failed to create command pool for graphics family.");
+		g_logger_assert(false, "");
 	}
 }
 
-static void createGraphicsPipeline()
+// -------------------- Dynamic resolution --------------------
+static void initDynamicResolution()
 {
-	vkb_FileContents vertBytecode = vkb_file_read("assets/shaders/bin/vert.spv");
-	vkb_FileContents fragBytecode = vkb_file_read("assets/shaders/bin/frag.spv");
+	// The scene image uses the swap chain format, it has to be blittable both ways with linear filtering
+	VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT |
+		VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+		VK_FORMAT_FEATURE_BLIT_DST_BIT |
+		VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if (!vkb_deviceCaps_supportsFormatFeatures(deviceCaps, swapChainImageFormat, requiredFeatures))
+	{
+		g_logger_warning("Swap chain format can't be blitted with linear filtering, dynamic resolution is disabled.");
+		appConfig.dynamicResolution = false;
+		return;
+	}
 
-	// TODO: It may be necessary to add padding to ensure this is 4-byte aligned
-	/*if (vertBytecode.size % 4 != 0)
+	frameTimer = vkb_gpuTimer_create(context, 1);
+	if (!frameTimer.supported)
 	{
-		vertBytecode.size = ((vertBytecode.size / 4) + 1 * 4);
-	}*/
+		g_logger_warning("Dynamic resolution needs GPU timestamps, it is disabled.");
+		appConfig.dynamicResolution = false;
+		return;
+	}
 
-	VkShaderModule vertModule = createShaderModule(vertBytecode);
-	VkShaderModule fragModule = createShaderModule(fragBytecode);
+	vkb_DynamicResolutionConfig config = appConfig.dynamicResolutionConfig;
+	if (config.maxScale > 1.0f)
+	{
+		g_logger_warning("Dynamic resolution max scale %2.2f clamped to 1.", config.maxScale);
+		config.maxScale = 1.0f;
+	}
+	config.minScale = config.minScale < config.maxScale ? config.minScale : config.maxScale;
+	resolutionController = vkb_dynamicResolution_create(config);
+	renderScale = resolutionController.scale;
 
-	// Create vertex shader and fragment shader stages
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = vertModule;
-	vertShaderStageInfo.pName = "main";
+	createSceneRenderPass();
+	createSceneTarget();
+}
 
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = fragModule;
-	fragShaderStageInfo.pName = "main";
+static void createSceneRenderPass()
+{
+	// The previous frame's blit has to finish reading before this one clears,
+	// and the blit has to wait for the writes
+	VkSubpassDependency subpassDeps[2] = {};
+	subpassDeps[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	subpassDeps[0].dstSubpass = 0;
+	subpassDeps[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDeps[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpassDeps[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	subpassDeps[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	subpassDeps[1].srcSubpass = 0;
+	subpassDeps[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	subpassDeps[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	subpassDeps[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	subpassDeps[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	subpassDeps[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	// Same attachments as renderPass, but the scene is left ready to be blitted from
+	sceneRenderPass = createColorDepthRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		subpassDeps, 2);
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_RENDER_PASS, sceneRenderPass, vkb_captureKey(vkb_CaptureOwner::App, CaptureSceneRenderPass));
+}
 
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+static void createSceneTarget()
+{
+	VkImageCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	createInfo.imageType = VK_IMAGE_TYPE_2D;
+	createInfo.format = swapChainImageFormat;
+	createInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+	createInfo.mipLevels = 1;
+	createInfo.arrayLayers = 1;
+	createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	uint32 result = vkCreateImage(logicalDevice, &createInfo, vkAllocator, &sceneImage);
+	g_logger_assert(result == VK_SUCCESS, "Failed to create scene image.");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(logicalDevice, sceneImage, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = vkb_deviceCaps_findMemoryType(deviceCaps, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g_logger_assert(allocInfo.memoryTypeIndex != UINT32_MAX, "No device local memory for the scene image.");
+
+	result = vkAllocateMemory(logicalDevice, &allocInfo, vkAllocator, &sceneImageMemory);
+	g_logger_assert(result == VK_SUCCESS, "Failed to allocate scene image memory.");
+	vkBindImageMemory(logicalDevice, sceneImage, sceneImageMemory, 0);
+
+	VkImageViewCreateInfo viewCreateInfo = {};
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.image = sceneImage;
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = swapChainImageFormat;
+	viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewCreateInfo.subresourceRange.baseMipLevel = 0;
+	viewCreateInfo.subresourceRange.levelCount = 1;
+	viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	viewCreateInfo.subresourceRange.layerCount = 1;
+
+	result = vkCreateImageView(logicalDevice, &viewCreateInfo, vkAllocator, &sceneImageView);
+	g_logger_assert(result == VK_SUCCESS, "Failed to create scene image view.");
+
+	VkFramebufferCreateInfo framebufferCreateInfo = {};
+	framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	VkImageView attachments[] = { sceneImageView, depthImageView };
+	framebufferCreateInfo.renderPass = sceneRenderPass;
+	framebufferCreateInfo.attachmentCount = 2;
+	framebufferCreateInfo.pAttachments = attachments;
+	framebufferCreateInfo.width = swapChainExtent.width;
+	framebufferCreateInfo.height = swapChainExtent.height;
+	framebufferCreateInfo.layers = 1;
+
+	result = vkCreateFramebuffer(logicalDevice, &framebufferCreateInfo, vkAllocator, &sceneFramebuffer);
+	g_logger_assert(result == VK_SUCCESS, "Failed to create scene framebuffer.");
+
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_IMAGE, sceneImage, vkb_captureKey(vkb_CaptureOwner::App, CaptureSceneImage));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_FRAMEBUFFER, sceneFramebuffer, vkb_captureKey(vkb_CaptureOwner::App, CaptureSceneFramebuffer));
+}
 
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
+static void retireSceneTarget(uint64 retireValue)
+{
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_FRAMEBUFFER, sceneFramebuffer, retireValue);
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE_VIEW, sceneImageView, retireValue);
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE, sceneImage, retireValue);
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_DEVICE_MEMORY, sceneImageMemory, retireValue);
+	sceneFramebuffer = VK_NULL_HANDLE;
+	sceneImageView = VK_NULL_HANDLE;
+	sceneImage = VK_NULL_HANDLE;
+	sceneImageMemory = VK_NULL_HANDLE;
+}
 
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssembly.primitiveRestartEnable = VK_FALSE;
+static void updateRenderScale()
+{
+	// Called once the previous frame's fence has signaled, so its timestamps are ready
+	if (!appConfig.dynamicResolution || submittedFrames.load(std::memory_order_relaxed) == 0)
+	{
+		return;
+	}
 
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = swapChainExtent.width;
-	viewport.height = swapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
+	float gpuFrameMs;
+	if (vkb_gpuTimer_read(context, frameTimer, 0, &gpuFrameMs))
+	{
+		renderScale = vkb_dynamicResolution_update(resolutionController, gpuFrameMs);
+	}
+}
 
-	VkRect2D scissorRect;
-	scissorRect.offset = { 0, 0 };
-	scissorRect.extent = swapChainExtent;
+static VkExtent2D getSceneExtent()
+{
+	VkExtent2D sceneExtent = swapChainExtent;
+	if (appConfig.dynamicResolution)
+	{
+		sceneExtent.width = (uint32)((float)swapChainExtent.width * renderScale);
+		sceneExtent.height = (uint32)((float)swapChainExtent.height * renderScale);
+		sceneExtent.width = sceneExtent.width > 0 ? sceneExtent.width : 1;
+		sceneExtent.height = sceneExtent.height > 0 ? sceneExtent.height : 1;
+	}
+	return sceneExtent;
+}
 
-	VkDynamicState dynamicStates[] = {
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR
-	};
+static void recordUpscale(VkCommandBuffer commandBuffer, uint32 imageIndex, VkExtent2D sceneExtent)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = swapChainImages[imageIndex];
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+
+	// Waiting on the color attachment stage chains this onto the image acquire
+	// semaphore, which the submit waits on at that stage
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &barrier);
+	bool capturing = vkb_commandCapture_isActive();
+	if (capturing)
+	{
+		vkb_commandCapture_pipelineBarrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+	}
 
-	VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
-	dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicStateInfo.dynamicStateCount = 2;
-	dynamicStateInfo.pDynamicStates = dynamicStates;
+	VkImageBlit blit = {};
+	blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	blit.srcSubresource.layerCount = 1;
+	blit.srcOffsets[1] = { (int32)sceneExtent.width, (int32)sceneExtent.height, 1 };
+	blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	blit.dstSubresource.layerCount = 1;
+	blit.dstOffsets[1] = { (int32)swapChainExtent.width, (int32)swapChainExtent.height, 1 };
+	vkCmdBlitImage(commandBuffer,
+		sceneImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		1, &blit, VK_FILTER_LINEAR);
+	if (capturing)
+	{
+		vkb_commandCapture_blitImage(sceneImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, blit, VK_FILTER_LINEAR);
+	}
 
-	VkPipelineViewportStateCreateInfo viewportInfo = {};
-	viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportInfo.viewportCount = 1;
-	viewportInfo.pViewports = &viewport;
-	viewportInfo.scissorCount = 1;
-	viewportInfo.pScissors = &scissorRect;
+	// Leave the image where the regular render pass would have
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	VkPipelineStageFlags dstStage;
+	if (appConfig.headless)
+	{
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	else
+	{
+		barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		barrier.dstAccessMask = 0;
+		dstStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+		0, nullptr, 0, nullptr, 1, &barrier);
+	if (capturing)
+	{
+		vkb_commandCapture_pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+	}
+}
 
-	VkPipelineRasterizationStateCreateInfo rasterInfo = {};
-	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterInfo.depthClampEnable = VK_FALSE;
-	rasterInfo.rasterizerDiscardEnable = VK_FALSE;
-	rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterInfo.lineWidth = 1.0f;
-	rasterInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterInfo.depthBiasEnable = VK_FALSE;
-	rasterInfo.depthBiasConstantFactor = 0.0f; // Optional
-	rasterInfo.depthBiasClamp = 0.0f; // Optional
-	rasterInfo.depthBiasSlopeFactor = 0.0f; // Optional
+// -------------------- Instanced scene --------------------
+static void initScene()
+{
+	g_logger_assert(appConfig.sceneInstances > 0, "The instanced scene needs at least one instance.");
+
+	// A field of triangles standing on the lit scene's floor, wider than the
+	// view so part of it is always off screen, behind the occluder wall.
+	// Front rows come first.
+	uint32 numFieldInstances = appConfig.sceneInstances;
+	uint32 numInstances = sceneOccluders + numFieldInstances;
+	uint32 columns = (uint32)ceilf(sqrtf((float)numFieldInstances));
+	uint32 rows = (numFieldInstances + columns - 1) / columns;
+	float spacingX = 2.0f * sceneHalfWidth / (float)columns;
+	float spacingZ = floorDepth / (float)rows;
+	float size = fminf(spacingX, spacingZ) * 0.8f;
+
+	sceneTransforms = vkb_transforms_create(numInstances);
+	sceneInstanceSizes = (float*)g_memory_allocate(sizeof(float) * numInstances);
+	for (uint32 i = 0; i < sceneOccluders; i++)
+	{
+		// Neighbours overlap by half their width, the odd ones are turned upside down
+		glm::vec3 position(
+			((float)i - (float)(sceneOccluders - 1) * 0.5f) * sceneOccluderSize * 0.5f,
+			-floorHeight + sceneOccluderSize * 0.5f,
+			sceneOccluderZ);
+		glm::quat rotation = (i % 2) == 0 ? glm::quat(1.0f, 0.0f, 0.0f, 0.0f) : glm::quat(0.0f, 0.0f, 0.0f, 1.0f);
+		vkb_transforms_add(sceneTransforms, position, rotation, glm::vec3(sceneOccluderSize));
+		sceneInstanceSizes[i] = sceneOccluderSize;
+	}
+	for (uint32 i = 0; i < numFieldInstances; i++)
+	{
+		glm::vec3 position(
+			-sceneHalfWidth + ((float)(i % columns) + 0.5f) * spacingX,
+			-floorHeight + size * 0.5f,
+			-(floorNear + ((float)(i / columns) + 0.5f) * spacingZ));
+		vkb_transforms_add(sceneTransforms, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(size));
+		sceneInstanceSizes[sceneOccluders + i] = size;
+	}
 
-	VkPipelineMultisampleStateCreateInfo multisampleInfo = {};
-	multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampleInfo.sampleShadingEnable = VK_FALSE;
-	multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	multisampleInfo.minSampleShading = 1.0f; // Optional
-	multisampleInfo.pSampleMask = nullptr; // Optional
-	multisampleInfo.alphaToCoverageEnable = VK_FALSE; // Optional
-	multisampleInfo.alphaToOneEnable = VK_FALSE; // Optional
+	sceneInstanceBuffer = vkb_buffer_create(context, sizeof(vkb_InstanceData) * numInstances, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	sceneIdsBuffer = vkb_buffer_create(context, sizeof(uint32) * numInstances, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	// The scene's set and the ids', plus room for the scene mesh's set
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 5;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = 3;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+
+	uint32 result = vkCreateDescriptorPool(logicalDevice, &poolCreateInfo, vkAllocator, &sceneDescriptorPool);
+	g_logger_assert(result == VK_SUCCESS, "Failed to create the scene descriptor pool.");
+
+	VkDescriptorSetLayout setLayouts[2] = { sceneSetLayout, instanceSetLayout };
+	VkDescriptorSet sets[2];
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = sceneDescriptorPool;
+	allocInfo.descriptorSetCount = 2;
+	allocInfo.pSetLayouts = setLayouts;
+
+	result = vkAllocateDescriptorSets(logicalDevice, &allocInfo, sets);
+	g_logger_assert(result == VK_SUCCESS, "Failed to allocate the scene descriptor sets.");
+	sceneSet = sets[0];
+	sceneIdsSet = sets[1];
+
+	// Nothing reads the mesh binding while the triangle is drawn, it only has to be valid
+	VkDescriptorBufferInfo bufferInfos[3] = {};
+	bufferInfos[0].buffer = sceneInstanceBuffer.buffer;
+	bufferInfos[1].buffer = sceneInstanceBuffer.buffer;
+	bufferInfos[2].buffer = sceneIdsBuffer.buffer;
+
+	VkWriteDescriptorSet writes[3] = {};
+	for (uint32 i = 0; i < 3; i++)
+	{
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = i < 2 ? sceneSet : sceneIdsSet;
+		writes[i].dstBinding = i < 2 ? i : 0;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(logicalDevice, 3, writes, 0, nullptr);
 
-	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-	colorBlendAttachment.colorWriteMask =
-		VK_COLOR_COMPONENT_R_BIT |
-		VK_COLOR_COMPONENT_G_BIT |
-		VK_COLOR_COMPONENT_B_BIT |
-		VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
+	vkb_commandCapture_trackBuffer(sceneInstanceBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::App, CaptureSceneInstanceBuffer),
+		sceneInstanceBuffer.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sceneInstanceBuffer.mapped);
+	vkb_commandCapture_trackBuffer(sceneIdsBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::App, CaptureSceneIdsBuffer),
+		sceneIdsBuffer.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sceneIdsBuffer.mapped);
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, sceneSet, vkb_captureKey(vkb_CaptureOwner::App, CaptureSceneSet));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, sceneIdsSet, vkb_captureKey(vkb_CaptureOwner::App, CaptureSceneIdsSet));
 
-	VkPipelineColorBlendStateCreateInfo blendInfo = {};
-	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	blendInfo.attachmentCount = 1;
-	blendInfo.pAttachments = &colorBlendAttachment;
-	blendInfo.logicOpEnable = VK_FALSE;
-	blendInfo.logicOp = VK_LOGIC_OP_COPY;
-	blendInfo.blendConstants[0] = 0.0f;
-	blendInfo.blendConstants[1] = 0.0f;
-	blendInfo.blendConstants[2] = 0.0f;
-	blendInfo.blendConstants[3] = 0.0f;
+	buildSceneBvh();
+}
+
+static void initSceneMesh(const vkb_MeshData& mesh)
+{
+	g_logger_assert(mesh.numLods > 0, "The scene mesh needs its LOD chain.");
+
+	VkDeviceSize verticesSize = sizeof(vkb_MeshVertex) * mesh.numVertices;
+	VkDeviceSize indicesSize = sizeof(uint32) * mesh.numIndices;
+	sceneMeshVertexBuffer = vkb_buffer_create(context, verticesSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	sceneMeshIndexBuffer = vkb_buffer_create(context, indicesSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	vkb_staging_upload(context, sceneMeshVertexBuffer, 0, mesh.vertices, verticesSize);
+	vkb_staging_upload(context, sceneMeshIndexBuffer, 0, mesh.indices, indicesSize);
+	vkb_staging_flush(context);
+
+	sceneMesh = mesh;
+	sceneMesh.vertices = nullptr;
+	sceneMesh.indices = nullptr;
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = sceneDescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &sceneSetLayout;
+
+	uint32 result = vkAllocateDescriptorSets(logicalDevice, &allocInfo, &sceneMeshSet);
+	g_logger_assert(result == VK_SUCCESS, "Failed to allocate the scene mesh descriptor set.");
+
+	VkDescriptorBufferInfo bufferInfos[2] = {};
+	bufferInfos[0].buffer = sceneInstanceBuffer.buffer;
+	bufferInfos[1].buffer = sceneMeshVertexBuffer.buffer;
+
+	VkWriteDescriptorSet writes[2] = {};
+	for (uint32 i = 0; i < 2; i++)
+	{
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = sceneMeshSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(logicalDevice, 2, writes, 0, nullptr);
+
+	// The mesh may reach further than the triangle did
+	buildSceneBvh();
+}
+
+static void buildSceneBvh()
+{
+	// Instances only spin in place, so a box around their bounding sphere never
+	// has to be refit. With the mesh it's whichever of it and the triangle reaches further.
+	float radius = sceneTriangleRadius;
+	if (sceneMeshSet != VK_NULL_HANDLE)
+	{
+		glm::vec3 meshCenter(sceneMesh.boundsCenter[0], sceneMesh.boundsCenter[1], sceneMesh.boundsCenter[2]);
+		radius = fmaxf(radius, glm::length(meshCenter) + sceneMesh.boundsRadius);
+	}
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	vkb_Aabb* bounds = vkb_arena_allocateArray<vkb_Aabb>(vkb_scratch_get(), sceneTransforms.count);
+	for (uint32 i = 0; i < sceneTransforms.count; i++)
+	{
+		glm::vec3 center(sceneTransforms.positionX[i], sceneTransforms.positionY[i], sceneTransforms.positionZ[i]);
+		glm::vec3 halfExtent(radius * sceneInstanceSizes[i]);
+		bounds[i] = { center - halfExtent, center + halfExtent };
+	}
+
+	if (sceneBvh.nodes != nullptr)
+	{
+		vkb_bvh_free(sceneBvh);
+	}
+	sceneBvh = vkb_bvh_build(bounds, sceneTransforms.count);
+	vkb_scratch_end(scratch);
+}
+
+static void updateScene(const vkb_FramePacket& packet)
+{
+	// Every instance behind the occluders spins in place at its own speed
+	float time = (float)packet.simulationTime;
+	for (uint32 i = sceneOccluders; i < sceneTransforms.count; i++)
+	{
+		float angle = time * (0.5f + (float)(i % 7) * 0.25f);
+		glm::quat rotation(cosf(angle * 0.5f), 0.0f, 0.0f, sinf(angle * 0.5f));
+		glm::vec3 position(sceneTransforms.positionX[i], sceneTransforms.positionY[i], sceneTransforms.positionZ[i]);
+		vkb_transforms_set(sceneTransforms, i, position, rotation, glm::vec3(sceneInstanceSizes[i]));
+	}
+
+	// Vulkan's clip space y points down
+	VkExtent2D sceneExtent = getSceneExtent();
+	sceneViewProj = glm::perspective(viewFovY, (float)sceneExtent.width / (float)sceneExtent.height, viewNearZ, viewFarZ);
+	sceneViewProj[1][1] *= -1.0f;
+
+	// The previous frame has finished reading the buffers, they're written in place
+	vkb_transforms_computeInstancesParallel(sceneTransforms, sceneViewProj, (vkb_InstanceData*)sceneInstanceBuffer.mapped);
+	vkb_commandCapture_updateBuffer(sceneInstanceBuffer.buffer, 0, sceneInstanceBuffer.mapped, sizeof(vkb_InstanceData) * sceneTransforms.count);
+
+	lastMeshLodStats = {};
+	if (packet.occlusionCulling)
+	{
+		// The occlusion culler tests the frustum itself
+		sceneVisibleInstances = 0;
+	}
+	else if (packet.sceneMesh)
+	{
+		// Only the field is drawn with the mesh, the occluders stay triangles
+		vkb_ArenaMarker scratch = vkb_scratch_begin();
+		uint32* visible = vkb_arena_allocateArray<uint32>(vkb_scratch_get(), sceneTransforms.count);
+		uint32 numVisible = vkb_bvh_cullFrustum(sceneBvh, vkb_frustum_fromViewProj(sceneViewProj), visible);
+		uint32 numField = 0;
+		for (uint32 i = 0; i < numVisible; i++)
+		{
+			if (visible[i] >= sceneOccluders)
+			{
+				visible[numField++] = visible[i];
+			}
+		}
+
+		vkb_MeshLodView view = {};
+		view.cameraPosition = glm::vec3(0.0f);
+		view.fovY = viewFovY;
+		view.viewportHeight = (float)sceneExtent.height;
+		view.maxPixelError = sceneMeshPixelError;
+		vkb_meshLod_bucketSubset(sceneMesh, sceneTransforms, visible, numField, view, (uint32*)sceneIdsBuffer.mapped, sceneLodOffsets, &lastMeshLodStats);
+		sceneVisibleInstances = numField;
+		vkb_scratch_end(scratch);
+	}
+	else
+	{
+		sceneVisibleInstances = vkb_bvh_cullFrustum(sceneBvh, vkb_frustum_fromViewProj(sceneViewProj), (uint32*)sceneIdsBuffer.mapped);
+	}
+	vkb_commandCapture_updateBuffer(sceneIdsBuffer.buffer, 0, sceneIdsBuffer.mapped, sizeof(uint32) * sceneVisibleInstances);
+}
+
+static void bindScene(VkCommandBuffer commandBuffer)
+{
+	// Set 2 stays bound across pipeline binds, they share the layout
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 2, 1, &sceneSet, 0, nullptr);
+	lastDrawStats.descriptorSetBinds++;
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 2, sceneSet);
+	}
+}
+
+// Fog fades over the height of the viewport the scene is drawn into, which
+// dynamic resolution and resizes change
+static void pushSceneConstants(VkCommandBuffer commandBuffer, const VkViewport& viewport)
+{
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(float), &viewport.height);
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_pushConstants(pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(float), &viewport.height);
+	}
+}
+
+static void pushSceneDraws(VkCommandBuffer commandBuffer, const vkb_FramePacket& packet)
+{
+	// The mesh's set is a superset of the scene's, the occluders draw with it too
+	if (packet.sceneMesh)
+	{
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 2, 1, &sceneMeshSet, 0, nullptr);
+		lastDrawStats.descriptorSetBinds++;
+	}
+	else
+	{
+		bindScene(commandBuffer);
+	}
+
+	uint32 shaderFeatures = packet.shaderFeatures | vkb_ShaderFeature_Instancing;
+	if (packet.sceneMesh)
+	{
+		vkb_DrawCommand occluderDraw = {};
+		occluderDraw.pipeline = vkb_shaderVariantCache_get(shaderVariants, shaderFeatures);
+		occluderDraw.pipelineLayout = pipelineLayout;
+		occluderDraw.vertexCount = 3;
+		occluderDraw.instanceCount = sceneOccluders;
+		vkb_drawQueue_push(drawQueue, vkb_drawKey_make(0, shaderFeatures, 0, 0, 0.0f), occluderDraw);
+
+		// One draw per LOD, each reading its range of the ids through set 0
+		uint32 meshFeatures = shaderFeatures | vkb_ShaderFeature_CulledInstances | vkb_ShaderFeature_MeshVertices;
+		vkb_DrawCommand meshDraw = {};
+		meshDraw.pipeline = vkb_shaderVariantCache_get(shaderVariants, meshFeatures);
+		meshDraw.pipelineLayout = pipelineLayout;
+		meshDraw.descriptorSet = sceneIdsSet;
+		meshDraw.indexBuffer = sceneMeshIndexBuffer.buffer;
+		vkb_meshLod_pushDraws(drawQueue, sceneMesh, sceneLodOffsets, meshDraw, 0, meshFeatures, 0, 1);
+	}
+	else if (sceneVisibleInstances > 0)
+	{
+		// Every instance the BVH found in the frustum, read through set 0
+		uint32 culledFeatures = shaderFeatures | vkb_ShaderFeature_CulledInstances;
+		vkb_DrawCommand draw = {};
+		draw.pipeline = vkb_shaderVariantCache_get(shaderVariants, culledFeatures);
+		draw.pipelineLayout = pipelineLayout;
+		draw.descriptorSet = sceneIdsSet;
+		draw.vertexCount = 3;
+		draw.instanceCount = sceneVisibleInstances;
+		vkb_drawQueue_push(drawQueue, vkb_drawKey_make(0, culledFeatures, 0, 0, 0.0f), draw);
+	}
+}
+
+// -------------------- Occlusion culling --------------------
+static void initOcclusionCulling()
+{
+	// The scene only covers part of the depth buffer at lower scales, which
+	// the pyramid doesn't account for
+	if (appConfig.dynamicResolution)
+	{
+		g_logger_warning("Occlusion culling isn't supported with dynamic resolution, it is disabled.");
+		appConfig.occlusionCulling = false;
+		return;
+	}
+
+	const char* downsampleShaderFilename = "assets/shaders/bin/hiz_downsample.spv";
+	const char* cullShaderFilename = "assets/shaders/bin/occlusion_cull.spv";
+	if (!vkb_file_exists(downsampleShaderFilename) || !vkb_file_exists(cullShaderFilename))
+	{
+		g_logger_warning("Occlusion culling shaders haven't been compiled, occlusion culling is disabled.");
+		appConfig.occlusionCulling = false;
+		return;
+	}
+	vkb_FileContents downsampleShader = vkb_file_read(downsampleShaderFilename);
+	vkb_FileContents cullShader = vkb_file_read(cullShaderFilename);
+
+	vkb_OcclusionCullerDesc desc = {};
+	desc.maxInstances = sceneTransforms.count;
+	desc.vertexCount = 3;
+	desc.instanceSetLayout = instanceSetLayout;
+	desc.downsampleShader = &downsampleShader;
+	desc.cullShader = &cullShader;
+	desc.pipelineCache = pipelineCache;
+	occlusionCuller = vkb_occlusionCuller_create(context, desc, depthImageView, swapChainExtent);
+
+	vkb_file_free(downsampleShader);
+	vkb_file_free(cullShader);
+
+	// Instances only spin in place, so their bounds never change
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	vkb_OcclusionInstance* instances = vkb_arena_allocateArray<vkb_OcclusionInstance>(vkb_scratch_get(), sceneTransforms.count);
+	for (uint32 i = 0; i < sceneTransforms.count; i++)
+	{
+		instances[i].center[0] = sceneTransforms.positionX[i];
+		instances[i].center[1] = sceneTransforms.positionY[i];
+		instances[i].center[2] = sceneTransforms.positionZ[i];
+		instances[i].radius = sceneTriangleRadius * sceneInstanceSizes[i];
+	}
+	vkb_occlusionCuller_setInstances(context, occlusionCuller, instances, sceneTransforms.count);
+	vkb_staging_flush(context);
+	vkb_scratch_end(scratch);
+
+	VkImageLayout finalLayout = appConfig.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	// The early pass waits on the previous frame's depth writes and pyramid
+	// build, and its depth has to land before the pyramid is built from it
+	VkSubpassDependency earlyDeps[2] = {};
+	earlyDeps[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	earlyDeps[0].dstSubpass = 0;
+	earlyDeps[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	earlyDeps[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	earlyDeps[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	earlyDeps[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	earlyDeps[1].srcSubpass = 0;
+	earlyDeps[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	earlyDeps[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	earlyDeps[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	earlyDeps[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	earlyDeps[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	earlyCullPass = createColorDepthRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		earlyDeps, 2);
+
+	// The pyramid build has to be done reading depth before it's written again
+	VkSubpassDependency lateDep = {};
+	lateDep.srcSubpass = VK_SUBPASS_EXTERNAL;
+	lateDep.dstSubpass = 0;
+	lateDep.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	lateDep.srcAccessMask = 0;
+	lateDep.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	lateDep.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	lateCullPass = createColorDepthRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, finalLayout,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		&lateDep, 1);
+
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_RENDER_PASS, earlyCullPass, vkb_captureKey(vkb_CaptureOwner::App, CaptureEarlyCullPass));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_RENDER_PASS, lateCullPass, vkb_captureKey(vkb_CaptureOwner::App, CaptureLateCullPass));
+}
+
+static void recordCulledScene(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo& renderPassInfo, const vkb_FramePacket& packet,
+	const VkViewport& viewport, const VkRect2D& scissor)
+{
+	uint32 shaderFeatures = packet.shaderFeatures | vkb_ShaderFeature_Instancing | vkb_ShaderFeature_CulledInstances;
+	VkPipeline graphicsPipeline = vkb_shaderVariantCache_get(shaderVariants, shaderFeatures);
+
+	bool lit = (packet.shaderFeatures & vkb_ShaderFeature_ClusteredLighting) != 0;
+	if (lit)
+	{
+		vkb_clusteredLighting_beginShading(clusteredLighting, commandBuffer);
+	}
+
+	bool capturing = vkb_commandCapture_isActive();
+	VkRenderPassBeginInfo phaseRenderPassInfo = renderPassInfo;
+	vkb_OcclusionPhase phases[] = { vkb_OcclusionPhase::Early, vkb_OcclusionPhase::Late };
+	for (vkb_OcclusionPhase phase : phases)
+	{
+		if (phase == vkb_OcclusionPhase::Late)
+		{
+			vkb_occlusionCuller_recordBuildPyramid(occlusionCuller, commandBuffer);
+		}
+		vkb_occlusionCuller_recordCull(occlusionCuller, commandBuffer, phase, sceneViewProj);
+
+		phaseRenderPassInfo.renderPass = phase == vkb_OcclusionPhase::Early ? earlyCullPass : lateCullPass;
+		vkCmdBeginRenderPass(commandBuffer, &phaseRenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		if (capturing)
+		{
+			vkb_commandCapture_beginRenderPass(phaseRenderPassInfo);
+			vkb_commandCapture_bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+			vkb_commandCapture_setViewport(viewport);
+			vkb_commandCapture_setScissor(scissor);
+		}
+		bindScene(commandBuffer);
+		pushSceneConstants(commandBuffer, viewport);
+		if (lit)
+		{
+			vkb_clusteredLighting_bind(clusteredLighting, commandBuffer, pipelineLayout, 1);
+			lastDrawStats.descriptorSetBinds++;
+		}
+		vkb_occlusionCuller_recordDraw(occlusionCuller, commandBuffer, phase, pipelineLayout);
+		if (phase == vkb_OcclusionPhase::Late && packet.particles)
+		{
+			vkb_particleSystem_recordDraw(particleSystem, commandBuffer);
+			lastDrawStats.numDraws++;
+			lastDrawStats.pipelineBinds++;
+			lastDrawStats.descriptorSetBinds++;
+		}
+		if (phase == vkb_OcclusionPhase::Late && packet.numSprites > 0)
+		{
+			recordSpriteDraw(commandBuffer, scissor.extent);
+		}
+		vkCmdEndRenderPass(commandBuffer);
+		if (capturing)
+		{
+			vkb_commandCapture_endRenderPass();
+		}
+
+		lastDrawStats.numDraws++;
+		lastDrawStats.pipelineBinds++;
+		lastDrawStats.descriptorSetBinds++;
+	}
+
+	if (lit)
+	{
+		vkb_clusteredLighting_endShading(clusteredLighting, commandBuffer);
+	}
+}
+
+// -------------------- Clustered lighting --------------------
+static void initClusteredLighting()
+{
+	const char* cullShaderFilename = "assets/shaders/bin/light_cull.spv";
+	if (!vkb_file_exists(cullShaderFilename))
+	{
+		g_logger_warning("The light culling shader hasn't been compiled, clustered lighting is disabled.");
+		appConfig.clusteredLighting = false;
+		return;
+	}
+
+	vkb_FileContents cullShader = vkb_file_read(cullShaderFilename);
+
+	vkb_ClusteredLightingDesc desc = {};
+	desc.maxLights = maxClusteredLights;
+	desc.maxLightsPerCluster = maxLightsPerCluster;
+	desc.maxLightIndices = maxLightIndices;
+	desc.lightingSetLayout = lightingSetLayout;
+	desc.cullShader = &cullShader;
+	desc.pipelineCache = pipelineCache;
+	clusteredLighting = vkb_clusteredLighting_create(context, desc);
+
+	vkb_file_free(cullShader);
+	appConfig.numLights = appConfig.numLights < maxClusteredLights ? appConfig.numLights : maxClusteredLights;
+}
 
-	VkPipelineLayoutCreateInfo pipelineCreateInfo = {};
-	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineCreateInfo.setLayoutCount = 0; // Optional
-	pipelineCreateInfo.pSetLayouts = nullptr; // Optional
-	pipelineCreateInfo.pushConstantRangeCount = 0; // Optional
-	pipelineCreateInfo.pPushConstantRanges = nullptr; // Optional
+static uint32 hashLight(uint32 value)
+{
+	value ^= value >> 16;
+	value *= 0x7feb352d;
+	value ^= value >> 15;
+	value *= 0x846ca68b;
+	value ^= value >> 16;
+	return value;
+}
 
-	uint32 result = vkCreatePipelineLayout(logicalDevice, &pipelineCreateInfo, nullptr, &pipelineLayout);
-	if (result != VK_SUCCESS)
+static void updateLights(const vkb_FramePacket& packet)
+{
+	// Every light drifts in a small circle above its own spot on the floor
+	vkb_PointLight* lights = vkb_arena_allocateArray<vkb_PointLight>(vkb_frameArena_get(), packet.numLights);
+	for (uint32 i = 0; i < packet.numLights; i++)
 	{
-		g_logger_assert(false, "Failed to create pipeline.");
+		uint32 placement = hashLight(i);
+		uint32 variation = hashLight(i ^ 0x9e3779b9);
+		float u = (float)(placement & 0xFFFF) / 65535.0f;
+		float v = (float)(placement >> 16) / 65535.0f;
+		float phase = (float)(variation & 0xFFFF) / 65535.0f * 6.2831853f;
+		float angle = (float)packet.simulationTime * 0.5f + phase;
+
+		vkb_PointLight& light = lights[i];
+		light.position[0] = (u * 2.0f - 1.0f) * floorHalfWidth + cosf(angle) * 0.5f;
+		light.position[1] = -floorHeight + 0.25f + (float)(variation >> 24) / 255.0f * 0.5f;
+		light.position[2] = -(floorNear + v * floorDepth) + sinf(angle) * 0.5f;
+		light.radius = 0.75f + (float)((variation >> 16) & 0xFF) / 255.0f * 0.75f;
+		light.color[0] = 0.5f + 0.5f * cosf(phase);
+		light.color[1] = 0.5f + 0.5f * cosf(phase + 2.0943951f);
+		light.color[2] = 0.5f + 0.5f * cosf(phase + 4.1887902f);
+		light.intensity = 1.5f;
 	}
 
-	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
-	graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	graphicsPipelineCreateInfo.stageCount = 2;
-	graphicsPipelineCreateInfo.pStages = shaderStages;
-	graphicsPipelineCreateInfo.pVertexInputState = &vertexInputInfo;
-	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssembly;
-	graphicsPipelineCreateInfo.pViewportState = &viewportInfo;
-	graphicsPipelineCreateInfo.pRasterizationState = &rasterInfo;
-	graphicsPipelineCreateInfo.pMultisampleState = &multisampleInfo;
-	graphicsPipelineCreateInfo.pDepthStencilState = nullptr;
-	graphicsPipelineCreateInfo.pColorBlendState = &blendInfo;
-	graphicsPipelineCreateInfo.pDynamicState = &dynamicStateInfo;
-	graphicsPipelineCreateInfo.layout = pipelineLayout;
-	graphicsPipelineCreateInfo.renderPass = renderPass;
-	graphicsPipelineCreateInfo.subpass = 0;
-	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
-	graphicsPipelineCreateInfo.basePipelineIndex = -1;
+	VkExtent2D sceneExtent = getSceneExtent();
+	vkb_ClusterView view = {};
+	view.width = sceneExtent.width;
+	view.height = sceneExtent.height;
+	view.tanHalfFovY = tanf(viewFovY * 0.5f);
+	view.tanHalfFovX = view.tanHalfFovY * (float)sceneExtent.width / (float)sceneExtent.height;
+	view.nearZ = viewNearZ;
+	view.farZ = viewFarZ;
+	vkb_clusteredLighting_update(clusteredLighting, lights, packet.numLights, view);
+}
 
-	result = vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &graphicsPipeline);
-	if (result != VK_SUCCESS)
+// -------------------- Particles --------------------
+static void initParticles()
+{
+	const char* computeShaderFilename = "assets/shaders/bin/particles.spv";
+	const char* vertShaderFilename = "assets/shaders/bin/particle_vert.spv";
+	const char* fragShaderFilename = "assets/shaders/bin/particle_frag.spv";
+	if (!vkb_file_exists(computeShaderFilename) || !vkb_file_exists(vertShaderFilename) || !vkb_file_exists(fragShaderFilename))
 	{
-		g_logger_assert(false, "Failed to create graphics pipeline.");
+		g_logger_warning("The particle shaders haven't been compiled, particles are disabled.");
+		appConfig.particles = false;
+		return;
 	}
 
-	vkDestroyShaderModule(logicalDevice, vertModule, nullptr);
-	vkDestroyShaderModule(logicalDevice, fragModule, nullptr);
+	vkb_FileContents computeShader = vkb_file_read(computeShaderFilename);
+	vkb_FileContents vertShader = vkb_file_read(vertShaderFilename);
+	vkb_FileContents fragShader = vkb_file_read(fragShaderFilename);
+
+	// A fountain in front of the camera, emitting just fast enough to keep every particle busy
+	vkb_ParticleSystemDesc desc = {};
+	desc.maxParticles = appConfig.maxParticles;
+	desc.maxEmitPerFrame = appConfig.maxParticles / 4 > 0 ? appConfig.maxParticles / 4 : 1;
+	desc.emitter.position[1] = -1.0f;
+	desc.emitter.position[2] = -8.0f;
+	desc.emitter.velocity[1] = 5.0f;
+	desc.emitter.spread = 1.5f;
+	desc.emitter.gravity[1] = -9.8f;
+	desc.emitter.lifetime = 1.5f;
+	desc.emitter.lifetimeJitter = 0.5f;
+	desc.emitter.size = 0.02f;
+	desc.emitter.emissionRate = (float)appConfig.maxParticles / (desc.emitter.lifetime + desc.emitter.lifetimeJitter);
+	desc.computeShader = &computeShader;
+	desc.vertShader = &vertShader;
+	desc.fragShader = &fragShader;
+	desc.renderPass = renderPass;
+	desc.pipelineCache = pipelineCache;
+	particleSystem = vkb_particleSystem_create(context, desc);
+
+	vkb_file_free(computeShader);
+	vkb_file_free(vertShader);
+	vkb_file_free(fragShader);
+	lastParticleTime = 0.0;
+}
 
-	vkb_file_free(vertBytecode);
-	vkb_file_free(fragBytecode);
+static void updateParticles(const vkb_FramePacket& packet)
+{
+	// The first frame after they're turned on doesn't simulate
+	float deltaTime = lastParticleTime > 0.0 ? (float)(packet.simulationTime - lastParticleTime) : 0.0f;
+	lastParticleTime = packet.simulationTime;
+
+	vkb_ParticleView view = {};
+	VkExtent2D sceneExtent = getSceneExtent();
+	view.tanHalfFovY = tanf(viewFovY * 0.5f);
+	view.tanHalfFovX = view.tanHalfFovY * (float)sceneExtent.width / (float)sceneExtent.height;
+	view.nearZ = viewNearZ;
+	view.farZ = viewFarZ;
+	vkb_particleSystem_update(particleSystem, deltaTime, view);
 }
 
-static void createRenderPass()
+// -------------------- Sprites --------------------
+static void initSprites()
 {
-	VkAttachmentDescription colorAttachment = {};
-	colorAttachment.format = swapChainImageFormat;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	const char* vertShaderFilename = "assets/shaders/bin/sprite_vert.spv";
+	const char* fragShaderFilename = "assets/shaders/bin/sprite_frag.spv";
+	if (!vkb_file_exists(vertShaderFilename) || !vkb_file_exists(fragShaderFilename))
+	{
+		g_logger_warning("The sprite shaders haven't been compiled, sprites are disabled.");
+		appConfig.sprites = false;
+		return;
+	}
 
-	VkAttachmentReference colorAttachmentRef = {};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	vkb_FileContents vertShader = vkb_file_read(vertShaderFilename);
+	vkb_FileContents fragShader = vkb_file_read(fragShaderFilename);
+
+	vkb_SpriteRendererDesc desc = {};
+	desc.atlasSize = 2048;
+	desc.maxAtlases = 4;
+	desc.maxImages = 1024;
+	desc.maxSpritesPerFrame = maxSpritesPerFrame;
+	desc.uploadBytesPerFrame = 4 * 1024 * 1024;
+	desc.vertShader = &vertShader;
+	desc.fragShader = &fragShader;
+	desc.renderPass = renderPass;
+	desc.pipelineCache = pipelineCache;
+	spriteRenderer = vkb_spriteRenderer_create(context, desc);
+
+	vkb_file_free(vertShader);
+	vkb_file_free(fragShader);
+
+	// Soft edged discs between 8 and 71 pixels across, white so the sprite's color tints them
+	constexpr uint32 maxImageSize = 8 + numSpriteImages - 1;
+	uint8* pixels = (uint8*)g_memory_allocate(maxImageSize * maxImageSize * 4);
+	for (uint32 i = 0; i < numSpriteImages; i++)
+	{
+		uint32 size = 8 + i;
+		float radius = (float)size * 0.5f;
+		for (uint32 y = 0; y < size; y++)
+		{
+			for (uint32 x = 0; x < size; x++)
+			{
+				float dx = (float)x + 0.5f - radius;
+				float dy = (float)y + 0.5f - radius;
+				float coverage = fminf(fmaxf(radius - sqrtf(dx * dx + dy * dy), 0.0f), 1.0f);
+				uint8 value = (uint8)(coverage * 255.0f);
+				uint8* pixel = pixels + (y * size + x) * 4;
+				pixel[0] = value;
+				pixel[1] = value;
+				pixel[2] = value;
+				pixel[3] = value;
+			}
+		}
+		spriteImages[i] = vkb_spriteRenderer_addImage(context, spriteRenderer, pixels, size, size);
+	}
+	g_memory_free(pixels);
 
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
+	lastSpriteStats = {};
+}
 
-	VkSubpassDependency subpassDep = {};
-	subpassDep.srcSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDep.dstSubpass = 0;
+static void updateSprites(const vkb_FramePacket& packet)
+{
+	// Drifting rows across the scene, every fourth sprite additive and a layer
+	// per row band, so the batcher has several runs to merge
+	VkExtent2D sceneExtent = getSceneExtent();
+	uint32 columns = (uint32)sqrtf((float)packet.numSprites) + 1;
+	float spacingX = (float)sceneExtent.width / (float)columns;
+	float spacingY = (float)sceneExtent.height / (float)columns;
+	float time = (float)packet.simulationTime;
+
+	vkb_spriteRenderer_beginFrame(spriteRenderer);
+	for (uint32 i = 0; i < packet.numSprites; i++)
+	{
+		uint32 column = i % columns;
+		uint32 row = i / columns;
+
+		vkb_Sprite sprite = {};
+		sprite.image = spriteImages[(i * 7) % numSpriteImages];
+		sprite.size[0] = spacingX * 1.5f;
+		sprite.size[1] = spacingY * 1.5f;
+		sprite.position[0] = (float)column * spacingX + sinf(time + (float)row * 0.3f) * spacingX;
+		sprite.position[1] = (float)row * spacingY;
+		sprite.color = (i & 3) == 0 ? 0x40402010 : 0xC0C08040;
+		sprite.blend = (i & 3) == 0 ? vkb_SpriteBlend::Additive : vkb_SpriteBlend::Alpha;
+		sprite.layer = (uint8)(row * 4 / columns);
+		vkb_spriteRenderer_draw(spriteRenderer, sprite);
+	}
+}
 
-	subpassDep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDep.srcAccessMask = 0;
+static void recordSpriteDraw(VkCommandBuffer commandBuffer, VkExtent2D targetExtent)
+{
+	// Last, over the scene and the particles
+	vkb_spriteRenderer_recordDraw(spriteRenderer, commandBuffer, targetExtent);
+	lastSpriteStats = vkb_spriteRenderer_getStats(spriteRenderer);
+	lastDrawStats.numDraws += lastSpriteStats.drawsAfterBatching;
+}
 
-	subpassDep.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+// -------------------- Bindless and materials --------------------
+static void initBindless()
+{
+	if (!descriptorIndexingEnabled)
+	{
+		g_logger_info("Descriptor indexing isn't supported, there's no bindless heap.");
+		return;
+	}
 
-	VkRenderPassCreateInfo renderPassCreateInfo = {};
-	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &colorAttachment;
-	renderPassCreateInfo.subpassCount = 1;
-	renderPassCreateInfo.pSubpasses = &subpass;
-	renderPassCreateInfo.dependencyCount = 1;
-	renderPassCreateInfo.pDependencies = &subpassDep;
+	vkb_BindlessHeapDesc desc = {};
+	desc.maxTextures = maxBindlessTextures;
+	desc.maxBuffers = maxBindlessBuffers;
+	desc.stages = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+	bindlessHeap = vkb_bindlessHeap_create(context, desc);
+}
 
-	uint32 result = vkCreateRenderPass(logicalDevice, &renderPassCreateInfo, nullptr, &renderPass);
-	if (result != VK_SUCCESS)
+static void initMaterials()
+{
+	const char* vertShaderFilename = "assets/shaders/bin/material_vert.spv";
+	const char* fragShaderFilename = "assets/shaders/bin/material_frag.spv";
+	const char* bindlessFragShaderFilename = "assets/shaders/bin/material_bindless_frag.spv";
+	if (!vkb_file_exists(vertShaderFilename) || !vkb_file_exists(fragShaderFilename) || !vkb_file_exists(bindlessFragShaderFilename))
 	{
-		g_logger_assert(false, "Failed to create render pass.");
+		g_logger_warning("The material shaders haven't been compiled, materials are disabled.");
+		appConfig.numMaterials = 0;
+		return;
 	}
+
+	vkb_FileContents vertShader = vkb_file_read(vertShaderFilename);
+	vkb_FileContents fragShader = vkb_file_read(fragShaderFilename);
+	vkb_FileContents bindlessFragShader = vkb_file_read(bindlessFragShaderFilename);
+
+	vkb_MaterialLibraryDesc desc = {};
+	desc.numMaterials = maxMaterials;
+	desc.bindlessHeap = bindlessHeap;
+	desc.vertShader = &vertShader;
+	desc.fragShader = &fragShader;
+	desc.bindlessFragShader = &bindlessFragShader;
+	desc.renderPass = renderPass;
+	desc.pipelineCache = pipelineCache;
+	materialLibrary = vkb_materialLibrary_create(context, desc);
+
+	vkb_file_free(vertShader);
+	vkb_file_free(fragShader);
+	vkb_file_free(bindlessFragShader);
 }
 
-static void createFramebuffers()
+static void pushMaterialDraws(VkCommandBuffer commandBuffer, const vkb_FramePacket& packet)
 {
-	swapChainFramebuffers.resize(swapChainImageViews.size());
+	vkb_MaterialBinding binding = packet.bindlessMaterials ? vkb_MaterialBinding::Bindless : vkb_MaterialBinding::PerMaterialSet;
+	if (packet.bindlessMaterials)
+	{
+		// The one descriptor set bind of the frame, every draw after it only pushes indices
+		VkPipelineLayout layout = vkb_materialLibrary_getPipelineLayout(materialLibrary, binding);
+		vkb_bindlessHeap_bind(bindlessHeap, commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0);
+		lastDrawStats.descriptorSetBinds++;
+	}
+	vkb_materialLibrary_pushDraws(materialLibrary, drawQueue, binding, packet.drawsPerFrame, packet.numMaterials);
+}
 
-	for (int i = 0; i < swapChainImageViews.size(); i++)
+// -------------------- Command capture --------------------
+static void beginCommandCapture()
+{
+	uint32 numFrames = pendingCaptureFrames.load(std::memory_order_acquire);
+	if (numFrames == 0 || numFrames == UINT32_MAX)
 	{
-		VkFramebufferCreateInfo createInfo = {};
-		createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		createInfo.renderPass = renderPass;
-		createInfo.attachmentCount = 1;
-		createInfo.pAttachments = &swapChainImageViews[i];
-		createInfo.width = swapChainExtent.width;
-		createInfo.height = swapChainExtent.height;
-		createInfo.layers = 1;
+		return;
+	}
 
-		uint32 res = vkCreateFramebuffer(logicalDevice, &createInfo, nullptr, &swapChainFramebuffers[i]);
-		if (res != VK_SUCCESS)
-		{
-			g_logger_error("Failed to create framebuffer[%d]", i);
-			g_logger_assert(false, "");
-		}
+	// The mesh's vertices only exist in the device local buffers it was uploaded to
+	if (sceneMeshEnabled)
+	{
+		g_logger_warning("Command capture isn't supported while the scene is drawn with a mesh, '%s' was skipped.", pendingCaptureFilename);
+	}
+	else
+	{
+		CapturedAppState state = {};
+		state.shaderFeatures = appConfig.shaderFeatures;
+		state.sceneInstances = appConfig.sceneInstances;
+		state.numLights = appConfig.numLights;
+		state.maxParticles = appConfig.maxParticles;
+		state.numSprites = appConfig.numSprites;
+		state.numMaterials = appConfig.numMaterials;
+		state.dynamicResolutionConfig = appConfig.dynamicResolutionConfig;
+		state.dynamicResolution = appConfig.dynamicResolution;
+		state.instancedScene = appConfig.instancedScene;
+		state.occlusionCulling = appConfig.occlusionCulling;
+		state.clusteredLighting = appConfig.clusteredLighting;
+		state.particles = appConfig.particles;
+		state.sprites = appConfig.sprites;
+		state.bindlessMaterials = appConfig.bindlessMaterials;
+		vkb_commandCapture_start(pendingCaptureFilename, numFrames, swapChainExtent, swapChainImageFormat, &state, sizeof(state));
 	}
+	pendingCaptureFrames.store(0, std::memory_order_release);
 }
 
-static void createCommandPool()
+static VkPipeline getReplayPipeline(uint32 variantKey, void*)
 {
-	QueueFamilyIndices queueFamily = findQueueFamilies(physicalDevice);
+	return vkb_shaderVariantCache_get(shaderVariants, variantKey);
+}
 
-	VkCommandPoolCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	createInfo.queueFamilyIndex = queueFamily.graphicsFamily;
+static void recordReplayFrame(VkCommandBuffer commandBuffer, uint32 imageIndex)
+{
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-	uint32 res = vkCreateCommandPool(logicalDevice, &createInfo, nullptr, &commandPool);
+	uint32 res = vkBeginCommandBuffer(commandBuffer, &beginInfo);
 	if (res != VK_SUCCESS)
 	{
-		g_logger_error("Failed to create command pool for graphics family.");
+		g_logger_error("Failed to begin command buffer.");
+		g_logger_assert(false, "");
+	}
+
+	// The atlases and material textures are filled by the replay's own uploads, a capture only has the ones made while it ran
+	if (spriteRenderer != nullptr)
+	{
+		vkb_spriteRenderer_beginFrame(spriteRenderer);
+		vkb_spriteRenderer_recordUploads(spriteRenderer, commandBuffer);
+	}
+	if (materialLibrary != nullptr)
+	{
+		vkb_materialLibrary_recordUploads(materialLibrary, commandBuffer);
+	}
+
+	vkb_ReplayTarget target = { renderPass, swapChainFramebuffers[imageIndex], swapChainImages[imageIndex] };
+	vkb_commandStream_recordFrame(replayStream, replayFrameIndex, commandBuffer, target, getReplayPipeline, nullptr);
+
+	res = vkEndCommandBuffer(commandBuffer);
+	if (res != VK_SUCCESS)
+	{
+		g_logger_error("Failed to end command buffer.");
 		g_logger_assert(false, "");
 	}
 }
@@ -757,9 +3420,9 @@ static void createSyncObjects()
 	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-	bool res = vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphore) == VK_SUCCESS;
-	res = res && (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphore) == VK_SUCCESS);
-	res = res && (vkCreateFence(logicalDevice, &fenceInfo, nullptr, &inFlightFence) == VK_SUCCESS);
+	bool res = vkCreateSemaphore(logicalDevice, &semaphoreInfo, vkAllocator, &imageAvailableSemaphore) == VK_SUCCESS;
+	res = res && (vkCreateSemaphore(logicalDevice, &semaphoreInfo, vkAllocator, &renderFinishedSemaphore) == VK_SUCCESS);
+	res = res && (vkCreateFence(logicalDevice, &fenceInfo, vkAllocator, &inFlightFence) == VK_SUCCESS);
 	g_logger_assert(res, "Failed to create sync objects.");
 }
 
@@ -780,7 +3443,7 @@ static void createCommandBuffer()
 	}
 }
 
-static void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32 imageIndex)
+static void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32 imageIndex, const vkb_FramePacket& packet)
 {
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -794,39 +3457,165 @@ static void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32 imageIndex
 		g_logger_assert(false, "");
 	}
 
+	VkExtent2D sceneExtent = getSceneExtent();
+	if (appConfig.dynamicResolution)
+	{
+		vkb_gpuTimer_reset(frameTimer, commandBuffer);
+		vkb_gpuTimer_begin(frameTimer, commandBuffer, 0);
+	}
+
 	// Start the render pass
 	VkRenderPassBeginInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = renderPass;
-	renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+	renderPassInfo.renderPass = appConfig.dynamicResolution ? sceneRenderPass : renderPass;
+	renderPassInfo.framebuffer = appConfig.dynamicResolution ? sceneFramebuffer : swapChainFramebuffers[imageIndex];
 	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = swapChainExtent;
+	renderPassInfo.renderArea.extent = sceneExtent;
 
-	VkClearValue clearColor = VkClearValue{ 0.7f, 0.05f, 0.1f, 1.0f };
-	renderPassInfo.clearValueCount = 1;
-	renderPassInfo.pClearValues = &clearColor;
-
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	VkClearValue clearValues[2] = {};
+	clearValues[0] = VkClearValue{ packet.clearColor[0], packet.clearColor[1], packet.clearColor[2], packet.clearColor[3] };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+	renderPassInfo.clearValueCount = 2;
+	renderPassInfo.pClearValues = clearValues;
 
 	VkViewport viewport;
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = (float)swapChainExtent.width;
-	viewport.height = (float)swapChainExtent.height;
+	viewport.width = (float)sceneExtent.width;
+	viewport.height = (float)sceneExtent.height;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
 	VkRect2D scissor = {};
 	scissor.offset = { 0, 0 };
-	scissor.extent = swapChainExtent;
-	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	scissor.extent = sceneExtent;
+
+	bool lit = (packet.shaderFeatures & vkb_ShaderFeature_ClusteredLighting) != 0;
+	if (lit)
+	{
+		vkb_clusteredLighting_recordCull(clusteredLighting, commandBuffer);
+	}
+	if (packet.particles)
+	{
+		vkb_particleSystem_recordSimulate(particleSystem, commandBuffer);
+	}
+	if (packet.numSprites > 0)
+	{
+		vkb_spriteRenderer_recordUploads(spriteRenderer, commandBuffer);
+	}
+	if (packet.numMaterials > 0)
+	{
+		vkb_materialLibrary_recordUploads(materialLibrary, commandBuffer);
+	}
+
+	lastDrawStats = {};
+	if (packet.occlusionCulling)
+	{
+		recordCulledScene(commandBuffer, renderPassInfo, packet, viewport, scissor);
+	}
+	else
+	{
+		bool capturing = vkb_commandCapture_isActive();
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		if (capturing)
+		{
+			vkb_commandCapture_beginRenderPass(renderPassInfo);
+		}
+		if (lit)
+		{
+			// Set 1 stays bound across the pipeline binds below, they share the layout
+			vkb_clusteredLighting_bind(clusteredLighting, commandBuffer, pipelineLayout, 1);
+			vkb_clusteredLighting_beginShading(clusteredLighting, commandBuffer);
+		}
+		pushSceneConstants(commandBuffer, viewport);
+
+		VkPipeline graphicsPipeline = vkb_shaderVariantCache_get(shaderVariants, packet.shaderFeatures);
+
+		if (packet.rebindStatePerDraw)
+		{
+			// Deliberately rebinds everything, this is what the draw queue saves us from
+			for (uint32 drawi = 0; drawi < packet.drawsPerFrame; drawi++)
+			{
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+				vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+				if (capturing)
+				{
+					vkb_commandCapture_bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+					vkb_commandCapture_setViewport(viewport);
+					vkb_commandCapture_setScissor(scissor);
+					vkb_commandCapture_draw(3, 1, 0, 0);
+				}
+			}
+			lastDrawStats.numDraws = packet.drawsPerFrame;
+			lastDrawStats.pipelineBinds = packet.drawsPerFrame;
+		}
+		else
+		{
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			if (capturing)
+			{
+				vkb_commandCapture_setViewport(viewport);
+				vkb_commandCapture_setScissor(scissor);
+			}
+
+			vkb_drawQueue_clear(drawQueue);
+			if (packet.numMaterials > 0)
+			{
+				pushMaterialDraws(commandBuffer, packet);
+			}
+			else if (packet.instancedScene)
+			{
+				pushSceneDraws(commandBuffer, packet);
+			}
+			else
+			{
+				vkb_DrawCommand draw = {};
+				draw.pipeline = graphicsPipeline;
+				draw.pipelineLayout = pipelineLayout;
+				draw.vertexCount = 3;
+				draw.instanceCount = 1;
+				uint64 key = vkb_drawKey_make(0, packet.shaderFeatures, 0, 0, 0.0f);
+
+				for (uint32 drawi = 0; drawi < packet.drawsPerFrame; drawi++)
+				{
+					vkb_drawQueue_push(drawQueue, key, draw);
+				}
+			}
+			vkb_drawQueue_sort(drawQueue);
+			vkb_drawQueue_record(drawQueue, commandBuffer, &lastDrawStats);
+		}
 
-	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+		if (lit)
+		{
+			vkb_clusteredLighting_endShading(clusteredLighting, commandBuffer);
+		}
+		// Last, they bind their own pipeline and layout and are blended over everything
+		if (packet.particles)
+		{
+			vkb_particleSystem_recordDraw(particleSystem, commandBuffer);
+			lastDrawStats.numDraws++;
+			lastDrawStats.pipelineBinds++;
+			lastDrawStats.descriptorSetBinds++;
+		}
+		if (packet.numSprites > 0)
+		{
+			recordSpriteDraw(commandBuffer, sceneExtent);
+		}
+		vkCmdEndRenderPass(commandBuffer);
+		if (capturing)
+		{
+			vkb_commandCapture_endRenderPass();
+		}
+	}
 
-	vkCmdEndRenderPass(commandBuffer);
+	if (appConfig.dynamicResolution)
+	{
+		recordUpscale(commandBuffer, imageIndex, sceneExtent);
+		vkb_gpuTimer_end(frameTimer, commandBuffer, 0);
+	}
 
 	res = vkEndCommandBuffer(commandBuffer);
 	if (res != VK_SUCCESS)
@@ -836,6 +3625,63 @@ static void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32 imageIndex
 	}
 }
 
+static VkCommandBuffer getRetainedCommandBuffer(uint32 imageIndex, const vkb_FramePacket& packet)
+{
+	if (imageIndex >= retainedCommandBuffers.size())
+	{
+		size_t oldSize = retainedCommandBuffers.size();
+		retainedCommandBuffers.resize(swapChainImages.size());
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		for (size_t i = oldSize; i < retainedCommandBuffers.size(); i++)
+		{
+			allocInfo.commandBufferCount = 1;
+			uint32 res = vkAllocateCommandBuffers(logicalDevice, &allocInfo, &retainedCommandBuffers[i].commandBuffer);
+			g_logger_assert(res == VK_SUCCESS, "Failed to allocate retained command buffer.");
+
+			// Generation 0 is never current, so the first use always records
+			retainedCommandBuffers[i].generation = 0;
+		}
+	}
+
+	RetainedCommandBuffer& retained = retainedCommandBuffers[imageIndex];
+	bool upToDate = retained.generation == retainedGeneration &&
+		retained.drawsPerFrame == packet.drawsPerFrame &&
+		retained.rebindStatePerDraw == packet.rebindStatePerDraw &&
+		retained.shaderFeatures == packet.shaderFeatures &&
+		retained.instancedScene == packet.instancedScene &&
+		retained.sceneVisibleInstances == sceneVisibleInstances &&
+		retained.particles == packet.particles &&
+		retained.numMaterials == packet.numMaterials &&
+		retained.bindlessMaterials == packet.bindlessMaterials &&
+		retained.renderScale == renderScale &&
+		memcmp(retained.clearColor, packet.clearColor, sizeof(retained.clearColor)) == 0;
+	if (upToDate)
+	{
+		return retained.commandBuffer;
+	}
+
+	vkResetCommandBuffer(retained.commandBuffer, 0);
+	recordCommandBuffer(retained.commandBuffer, imageIndex, packet);
+
+	retained.generation = retainedGeneration;
+	retained.drawsPerFrame = packet.drawsPerFrame;
+	retained.rebindStatePerDraw = packet.rebindStatePerDraw;
+	retained.shaderFeatures = packet.shaderFeatures;
+	retained.instancedScene = packet.instancedScene;
+	retained.sceneVisibleInstances = sceneVisibleInstances;
+	retained.particles = packet.particles;
+	retained.numMaterials = packet.numMaterials;
+	retained.bindlessMaterials = packet.bindlessMaterials;
+	retained.renderScale = renderScale;
+	memcpy(retained.clearColor, packet.clearColor, sizeof(retained.clearColor));
+
+	return retained.commandBuffer;
+}
+
 // -------------------- Shader functions --------------------
 static VkShaderModule createShaderModule(vkb_FileContents& fileContents)
 {
@@ -845,7 +3691,7 @@ static VkShaderModule createShaderModule(vkb_FileContents& fileContents)
 	createInfo.pCode = (uint32*)fileContents.data;
 
 	VkShaderModule shaderModule;
-	uint32 result = vkCreateShaderModule(logicalDevice, &createInfo, nullptr, &shaderModule);
+	uint32 result = vkCreateShaderModule(logicalDevice, &createInfo, vkAllocator, &shaderModule);
 	if (result != VK_SUCCESS)
 	{
 		g_logger_assert(false, "Failed to create shader module.");
@@ -854,77 +3700,36 @@ static VkShaderModule createShaderModule(vkb_FileContents& fileContents)
 	return shaderModule;
 }
 
-static bool isDeviceSuitable(VkPhysicalDevice device)
+static bool isDeviceSuitable(const vkb_DeviceCaps& caps)
 {
-	// TODO: Can use these and check for certain properties
-	// VkPhysicalDeviceProperties deviceProperties;
-	// vkGetPhysicalDeviceProperties(device, &deviceProperties);
-	// 
-	// VkPhysicalDeviceFeatures deviceFeatures;
-	// vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-
-	QueueFamilyIndices indices = findQueueFamilies(device);
-	bool extensionsSupported = checkDeviceExtensionSupport(device);
-	bool swapChainAdequate = false;
-	if (extensionsSupported)
+	if (appConfig.headless)
 	{
-		SwapChainSupportDetails details = querySwapChainSupport(device);
-		swapChainAdequate = !details.formats.empty() && !details.presentModes.empty();
+		return caps.graphicsFamily != NullQueueFamily;
 	}
 
-	return indices.isComplete() && extensionsSupported && swapChainAdequate;
-}
-
-static QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device)
-{
-	QueueFamilyIndices indices;
-	indices.graphicsFamily = NullQueueFamily;
-
-	// NOTE: We look for a queue family suitable to store graphics commands
-	// which is our requirements for a suitable device
-	// Logic to find graphics queue family
-	uint32 queueFamilyCount = 0;
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-
-	VkQueueFamilyProperties* queueFamilies = (VkQueueFamilyProperties*)g_memory_allocate(sizeof(VkQueueFamilyProperties) * queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies);
-
-	for (uint32 familyi = 0; familyi < queueFamilyCount; familyi++)
+	// TODO: Can use caps.properties and caps.features and check for certain properties
+	bool queueFamiliesComplete = caps.graphicsFamily != NullQueueFamily && caps.presentFamily != NullQueueFamily;
+	bool extensionsSupported = checkDeviceExtensionSupport(caps);
+	bool swapChainAdequate = false;
+	if (extensionsSupported)
 	{
-		const VkQueueFamilyProperties& queueFamily = queueFamilies[familyi];
-		if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-		{
-			indices.graphicsFamily = familyi;
-		}
-
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, familyi, surface, &presentSupport);
-		if (presentSupport)
-		{
-			indices.presentFamily = familyi;
-		}
-
-		if (indices.isComplete())
-		{
-			break;
-		}
+		swapChainAdequate = caps.surfaceFormatCount > 0 && caps.presentModeCount > 0;
 	}
 
-	g_memory_free(queueFamilies);
-
-	return indices;
+	return queueFamiliesComplete && extensionsSupported && swapChainAdequate;
 }
 
-static bool checkForRequiredExts(const std::vector<const char*>& requiredExts)
+static bool checkForRequiredExts(const char* const* requiredExts, uint32 requiredExtCount)
 {
 	bool res = true;
 
 	// How to enumerate extensions
 	uint32 extensionCount = 0;
 	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
-	VkExtensionProperties* extensions = (VkExtensionProperties*)g_memory_allocate(sizeof(VkExtensionProperties) * extensionCount);
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	VkExtensionProperties* extensions = vkb_arena_allocateArray<VkExtensionProperties>(vkb_scratch_get(), extensionCount);
 	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions);
-	for (uint32 requiredExti = 0; requiredExti < requiredExts.size(); requiredExti++)
+	for (uint32 requiredExti = 0; requiredExti < requiredExtCount; requiredExti++)
 	{
 		bool foundExt = false;
 		for (uint32 exti = 0; exti < extensionCount; exti++)
@@ -943,16 +3748,39 @@ static bool checkForRequiredExts(const std::vector<const char*>& requiredExts)
 		}
 	}
 
-	g_memory_free(extensions);
+	vkb_scratch_end(scratch);
 	return res;
 }
 
+static bool hasInstanceExtension(const char* extensionName)
+{
+	uint32 extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	VkExtensionProperties* extensions = vkb_arena_allocateArray<VkExtensionProperties>(vkb_scratch_get(), extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions);
+
+	bool found = false;
+	for (uint32 exti = 0; exti < extensionCount; exti++)
+	{
+		if (strcmp(extensions[exti].extensionName, extensionName) == 0)
+		{
+			found = true;
+			break;
+		}
+	}
+
+	vkb_scratch_end(scratch);
+	return found;
+}
+
 static bool checkValidationLayerSupport()
 {
 	uint32 layerCount;
 	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
 
-	VkLayerProperties* availableLayers = (VkLayerProperties*)g_memory_allocate(sizeof(VkLayerProperties) * layerCount);
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	VkLayerProperties* availableLayers = vkb_arena_allocateArray<VkLayerProperties>(vkb_scratch_get(), layerCount);
 	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers);
 
 	bool res = true;
@@ -975,75 +3803,29 @@ static bool checkValidationLayerSupport()
 		}
 	}
 
-	g_memory_free(availableLayers);
+	vkb_scratch_end(scratch);
 
 	return res;
 }
 
-static bool checkDeviceExtensionSupport(VkPhysicalDevice device)
+static bool checkDeviceExtensionSupport(const vkb_DeviceCaps& caps)
 {
-	uint32 deviceExtensionCount;
-	vkEnumerateDeviceExtensionProperties(device, nullptr, &deviceExtensionCount, nullptr);
-
-	VkExtensionProperties* extensions = (VkExtensionProperties*)g_memory_allocate(sizeof(VkExtensionProperties) * deviceExtensionCount);
-	vkEnumerateDeviceExtensionProperties(device, nullptr, &deviceExtensionCount, extensions);
-
-	bool res = true;
 	for (const char* requiredExt : requiredDeviceExtensions)
 	{
-		bool foundExt = false;
-		for (int i = 0; i < deviceExtensionCount; i++)
-		{
-			if (strcmp(extensions[i].extensionName, requiredExt) == 0)
-			{
-				foundExt = true;
-				break;
-			}
-		}
-
-		if (!foundExt)
+		if (!vkb_deviceCaps_hasExtension(caps, requiredExt))
 		{
-			res = false;
-			break;
+			return false;
 		}
 	}
 
-	g_memory_free(extensions);
-
-	return res;
-}
-
-static SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device)
-{
-	SwapChainSupportDetails details = {};
-
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
-
-	uint32 formatCount = 0;
-	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
-
-	if (formatCount != 0)
-	{
-		details.formats.resize(formatCount);
-		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
-	}
-
-	uint32 presentModeCount = 0;
-	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
-
-	if (presentModeCount != 0)
-	{
-		details.presentModes.resize(presentModeCount);
-		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
-	}
-
-	return details;
+	return true;
 }
 
-static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
+static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const VkSurfaceFormatKHR* availableFormats, uint32 formatCount)
 {
-	for (const VkSurfaceFormatKHR& format : availableFormats)
+	for (uint32 formati = 0; formati < formatCount; formati++)
 	{
+		const VkSurfaceFormatKHR& format = availableFormats[formati];
 		if (format.format == VK_FORMAT_B8G8R8A8_SRGB && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
 		{
 			return format;
@@ -1054,10 +3836,11 @@ static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFor
 	return availableFormats[0];
 }
 
-static VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+static VkPresentModeKHR chooseSwapPresentMode(const VkPresentModeKHR* availablePresentModes, uint32 presentModeCount)
 {
-	for (const auto& presentMode : availablePresentModes)
+	for (uint32 modei = 0; modei < presentModeCount; modei++)
 	{
+		const VkPresentModeKHR& presentMode = availablePresentModes[modei];
 		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
 		{
 			return presentMode;
@@ -1087,17 +3870,27 @@ static VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
 	return actualSize;
 }
 
-static std::vector<const char*> getRequiredExtensions()
+// NOTE: The result lives in the calling thread's scratch arena
+static const char** getRequiredExtensions(uint32* extensionCount)
 {
 	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	const char** glfwExtensions = nullptr;
+	if (!appConfig.headless)
+	{
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	}
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	// Room for the debug utils extension and one optional extension createInstance may add
+	const char** extensions = vkb_arena_allocateArray<const char*>(vkb_scratch_get(), glfwExtensionCount + 2);
+	for (uint32 i = 0; i < glfwExtensionCount; i++)
+	{
+		extensions[i] = glfwExtensions[i];
+	}
+	*extensionCount = glfwExtensionCount;
 
 	if (enableValidationLayers)
 	{
-		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		extensions[(*extensionCount)++] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
 	}
 
 	return extensions;
@@ -1109,7 +3902,7 @@ static void setupDebugMessenger()
 
 	VkDebugUtilsMessengerCreateInfoEXT createInfo;
 	initDebugMessengerCreateInfo(createInfo);
-	if (CreateDebugUtilsMessengerEXT(vkInstance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS)
+	if (CreateDebugUtilsMessengerEXT(vkInstance, &createInfo, vkAllocator, &debugMessenger) != VK_SUCCESS)
 	{
 		g_logger_assert(false, "failed to set up debug messenger!");
 	}
@@ -1152,17 +3945,20 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
 	void* pUserData)
 {
+	vkb_LogSeverity severity = vkb_LogSeverity::Verbose;
 	if (messageSeverity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
 	{
-		g_logger_error("Validation Layer: \n\t%s", pCallbackData->pMessage);
+		severity = vkb_LogSeverity::Error;
 	}
 	else if (messageSeverity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
 	{
-		g_logger_warning("Validation Layer: \n\t%s", pCallbackData->pMessage);
+		severity = vkb_LogSeverity::Warning;
 	}
 	else if (messageSeverity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
 	{
-		g_logger_log("Validation Layer: \n\t%s", pCallbackData->pMessage);
+		severity = vkb_LogSeverity::Info;
 	}
+
+	vkb_logSink_push(severity, pCallbackData->messageIdNumber, pCallbackData->pMessageIdName, pCallbackData->pMessage);
 	return VK_FALSE;
 }
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "VulkanBegins/Arena.h"
+
+struct vkb_ArenaOverflowBlock
+{
+	vkb_ArenaOverflowBlock* next;
+	size_t size;
+};
+
+// ------------ Internal Variables ------------
+static constexpr size_t defaultScratchSize = 1024 * 1024;
+static constexpr uint32 maxFramesInFlight = 8;
+
+static vkb_Arena frameArenas[maxFramesInFlight];
+static uint32 numFrameArenas = 0;
+static uint32 currentFrameSlot = 0;
+static vkb_FrameArenaStats lastFrameStats = {};
+
+static thread_local vkb_Arena scratchArena = {};
+// Totals over the thread's lifetime, the arena's own counts restart when it grows
+static thread_local uint32 scratchAllocations = 0;
+static thread_local uint32 scratchHeapAllocations = 0;
+// The totals when this thread last began a frame
+static thread_local uint32 frameStartScratchAllocations = 0;
+static thread_local uint32 frameStartScratchHeapAllocations = 0;
+
+// ------------ Internal Functions ------------
+static inline size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + (alignment - 1)) & ~(alignment - 1);
+}
+
+static void freeOverflowBlocks(vkb_Arena& arena, vkb_ArenaOverflowBlock* until)
+{
+	while (arena.overflowBlocks != until)
+	{
+		vkb_ArenaOverflowBlock* next = arena.overflowBlocks->next;
+		arena.overflowBytes -= arena.overflowBlocks->size;
+		g_memory_free(arena.overflowBlocks);
+		arena.overflowBlocks = next;
+	}
+}
+
+vkb_Arena vkb_arena_create(size_t size)
+{
+	vkb_Arena arena = {};
+	arena.memory = (uint8*)g_memory_allocate(size);
+	g_logger_assert(arena.memory != nullptr, "Out of RAM.");
+	arena.size = size;
+	return arena;
+}
+
+void* vkb_arena_allocate(vkb_Arena& arena, size_t numBytes, size_t alignment)
+{
+	arena.numAllocations++;
+
+	size_t alignedOffset = alignUp((size_t)(arena.memory + arena.offset), alignment) - (size_t)arena.memory;
+	if (arena.memory != nullptr && alignedOffset + numBytes <= arena.size)
+	{
+		arena.offset = alignedOffset + numBytes;
+		size_t used = arena.offset + arena.overflowBytes;
+		arena.highWaterMark = used > arena.highWaterMark ? used : arena.highWaterMark;
+		return arena.memory + alignedOffset;
+	}
+
+	// Didn't fit, fall back to the heap until the next reset grows the arena
+	size_t blockSize = sizeof(vkb_ArenaOverflowBlock) + alignment + numBytes;
+	vkb_ArenaOverflowBlock* block = (vkb_ArenaOverflowBlock*)g_memory_allocate(blockSize);
+	g_logger_assert(block != nullptr, "Out of RAM.");
+	block->next = arena.overflowBlocks;
+	block->size = blockSize;
+	arena.overflowBlocks = block;
+	arena.overflowBytes += blockSize;
+	arena.numHeapAllocations++;
+
+	size_t used = arena.offset + arena.overflowBytes;
+	arena.highWaterMark = used > arena.highWaterMark ? used : arena.highWaterMark;
+
+	return (void*)alignUp((size_t)(block + 1), alignment);
+}
+
+vkb_ArenaMarker vkb_arena_mark(const vkb_Arena& arena)
+{
+	return vkb_ArenaMarker{ arena.offset, arena.overflowBlocks, arena.overflowBytes };
+}
+
+void vkb_arena_popTo(vkb_Arena& arena, const vkb_ArenaMarker& marker)
+{
+	g_logger_assert(marker.offset <= arena.offset, "Arena popped past a marker that is no longer valid.");
+	freeOverflowBlocks(arena, marker.overflowBlocks);
+	arena.offset = marker.offset;
+}
+
+void vkb_arena_reset(vkb_Arena& arena)
+{
+	freeOverflowBlocks(arena, nullptr);
+
+	// If we overflowed since the last reset, grow so the same workload fits next time
+	if (arena.highWaterMark > arena.size)
+	{
+		size_t newSize = arena.size > 0 ? arena.size : 1024;
+		while (newSize < arena.highWaterMark)
+		{
+			newSize *= 2;
+		}
+
+		g_memory_free(arena.memory);
+		arena.memory = (uint8*)g_memory_allocate(newSize);
+		g_logger_assert(arena.memory != nullptr, "Out of RAM.");
+		arena.size = newSize;
+	}
+
+	arena.offset = 0;
+	arena.numAllocations = 0;
+	arena.numHeapAllocations = 0;
+	arena.highWaterMark = 0;
+}
+
+void vkb_arena_free(vkb_Arena& arena)
+{
+	freeOverflowBlocks(arena, nullptr);
+	if (arena.memory != nullptr)
+	{
+		g_memory_free(arena.memory);
+	}
+
+	arena = {};
+}
+
+// ------------ Per-frame arenas ------------
+void vkb_frameArena_init(size_t sizePerFrame, uint32 framesInFlight)
+{
+	g_logger_assert(framesInFlight > 0 && framesInFlight <= maxFramesInFlight, "Invalid number of frames in flight: %d", framesInFlight);
+
+	numFrameArenas = framesInFlight;
+	for (uint32 i = 0; i < numFrameArenas; i++)
+	{
+		frameArenas[i] = vkb_arena_create(sizePerFrame);
+	}
+
+	currentFrameSlot = 0;
+	lastFrameStats = {};
+}
+
+void vkb_frameArena_beginFrame(uint32 frameSlot)
+{
+	g_logger_assert(frameSlot < numFrameArenas, "Invalid frame slot: %d", frameSlot);
+
+	// The frame that last used this slot has retired, record its stats and recycle it
+	vkb_Arena& arena = frameArenas[frameSlot];
+	uint32 totalScratchAllocations = scratchAllocations + scratchArena.numAllocations;
+	uint32 totalScratchHeapAllocations = scratchHeapAllocations + scratchArena.numHeapAllocations;
+	lastFrameStats.numAllocations = arena.numAllocations + (totalScratchAllocations - frameStartScratchAllocations);
+	lastFrameStats.numHeapAllocations = arena.numHeapAllocations + (totalScratchHeapAllocations - frameStartScratchHeapAllocations);
+	lastFrameStats.bytesUsed = arena.highWaterMark;
+	frameStartScratchAllocations = totalScratchAllocations;
+	frameStartScratchHeapAllocations = totalScratchHeapAllocations;
+
+	vkb_arena_reset(arena);
+	currentFrameSlot = frameSlot;
+}
+
+vkb_Arena& vkb_frameArena_get()
+{
+	return frameArenas[currentFrameSlot];
+}
+
+vkb_FrameArenaStats vkb_frameArena_getLastFrameStats()
+{
+	return lastFrameStats;
+}
+
+void vkb_frameArena_free()
+{
+	for (uint32 i = 0; i < numFrameArenas; i++)
+	{
+		vkb_arena_free(frameArenas[i]);
+	}
+
+	numFrameArenas = 0;
+}
+
+// ------------ Thread-local scratch ------------
+vkb_Arena& vkb_scratch_get()
+{
+	if (scratchArena.memory == nullptr)
+	{
+		scratchArena = vkb_arena_create(defaultScratchSize);
+	}
+
+	return scratchArena;
+}
+
+vkb_ArenaMarker vkb_scratch_begin()
+{
+	return vkb_arena_mark(vkb_scratch_get());
+}
+
+void vkb_scratch_end(const vkb_ArenaMarker& marker)
+{
+	vkb_arena_popTo(scratchArena, marker);
+
+	// Outermost scope closed, this is the only point the scratch arena can grow
+	if (scratchArena.offset == 0 && scratchArena.highWaterMark > scratchArena.size)
+	{
+		scratchAllocations += scratchArena.numAllocations;
+		scratchHeapAllocations += scratchArena.numHeapAllocations;
+		vkb_arena_reset(scratchArena);
+	}
+}
+
+void vkb_scratch_free()
+{
+	scratchAllocations += scratchArena.numAllocations;
+	scratchHeapAllocations += scratchArena.numHeapAllocations;
+	vkb_arena_free(scratchArena);
+}
@@ -0,0 +1,157 @@
+#include "VulkanBegins/AtlasPacker.h"
+
+#include <string.h>
+
+// ------------ Internal Functions ------------
+// Returns the y a rectangle starting at node index's x would rest at, or
+// UINT32_MAX if it runs off the right or top of the atlas
+static uint32 fitAt(const vkb_AtlasPacker& packer, uint32 index, uint32 width, uint32 height)
+{
+	uint32 x = packer.nodes[index].x;
+	if (x + width > packer.width)
+	{
+		return UINT32_MAX;
+	}
+
+	uint32 y = 0;
+	uint32 remaining = width;
+	for (uint32 i = index; remaining > 0; i++)
+	{
+		const vkb_SkylineNode& node = packer.nodes[i];
+		y = node.y > y ? node.y : y;
+		if (y + height > packer.height)
+		{
+			return UINT32_MAX;
+		}
+		remaining = node.width < remaining ? remaining - node.width : 0;
+	}
+	return y;
+}
+
+static void insertNode(vkb_AtlasPacker& packer, uint32 index, const vkb_SkylineNode& node)
+{
+	if (packer.numNodes == packer.nodeCapacity)
+	{
+		packer.nodeCapacity *= 2;
+		packer.nodes = (vkb_SkylineNode*)g_memory_realloc(packer.nodes, sizeof(vkb_SkylineNode) * packer.nodeCapacity);
+	}
+
+	memmove(packer.nodes + index + 1, packer.nodes + index, sizeof(vkb_SkylineNode) * (packer.numNodes - index));
+	packer.nodes[index] = node;
+	packer.numNodes++;
+}
+
+static void removeNode(vkb_AtlasPacker& packer, uint32 index)
+{
+	memmove(packer.nodes + index, packer.nodes + index + 1, sizeof(vkb_SkylineNode) * (packer.numNodes - index - 1));
+	packer.numNodes--;
+}
+
+// ------------ Public Functions ------------
+vkb_AtlasPacker vkb_atlasPacker_create(uint32 width, uint32 height)
+{
+	vkb_AtlasPacker packer = {};
+	packer.width = width;
+	packer.height = height;
+	packer.nodeCapacity = 16;
+	packer.nodes = (vkb_SkylineNode*)g_memory_allocate(sizeof(vkb_SkylineNode) * packer.nodeCapacity);
+	vkb_atlasPacker_reset(packer);
+	return packer;
+}
+
+bool vkb_atlasPacker_pack(vkb_AtlasPacker& packer, uint32 width, uint32 height, uint32* x, uint32* y)
+{
+	if (width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	// Lowest top edge wins, then the narrowest segment so wide ones stay open for wide rectangles
+	uint32 bestIndex = UINT32_MAX;
+	uint32 bestTop = UINT32_MAX;
+	uint32 bestWidth = UINT32_MAX;
+	uint32 bestY = 0;
+	for (uint32 i = 0; i < packer.numNodes; i++)
+	{
+		uint32 fitY = fitAt(packer, i, width, height);
+		if (fitY == UINT32_MAX)
+		{
+			continue;
+		}
+
+		uint32 top = fitY + height;
+		if (top < bestTop || (top == bestTop && packer.nodes[i].width < bestWidth))
+		{
+			bestIndex = i;
+			bestTop = top;
+			bestWidth = packer.nodes[i].width;
+			bestY = fitY;
+		}
+	}
+
+	if (bestIndex == UINT32_MAX)
+	{
+		return false;
+	}
+
+	*x = packer.nodes[bestIndex].x;
+	*y = bestY;
+
+	vkb_SkylineNode placed = { *x, bestTop, width };
+	insertNode(packer, bestIndex, placed);
+
+	// Cut the segments the new one now covers
+	uint32 placedEnd = placed.x + placed.width;
+	for (uint32 i = bestIndex + 1; i < packer.numNodes;)
+	{
+		vkb_SkylineNode& node = packer.nodes[i];
+		if (node.x >= placedEnd)
+		{
+			break;
+		}
+
+		uint32 nodeEnd = node.x + node.width;
+		if (nodeEnd <= placedEnd)
+		{
+			removeNode(packer, i);
+			continue;
+		}
+
+		node.width = nodeEnd - placedEnd;
+		node.x = placedEnd;
+		break;
+	}
+
+	// Neighbours at the same height are one segment
+	for (uint32 i = 0; i + 1 < packer.numNodes;)
+	{
+		if (packer.nodes[i].y == packer.nodes[i + 1].y)
+		{
+			packer.nodes[i].width += packer.nodes[i + 1].width;
+			removeNode(packer, i + 1);
+			continue;
+		}
+		i++;
+	}
+
+	packer.usedArea += (uint64)width * height;
+	return true;
+}
+
+float vkb_atlasPacker_getOccupancy(const vkb_AtlasPacker& packer)
+{
+	return (float)((double)packer.usedArea / ((double)packer.width * (double)packer.height));
+}
+
+void vkb_atlasPacker_reset(vkb_AtlasPacker& packer)
+{
+	packer.nodes[0] = { 0, 0, packer.width };
+	packer.numNodes = 1;
+	packer.usedArea = 0;
+}
+
+void vkb_atlasPacker_free(vkb_AtlasPacker& packer)
+{
+	g_memory_free(packer.nodes);
+	packer = {};
+}
@@ -0,0 +1,342 @@
+#include "VulkanBegins/Bindless.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/CommandStream.h"
+
+#include <new>
+
+// ------------ Internal structures ------------
+enum BindlessBinding : uint32
+{
+	BindingTextures = 0,
+	BindingBuffers,
+
+	BindingCount
+};
+
+struct RetiringSlot
+{
+	uint64 retireValue;
+	vkb_BindlessIndex index;
+	BindlessBinding binding;
+};
+
+// Slots not in use, popped from the back so the lowest ones go first
+struct SlotFreeList
+{
+	vkb_BindlessIndex* slots;
+	uint32 numFree;
+	uint32 capacity;
+};
+
+struct vkb_BindlessHeap
+{
+	VkDevice device;
+	const VkAllocationCallbacks* allocator;
+
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet set;
+
+	SlotFreeList freeSlots[BindingCount];
+
+	RetiringSlot* retiring;
+	uint32 numRetiring;
+	uint32 retiringCapacity;
+};
+
+// ------------ Internal Functions ------------
+static SlotFreeList createFreeList(uint32 capacity)
+{
+	SlotFreeList list = {};
+	list.slots = (vkb_BindlessIndex*)g_memory_allocate(sizeof(vkb_BindlessIndex) * capacity);
+	list.capacity = capacity;
+	list.numFree = capacity;
+	for (uint32 i = 0; i < capacity; i++)
+	{
+		list.slots[i] = capacity - 1 - i;
+	}
+	return list;
+}
+
+static vkb_BindlessIndex popFreeSlot(SlotFreeList& list)
+{
+	if (list.numFree == 0)
+	{
+		return vkb_invalidBindlessIndex;
+	}
+	return list.slots[--list.numFree];
+}
+
+static void release(vkb_BindlessHeap* heap, BindlessBinding binding, vkb_BindlessIndex index, uint64 retireValue)
+{
+	g_logger_assert(index < heap->freeSlots[binding].capacity, "Released an invalid bindless index %d.", index);
+
+	if (heap->numRetiring == heap->retiringCapacity)
+	{
+		heap->retiringCapacity = heap->retiringCapacity > 0 ? heap->retiringCapacity * 2 : 64;
+		heap->retiring = (RetiringSlot*)g_memory_realloc(heap->retiring, sizeof(RetiringSlot) * heap->retiringCapacity);
+	}
+	heap->retiring[heap->numRetiring++] = { retireValue, index, binding };
+}
+
+// Falls back to the requested counts if the limits can't be queried
+static void clampToDeviceLimits(const vkb_Context& ctx, uint32& maxTextures, uint32& maxBuffers)
+{
+	auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(ctx.instance, "vkGetPhysicalDeviceProperties2KHR");
+	if (getProperties2 == nullptr)
+	{
+		return;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2KHR properties2 = {};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &indexingProperties;
+	getProperties2(ctx.physicalDevice, &properties2);
+
+	// Combined image samplers count as both a sampled image and a sampler
+	uint32 textureLimits[] = {
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers
+	};
+	uint32 textureLimit = UINT32_MAX;
+	for (uint32 limit : textureLimits)
+	{
+		textureLimit = limit < textureLimit ? limit : textureLimit;
+	}
+	uint32 bufferLimit = indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers;
+	if (indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers < bufferLimit)
+	{
+		bufferLimit = indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers;
+	}
+
+	if (maxTextures > textureLimit || maxBuffers > bufferLimit)
+	{
+		g_logger_warning("The bindless heap was clamped to the device's %d textures and %d buffers.", textureLimit, bufferLimit);
+	}
+	maxTextures = maxTextures < textureLimit ? maxTextures : textureLimit;
+	maxBuffers = maxBuffers < bufferLimit ? maxBuffers : bufferLimit;
+}
+
+// ------------ Public Functions ------------
+vkb_BindlessHeap* vkb_bindlessHeap_create(const vkb_Context& ctx, const vkb_BindlessHeapDesc& desc)
+{
+	g_logger_assert(ctx.descriptorIndexingEnabled, "The bindless heap needs descriptor indexing.");
+
+	uint32 maxTextures = desc.maxTextures;
+	uint32 maxBuffers = desc.maxBuffers;
+	clampToDeviceLimits(ctx, maxTextures, maxBuffers);
+	g_logger_assert(maxTextures > 0 && maxBuffers > 0, "A bindless heap needs room for at least one texture and one buffer.");
+
+	vkb_BindlessHeap* heap = (vkb_BindlessHeap*)g_memory_allocate(sizeof(vkb_BindlessHeap));
+	new(heap)vkb_BindlessHeap();
+	heap->device = ctx.device;
+	heap->allocator = ctx.allocator;
+	heap->freeSlots[BindingTextures] = createFreeList(maxTextures);
+	heap->freeSlots[BindingBuffers] = createFreeList(maxBuffers);
+
+	VkDescriptorSetLayoutBinding bindings[BindingCount] = {};
+	bindings[BindingTextures].binding = BindingTextures;
+	bindings[BindingTextures].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[BindingTextures].descriptorCount = maxTextures;
+	bindings[BindingTextures].stageFlags = desc.stages;
+	bindings[BindingBuffers].binding = BindingBuffers;
+	bindings[BindingBuffers].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[BindingBuffers].descriptorCount = maxBuffers;
+	bindings[BindingBuffers].stageFlags = desc.stages;
+
+	VkDescriptorBindingFlagsEXT bindingFlags[BindingCount];
+	for (uint32 i = 0; i < BindingCount; i++)
+	{
+		bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsInfo.bindingCount = BindingCount;
+	bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.pNext = &bindingFlagsInfo;
+	setLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	setLayoutCreateInfo.bindingCount = BindingCount;
+	setLayoutCreateInfo.pBindings = bindings;
+
+	uint32 res = vkCreateDescriptorSetLayout(heap->device, &setLayoutCreateInfo, heap->allocator, &heap->setLayout);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create the bindless descriptor set layout.");
+
+	VkDescriptorPoolSize poolSizes[BindingCount] = {};
+	poolSizes[BindingTextures].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[BindingTextures].descriptorCount = maxTextures;
+	poolSizes[BindingBuffers].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[BindingBuffers].descriptorCount = maxBuffers;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = BindingCount;
+	poolCreateInfo.pPoolSizes = poolSizes;
+
+	res = vkCreateDescriptorPool(heap->device, &poolCreateInfo, heap->allocator, &heap->descriptorPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create the bindless descriptor pool.");
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = heap->descriptorPool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &heap->setLayout;
+
+	res = vkAllocateDescriptorSets(heap->device, &setAllocInfo, &heap->set);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate the bindless descriptor set.");
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, heap->set, vkb_captureKey(vkb_CaptureOwner::Bindless, 0));
+
+	return heap;
+}
+
+VkDescriptorSetLayout vkb_bindlessHeap_getSetLayout(const vkb_BindlessHeap* heap)
+{
+	return heap->setLayout;
+}
+
+vkb_BindlessIndex vkb_bindlessHeap_addTexture(vkb_BindlessHeap* heap, VkImageView imageView, VkSampler sampler)
+{
+	vkb_BindlessIndex index = popFreeSlot(heap->freeSlots[BindingTextures]);
+	if (index == vkb_invalidBindlessIndex)
+	{
+		g_logger_warning("Every bindless texture slot is taken.");
+		return vkb_invalidBindlessIndex;
+	}
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = heap->set;
+	write.dstBinding = BindingTextures;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(heap->device, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+vkb_BindlessIndex vkb_bindlessHeap_addBuffer(vkb_BindlessHeap* heap, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	vkb_BindlessIndex index = popFreeSlot(heap->freeSlots[BindingBuffers]);
+	if (index == vkb_invalidBindlessIndex)
+	{
+		g_logger_warning("Every bindless buffer slot is taken.");
+		return vkb_invalidBindlessIndex;
+	}
+
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = heap->set;
+	write.dstBinding = BindingBuffers;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(heap->device, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+void vkb_bindlessHeap_releaseTexture(vkb_BindlessHeap* heap, vkb_BindlessIndex index, uint64 retireValue)
+{
+	release(heap, BindingTextures, index, retireValue);
+}
+
+void vkb_bindlessHeap_releaseBuffer(vkb_BindlessHeap* heap, vkb_BindlessIndex index, uint64 retireValue)
+{
+	release(heap, BindingBuffers, index, retireValue);
+}
+
+void vkb_bindlessHeap_collect(vkb_BindlessHeap* heap, uint64 completedValue)
+{
+	uint32 numKept = 0;
+	for (uint32 i = 0; i < heap->numRetiring; i++)
+	{
+		const RetiringSlot& slot = heap->retiring[i];
+		if (slot.retireValue <= completedValue)
+		{
+			// The descriptor is left as is, partially bound arrays don't care and the next add overwrites it
+			SlotFreeList& list = heap->freeSlots[slot.binding];
+			list.slots[list.numFree++] = slot.index;
+		}
+		else
+		{
+			heap->retiring[numKept++] = slot;
+		}
+	}
+	heap->numRetiring = numKept;
+}
+
+void vkb_bindlessHeap_bind(const vkb_BindlessHeap* heap, VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32 set)
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, set, 1, &heap->set, 0, nullptr);
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_bindDescriptorSet(bindPoint, layout, set, heap->set);
+	}
+}
+
+vkb_BindlessStats vkb_bindlessHeap_getStats(const vkb_BindlessHeap* heap)
+{
+	const SlotFreeList& textures = heap->freeSlots[BindingTextures];
+	const SlotFreeList& buffers = heap->freeSlots[BindingBuffers];
+
+	vkb_BindlessStats stats = {};
+	stats.maxTextures = textures.capacity;
+	stats.maxBuffers = buffers.capacity;
+	stats.numRetiring = heap->numRetiring;
+	stats.numTextures = textures.capacity - textures.numFree;
+	stats.numBuffers = buffers.capacity - buffers.numFree;
+	for (uint32 i = 0; i < heap->numRetiring; i++)
+	{
+		if (heap->retiring[i].binding == BindingTextures)
+		{
+			stats.numTextures--;
+		}
+		else
+		{
+			stats.numBuffers--;
+		}
+	}
+	return stats;
+}
+
+void vkb_bindlessHeap_free(const vkb_Context& ctx, vkb_BindlessHeap* heap)
+{
+	vkDestroyDescriptorPool(ctx.device, heap->descriptorPool, ctx.allocator);
+	vkDestroyDescriptorSetLayout(ctx.device, heap->setLayout, ctx.allocator);
+
+	for (uint32 i = 0; i < BindingCount; i++)
+	{
+		g_memory_free(heap->freeSlots[i].slots);
+	}
+	if (heap->retiring != nullptr)
+	{
+		g_memory_free(heap->retiring);
+	}
+
+	heap->~vkb_BindlessHeap();
+	g_memory_free(heap);
+}
@@ -0,0 +1,238 @@
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/DeviceCaps.h"
+#include "VulkanBegins/DeletionQueue.h"
+
+// ------------ Internal Variables ------------
+static vkb_Buffer stagingBuffer = {};
+static VkDeviceSize stagingOffset = 0;
+static VkCommandPool stagingCommandPool = VK_NULL_HANDLE;
+static VkCommandBuffer stagingCommandBuffer = VK_NULL_HANDLE;
+static VkFence stagingFence = VK_NULL_HANDLE;
+static bool stagingRecording = false;
+
+// ------------ Internal Functions ------------
+static void beginStagingCommands()
+{
+	if (stagingRecording)
+	{
+		return;
+	}
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	uint32 res = vkBeginCommandBuffer(stagingCommandBuffer, &beginInfo);
+	g_logger_assert(res == VK_SUCCESS, "Failed to begin staging command buffer.");
+	stagingRecording = true;
+}
+
+static vkb_Buffer createBuffer(const vkb_Context& ctx, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties, bool resident)
+{
+	vkb_Buffer result = {};
+	result.size = size;
+
+	VkBufferCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	createInfo.size = size;
+	createInfo.usage = usage;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	uint32 res = vkCreateBuffer(ctx.device, &createInfo, ctx.allocator, &result.buffer);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create buffer.");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(ctx.device, result.buffer, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = vkb_deviceCaps_findMemoryType(*ctx.caps, memoryRequirements.memoryTypeBits, memoryProperties);
+	g_logger_assert(allocInfo.memoryTypeIndex != UINT32_MAX, "No memory type for buffer of %llu bytes.", (unsigned long long)size);
+
+	if (resident)
+	{
+		res = vkb_residency_allocateMemory(ctx, allocInfo, vkb_StreamingPriority::Critical, &result.memory);
+
+		vkb_ResidentResourceDesc desc = {};
+		desc.priority = vkb_StreamingPriority::Critical;
+		desc.memoryTypeIndex = allocInfo.memoryTypeIndex;
+		desc.numMips = 1;
+		desc.fullSize = allocInfo.allocationSize;
+		result.residentResource = vkb_residency_register(desc);
+		result.resident = true;
+	}
+	else
+	{
+		res = vkAllocateMemory(ctx.device, &allocInfo, ctx.allocator, &result.memory);
+	}
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate buffer memory.");
+	vkBindBufferMemory(ctx.device, result.buffer, result.memory, 0);
+	result.memoryTypeIndex = allocInfo.memoryTypeIndex;
+	result.allocationSize = allocInfo.allocationSize;
+
+	if (memoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		vkMapMemory(ctx.device, result.memory, 0, size, 0, &result.mapped);
+	}
+
+	return result;
+}
+
+// ------------ Public Functions ------------
+vkb_Buffer vkb_buffer_create(const vkb_Context& ctx, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties)
+{
+	return createBuffer(ctx, size, usage, memoryProperties, false);
+}
+
+vkb_Buffer vkb_buffer_createResident(const vkb_Context& ctx, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties)
+{
+	return createBuffer(ctx, size, usage, memoryProperties, true);
+}
+
+void vkb_buffer_free(const vkb_Context& ctx, vkb_Buffer& buffer)
+{
+	if (buffer.mapped != nullptr)
+	{
+		vkUnmapMemory(ctx.device, buffer.memory);
+	}
+
+	vkDestroyBuffer(ctx.device, buffer.buffer, ctx.allocator);
+	if (buffer.resident)
+	{
+		// Goes through the deletion queue, but nothing can be using it anymore
+		vkb_residency_unregister(buffer.residentResource);
+		vkb_residency_freeMemory(buffer.memory, buffer.allocationSize, buffer.memoryTypeIndex, 0);
+	}
+	else
+	{
+		vkFreeMemory(ctx.device, buffer.memory, ctx.allocator);
+	}
+	buffer = {};
+}
+
+void vkb_buffer_freeDeferred(vkb_Buffer& buffer, uint64 retireValue)
+{
+	// Freeing the memory unmaps it, no need to unmap here
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_BUFFER, buffer.buffer, retireValue);
+	if (buffer.resident)
+	{
+		vkb_residency_unregister(buffer.residentResource);
+		vkb_residency_freeMemory(buffer.memory, buffer.allocationSize, buffer.memoryTypeIndex, retireValue);
+	}
+	else
+	{
+		vkb_deletionQueue_push(VK_OBJECT_TYPE_DEVICE_MEMORY, buffer.memory, retireValue);
+	}
+	buffer = {};
+}
+
+void vkb_staging_init(const vkb_Context& ctx, VkDeviceSize capacity)
+{
+	stagingBuffer = vkb_buffer_create(ctx, capacity,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	stagingOffset = 0;
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = ctx.graphicsFamily;
+	uint32 res = vkCreateCommandPool(ctx.device, &poolInfo, ctx.allocator, &stagingCommandPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create staging command pool.");
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = stagingCommandPool;
+	allocInfo.commandBufferCount = 1;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	res = vkAllocateCommandBuffers(ctx.device, &allocInfo, &stagingCommandBuffer);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate staging command buffer.");
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	res = vkCreateFence(ctx.device, &fenceInfo, ctx.allocator, &stagingFence);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create staging fence.");
+
+	stagingRecording = false;
+}
+
+void vkb_staging_upload(const vkb_Context& ctx, vkb_Buffer& dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	g_logger_assert(dstOffset + size <= dst.size, "Staging upload out of bounds of the destination buffer.");
+
+	const uint8* src = (const uint8*)data;
+	while (size > 0)
+	{
+		if (stagingOffset == stagingBuffer.size)
+		{
+			vkb_staging_flush(ctx);
+		}
+
+		// Uploads bigger than the staging buffer are split across flushes
+		VkDeviceSize chunkSize = stagingBuffer.size - stagingOffset;
+		if (chunkSize > size)
+		{
+			chunkSize = size;
+		}
+
+		memcpy((uint8*)stagingBuffer.mapped + stagingOffset, src, chunkSize);
+
+		beginStagingCommands();
+		VkBufferCopy region = {};
+		region.srcOffset = stagingOffset;
+		region.dstOffset = dstOffset;
+		region.size = chunkSize;
+		vkCmdCopyBuffer(stagingCommandBuffer, stagingBuffer.buffer, dst.buffer, 1, &region);
+
+		// Keep every copy 16 byte aligned in the staging buffer
+		stagingOffset = (stagingOffset + chunkSize + 15) & ~(VkDeviceSize)15;
+		if (stagingOffset > stagingBuffer.size)
+		{
+			stagingOffset = stagingBuffer.size;
+		}
+
+		src += chunkSize;
+		dstOffset += chunkSize;
+		size -= chunkSize;
+	}
+}
+
+void vkb_staging_flush(const vkb_Context& ctx)
+{
+	if (!stagingRecording)
+	{
+		return;
+	}
+
+	uint32 res = vkEndCommandBuffer(stagingCommandBuffer);
+	g_logger_assert(res == VK_SUCCESS, "Failed to end staging command buffer.");
+	stagingRecording = false;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &stagingCommandBuffer;
+
+	res = vkQueueSubmit(ctx.graphicsQueue, 1, &submitInfo, stagingFence);
+	g_logger_assert(res == VK_SUCCESS, "Failed to submit staging copies.");
+
+	vkWaitForFences(ctx.device, 1, &stagingFence, VK_TRUE, UINT64_MAX);
+	vkResetFences(ctx.device, 1, &stagingFence);
+	vkResetCommandBuffer(stagingCommandBuffer, 0);
+	stagingOffset = 0;
+}
+
+void vkb_staging_free(const vkb_Context& ctx)
+{
+	vkb_staging_flush(ctx);
+
+	vkDestroyFence(ctx.device, stagingFence, ctx.allocator);
+	vkDestroyCommandPool(ctx.device, stagingCommandPool, ctx.allocator);
+	vkb_buffer_free(ctx, stagingBuffer);
+
+	stagingFence = VK_NULL_HANDLE;
+	stagingCommandPool = VK_NULL_HANDLE;
+	stagingCommandBuffer = VK_NULL_HANDLE;
+}
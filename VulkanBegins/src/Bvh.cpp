@@ -0,0 +1,723 @@
+#include "VulkanBegins/Bvh.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define VKB_BVH_X86 1
+#include <immintrin.h>
+#else
+#define VKB_BVH_X86 0
+#endif
+
+#if VKB_BVH_X86 && !defined(_MSC_VER)
+#define VKB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define VKB_TARGET_AVX2
+#endif
+
+// ------------ Internal structures ------------
+struct BuildRange
+{
+	uint32 first;
+	uint32 count;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 maxTraversalDepth = 256;
+static constexpr uint32 noParent = 0xFFFFFFFF;
+
+// ------------ Internal Functions ------------
+static void resetChildBounds(vkb_BvhNode& node, uint32 childIndex)
+{
+	// Inverted so empty slots fail every overlap test without a mask
+	node.minX[childIndex] = FLT_MAX;
+	node.minY[childIndex] = FLT_MAX;
+	node.minZ[childIndex] = FLT_MAX;
+	node.maxX[childIndex] = -FLT_MAX;
+	node.maxY[childIndex] = -FLT_MAX;
+	node.maxZ[childIndex] = -FLT_MAX;
+}
+
+static void growChildBounds(vkb_BvhNode& node, uint32 childIndex, float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+{
+	node.minX[childIndex] = fminf(node.minX[childIndex], minX);
+	node.minY[childIndex] = fminf(node.minY[childIndex], minY);
+	node.minZ[childIndex] = fminf(node.minZ[childIndex], minZ);
+	node.maxX[childIndex] = fmaxf(node.maxX[childIndex], maxX);
+	node.maxY[childIndex] = fmaxf(node.maxY[childIndex], maxY);
+	node.maxZ[childIndex] = fmaxf(node.maxZ[childIndex], maxZ);
+}
+
+// Recomputes one child's box from its objects or its node's children
+static void fitChild(vkb_Bvh& bvh, uint32 nodeIndex, uint32 childIndex)
+{
+	vkb_BvhNode& node = bvh.nodes[nodeIndex];
+	resetChildBounds(node, childIndex);
+	if (node.leafCount[childIndex] > 0)
+	{
+		uint32 first = node.child[childIndex];
+		for (uint32 slot = first; slot < first + node.leafCount[childIndex]; slot++)
+		{
+			growChildBounds(node, childIndex, bvh.minX[slot], bvh.minY[slot], bvh.minZ[slot], bvh.maxX[slot], bvh.maxY[slot], bvh.maxZ[slot]);
+		}
+		return;
+	}
+
+	const vkb_BvhNode& child = bvh.nodes[node.child[childIndex]];
+	for (uint32 i = 0; i < child.numChildren; i++)
+	{
+		growChildBounds(node, childIndex, child.minX[i], child.minY[i], child.minZ[i], child.maxX[i], child.maxY[i], child.maxZ[i]);
+	}
+}
+
+// Median split on the axis the centroids spread furthest along
+static void splitRange(const vkb_Aabb* bounds, uint32* ids, BuildRange range, BuildRange* left, BuildRange* right)
+{
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+	for (uint32 i = range.first; i < range.first + range.count; i++)
+	{
+		const vkb_Aabb& box = bounds[ids[i]];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float centroid = box.min[axis] + box.max[axis];
+			centroidMin[axis] = fminf(centroidMin[axis], centroid);
+			centroidMax[axis] = fmaxf(centroidMax[axis], centroid);
+		}
+	}
+
+	glm::vec3 extent = centroidMax - centroidMin;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	uint32 half = range.count / 2;
+	std::nth_element(ids + range.first, ids + range.first + half, ids + range.first + range.count, [bounds, axis](uint32 a, uint32 b)
+		{
+			return bounds[a].min[axis] + bounds[a].max[axis] < bounds[b].min[axis] + bounds[b].max[axis];
+		});
+
+	*left = { range.first, half };
+	*right = { range.first + half, range.count - half };
+}
+
+static uint32 allocateNode(vkb_Bvh& bvh)
+{
+	if (bvh.numNodes == bvh.nodeCapacity)
+	{
+		bvh.nodeCapacity = bvh.nodeCapacity > 0 ? bvh.nodeCapacity * 2 : 64;
+		bvh.nodes = (vkb_BvhNode*)g_memory_realloc(bvh.nodes, sizeof(vkb_BvhNode) * bvh.nodeCapacity);
+	}
+
+	uint32 nodeIndex = bvh.numNodes++;
+	vkb_BvhNode& node = bvh.nodes[nodeIndex];
+	node = {};
+	for (uint32 i = 0; i < 4; i++)
+	{
+		resetChildBounds(node, i);
+	}
+	return nodeIndex;
+}
+
+// ids are object ids in slot order once the build is done
+static uint32 buildNode(vkb_Bvh& bvh, const vkb_Aabb* bounds, uint32* ids, BuildRange range, uint32 parent)
+{
+	uint32 nodeIndex = allocateNode(bvh);
+	bvh.nodes[nodeIndex].parent = parent;
+	bvh.nodes[nodeIndex].firstObject = range.first;
+	bvh.nodes[nodeIndex].numObjects = range.count;
+
+	// Two levels of binary splits make up to 4 children
+	BuildRange children[4];
+	uint32 numChildren = 0;
+	if (range.count <= vkb_bvhLeafSize)
+	{
+		children[numChildren++] = range;
+	}
+	else
+	{
+		BuildRange halves[2];
+		splitRange(bounds, ids, range, &halves[0], &halves[1]);
+		for (uint32 i = 0; i < 2; i++)
+		{
+			if (halves[i].count <= vkb_bvhLeafSize)
+			{
+				children[numChildren++] = halves[i];
+			}
+			else
+			{
+				splitRange(bounds, ids, halves[i], &children[numChildren], &children[numChildren + 1]);
+				numChildren += 2;
+			}
+		}
+	}
+
+	bvh.nodes[nodeIndex].numChildren = (uint8)numChildren;
+	for (uint32 i = 0; i < numChildren; i++)
+	{
+		if (children[i].count <= vkb_bvhLeafSize)
+		{
+			bvh.nodes[nodeIndex].child[i] = children[i].first;
+			bvh.nodes[nodeIndex].leafCount[i] = (uint8)children[i].count;
+			for (uint32 slot = children[i].first; slot < children[i].first + children[i].count; slot++)
+			{
+				bvh.slotLeaves[slot] = nodeIndex * 4 + i;
+			}
+		}
+		else
+		{
+			// bvh.nodes can move while the subtree is built
+			uint32 childIndex = buildNode(bvh, bounds, ids, children[i], nodeIndex);
+			bvh.nodes[nodeIndex].child[i] = childIndex;
+			bvh.nodes[nodeIndex].leafCount[i] = 0;
+		}
+	}
+
+	return nodeIndex;
+}
+
+static void emitSubtree(const vkb_Bvh& bvh, const vkb_BvhNode& node, uint32 childIndex, uint32* ids, uint32* count)
+{
+	uint32 first;
+	uint32 numObjects;
+	if (node.leafCount[childIndex] > 0)
+	{
+		first = node.child[childIndex];
+		numObjects = node.leafCount[childIndex];
+	}
+	else
+	{
+		const vkb_BvhNode& child = bvh.nodes[node.child[childIndex]];
+		first = child.firstObject;
+		numObjects = child.numObjects;
+	}
+
+	memcpy(ids + *count, bvh.slotObjects + first, sizeof(uint32) * numObjects);
+	*count += numObjects;
+}
+
+// Box vs frustum with the usual positive/negative vertex test. The positive
+// vertex is the corner furthest along the plane normal: if it's behind any
+// plane the box is outside, and if the negative vertex is in front of every
+// plane the box is fully inside.
+static void classifyChildrenScalar(const vkb_BvhNode& node, const vkb_Frustum& frustum, uint32* outsideMask, uint32* insideMask)
+{
+	*outsideMask = 0;
+	*insideMask = 0;
+	for (uint32 i = 0; i < node.numChildren; i++)
+	{
+		bool outside = false;
+		bool inside = true;
+		for (uint32 p = 0; p < 6 && !outside; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+			float positive = plane.w +
+				plane.x * (plane.x >= 0.0f ? node.maxX[i] : node.minX[i]) +
+				plane.y * (plane.y >= 0.0f ? node.maxY[i] : node.minY[i]) +
+				plane.z * (plane.z >= 0.0f ? node.maxZ[i] : node.minZ[i]);
+			float negative = plane.w +
+				plane.x * (plane.x >= 0.0f ? node.minX[i] : node.maxX[i]) +
+				plane.y * (plane.y >= 0.0f ? node.minY[i] : node.maxY[i]) +
+				plane.z * (plane.z >= 0.0f ? node.minZ[i] : node.maxZ[i]);
+			outside = positive < 0.0f;
+			inside = inside && negative >= 0.0f;
+		}
+
+		*outsideMask |= outside ? (1u << i) : 0;
+		*insideMask |= !outside && inside ? (1u << i) : 0;
+	}
+}
+
+static uint32 testObjectsScalar(const vkb_Bvh& bvh, const vkb_Frustum& frustum, uint32 first, uint32 count)
+{
+	uint32 visibleMask = 0;
+	for (uint32 i = 0; i < count; i++)
+	{
+		uint32 slot = first + i;
+		bool outside = false;
+		for (uint32 p = 0; p < 6 && !outside; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+			float positive = plane.w +
+				plane.x * (plane.x >= 0.0f ? bvh.maxX[slot] : bvh.minX[slot]) +
+				plane.y * (plane.y >= 0.0f ? bvh.maxY[slot] : bvh.minY[slot]) +
+				plane.z * (plane.z >= 0.0f ? bvh.maxZ[slot] : bvh.minZ[slot]);
+			outside = positive < 0.0f;
+		}
+		visibleMask |= outside ? 0 : (1u << i);
+	}
+	return visibleMask;
+}
+
+#if VKB_BVH_X86
+static void classifyChildrenSSE(const vkb_BvhNode& node, const vkb_Frustum& frustum, uint32* outsideMask, uint32* insideMask)
+{
+	__m128 minX = _mm_loadu_ps(node.minX);
+	__m128 minY = _mm_loadu_ps(node.minY);
+	__m128 minZ = _mm_loadu_ps(node.minZ);
+	__m128 maxX = _mm_loadu_ps(node.maxX);
+	__m128 maxY = _mm_loadu_ps(node.maxY);
+	__m128 maxZ = _mm_loadu_ps(node.maxZ);
+	__m128 zero = _mm_setzero_ps();
+
+	__m128 outside = zero;
+	__m128 partial = zero;
+	for (uint32 p = 0; p < 6; p++)
+	{
+		// The plane's signs pick the corners once for all 4 children
+		const glm::vec4& plane = frustum.planes[p];
+		__m128 nx = _mm_set1_ps(plane.x);
+		__m128 ny = _mm_set1_ps(plane.y);
+		__m128 nz = _mm_set1_ps(plane.z);
+		__m128 d = _mm_set1_ps(plane.w);
+
+		__m128 positive = _mm_add_ps(d, _mm_add_ps(
+			_mm_mul_ps(nx, plane.x >= 0.0f ? maxX : minX),
+			_mm_add_ps(_mm_mul_ps(ny, plane.y >= 0.0f ? maxY : minY), _mm_mul_ps(nz, plane.z >= 0.0f ? maxZ : minZ))));
+		__m128 negative = _mm_add_ps(d, _mm_add_ps(
+			_mm_mul_ps(nx, plane.x >= 0.0f ? minX : maxX),
+			_mm_add_ps(_mm_mul_ps(ny, plane.y >= 0.0f ? minY : maxY), _mm_mul_ps(nz, plane.z >= 0.0f ? minZ : maxZ))));
+
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(positive, zero));
+		partial = _mm_or_ps(partial, _mm_cmplt_ps(negative, zero));
+	}
+
+	uint32 childMask = (1u << node.numChildren) - 1;
+	*outsideMask = ((uint32)_mm_movemask_ps(outside) | ~childMask) & 0xF;
+	*insideMask = ~((uint32)_mm_movemask_ps(_mm_or_ps(outside, partial))) & childMask;
+}
+
+static uint32 testObjectsSSE(const vkb_Bvh& bvh, const vkb_Frustum& frustum, uint32 first, uint32 count)
+{
+	uint32 visibleMask = 0;
+	__m128 zero = _mm_setzero_ps();
+	for (uint32 group = 0; group < count; group += 4)
+	{
+		uint32 slot = first + group;
+		__m128 minX = _mm_loadu_ps(bvh.minX + slot);
+		__m128 minY = _mm_loadu_ps(bvh.minY + slot);
+		__m128 minZ = _mm_loadu_ps(bvh.minZ + slot);
+		__m128 maxX = _mm_loadu_ps(bvh.maxX + slot);
+		__m128 maxY = _mm_loadu_ps(bvh.maxY + slot);
+		__m128 maxZ = _mm_loadu_ps(bvh.maxZ + slot);
+
+		__m128 outside = zero;
+		for (uint32 p = 0; p < 6; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+			__m128 positive = _mm_add_ps(_mm_set1_ps(plane.w), _mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(plane.x), plane.x >= 0.0f ? maxX : minX),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.y), plane.y >= 0.0f ? maxY : minY), _mm_mul_ps(_mm_set1_ps(plane.z), plane.z >= 0.0f ? maxZ : minZ))));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(positive, zero));
+		}
+		visibleMask |= (~(uint32)_mm_movemask_ps(outside) & 0xF) << group;
+	}
+
+	// Lanes past the leaf belong to the next one
+	return visibleMask & ((1u << count) - 1);
+}
+
+VKB_TARGET_AVX2 static uint32 testObjectsAVX2(const vkb_Bvh& bvh, const vkb_Frustum& frustum, uint32 first, uint32 count)
+{
+	__m256 minX = _mm256_loadu_ps(bvh.minX + first);
+	__m256 minY = _mm256_loadu_ps(bvh.minY + first);
+	__m256 minZ = _mm256_loadu_ps(bvh.minZ + first);
+	__m256 maxX = _mm256_loadu_ps(bvh.maxX + first);
+	__m256 maxY = _mm256_loadu_ps(bvh.maxY + first);
+	__m256 maxZ = _mm256_loadu_ps(bvh.maxZ + first);
+	__m256 zero = _mm256_setzero_ps();
+
+	__m256 outside = zero;
+	for (uint32 p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+		__m256 positive = _mm256_add_ps(_mm256_set1_ps(plane.w), _mm256_add_ps(
+			_mm256_mul_ps(_mm256_set1_ps(plane.x), plane.x >= 0.0f ? maxX : minX),
+			_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.y), plane.y >= 0.0f ? maxY : minY), _mm256_mul_ps(_mm256_set1_ps(plane.z), plane.z >= 0.0f ? maxZ : minZ))));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(positive, zero, _CMP_LT_OQ));
+	}
+
+	return ~(uint32)_mm256_movemask_ps(outside) & ((1u << count) - 1);
+}
+#endif
+
+static vkb_TransformKernel resolveKernel(vkb_TransformKernel kernel)
+{
+	if (kernel == vkb_TransformKernel::Best)
+	{
+		if (vkb_transforms_isKernelSupported(vkb_TransformKernel::AVX2))
+		{
+			return vkb_TransformKernel::AVX2;
+		}
+
+		return vkb_transforms_isKernelSupported(vkb_TransformKernel::SSE) ? vkb_TransformKernel::SSE : vkb_TransformKernel::Scalar;
+	}
+
+	g_logger_assert(vkb_transforms_isKernelSupported(kernel), "Culling kernel %d isn't supported on this CPU.", (int)kernel);
+	return kernel;
+}
+
+template<vkb_TransformKernel Kernel>
+static uint32 cullFrustum(const vkb_Bvh& bvh, const vkb_Frustum& frustum, uint32* visibleIds)
+{
+	uint32 count = 0;
+	uint32 stack[maxTraversalDepth];
+	uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const vkb_BvhNode& node = bvh.nodes[stack[--stackSize]];
+
+		uint32 outsideMask;
+		uint32 insideMask;
+#if VKB_BVH_X86
+		if (Kernel != vkb_TransformKernel::Scalar)
+		{
+			classifyChildrenSSE(node, frustum, &outsideMask, &insideMask);
+		}
+		else
+#endif
+		{
+			classifyChildrenScalar(node, frustum, &outsideMask, &insideMask);
+		}
+
+		for (uint32 i = 0; i < node.numChildren; i++)
+		{
+			if (outsideMask & (1u << i))
+			{
+				continue;
+			}
+
+			if (insideMask & (1u << i))
+			{
+				emitSubtree(bvh, node, i, visibleIds, &count);
+			}
+			else if (node.leafCount[i] > 0)
+			{
+				uint32 first = node.child[i];
+				uint32 visibleMask;
+#if VKB_BVH_X86
+				if (Kernel == vkb_TransformKernel::AVX2)
+				{
+					visibleMask = testObjectsAVX2(bvh, frustum, first, node.leafCount[i]);
+				}
+				else if (Kernel == vkb_TransformKernel::SSE)
+				{
+					visibleMask = testObjectsSSE(bvh, frustum, first, node.leafCount[i]);
+				}
+				else
+#endif
+				{
+					visibleMask = testObjectsScalar(bvh, frustum, first, node.leafCount[i]);
+				}
+
+				while (visibleMask != 0)
+				{
+					uint32 lane = 0;
+					while ((visibleMask & (1u << lane)) == 0)
+					{
+						lane++;
+					}
+					visibleMask &= visibleMask - 1;
+					visibleIds[count++] = bvh.slotObjects[first + lane];
+				}
+			}
+			else
+			{
+				g_logger_assert(stackSize < maxTraversalDepth, "BVH traversal stack overflowed.");
+				stack[stackSize++] = node.child[i];
+			}
+		}
+	}
+
+	return count;
+}
+
+static bool boxesOverlap(const vkb_Aabb& box, float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+{
+	return box.min.x <= maxX && box.max.x >= minX &&
+		box.min.y <= maxY && box.max.y >= minY &&
+		box.min.z <= maxZ && box.max.z >= minZ;
+}
+
+// Slab test, returns the distance the ray enters the box at
+static bool rayHitsBox(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const float* min, const float* max, float* entry)
+{
+	float tNear = 0.0f;
+	float tFar = maxDistance;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float t0 = (min[axis] - origin[axis]) * inverseDirection[axis];
+		float t1 = (max[axis] - origin[axis]) * inverseDirection[axis];
+		tNear = fmaxf(tNear, fminf(t0, t1));
+		tFar = fminf(tFar, fmaxf(t0, t1));
+	}
+
+	*entry = tNear;
+	return tNear <= tFar;
+}
+
+// ------------ Public Functions ------------
+vkb_Frustum vkb_frustum_fromViewProj(const glm::mat4& viewProj)
+{
+	// Rows of the matrix, glm is column major
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; row++)
+	{
+		rows[row] = glm::vec4(viewProj[0][row], viewProj[1][row], viewProj[2][row], viewProj[3][row]);
+	}
+
+	vkb_Frustum result;
+	result.planes[0] = rows[3] + rows[0];
+	result.planes[1] = rows[3] - rows[0];
+	result.planes[2] = rows[3] + rows[1];
+	result.planes[3] = rows[3] - rows[1];
+	// Vulkan's depth range starts at 0, not -w
+	result.planes[4] = rows[2];
+	result.planes[5] = rows[3] - rows[2];
+
+	for (uint32 p = 0; p < 6; p++)
+	{
+		glm::vec4& plane = result.planes[p];
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f)
+		{
+			plane = plane * (1.0f / length);
+		}
+	}
+
+	return result;
+}
+
+vkb_Bvh vkb_bvh_build(const vkb_Aabb* bounds, uint32 numObjects)
+{
+	vkb_Bvh result = {};
+	result.numObjects = numObjects;
+
+	// One allocation for the 6 padded coordinate arrays
+	size_t paddedCount = numObjects + vkb_bvhLeafSize;
+	float* coordinates = (float*)g_memory_allocate(sizeof(float) * paddedCount * 6);
+	memset(coordinates, 0, sizeof(float) * paddedCount * 6);
+	result.minX = coordinates;
+	result.minY = coordinates + paddedCount;
+	result.minZ = coordinates + paddedCount * 2;
+	result.maxX = coordinates + paddedCount * 3;
+	result.maxY = coordinates + paddedCount * 4;
+	result.maxZ = coordinates + paddedCount * 5;
+	result.slotObjects = (uint32*)g_memory_allocate(sizeof(uint32) * paddedCount);
+	result.objectSlots = (uint32*)g_memory_allocate(sizeof(uint32) * paddedCount);
+	result.slotLeaves = (uint32*)g_memory_allocate(sizeof(uint32) * paddedCount);
+
+	for (uint32 i = 0; i < numObjects; i++)
+	{
+		result.slotObjects[i] = i;
+	}
+	if (numObjects == 0)
+	{
+		return result;
+	}
+
+	result.nodeCapacity = numObjects / 4 + 1;
+	result.nodes = (vkb_BvhNode*)g_memory_allocate(sizeof(vkb_BvhNode) * result.nodeCapacity);
+
+	// The build only orders the objects, boxes are fit once the slots hold them
+	buildNode(result, bounds, result.slotObjects, { 0, numObjects }, noParent);
+	for (uint32 slot = 0; slot < numObjects; slot++)
+	{
+		const vkb_Aabb& box = bounds[result.slotObjects[slot]];
+		result.minX[slot] = box.min.x;
+		result.minY[slot] = box.min.y;
+		result.minZ[slot] = box.min.z;
+		result.maxX[slot] = box.max.x;
+		result.maxY[slot] = box.max.y;
+		result.maxZ[slot] = box.max.z;
+		result.objectSlots[result.slotObjects[slot]] = slot;
+	}
+
+	// Children come after their parent, so walking backwards fits them first
+	for (uint32 nodeIndex = result.numNodes; nodeIndex > 0; nodeIndex--)
+	{
+		for (uint32 i = 0; i < result.nodes[nodeIndex - 1].numChildren; i++)
+		{
+			fitChild(result, nodeIndex - 1, i);
+		}
+	}
+
+	return result;
+}
+
+void vkb_bvh_update(vkb_Bvh& bvh, uint32 objectId, const vkb_Aabb& bounds)
+{
+	g_logger_assert(objectId < bvh.numObjects, "Object %d isn't in the BVH.", objectId);
+
+	uint32 slot = bvh.objectSlots[objectId];
+	bvh.minX[slot] = bounds.min.x;
+	bvh.minY[slot] = bounds.min.y;
+	bvh.minZ[slot] = bounds.min.z;
+	bvh.maxX[slot] = bounds.max.x;
+	bvh.maxY[slot] = bounds.max.y;
+	bvh.maxZ[slot] = bounds.max.z;
+	bvh.nodes[bvh.slotLeaves[slot] / 4].dirty = true;
+}
+
+void vkb_bvh_refit(vkb_Bvh& bvh)
+{
+	// Children always come after their parent, so walking backwards finishes
+	// every child before the parent reads it
+	for (uint32 nodeIndex = bvh.numNodes; nodeIndex > 0; nodeIndex--)
+	{
+		vkb_BvhNode& node = bvh.nodes[nodeIndex - 1];
+		if (!node.dirty)
+		{
+			continue;
+		}
+
+		for (uint32 i = 0; i < node.numChildren; i++)
+		{
+			fitChild(bvh, nodeIndex - 1, i);
+		}
+		node.dirty = false;
+		if (node.parent != noParent)
+		{
+			bvh.nodes[node.parent].dirty = true;
+		}
+	}
+}
+
+uint32 vkb_bvh_cullFrustum(const vkb_Bvh& bvh, const vkb_Frustum& frustum, uint32* visibleIds, vkb_TransformKernel kernel)
+{
+	if (bvh.numNodes == 0)
+	{
+		return 0;
+	}
+
+	switch (resolveKernel(kernel))
+	{
+#if VKB_BVH_X86
+	case vkb_TransformKernel::AVX2:
+		return cullFrustum<vkb_TransformKernel::AVX2>(bvh, frustum, visibleIds);
+	case vkb_TransformKernel::SSE:
+		return cullFrustum<vkb_TransformKernel::SSE>(bvh, frustum, visibleIds);
+#endif
+	default:
+		return cullFrustum<vkb_TransformKernel::Scalar>(bvh, frustum, visibleIds);
+	}
+}
+
+uint32 vkb_bvh_queryBox(const vkb_Bvh& bvh, const vkb_Aabb& box, uint32* ids, uint32 maxIds)
+{
+	if (bvh.numNodes == 0)
+	{
+		return 0;
+	}
+
+	uint32 count = 0;
+	uint32 stack[maxTraversalDepth];
+	uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0 && count < maxIds)
+	{
+		const vkb_BvhNode& node = bvh.nodes[stack[--stackSize]];
+		for (uint32 i = 0; i < node.numChildren && count < maxIds; i++)
+		{
+			if (!boxesOverlap(box, node.minX[i], node.minY[i], node.minZ[i], node.maxX[i], node.maxY[i], node.maxZ[i]))
+			{
+				continue;
+			}
+
+			if (node.leafCount[i] == 0)
+			{
+				g_logger_assert(stackSize < maxTraversalDepth, "BVH traversal stack overflowed.");
+				stack[stackSize++] = node.child[i];
+				continue;
+			}
+
+			for (uint32 slot = node.child[i]; slot < node.child[i] + node.leafCount[i] && count < maxIds; slot++)
+			{
+				if (boxesOverlap(box, bvh.minX[slot], bvh.minY[slot], bvh.minZ[slot], bvh.maxX[slot], bvh.maxY[slot], bvh.maxZ[slot]))
+				{
+					ids[count++] = bvh.slotObjects[slot];
+				}
+			}
+		}
+	}
+
+	return count;
+}
+
+bool vkb_bvh_raycast(const vkb_Bvh& bvh, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, vkb_BvhRayHit* hit)
+{
+	if (bvh.numNodes == 0)
+	{
+		return false;
+	}
+
+	// Zero components become tiny ones so the slabs never compute 0 * inf
+	glm::vec3 inverseDirection;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float component = fabsf(direction[axis]) > 1e-20f ? direction[axis] : 1e-20f;
+		inverseDirection[axis] = 1.0f / component;
+	}
+
+	float closest = maxDistance;
+	bool found = false;
+	uint32 stack[maxTraversalDepth];
+	uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const vkb_BvhNode& node = bvh.nodes[stack[--stackSize]];
+		for (uint32 i = 0; i < node.numChildren; i++)
+		{
+			float childMin[3] = { node.minX[i], node.minY[i], node.minZ[i] };
+			float childMax[3] = { node.maxX[i], node.maxY[i], node.maxZ[i] };
+			float entry;
+			if (!rayHitsBox(origin, inverseDirection, closest, childMin, childMax, &entry))
+			{
+				continue;
+			}
+
+			if (node.leafCount[i] == 0)
+			{
+				g_logger_assert(stackSize < maxTraversalDepth, "BVH traversal stack overflowed.");
+				stack[stackSize++] = node.child[i];
+				continue;
+			}
+
+			for (uint32 slot = node.child[i]; slot < node.child[i] + node.leafCount[i]; slot++)
+			{
+				float objectMin[3] = { bvh.minX[slot], bvh.minY[slot], bvh.minZ[slot] };
+				float objectMax[3] = { bvh.maxX[slot], bvh.maxY[slot], bvh.maxZ[slot] };
+				if (rayHitsBox(origin, inverseDirection, closest, objectMin, objectMax, &entry))
+				{
+					closest = entry;
+					hit->objectId = bvh.slotObjects[slot];
+					hit->distance = entry;
+					found = true;
+				}
+			}
+		}
+	}
+
+	return found;
+}
+
+void vkb_bvh_free(vkb_Bvh& bvh)
+{
+	if (bvh.minX != nullptr)
+	{
+		g_memory_free(bvh.minX);
+		g_memory_free(bvh.slotObjects);
+		g_memory_free(bvh.objectSlots);
+		g_memory_free(bvh.slotLeaves);
+	}
+	if (bvh.nodes != nullptr)
+	{
+		g_memory_free(bvh.nodes);
+	}
+	bvh = {};
+}
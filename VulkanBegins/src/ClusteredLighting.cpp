@@ -0,0 +1,370 @@
+#include "VulkanBegins/ClusteredLighting.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/GpuTimer.h"
+#include "VulkanBegins/File.h"
+#include "VulkanBegins/CommandStream.h"
+
+#include <math.h>
+#include <string.h>
+#include <new>
+
+// ------------ Internal structures ------------
+// Matches ClusterParams in light_cull.comp, shader.vert and shader.frag
+struct ClusterParams
+{
+	// x, y and z cluster counts, then the number of lights
+	uint32 gridSize[4];
+	// Tile width and height in pixels, then the depth slice scale and bias
+	float tileAndSlice[4];
+	// Near and far distance, then tan of half the field of view in x and y
+	float depthAndFov[4];
+	// Viewport width and height in pixels
+	float viewport[4];
+	// maxLightsPerCluster and maxLightIndices
+	uint32 limits[4];
+};
+
+// Matches Counters in light_cull.comp
+enum CounterSlot : uint32
+{
+	CounterLightIndices,
+	CounterMaxLightsInCluster,
+	CounterTruncatedClusters,
+
+	CounterCount
+};
+
+enum TimerScope : uint32
+{
+	TimerCull,
+	TimerShading,
+
+	TimerScopeCount
+};
+
+// Keys the lighting's objects are captured under
+enum CaptureObject : uint32
+{
+	CaptureCullPipeline,
+	CaptureCullLayout,
+	CaptureLightingSet,
+	CaptureParamsBuffer,
+	CaptureLightBuffer,
+	CaptureCounterBuffer
+};
+
+struct vkb_ClusteredLighting
+{
+	uint32 maxLights;
+	uint32 maxLightsPerCluster;
+	uint32 maxLightIndices;
+	uint32 numLights;
+
+	VkDevice device;
+	const VkAllocationCallbacks* allocator;
+
+	VkPipelineLayout cullLayout;
+	VkPipeline cullPipeline;
+
+	// Written by the CPU every frame
+	vkb_Buffer paramsBuffer;
+	vkb_Buffer lightBuffer;
+	// Written by the cull pass
+	vkb_Buffer gridBuffer;
+	vkb_Buffer indexBuffer;
+	vkb_Buffer counterBuffer;
+
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet lightingSet;
+
+	vkb_GpuTimer timer;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 cullGroupSize = 64;
+
+// ------------ Internal Functions ------------
+static void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+{
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_pipelineBarrier(srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+static void createCullPipeline(vkb_ClusteredLighting* lighting, const vkb_ClusteredLightingDesc& desc)
+{
+	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &desc.lightingSetLayout;
+
+	uint32 res = vkCreatePipelineLayout(lighting->device, &layoutCreateInfo, lighting->allocator, &lighting->cullLayout);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create light culling pipeline layout.");
+
+	VkShaderModuleCreateInfo moduleCreateInfo = {};
+	moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleCreateInfo.codeSize = desc.cullShader->size;
+	moduleCreateInfo.pCode = (const uint32*)desc.cullShader->data;
+
+	VkShaderModule module;
+	res = vkCreateShaderModule(lighting->device, &moduleCreateInfo, lighting->allocator, &module);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create light culling shader module.");
+
+	VkComputePipelineCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	createInfo.stage.module = module;
+	createInfo.stage.pName = "main";
+	createInfo.layout = lighting->cullLayout;
+	createInfo.basePipelineIndex = -1;
+
+	res = vkCreateComputePipelines(lighting->device, desc.pipelineCache, 1, &createInfo, lighting->allocator, &lighting->cullPipeline);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create light culling pipeline.");
+
+	vkDestroyShaderModule(lighting->device, module, lighting->allocator);
+}
+
+static void createLightingSet(vkb_ClusteredLighting* lighting, const vkb_ClusteredLightingDesc& desc)
+{
+	VkDescriptorPoolSize poolSizes[2] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = 4;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = 2;
+	poolCreateInfo.pPoolSizes = poolSizes;
+
+	uint32 res = vkCreateDescriptorPool(lighting->device, &poolCreateInfo, lighting->allocator, &lighting->descriptorPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create lighting descriptor pool.");
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = lighting->descriptorPool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &desc.lightingSetLayout;
+	res = vkAllocateDescriptorSets(lighting->device, &setAllocInfo, &lighting->lightingSet);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate the lighting descriptor set.");
+
+	// Binding order of light_cull.comp
+	const vkb_Buffer* buffers[] = {
+		&lighting->paramsBuffer,
+		&lighting->lightBuffer,
+		&lighting->gridBuffer,
+		&lighting->indexBuffer,
+		&lighting->counterBuffer
+	};
+	constexpr uint32 numBuffers = sizeof(buffers) / sizeof(buffers[0]);
+
+	VkDescriptorBufferInfo bufferInfos[numBuffers] = {};
+	VkWriteDescriptorSet writes[numBuffers] = {};
+	for (uint32 i = 0; i < numBuffers; i++)
+	{
+		bufferInfos[i].buffer = buffers[i]->buffer;
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = lighting->lightingSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(lighting->device, numBuffers, writes, 0, nullptr);
+}
+
+// ------------ Public Functions ------------
+vkb_ClusteredLighting* vkb_clusteredLighting_create(const vkb_Context& ctx, const vkb_ClusteredLightingDesc& desc)
+{
+	g_logger_assert(desc.cullShader->data != nullptr, "Missing light culling shader bytecode.");
+	g_logger_assert(desc.maxLights > 0 && desc.maxLightsPerCluster > 0 && desc.maxLightIndices > 0, "Clustered lighting needs room for at least one light.");
+
+	vkb_ClusteredLighting* lighting = (vkb_ClusteredLighting*)g_memory_allocate(sizeof(vkb_ClusteredLighting));
+	new(lighting)vkb_ClusteredLighting();
+
+	lighting->maxLights = desc.maxLights;
+	lighting->maxLightsPerCluster = desc.maxLightsPerCluster;
+	lighting->maxLightIndices = desc.maxLightIndices;
+	lighting->numLights = 0;
+	lighting->device = ctx.device;
+	lighting->allocator = ctx.allocator;
+
+	createCullPipeline(lighting, desc);
+
+	// With one frame in flight the CPU side can be written in place, the GPU is done with it by then
+	VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	lighting->paramsBuffer = vkb_buffer_create(ctx, sizeof(ClusterParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible);
+	// The big ones count against the memory budget
+	lighting->lightBuffer = vkb_buffer_createResident(ctx, sizeof(vkb_PointLight) * desc.maxLights, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+	lighting->gridBuffer = vkb_buffer_createResident(ctx, sizeof(uint32) * 2 * vkb_numClusters,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	lighting->indexBuffer = vkb_buffer_createResident(ctx, sizeof(uint32) * desc.maxLightIndices,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	lighting->counterBuffer = vkb_buffer_create(ctx, sizeof(uint32) * CounterCount,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible);
+	memset(lighting->paramsBuffer.mapped, 0, sizeof(ClusterParams));
+	memset(lighting->counterBuffer.mapped, 0, sizeof(uint32) * CounterCount);
+
+	createLightingSet(lighting, desc);
+
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE, lighting->cullPipeline, vkb_captureKey(vkb_CaptureOwner::ClusteredLighting, CaptureCullPipeline));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, lighting->cullLayout, vkb_captureKey(vkb_CaptureOwner::ClusteredLighting, CaptureCullLayout));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, lighting->lightingSet, vkb_captureKey(vkb_CaptureOwner::ClusteredLighting, CaptureLightingSet));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_BUFFER, lighting->counterBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::ClusteredLighting, CaptureCounterBuffer));
+	vkb_commandCapture_trackBuffer(lighting->paramsBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::ClusteredLighting, CaptureParamsBuffer),
+		sizeof(ClusterParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, lighting->paramsBuffer.mapped);
+	vkb_commandCapture_trackBuffer(lighting->lightBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::ClusteredLighting, CaptureLightBuffer),
+		sizeof(vkb_PointLight) * desc.maxLights, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, lighting->lightBuffer.mapped);
+
+	lighting->timer = vkb_gpuTimer_create(ctx, TimerScopeCount);
+
+	return lighting;
+}
+
+void vkb_clusteredLighting_update(vkb_ClusteredLighting* lighting, const vkb_PointLight* lights, uint32 numLights, const vkb_ClusterView& view)
+{
+	if (numLights > lighting->maxLights)
+	{
+		g_logger_warning("%d lights don't fit in clustered lighting made for %d, the rest are dropped.", numLights, lighting->maxLights);
+		numLights = lighting->maxLights;
+	}
+
+	memcpy(lighting->lightBuffer.mapped, lights, sizeof(vkb_PointLight) * numLights);
+	vkb_commandCapture_updateBuffer(lighting->lightBuffer.buffer, 0, lights, sizeof(vkb_PointLight) * numLights);
+	lighting->numLights = numLights;
+
+	// Slice k starts at near * (far / near)^(k / slices), so the slice of a
+	// view depth d is log(d) * scale + bias
+	float logDepthRange = logf(view.farZ / view.nearZ);
+	float sliceScale = (float)vkb_clusterGridZ / logDepthRange;
+
+	ClusterParams params = {};
+	params.gridSize[0] = vkb_clusterGridX;
+	params.gridSize[1] = vkb_clusterGridY;
+	params.gridSize[2] = vkb_clusterGridZ;
+	params.gridSize[3] = numLights;
+	params.tileAndSlice[0] = ceilf((float)view.width / (float)vkb_clusterGridX);
+	params.tileAndSlice[1] = ceilf((float)view.height / (float)vkb_clusterGridY);
+	params.tileAndSlice[2] = sliceScale;
+	params.tileAndSlice[3] = -sliceScale * logf(view.nearZ);
+	params.depthAndFov[0] = view.nearZ;
+	params.depthAndFov[1] = view.farZ;
+	params.depthAndFov[2] = view.tanHalfFovX;
+	params.depthAndFov[3] = view.tanHalfFovY;
+	params.viewport[0] = (float)view.width;
+	params.viewport[1] = (float)view.height;
+	params.limits[0] = lighting->maxLightsPerCluster;
+	params.limits[1] = lighting->maxLightIndices;
+	memcpy(lighting->paramsBuffer.mapped, &params, sizeof(params));
+	vkb_commandCapture_updateBuffer(lighting->paramsBuffer.buffer, 0, &params, sizeof(params));
+}
+
+void vkb_clusteredLighting_recordCull(vkb_ClusteredLighting* lighting, VkCommandBuffer commandBuffer)
+{
+	vkb_gpuTimer_reset(lighting->timer, commandBuffer);
+	vkb_gpuTimer_begin(lighting->timer, commandBuffer, TimerCull);
+
+	// Last frame's draws have to be done reading the lists before they're rebuilt
+	memoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0);
+
+	vkCmdFillBuffer(commandBuffer, lighting->counterBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+	bool capturing = vkb_commandCapture_isActive();
+	if (capturing)
+	{
+		vkb_commandCapture_fillBuffer(lighting->counterBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+	}
+	memoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, lighting->cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, lighting->cullLayout, 0, 1, &lighting->lightingSet, 0, nullptr);
+	vkCmdDispatch(commandBuffer, (vkb_numClusters + cullGroupSize - 1) / cullGroupSize, 1, 1);
+	if (capturing)
+	{
+		vkb_commandCapture_bindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, lighting->cullPipeline);
+		vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, lighting->cullLayout, 0, lighting->lightingSet);
+		vkb_commandCapture_dispatch((vkb_numClusters + cullGroupSize - 1) / cullGroupSize, 1, 1);
+	}
+
+	// The counters double as stats, so the host reads them too
+	memoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT);
+
+	vkb_gpuTimer_end(lighting->timer, commandBuffer, TimerCull);
+}
+
+void vkb_clusteredLighting_bind(const vkb_ClusteredLighting* lighting, VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32 set)
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1, &lighting->lightingSet, 0, nullptr);
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, lighting->lightingSet);
+	}
+}
+
+void vkb_clusteredLighting_beginShading(const vkb_ClusteredLighting* lighting, VkCommandBuffer commandBuffer)
+{
+	vkb_gpuTimer_begin(lighting->timer, commandBuffer, TimerShading);
+}
+
+void vkb_clusteredLighting_endShading(const vkb_ClusteredLighting* lighting, VkCommandBuffer commandBuffer)
+{
+	vkb_gpuTimer_end(lighting->timer, commandBuffer, TimerShading);
+}
+
+void vkb_clusteredLighting_markUsed(const vkb_ClusteredLighting* lighting, uint64 frameIndex)
+{
+	vkb_residency_markUsed(lighting->lightBuffer.residentResource, frameIndex);
+	vkb_residency_markUsed(lighting->gridBuffer.residentResource, frameIndex);
+	vkb_residency_markUsed(lighting->indexBuffer.residentResource, frameIndex);
+}
+
+vkb_ClusteredLightingStats vkb_clusteredLighting_readStats(const vkb_Context& ctx, const vkb_ClusteredLighting* lighting)
+{
+	const uint32* counters = (const uint32*)lighting->counterBuffer.mapped;
+
+	vkb_ClusteredLightingStats stats = {};
+	stats.numLights = lighting->numLights;
+	stats.numLightIndices = counters[CounterLightIndices] < lighting->maxLightIndices ? counters[CounterLightIndices] : lighting->maxLightIndices;
+	stats.maxLightsInCluster = counters[CounterMaxLightsInCluster];
+	stats.numTruncatedClusters = counters[CounterTruncatedClusters];
+	stats.timingSupported = vkb_gpuTimer_read(ctx, lighting->timer, TimerCull, &stats.cullMs) &&
+		vkb_gpuTimer_read(ctx, lighting->timer, TimerShading, &stats.shadingMs);
+	return stats;
+}
+
+void vkb_clusteredLighting_free(const vkb_Context& ctx, vkb_ClusteredLighting* lighting)
+{
+	vkb_gpuTimer_free(ctx, lighting->timer);
+	vkDestroyDescriptorPool(lighting->device, lighting->descriptorPool, lighting->allocator);
+
+	vkb_commandCapture_untrackBuffer(lighting->paramsBuffer.buffer);
+	vkb_commandCapture_untrackBuffer(lighting->lightBuffer.buffer);
+	vkb_buffer_free(ctx, lighting->paramsBuffer);
+	vkb_buffer_free(ctx, lighting->lightBuffer);
+	vkb_buffer_free(ctx, lighting->gridBuffer);
+	vkb_buffer_free(ctx, lighting->indexBuffer);
+	vkb_buffer_free(ctx, lighting->counterBuffer);
+
+	vkDestroyPipeline(lighting->device, lighting->cullPipeline, lighting->allocator);
+	vkDestroyPipelineLayout(lighting->device, lighting->cullLayout, lighting->allocator);
+
+	lighting->~vkb_ClusteredLighting();
+	g_memory_free(lighting);
+}
@@ -0,0 +1,1180 @@
+#include "VulkanBegins/CommandStream.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/File.h"
+
+#include <mutex>
+#include <string.h>
+
+// ------------ Internal structures ------------
+// Followed by appStateSize bytes of app state
+struct StreamHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint32 width;
+	uint32 height;
+	uint32 colorFormat;
+	uint32 numFrames;
+	uint32 appStateSize;
+	uint32 padding;
+};
+
+// Followed by size bytes of contents
+struct CreateBufferOp
+{
+	uint32 key;
+	uint32 usage;
+	uint64 size;
+};
+
+// Followed by size bytes of data, for both CPU writes and vkCmdUpdateBuffer
+struct UpdateBufferOp
+{
+	uint32 key;
+	uint32 padding;
+	uint64 offset;
+	uint64 size;
+};
+
+struct BeginRenderPassOp
+{
+	uint32 renderPassKey;
+	uint32 framebufferKey;
+	VkRect2D renderArea;
+	uint32 clearValueCount;
+	float clearColor[4];
+	float clearDepth;
+};
+
+struct BindPipelineOp
+{
+	uint32 bindPoint;
+	uint32 key;
+};
+
+struct BindDescriptorSetOp
+{
+	uint32 bindPoint;
+	uint32 layoutKey;
+	uint32 set;
+	uint32 setKey;
+};
+
+// Followed by size bytes of values
+struct PushConstantsOp
+{
+	uint32 layoutKey;
+	uint32 stages;
+	uint32 offset;
+	uint32 size;
+};
+
+struct BindBufferOp
+{
+	uint32 key;
+	uint32 padding;
+	uint64 offset;
+};
+
+struct DrawOp
+{
+	uint32 vertexCount;
+	uint32 instanceCount;
+	uint32 firstVertex;
+	uint32 firstInstance;
+};
+
+struct DrawIndexedOp
+{
+	uint32 indexCount;
+	uint32 instanceCount;
+	uint32 firstIndex;
+	int32 vertexOffset;
+	uint32 firstInstance;
+};
+
+struct DrawIndirectOp
+{
+	uint32 key;
+	uint32 drawCount;
+	uint64 offset;
+	uint32 stride;
+	uint32 padding;
+};
+
+struct DispatchOp
+{
+	uint32 groupCountX;
+	uint32 groupCountY;
+	uint32 groupCountZ;
+};
+
+struct CopyBufferOp
+{
+	uint32 srcKey;
+	uint32 dstKey;
+	VkBufferCopy region;
+};
+
+struct FillBufferOp
+{
+	uint32 key;
+	uint32 data;
+	uint64 offset;
+	uint64 size;
+};
+
+// Followed by the memory, buffer and image barriers, in that order
+struct PipelineBarrierOp
+{
+	uint32 srcStages;
+	uint32 dstStages;
+	uint32 dependencyFlags;
+	uint32 numMemoryBarriers;
+	uint32 numBufferBarriers;
+	uint32 numImageBarriers;
+};
+
+struct MemoryBarrierData
+{
+	uint32 srcAccess;
+	uint32 dstAccess;
+};
+
+struct BufferBarrierData
+{
+	uint32 srcAccess;
+	uint32 dstAccess;
+	uint32 srcQueueFamily;
+	uint32 dstQueueFamily;
+	uint32 key;
+	uint32 padding;
+	uint64 offset;
+	uint64 size;
+};
+
+struct ImageBarrierData
+{
+	uint32 srcAccess;
+	uint32 dstAccess;
+	uint32 oldLayout;
+	uint32 newLayout;
+	uint32 srcQueueFamily;
+	uint32 dstQueueFamily;
+	uint32 key;
+	VkImageSubresourceRange range;
+};
+
+struct ClearColorImageOp
+{
+	uint32 key;
+	uint32 layout;
+	VkClearColorValue color;
+	VkImageSubresourceRange range;
+};
+
+struct CopyBufferToImageOp
+{
+	uint32 bufferKey;
+	uint32 imageKey;
+	uint32 layout;
+	uint32 padding;
+	VkBufferImageCopy region;
+};
+
+struct BlitImageOp
+{
+	uint32 srcKey;
+	uint32 srcLayout;
+	uint32 dstKey;
+	uint32 dstLayout;
+	uint32 filter;
+	VkImageBlit region;
+};
+
+struct RegisteredObject
+{
+	uint64 handle;
+	VkObjectType type;
+	uint32 key;
+};
+
+struct TrackedBuffer
+{
+	VkBuffer buffer;
+	uint32 key;
+	VkBufferUsageFlags usage;
+	VkDeviceSize size;
+	uint8* mapped;
+};
+
+struct ReplayBuffer
+{
+	uint32 key;
+	VkBufferUsageFlags usage;
+	VkDeviceSize size;
+	VkBuffer buffer;
+	uint8* mapped;
+	// Only created for captured buffers this process never tracked
+	vkb_Buffer ownedBuffer;
+};
+
+struct vkb_CommandStream
+{
+	vkb_FileContents file;
+	StreamHeader header;
+	// Byte offset of each frame's first op, frame 0 starts with the buffer creates
+	uint32* frameOffsets;
+	ReplayBuffer* buffers;
+	uint32 numBuffers;
+};
+
+// ------------ Internal Variables ------------
+// "VKBC"
+static constexpr uint32 streamMagic = 0x43424B56;
+static constexpr uint32 streamVersion = 2;
+static constexpr uint32 maxTrackedBuffers = 256;
+static constexpr uint32 maxFilenameLength = 260;
+
+static const size_t opPayloadSizes[(uint32)vkb_CaptureOp::Count] = {
+	sizeof(CreateBufferOp),
+	sizeof(UpdateBufferOp),
+	sizeof(BeginRenderPassOp),
+	sizeof(VkViewport),
+	sizeof(VkRect2D),
+	sizeof(BindPipelineOp),
+	sizeof(BindDescriptorSetOp),
+	sizeof(PushConstantsOp),
+	sizeof(BindBufferOp),
+	sizeof(BindBufferOp),
+	sizeof(DrawOp),
+	sizeof(DrawIndexedOp),
+	sizeof(DrawIndirectOp),
+	sizeof(DispatchOp),
+	sizeof(BindBufferOp),
+	sizeof(CopyBufferOp),
+	sizeof(FillBufferOp),
+	sizeof(UpdateBufferOp),
+	sizeof(PipelineBarrierOp),
+	sizeof(ClearColorImageOp),
+	sizeof(CopyBufferToImageOp),
+	sizeof(BlitImageOp),
+	0,
+	0
+};
+
+// Objects are registered from whichever thread creates them
+static std::mutex registryMutex;
+static RegisteredObject* registeredObjects = nullptr;
+static uint32 numRegisteredObjects = 0;
+static uint32 registeredObjectsCapacity = 0;
+static TrackedBuffer trackedBuffers[maxTrackedBuffers];
+static uint32 numTrackedBuffers = 0;
+
+static bool capturing = false;
+static char captureFilename[maxFilenameLength];
+static uint32 framesLeft = 0;
+static uint8* streamData = nullptr;
+static size_t streamSize = 0;
+static size_t streamCapacity = 0;
+
+// ------------ Internal Functions ------------
+static void appendBytes(const void* data, size_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	if (streamSize + size > streamCapacity)
+	{
+		size_t newCapacity = streamCapacity > 0 ? streamCapacity * 2 : 64 * 1024;
+		while (newCapacity < streamSize + size)
+		{
+			newCapacity *= 2;
+		}
+		streamData = (uint8*)g_memory_realloc(streamData, newCapacity);
+		streamCapacity = newCapacity;
+	}
+
+	memcpy(streamData + streamSize, data, size);
+	streamSize += size;
+}
+
+static void appendOp(vkb_CaptureOp op, const void* payload)
+{
+	uint8 opcode = (uint8)op;
+	appendBytes(&opcode, sizeof(opcode));
+	appendBytes(payload, opPayloadSizes[(uint32)op]);
+}
+
+static RegisteredObject* findRegisteredHandle(VkObjectType type, uint64 handle)
+{
+	for (uint32 i = 0; i < numRegisteredObjects; i++)
+	{
+		if (registeredObjects[i].handle == handle && registeredObjects[i].type == type)
+		{
+			return &registeredObjects[i];
+		}
+	}
+	return nullptr;
+}
+
+// The key a captured object goes by in the stream
+template<typename T>
+static uint32 keyOf(VkObjectType type, T handle)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	RegisteredObject* object = findRegisteredHandle(type, (uint64)handle);
+	g_logger_assert(object != nullptr, "Captured a Vulkan object (type %d) that was never registered, see vkb_commandCapture_registerObject.", (int)type);
+	return object->key;
+}
+
+static TrackedBuffer* findTrackedBuffer(VkBuffer buffer)
+{
+	for (uint32 i = 0; i < numTrackedBuffers; i++)
+	{
+		if (trackedBuffers[i].buffer == buffer)
+		{
+			return &trackedBuffers[i];
+		}
+	}
+	return nullptr;
+}
+
+static TrackedBuffer* findTrackedKey(uint32 key)
+{
+	for (uint32 i = 0; i < numTrackedBuffers; i++)
+	{
+		if (trackedBuffers[i].key == key)
+		{
+			return &trackedBuffers[i];
+		}
+	}
+	return nullptr;
+}
+
+static void appendCreateBuffer(const TrackedBuffer& tracked)
+{
+	CreateBufferOp op = { tracked.key, tracked.usage, tracked.size };
+	appendOp(vkb_CaptureOp::CreateBuffer, &op);
+	appendBytes(tracked.mapped, (size_t)tracked.size);
+}
+
+// Payloads follow a one byte opcode, so they're copied out rather than cast in place
+template<typename T>
+static T readPayload(const uint8* payload)
+{
+	T result;
+	memcpy(&result, payload, sizeof(T));
+	return result;
+}
+
+static uint64 opDataSize(vkb_CaptureOp op, const uint8* payload)
+{
+	switch (op)
+	{
+	case vkb_CaptureOp::CreateBuffer:
+		return readPayload<CreateBufferOp>(payload).size;
+	case vkb_CaptureOp::UpdateBuffer:
+	case vkb_CaptureOp::CmdUpdateBuffer:
+		return readPayload<UpdateBufferOp>(payload).size;
+	case vkb_CaptureOp::PushConstants:
+		return readPayload<PushConstantsOp>(payload).size;
+	case vkb_CaptureOp::PipelineBarrier:
+	{
+		PipelineBarrierOp barrier = readPayload<PipelineBarrierOp>(payload);
+		return (uint64)barrier.numMemoryBarriers * sizeof(MemoryBarrierData) +
+			(uint64)barrier.numBufferBarriers * sizeof(BufferBarrierData) +
+			(uint64)barrier.numImageBarriers * sizeof(ImageBarrierData);
+	}
+	default:
+		return 0;
+	}
+}
+
+// Steps over one op, false if it runs past the end of the stream
+static bool readOp(const uint8** cursor, const uint8* end, vkb_CaptureOp* op, const uint8** payload, const uint8** data, uint64* dataSize)
+{
+	if (*cursor >= end || **cursor >= (uint8)vkb_CaptureOp::Count)
+	{
+		return false;
+	}
+
+	*op = (vkb_CaptureOp)**cursor;
+	*payload = *cursor + 1;
+	size_t payloadSize = opPayloadSizes[(uint32)*op];
+	if (end - *payload < (ptrdiff_t)payloadSize)
+	{
+		return false;
+	}
+
+	*data = *payload + payloadSize;
+	*dataSize = opDataSize(*op, *payload);
+	if ((uint64)(end - *data) < *dataSize)
+	{
+		return false;
+	}
+
+	*cursor = *data + *dataSize;
+	return true;
+}
+
+// The replay's object for a key, the newest one registered with it
+static uint64 resolveKey(VkObjectType type, uint32 key)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (uint32 i = numRegisteredObjects; i > 0; i--)
+	{
+		const RegisteredObject& object = registeredObjects[i - 1];
+		if (object.key == key && object.type == type)
+		{
+			return object.handle;
+		}
+	}
+
+	g_logger_assert(false, "Command stream references object %x (type %d), which the replay never registered. Was it initialized with the stream's app state?", key, (int)type);
+	return 0;
+}
+
+static bool isTargetKey(uint32 key)
+{
+	return (key >> 24) == (uint32)vkb_CaptureOwner::Target;
+}
+
+static ReplayBuffer* findReplayBuffer(vkb_CommandStream* stream, uint32 key)
+{
+	for (uint32 i = 0; i < stream->numBuffers; i++)
+	{
+		if (stream->buffers[i].key == key)
+		{
+			return &stream->buffers[i];
+		}
+	}
+	return nullptr;
+}
+
+static VkBuffer resolveBuffer(vkb_CommandStream* stream, uint32 key)
+{
+	ReplayBuffer* buffer = findReplayBuffer(stream, key);
+	if (buffer != nullptr)
+	{
+		return buffer->buffer;
+	}
+	return (VkBuffer)resolveKey(VK_OBJECT_TYPE_BUFFER, key);
+}
+
+static VkImage resolveImage(uint32 key, const vkb_ReplayTarget& target)
+{
+	return isTargetKey(key) ? target.image : (VkImage)resolveKey(VK_OBJECT_TYPE_IMAGE, key);
+}
+
+static uint8* replayBufferData(vkb_CommandStream* stream, uint32 key)
+{
+	ReplayBuffer* buffer = findReplayBuffer(stream, key);
+	g_logger_assert(buffer != nullptr, "Command stream writes buffer %x, which it never created.", key);
+	return buffer->mapped;
+}
+
+static void recordBarrier(vkb_CommandStream* stream, VkCommandBuffer commandBuffer, const vkb_ReplayTarget& target, const uint8* payload, const uint8* data)
+{
+	static constexpr uint32 maxBarriers = 32;
+	PipelineBarrierOp op = readPayload<PipelineBarrierOp>(payload);
+	g_logger_assert(op.numMemoryBarriers <= maxBarriers && op.numBufferBarriers <= maxBarriers && op.numImageBarriers <= maxBarriers,
+		"Command stream barrier has more than %d barriers of one kind.", maxBarriers);
+
+	VkMemoryBarrier memoryBarriers[maxBarriers];
+	for (uint32 i = 0; i < op.numMemoryBarriers; i++)
+	{
+		MemoryBarrierData barrier = readPayload<MemoryBarrierData>(data);
+		data += sizeof(MemoryBarrierData);
+		memoryBarriers[i] = {};
+		memoryBarriers[i].sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarriers[i].srcAccessMask = barrier.srcAccess;
+		memoryBarriers[i].dstAccessMask = barrier.dstAccess;
+	}
+
+	VkBufferMemoryBarrier bufferBarriers[maxBarriers];
+	for (uint32 i = 0; i < op.numBufferBarriers; i++)
+	{
+		BufferBarrierData barrier = readPayload<BufferBarrierData>(data);
+		data += sizeof(BufferBarrierData);
+		bufferBarriers[i] = {};
+		bufferBarriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		bufferBarriers[i].srcAccessMask = barrier.srcAccess;
+		bufferBarriers[i].dstAccessMask = barrier.dstAccess;
+		bufferBarriers[i].srcQueueFamilyIndex = barrier.srcQueueFamily;
+		bufferBarriers[i].dstQueueFamilyIndex = barrier.dstQueueFamily;
+		bufferBarriers[i].buffer = resolveBuffer(stream, barrier.key);
+		bufferBarriers[i].offset = barrier.offset;
+		bufferBarriers[i].size = barrier.size;
+	}
+
+	VkImageMemoryBarrier imageBarriers[maxBarriers];
+	for (uint32 i = 0; i < op.numImageBarriers; i++)
+	{
+		ImageBarrierData barrier = readPayload<ImageBarrierData>(data);
+		data += sizeof(ImageBarrierData);
+		imageBarriers[i] = {};
+		imageBarriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarriers[i].srcAccessMask = barrier.srcAccess;
+		imageBarriers[i].dstAccessMask = barrier.dstAccess;
+		imageBarriers[i].oldLayout = (VkImageLayout)barrier.oldLayout;
+		imageBarriers[i].newLayout = (VkImageLayout)barrier.newLayout;
+		imageBarriers[i].srcQueueFamilyIndex = barrier.srcQueueFamily;
+		imageBarriers[i].dstQueueFamilyIndex = barrier.dstQueueFamily;
+		imageBarriers[i].image = resolveImage(barrier.key, target);
+		imageBarriers[i].subresourceRange = barrier.range;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, op.srcStages, op.dstStages, op.dependencyFlags,
+		op.numMemoryBarriers, memoryBarriers, op.numBufferBarriers, bufferBarriers, op.numImageBarriers, imageBarriers);
+}
+
+// ------------ Public Functions ------------
+void vkb_commandCapture_registerObject(VkObjectType type, uint64 handle, uint32 key)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	RegisteredObject* object = findRegisteredHandle(type, handle);
+	if (object != nullptr)
+	{
+		// Moved to the end so it's the newest object with its key, the rest keep their order
+		uint32 index = (uint32)(object - registeredObjects);
+		memmove(object, object + 1, sizeof(RegisteredObject) * (numRegisteredObjects - index - 1));
+		numRegisteredObjects--;
+	}
+
+	if (numRegisteredObjects == registeredObjectsCapacity)
+	{
+		registeredObjectsCapacity = registeredObjectsCapacity > 0 ? registeredObjectsCapacity * 2 : 256;
+		registeredObjects = (RegisteredObject*)g_memory_realloc(registeredObjects, sizeof(RegisteredObject) * registeredObjectsCapacity);
+	}
+	registeredObjects[numRegisteredObjects++] = { handle, type, key };
+}
+
+void vkb_commandCapture_trackBuffer(VkBuffer buffer, uint32 key, VkDeviceSize size, VkBufferUsageFlags usage, void* mapped)
+{
+	g_logger_assert(numTrackedBuffers < maxTrackedBuffers, "Can't track more than %d buffers for command capture.", maxTrackedBuffers);
+	g_logger_assert(mapped != nullptr, "Only mapped buffers can be tracked for command capture.");
+
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_BUFFER, buffer, key);
+	TrackedBuffer* tracked = findTrackedBuffer(buffer);
+	if (tracked == nullptr)
+	{
+		tracked = &trackedBuffers[numTrackedBuffers++];
+	}
+	tracked->buffer = buffer;
+	tracked->key = key;
+	tracked->usage = usage;
+	tracked->size = size;
+	tracked->mapped = (uint8*)mapped;
+
+	if (capturing)
+	{
+		appendCreateBuffer(*tracked);
+	}
+}
+
+void vkb_commandCapture_untrackBuffer(VkBuffer buffer)
+{
+	TrackedBuffer* tracked = findTrackedBuffer(buffer);
+	if (tracked != nullptr)
+	{
+		*tracked = trackedBuffers[--numTrackedBuffers];
+	}
+}
+
+void vkb_commandCapture_updateBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size)
+{
+	if (!capturing || size == 0)
+	{
+		return;
+	}
+
+	TrackedBuffer* tracked = findTrackedBuffer(buffer);
+	g_logger_assert(tracked != nullptr, "Captured a write to a buffer that isn't tracked, see vkb_commandCapture_trackBuffer.");
+	g_logger_assert(offset + size <= tracked->size, "Buffer update runs past the end of the buffer.");
+
+	UpdateBufferOp op = { tracked->key, 0, offset, size };
+	appendOp(vkb_CaptureOp::UpdateBuffer, &op);
+	appendBytes(data, (size_t)size);
+}
+
+void vkb_commandCapture_start(const char* filename, uint32 numFrames, VkExtent2D extent, VkFormat colorFormat, const void* appState, uint32 appStateSize)
+{
+	if (capturing)
+	{
+		g_logger_warning("A command capture is already running, '%s' wasn't started.", filename);
+		return;
+	}
+	if (numFrames == 0 || strlen(filename) >= maxFilenameLength)
+	{
+		g_logger_error("Invalid command capture '%s' of %d frames.", filename, numFrames);
+		return;
+	}
+
+	strcpy(captureFilename, filename);
+	framesLeft = numFrames;
+	streamSize = 0;
+	capturing = true;
+
+	StreamHeader header = {};
+	header.magic = streamMagic;
+	header.version = streamVersion;
+	header.width = extent.width;
+	header.height = extent.height;
+	header.colorFormat = (uint32)colorFormat;
+	header.numFrames = numFrames;
+	header.appStateSize = appStateSize;
+	appendBytes(&header, sizeof(header));
+	appendBytes(appState, appStateSize);
+
+	// The mapped contents are the CPU's latest writes, this frame's included
+	for (uint32 i = 0; i < numTrackedBuffers; i++)
+	{
+		appendCreateBuffer(trackedBuffers[i]);
+	}
+
+	g_logger_info("Capturing %d frames of commands to '%s'.", numFrames, filename);
+}
+
+bool vkb_commandCapture_isActive()
+{
+	return capturing;
+}
+
+void vkb_commandCapture_beginRenderPass(const VkRenderPassBeginInfo& beginInfo)
+{
+	g_logger_assert(beginInfo.clearValueCount <= 2, "Captured render passes clear at most a color and a depth attachment.");
+
+	BeginRenderPassOp op = {};
+	op.renderPassKey = keyOf(VK_OBJECT_TYPE_RENDER_PASS, beginInfo.renderPass);
+	op.framebufferKey = keyOf(VK_OBJECT_TYPE_FRAMEBUFFER, beginInfo.framebuffer);
+	op.renderArea = beginInfo.renderArea;
+	op.clearValueCount = beginInfo.clearValueCount;
+	if (beginInfo.clearValueCount > 0)
+	{
+		memcpy(op.clearColor, beginInfo.pClearValues[0].color.float32, sizeof(op.clearColor));
+	}
+	if (beginInfo.clearValueCount > 1)
+	{
+		op.clearDepth = beginInfo.pClearValues[1].depthStencil.depth;
+	}
+	appendOp(vkb_CaptureOp::BeginRenderPass, &op);
+}
+
+void vkb_commandCapture_setViewport(const VkViewport& viewport)
+{
+	appendOp(vkb_CaptureOp::SetViewport, &viewport);
+}
+
+void vkb_commandCapture_setScissor(const VkRect2D& scissor)
+{
+	appendOp(vkb_CaptureOp::SetScissor, &scissor);
+}
+
+void vkb_commandCapture_bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline)
+{
+	BindPipelineOp op = { (uint32)bindPoint, keyOf(VK_OBJECT_TYPE_PIPELINE, pipeline) };
+	appendOp(vkb_CaptureOp::BindPipeline, &op);
+}
+
+void vkb_commandCapture_bindDescriptorSet(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32 set, VkDescriptorSet descriptorSet)
+{
+	BindDescriptorSetOp op = { (uint32)bindPoint, keyOf(VK_OBJECT_TYPE_PIPELINE_LAYOUT, layout), set, keyOf(VK_OBJECT_TYPE_DESCRIPTOR_SET, descriptorSet) };
+	appendOp(vkb_CaptureOp::BindDescriptorSet, &op);
+}
+
+void vkb_commandCapture_pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32 offset, uint32 size, const void* values)
+{
+	PushConstantsOp op = { keyOf(VK_OBJECT_TYPE_PIPELINE_LAYOUT, layout), stages, offset, size };
+	appendOp(vkb_CaptureOp::PushConstants, &op);
+	appendBytes(values, size);
+}
+
+void vkb_commandCapture_bindVertexBuffer(VkBuffer buffer, VkDeviceSize offset)
+{
+	BindBufferOp op = { keyOf(VK_OBJECT_TYPE_BUFFER, buffer), 0, offset };
+	appendOp(vkb_CaptureOp::BindVertexBuffer, &op);
+}
+
+void vkb_commandCapture_bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset)
+{
+	BindBufferOp op = { keyOf(VK_OBJECT_TYPE_BUFFER, buffer), 0, offset };
+	appendOp(vkb_CaptureOp::BindIndexBuffer, &op);
+}
+
+void vkb_commandCapture_draw(uint32 vertexCount, uint32 instanceCount, uint32 firstVertex, uint32 firstInstance)
+{
+	DrawOp op = { vertexCount, instanceCount, firstVertex, firstInstance };
+	appendOp(vkb_CaptureOp::Draw, &op);
+}
+
+void vkb_commandCapture_drawIndexed(uint32 indexCount, uint32 instanceCount, uint32 firstIndex, int32 vertexOffset, uint32 firstInstance)
+{
+	DrawIndexedOp op = { indexCount, instanceCount, firstIndex, vertexOffset, firstInstance };
+	appendOp(vkb_CaptureOp::DrawIndexed, &op);
+}
+
+void vkb_commandCapture_drawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32 drawCount, uint32 stride)
+{
+	DrawIndirectOp op = { keyOf(VK_OBJECT_TYPE_BUFFER, buffer), drawCount, offset, stride, 0 };
+	appendOp(vkb_CaptureOp::DrawIndirect, &op);
+}
+
+void vkb_commandCapture_dispatch(uint32 groupCountX, uint32 groupCountY, uint32 groupCountZ)
+{
+	DispatchOp op = { groupCountX, groupCountY, groupCountZ };
+	appendOp(vkb_CaptureOp::Dispatch, &op);
+}
+
+void vkb_commandCapture_dispatchIndirect(VkBuffer buffer, VkDeviceSize offset)
+{
+	BindBufferOp op = { keyOf(VK_OBJECT_TYPE_BUFFER, buffer), 0, offset };
+	appendOp(vkb_CaptureOp::DispatchIndirect, &op);
+}
+
+void vkb_commandCapture_copyBuffer(VkBuffer src, VkBuffer dst, const VkBufferCopy& region)
+{
+	CopyBufferOp op = { keyOf(VK_OBJECT_TYPE_BUFFER, src), keyOf(VK_OBJECT_TYPE_BUFFER, dst), region };
+	appendOp(vkb_CaptureOp::CopyBuffer, &op);
+}
+
+void vkb_commandCapture_fillBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, uint32 data)
+{
+	FillBufferOp op = { keyOf(VK_OBJECT_TYPE_BUFFER, buffer), data, offset, size };
+	appendOp(vkb_CaptureOp::FillBuffer, &op);
+}
+
+void vkb_commandCapture_cmdUpdateBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const void* data)
+{
+	UpdateBufferOp op = { keyOf(VK_OBJECT_TYPE_BUFFER, buffer), 0, offset, size };
+	appendOp(vkb_CaptureOp::CmdUpdateBuffer, &op);
+	appendBytes(data, (size_t)size);
+}
+
+void vkb_commandCapture_pipelineBarrier(VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages, VkDependencyFlags dependencyFlags,
+	uint32 numMemoryBarriers, const VkMemoryBarrier* memoryBarriers, uint32 numBufferBarriers, const VkBufferMemoryBarrier* bufferBarriers,
+	uint32 numImageBarriers, const VkImageMemoryBarrier* imageBarriers)
+{
+	PipelineBarrierOp op = { srcStages, dstStages, dependencyFlags, numMemoryBarriers, numBufferBarriers, numImageBarriers };
+	appendOp(vkb_CaptureOp::PipelineBarrier, &op);
+
+	for (uint32 i = 0; i < numMemoryBarriers; i++)
+	{
+		MemoryBarrierData barrier = { memoryBarriers[i].srcAccessMask, memoryBarriers[i].dstAccessMask };
+		appendBytes(&barrier, sizeof(barrier));
+	}
+	for (uint32 i = 0; i < numBufferBarriers; i++)
+	{
+		const VkBufferMemoryBarrier& src = bufferBarriers[i];
+		BufferBarrierData barrier = { src.srcAccessMask, src.dstAccessMask, src.srcQueueFamilyIndex, src.dstQueueFamilyIndex,
+			keyOf(VK_OBJECT_TYPE_BUFFER, src.buffer), 0, src.offset, src.size };
+		appendBytes(&barrier, sizeof(barrier));
+	}
+	for (uint32 i = 0; i < numImageBarriers; i++)
+	{
+		const VkImageMemoryBarrier& src = imageBarriers[i];
+		ImageBarrierData barrier = { src.srcAccessMask, src.dstAccessMask, (uint32)src.oldLayout, (uint32)src.newLayout,
+			src.srcQueueFamilyIndex, src.dstQueueFamilyIndex, keyOf(VK_OBJECT_TYPE_IMAGE, src.image), src.subresourceRange };
+		appendBytes(&barrier, sizeof(barrier));
+	}
+}
+
+void vkb_commandCapture_clearColorImage(VkImage image, VkImageLayout layout, const VkClearColorValue& color, const VkImageSubresourceRange& range)
+{
+	ClearColorImageOp op = { keyOf(VK_OBJECT_TYPE_IMAGE, image), (uint32)layout, color, range };
+	appendOp(vkb_CaptureOp::ClearColorImage, &op);
+}
+
+void vkb_commandCapture_copyBufferToImage(VkBuffer buffer, VkImage image, VkImageLayout layout, const VkBufferImageCopy& region)
+{
+	CopyBufferToImageOp op = { keyOf(VK_OBJECT_TYPE_BUFFER, buffer), keyOf(VK_OBJECT_TYPE_IMAGE, image), (uint32)layout, 0, region };
+	appendOp(vkb_CaptureOp::CopyBufferToImage, &op);
+}
+
+void vkb_commandCapture_blitImage(VkImage src, VkImageLayout srcLayout, VkImage dst, VkImageLayout dstLayout, const VkImageBlit& region, VkFilter filter)
+{
+	BlitImageOp op = { keyOf(VK_OBJECT_TYPE_IMAGE, src), (uint32)srcLayout, keyOf(VK_OBJECT_TYPE_IMAGE, dst), (uint32)dstLayout, (uint32)filter, region };
+	appendOp(vkb_CaptureOp::BlitImage, &op);
+}
+
+void vkb_commandCapture_endRenderPass()
+{
+	appendOp(vkb_CaptureOp::EndRenderPass, nullptr);
+}
+
+void vkb_commandCapture_endFrame()
+{
+	if (!capturing)
+	{
+		return;
+	}
+
+	appendOp(vkb_CaptureOp::EndFrame, nullptr);
+	framesLeft--;
+	if (framesLeft > 0)
+	{
+		return;
+	}
+
+	// Written on the render thread, a capture is a one off so the hitch is fine
+	capturing = false;
+	if (vkb_file_write(captureFilename, streamData, streamSize))
+	{
+		g_logger_info("Wrote command capture '%s' (%d bytes).", captureFilename, (int)streamSize);
+	}
+	else
+	{
+		g_logger_error("Failed to write command capture '%s'.", captureFilename);
+	}
+}
+
+void vkb_commandCapture_free()
+{
+	numTrackedBuffers = 0;
+	capturing = false;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	if (registeredObjects != nullptr)
+	{
+		g_memory_free(registeredObjects);
+		registeredObjects = nullptr;
+	}
+	numRegisteredObjects = 0;
+	registeredObjectsCapacity = 0;
+
+	if (streamData != nullptr)
+	{
+		g_memory_free(streamData);
+		streamData = nullptr;
+	}
+	streamSize = 0;
+	streamCapacity = 0;
+}
+
+vkb_CommandStream* vkb_commandStream_load(const char* filename)
+{
+	if (!vkb_file_exists(filename))
+	{
+		g_logger_error("Command capture '%s' doesn't exist.", filename);
+		return nullptr;
+	}
+
+	vkb_FileContents file = vkb_file_read(filename);
+	StreamHeader header = {};
+	if (file.size >= sizeof(header))
+	{
+		memcpy(&header, file.data, sizeof(header));
+	}
+	if (header.magic != streamMagic || header.version != streamVersion || header.numFrames == 0 ||
+		(uint64)file.size < sizeof(header) + (uint64)header.appStateSize)
+	{
+		g_logger_error("'%s' isn't a version %d command capture.", filename, streamVersion);
+		vkb_file_free(file);
+		return nullptr;
+	}
+
+	vkb_CommandStream* stream = (vkb_CommandStream*)g_memory_allocate(sizeof(vkb_CommandStream));
+	*stream = {};
+	stream->file = file;
+	stream->header = header;
+	stream->frameOffsets = (uint32*)g_memory_allocate(sizeof(uint32) * header.numFrames);
+
+	// One pass to find the frames and count the buffers, one to fill them in
+	uint32 firstOp = (uint32)sizeof(header) + header.appStateSize;
+	const uint8* end = file.data + file.size;
+	for (uint32 pass = 0; pass < 2; pass++)
+	{
+		const uint8* cursor = file.data + firstOp;
+		uint32 frame = 0;
+		uint32 numBuffers = 0;
+		stream->frameOffsets[0] = firstOp;
+
+		vkb_CaptureOp op;
+		const uint8* payload;
+		const uint8* data;
+		uint64 dataSize;
+		while (frame < header.numFrames && readOp(&cursor, end, &op, &payload, &data, &dataSize))
+		{
+			if (op == vkb_CaptureOp::CreateBuffer)
+			{
+				if (pass == 1)
+				{
+					CreateBufferOp create = readPayload<CreateBufferOp>(payload);
+					ReplayBuffer& buffer = stream->buffers[numBuffers];
+					buffer = {};
+					buffer.key = create.key;
+					buffer.usage = create.usage;
+					buffer.size = create.size;
+				}
+				numBuffers++;
+			}
+			else if (op == vkb_CaptureOp::EndFrame)
+			{
+				frame++;
+				if (frame < header.numFrames)
+				{
+					stream->frameOffsets[frame] = (uint32)(cursor - file.data);
+				}
+			}
+		}
+
+		if (frame < header.numFrames)
+		{
+			g_logger_error("'%s' is truncated, it ends in frame %d of %d.", filename, frame, header.numFrames);
+			vkb_commandStream_free(vkb_Context{}, stream);
+			return nullptr;
+		}
+
+		if (pass == 0)
+		{
+			stream->numBuffers = numBuffers;
+			stream->buffers = (ReplayBuffer*)g_memory_allocate(sizeof(ReplayBuffer) * (numBuffers > 0 ? numBuffers : 1));
+		}
+	}
+
+	return stream;
+}
+
+uint32 vkb_commandStream_getFrameCount(const vkb_CommandStream* stream)
+{
+	return stream->header.numFrames;
+}
+
+VkExtent2D vkb_commandStream_getExtent(const vkb_CommandStream* stream)
+{
+	return VkExtent2D{ stream->header.width, stream->header.height };
+}
+
+VkFormat vkb_commandStream_getColorFormat(const vkb_CommandStream* stream)
+{
+	return (VkFormat)stream->header.colorFormat;
+}
+
+const void* vkb_commandStream_getAppState(const vkb_CommandStream* stream, uint32* appStateSize)
+{
+	*appStateSize = stream->header.appStateSize;
+	return stream->file.data + sizeof(StreamHeader);
+}
+
+void vkb_commandStream_createResources(const vkb_Context& ctx, vkb_CommandStream* stream)
+{
+	for (uint32 i = 0; i < stream->numBuffers; i++)
+	{
+		ReplayBuffer& buffer = stream->buffers[i];
+		TrackedBuffer* tracked = findTrackedKey(buffer.key);
+		if (tracked != nullptr && tracked->size >= buffer.size)
+		{
+			buffer.buffer = tracked->buffer;
+			buffer.mapped = tracked->mapped;
+			continue;
+		}
+
+		buffer.ownedBuffer = vkb_buffer_create(ctx, buffer.size, buffer.usage,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		buffer.buffer = buffer.ownedBuffer.buffer;
+		buffer.mapped = (uint8*)buffer.ownedBuffer.mapped;
+	}
+}
+
+void vkb_commandStream_recordFrame(vkb_CommandStream* stream, uint32 frameIndex, VkCommandBuffer commandBuffer, const vkb_ReplayTarget& target, vkb_ReplayPipelineFn getPipeline, void* userData)
+{
+	g_logger_assert(frameIndex < stream->header.numFrames, "Frame %d is past the end of the command stream.", frameIndex);
+
+	const uint8* cursor = stream->file.data + stream->frameOffsets[frameIndex];
+	const uint8* end = stream->file.data + stream->file.size;
+	vkb_CaptureOp op;
+	const uint8* payload;
+	const uint8* data;
+	uint64 dataSize;
+	while (readOp(&cursor, end, &op, &payload, &data, &dataSize) && op != vkb_CaptureOp::EndFrame)
+	{
+		switch (op)
+		{
+		case vkb_CaptureOp::CreateBuffer:
+		{
+			// Created up front, this only restores the initial contents
+			CreateBufferOp create = readPayload<CreateBufferOp>(payload);
+			memcpy(replayBufferData(stream, create.key), data, (size_t)dataSize);
+			break;
+		}
+		case vkb_CaptureOp::UpdateBuffer:
+		{
+			UpdateBufferOp update = readPayload<UpdateBufferOp>(payload);
+			memcpy(replayBufferData(stream, update.key) + update.offset, data, (size_t)dataSize);
+			break;
+		}
+		case vkb_CaptureOp::BeginRenderPass:
+		{
+			BeginRenderPassOp begin = readPayload<BeginRenderPassOp>(payload);
+			VkClearValue clearValues[2] = {};
+			memcpy(clearValues[0].color.float32, begin.clearColor, sizeof(begin.clearColor));
+			clearValues[1].depthStencil = { begin.clearDepth, 0 };
+
+			VkRenderPassBeginInfo renderPassInfo = {};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			renderPassInfo.renderPass = isTargetKey(begin.renderPassKey) ? target.renderPass : (VkRenderPass)resolveKey(VK_OBJECT_TYPE_RENDER_PASS, begin.renderPassKey);
+			renderPassInfo.framebuffer = isTargetKey(begin.framebufferKey) ? target.framebuffer : (VkFramebuffer)resolveKey(VK_OBJECT_TYPE_FRAMEBUFFER, begin.framebufferKey);
+			renderPassInfo.renderArea = begin.renderArea;
+			renderPassInfo.clearValueCount = begin.clearValueCount;
+			renderPassInfo.pClearValues = clearValues;
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+			break;
+		}
+		case vkb_CaptureOp::SetViewport:
+		{
+			VkViewport viewport = readPayload<VkViewport>(payload);
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			break;
+		}
+		case vkb_CaptureOp::SetScissor:
+		{
+			VkRect2D scissor = readPayload<VkRect2D>(payload);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			break;
+		}
+		case vkb_CaptureOp::BindPipeline:
+		{
+			// Shader variants are created the first time a replay asks for them
+			BindPipelineOp bind = readPayload<BindPipelineOp>(payload);
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			if ((bind.key >> 24) == (uint32)vkb_CaptureOwner::ShaderVariants)
+			{
+				pipeline = getPipeline(bind.key & 0xFFFFFF, userData);
+			}
+			else
+			{
+				pipeline = (VkPipeline)resolveKey(VK_OBJECT_TYPE_PIPELINE, bind.key);
+			}
+			vkCmdBindPipeline(commandBuffer, (VkPipelineBindPoint)bind.bindPoint, pipeline);
+			break;
+		}
+		case vkb_CaptureOp::BindDescriptorSet:
+		{
+			BindDescriptorSetOp bind = readPayload<BindDescriptorSetOp>(payload);
+			VkPipelineLayout layout = (VkPipelineLayout)resolveKey(VK_OBJECT_TYPE_PIPELINE_LAYOUT, bind.layoutKey);
+			VkDescriptorSet set = (VkDescriptorSet)resolveKey(VK_OBJECT_TYPE_DESCRIPTOR_SET, bind.setKey);
+			vkCmdBindDescriptorSets(commandBuffer, (VkPipelineBindPoint)bind.bindPoint, layout, bind.set, 1, &set, 0, nullptr);
+			break;
+		}
+		case vkb_CaptureOp::PushConstants:
+		{
+			PushConstantsOp push = readPayload<PushConstantsOp>(payload);
+			VkPipelineLayout layout = (VkPipelineLayout)resolveKey(VK_OBJECT_TYPE_PIPELINE_LAYOUT, push.layoutKey);
+			vkCmdPushConstants(commandBuffer, layout, push.stages, push.offset, push.size, data);
+			break;
+		}
+		case vkb_CaptureOp::BindVertexBuffer:
+		{
+			BindBufferOp bind = readPayload<BindBufferOp>(payload);
+			VkBuffer buffer = resolveBuffer(stream, bind.key);
+			VkDeviceSize offset = bind.offset;
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer, &offset);
+			break;
+		}
+		case vkb_CaptureOp::BindIndexBuffer:
+		{
+			BindBufferOp bind = readPayload<BindBufferOp>(payload);
+			vkCmdBindIndexBuffer(commandBuffer, resolveBuffer(stream, bind.key), bind.offset, VK_INDEX_TYPE_UINT32);
+			break;
+		}
+		case vkb_CaptureOp::Draw:
+		{
+			DrawOp draw = readPayload<DrawOp>(payload);
+			vkCmdDraw(commandBuffer, draw.vertexCount, draw.instanceCount, draw.firstVertex, draw.firstInstance);
+			break;
+		}
+		case vkb_CaptureOp::DrawIndexed:
+		{
+			DrawIndexedOp draw = readPayload<DrawIndexedOp>(payload);
+			vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+			break;
+		}
+		case vkb_CaptureOp::DrawIndirect:
+		{
+			DrawIndirectOp draw = readPayload<DrawIndirectOp>(payload);
+			vkCmdDrawIndirect(commandBuffer, resolveBuffer(stream, draw.key), draw.offset, draw.drawCount, draw.stride);
+			break;
+		}
+		case vkb_CaptureOp::Dispatch:
+		{
+			DispatchOp dispatch = readPayload<DispatchOp>(payload);
+			vkCmdDispatch(commandBuffer, dispatch.groupCountX, dispatch.groupCountY, dispatch.groupCountZ);
+			break;
+		}
+		case vkb_CaptureOp::DispatchIndirect:
+		{
+			BindBufferOp dispatch = readPayload<BindBufferOp>(payload);
+			vkCmdDispatchIndirect(commandBuffer, resolveBuffer(stream, dispatch.key), dispatch.offset);
+			break;
+		}
+		case vkb_CaptureOp::CopyBuffer:
+		{
+			CopyBufferOp copy = readPayload<CopyBufferOp>(payload);
+			vkCmdCopyBuffer(commandBuffer, resolveBuffer(stream, copy.srcKey), resolveBuffer(stream, copy.dstKey), 1, &copy.region);
+			break;
+		}
+		case vkb_CaptureOp::FillBuffer:
+		{
+			FillBufferOp fill = readPayload<FillBufferOp>(payload);
+			vkCmdFillBuffer(commandBuffer, resolveBuffer(stream, fill.key), fill.offset, fill.size, fill.data);
+			break;
+		}
+		case vkb_CaptureOp::CmdUpdateBuffer:
+		{
+			UpdateBufferOp update = readPayload<UpdateBufferOp>(payload);
+			vkCmdUpdateBuffer(commandBuffer, resolveBuffer(stream, update.key), update.offset, update.size, data);
+			break;
+		}
+		case vkb_CaptureOp::PipelineBarrier:
+			recordBarrier(stream, commandBuffer, target, payload, data);
+			break;
+		case vkb_CaptureOp::ClearColorImage:
+		{
+			ClearColorImageOp clear = readPayload<ClearColorImageOp>(payload);
+			vkCmdClearColorImage(commandBuffer, resolveImage(clear.key, target), (VkImageLayout)clear.layout, &clear.color, 1, &clear.range);
+			break;
+		}
+		case vkb_CaptureOp::CopyBufferToImage:
+		{
+			CopyBufferToImageOp copy = readPayload<CopyBufferToImageOp>(payload);
+			vkCmdCopyBufferToImage(commandBuffer, resolveBuffer(stream, copy.bufferKey), resolveImage(copy.imageKey, target),
+				(VkImageLayout)copy.layout, 1, &copy.region);
+			break;
+		}
+		case vkb_CaptureOp::BlitImage:
+		{
+			BlitImageOp blit = readPayload<BlitImageOp>(payload);
+			vkCmdBlitImage(commandBuffer, resolveImage(blit.srcKey, target), (VkImageLayout)blit.srcLayout,
+				resolveImage(blit.dstKey, target), (VkImageLayout)blit.dstLayout, 1, &blit.region, (VkFilter)blit.filter);
+			break;
+		}
+		case vkb_CaptureOp::EndRenderPass:
+			vkCmdEndRenderPass(commandBuffer);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void vkb_commandStream_free(const vkb_Context& ctx, vkb_CommandStream* stream)
+{
+	for (uint32 i = 0; i < stream->numBuffers; i++)
+	{
+		if (stream->buffers[i].ownedBuffer.buffer != VK_NULL_HANDLE)
+		{
+			vkb_buffer_free(ctx, stream->buffers[i].ownedBuffer);
+		}
+	}
+
+	if (stream->buffers != nullptr)
+	{
+		g_memory_free(stream->buffers);
+	}
+	g_memory_free(stream->frameOffsets);
+	vkb_file_free(stream->file);
+	g_memory_free(stream);
+}
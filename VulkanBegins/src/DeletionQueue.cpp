@@ -0,0 +1,171 @@
+#include "VulkanBegins/DeletionQueue.h"
+#include "VulkanBegins/Context.h"
+
+#include <mutex>
+
+// ------------ Internal structures ------------
+struct PendingDeletion
+{
+	VkObjectType type;
+	uint64 handle;
+	uint64 retireValue;
+};
+
+// ------------ Internal Variables ------------
+static VkDevice device = VK_NULL_HANDLE;
+static const VkAllocationCallbacks* allocator = nullptr;
+
+static std::mutex queueMutex;
+static PendingDeletion* pending = nullptr;
+static uint32 numPending = 0;
+static uint32 pendingCapacity = 0;
+
+// ------------ Internal Functions ------------
+template<typename T>
+static T toHandle(uint64 handle)
+{
+	return (T)handle;
+}
+
+static void destroyObject(const PendingDeletion& object)
+{
+	switch (object.type)
+	{
+	case VK_OBJECT_TYPE_BUFFER:
+		vkDestroyBuffer(device, toHandle<VkBuffer>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_BUFFER_VIEW:
+		vkDestroyBufferView(device, toHandle<VkBufferView>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_IMAGE:
+		vkDestroyImage(device, toHandle<VkImage>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_IMAGE_VIEW:
+		vkDestroyImageView(device, toHandle<VkImageView>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_SAMPLER:
+		vkDestroySampler(device, toHandle<VkSampler>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_DEVICE_MEMORY:
+		vkFreeMemory(device, toHandle<VkDeviceMemory>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_SHADER_MODULE:
+		vkDestroyShaderModule(device, toHandle<VkShaderModule>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_PIPELINE:
+		vkDestroyPipeline(device, toHandle<VkPipeline>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+		vkDestroyPipelineLayout(device, toHandle<VkPipelineLayout>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_PIPELINE_CACHE:
+		vkDestroyPipelineCache(device, toHandle<VkPipelineCache>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_RENDER_PASS:
+		vkDestroyRenderPass(device, toHandle<VkRenderPass>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_FRAMEBUFFER:
+		vkDestroyFramebuffer(device, toHandle<VkFramebuffer>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT:
+		vkDestroyDescriptorSetLayout(device, toHandle<VkDescriptorSetLayout>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+		vkDestroyDescriptorPool(device, toHandle<VkDescriptorPool>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_COMMAND_POOL:
+		vkDestroyCommandPool(device, toHandle<VkCommandPool>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_SEMAPHORE:
+		vkDestroySemaphore(device, toHandle<VkSemaphore>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_FENCE:
+		vkDestroyFence(device, toHandle<VkFence>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_EVENT:
+		vkDestroyEvent(device, toHandle<VkEvent>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_QUERY_POOL:
+		vkDestroyQueryPool(device, toHandle<VkQueryPool>(object.handle), allocator);
+		break;
+	case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+		vkDestroySwapchainKHR(device, toHandle<VkSwapchainKHR>(object.handle), allocator);
+		break;
+	default:
+		g_logger_error("Deletion queue can't destroy objects of type %d, leaking it.", (int)object.type);
+		break;
+	}
+}
+
+// ------------ Public Functions ------------
+void vkb_deletionQueue_init(const vkb_Context& ctx, uint32 initialCapacity)
+{
+	device = ctx.device;
+	allocator = ctx.allocator;
+
+	pendingCapacity = initialCapacity > 0 ? initialCapacity : 1;
+	pending = (PendingDeletion*)g_memory_allocate(sizeof(PendingDeletion) * pendingCapacity);
+	numPending = 0;
+}
+
+void vkb_deletionQueue_push(VkObjectType type, uint64 handle, uint64 retireValue)
+{
+	if (handle == 0)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(queueMutex);
+	if (numPending == pendingCapacity)
+	{
+		pendingCapacity *= 2;
+		pending = (PendingDeletion*)g_memory_realloc(pending, sizeof(PendingDeletion) * pendingCapacity);
+	}
+
+	pending[numPending++] = { type, handle, retireValue };
+}
+
+uint32 vkb_deletionQueue_collect(uint64 completedValue)
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+
+	// Destroy in the order things were queued, compacting whatever is still in use
+	uint32 numKept = 0;
+	for (uint32 i = 0; i < numPending; i++)
+	{
+		if (pending[i].retireValue <= completedValue)
+		{
+			destroyObject(pending[i]);
+		}
+		else
+		{
+			pending[numKept++] = pending[i];
+		}
+	}
+
+	uint32 numDestroyed = numPending - numKept;
+	numPending = numKept;
+	return numDestroyed;
+}
+
+uint32 vkb_deletionQueue_flush()
+{
+	return vkb_deletionQueue_collect(UINT64_MAX);
+}
+
+uint32 vkb_deletionQueue_numPending()
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return numPending;
+}
+
+void vkb_deletionQueue_free()
+{
+	g_logger_assert(numPending == 0, "Deletion queue freed with %d objects still pending, flush it first.", numPending);
+
+	g_memory_free(pending);
+	pending = nullptr;
+	pendingCapacity = 0;
+	device = VK_NULL_HANDLE;
+	allocator = nullptr;
+}
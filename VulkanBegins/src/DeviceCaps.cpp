@@ -0,0 +1,302 @@
+#include "VulkanBegins/DeviceCaps.h"
+#include "VulkanBegins/File.h"
+
+#include <stdio.h>
+
+// ------------ Internal structures ------------
+struct DeviceCapsFileHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint32 vendorID;
+	uint32 deviceID;
+	uint32 driverVersion;
+	uint32 apiVersion;
+	uint8 pipelineCacheUUID[VK_UUID_SIZE];
+	uint32 queueFamilyCount;
+	uint32 extensionCount;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 deviceCapsMagic = 0x43424B56; // 'VKBC'
+static constexpr uint32 deviceCapsVersion = 1;
+
+// ------------ Internal Functions ------------
+static void getCacheFilename(const vkb_DeviceCaps& caps, const char* cacheDirectory, char* buffer, size_t bufferSize)
+{
+	snprintf(buffer, bufferSize, "%s/device_caps_%04x_%04x.bin", cacheDirectory, caps.properties.vendorID, caps.properties.deviceID);
+}
+
+static bool loadFromDisk(vkb_DeviceCaps& caps, const char* filename)
+{
+	if (!vkb_file_exists(filename))
+	{
+		return false;
+	}
+
+	vkb_FileContents file = vkb_file_read(filename);
+	if (file.data == nullptr || file.size < sizeof(DeviceCapsFileHeader))
+	{
+		vkb_file_free(file);
+		return false;
+	}
+
+	DeviceCapsFileHeader header;
+	memcpy(&header, file.data, sizeof(header));
+
+	size_t expectedSize = sizeof(DeviceCapsFileHeader) +
+		sizeof(VkPhysicalDeviceFeatures) +
+		sizeof(VkPhysicalDeviceMemoryProperties) +
+		sizeof(VkQueueFamilyProperties) * header.queueFamilyCount +
+		sizeof(VkExtensionProperties) * header.extensionCount;
+
+	bool matches = header.magic == deviceCapsMagic &&
+		header.version == deviceCapsVersion &&
+		header.vendorID == caps.properties.vendorID &&
+		header.deviceID == caps.properties.deviceID &&
+		header.driverVersion == caps.properties.driverVersion &&
+		header.apiVersion == caps.properties.apiVersion &&
+		memcmp(header.pipelineCacheUUID, caps.properties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+		file.size == expectedSize;
+	if (!matches)
+	{
+		vkb_file_free(file);
+		return false;
+	}
+
+	const uint8* cursor = file.data + sizeof(DeviceCapsFileHeader);
+	memcpy(&caps.features, cursor, sizeof(VkPhysicalDeviceFeatures));
+	cursor += sizeof(VkPhysicalDeviceFeatures);
+	memcpy(&caps.memoryProperties, cursor, sizeof(VkPhysicalDeviceMemoryProperties));
+	cursor += sizeof(VkPhysicalDeviceMemoryProperties);
+
+	caps.queueFamilyCount = header.queueFamilyCount;
+	caps.queueFamilies = (VkQueueFamilyProperties*)g_memory_allocate(sizeof(VkQueueFamilyProperties) * caps.queueFamilyCount);
+	memcpy(caps.queueFamilies, cursor, sizeof(VkQueueFamilyProperties) * caps.queueFamilyCount);
+	cursor += sizeof(VkQueueFamilyProperties) * caps.queueFamilyCount;
+
+	caps.extensionCount = header.extensionCount;
+	caps.extensions = (VkExtensionProperties*)g_memory_allocate(sizeof(VkExtensionProperties) * caps.extensionCount);
+	memcpy(caps.extensions, cursor, sizeof(VkExtensionProperties) * caps.extensionCount);
+
+	vkb_file_free(file);
+	return true;
+}
+
+static void saveToDisk(const vkb_DeviceCaps& caps, const char* filename)
+{
+	DeviceCapsFileHeader header = {};
+	header.magic = deviceCapsMagic;
+	header.version = deviceCapsVersion;
+	header.vendorID = caps.properties.vendorID;
+	header.deviceID = caps.properties.deviceID;
+	header.driverVersion = caps.properties.driverVersion;
+	header.apiVersion = caps.properties.apiVersion;
+	memcpy(header.pipelineCacheUUID, caps.properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.queueFamilyCount = caps.queueFamilyCount;
+	header.extensionCount = caps.extensionCount;
+
+	size_t fileSize = sizeof(DeviceCapsFileHeader) +
+		sizeof(VkPhysicalDeviceFeatures) +
+		sizeof(VkPhysicalDeviceMemoryProperties) +
+		sizeof(VkQueueFamilyProperties) * caps.queueFamilyCount +
+		sizeof(VkExtensionProperties) * caps.extensionCount;
+
+	uint8* data = (uint8*)g_memory_allocate(fileSize);
+	uint8* cursor = data;
+	memcpy(cursor, &header, sizeof(header));
+	cursor += sizeof(header);
+	memcpy(cursor, &caps.features, sizeof(VkPhysicalDeviceFeatures));
+	cursor += sizeof(VkPhysicalDeviceFeatures);
+	memcpy(cursor, &caps.memoryProperties, sizeof(VkPhysicalDeviceMemoryProperties));
+	cursor += sizeof(VkPhysicalDeviceMemoryProperties);
+	memcpy(cursor, caps.queueFamilies, sizeof(VkQueueFamilyProperties) * caps.queueFamilyCount);
+	cursor += sizeof(VkQueueFamilyProperties) * caps.queueFamilyCount;
+	memcpy(cursor, caps.extensions, sizeof(VkExtensionProperties) * caps.extensionCount);
+
+	vkb_file_write(filename, data, fileSize);
+	g_memory_free(data);
+}
+
+static void enumerate(vkb_DeviceCaps& caps)
+{
+	VkPhysicalDevice device = caps.physicalDevice;
+	vkGetPhysicalDeviceFeatures(device, &caps.features);
+	vkGetPhysicalDeviceMemoryProperties(device, &caps.memoryProperties);
+
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &caps.queueFamilyCount, nullptr);
+	caps.queueFamilies = (VkQueueFamilyProperties*)g_memory_allocate(sizeof(VkQueueFamilyProperties) * caps.queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &caps.queueFamilyCount, caps.queueFamilies);
+
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &caps.extensionCount, nullptr);
+	caps.extensions = (VkExtensionProperties*)g_memory_allocate(sizeof(VkExtensionProperties) * caps.extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &caps.extensionCount, caps.extensions);
+}
+
+static void querySurface(vkb_DeviceCaps& caps, VkSurfaceKHR surface)
+{
+	VkPhysicalDevice device = caps.physicalDevice;
+
+	caps.presentSupport = (VkBool32*)g_memory_allocate(sizeof(VkBool32) * caps.queueFamilyCount);
+	for (uint32 familyi = 0; familyi < caps.queueFamilyCount; familyi++)
+	{
+		caps.presentSupport[familyi] = VK_FALSE;
+		if (surface != VK_NULL_HANDLE)
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, familyi, surface, &caps.presentSupport[familyi]);
+		}
+	}
+
+	caps.surfaceCapabilities = {};
+	caps.surfaceFormatCount = 0;
+	caps.presentModeCount = 0;
+	caps.surfaceFormats = nullptr;
+	caps.presentModes = nullptr;
+
+	// Without VK_KHR_swapchain the surface queries are meaningless
+	if (surface == VK_NULL_HANDLE || !vkb_deviceCaps_hasExtension(caps, VK_KHR_SWAPCHAIN_EXTENSION_NAME))
+	{
+		return;
+	}
+
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &caps.surfaceCapabilities);
+
+	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &caps.surfaceFormatCount, nullptr);
+	if (caps.surfaceFormatCount != 0)
+	{
+		caps.surfaceFormats = (VkSurfaceFormatKHR*)g_memory_allocate(sizeof(VkSurfaceFormatKHR) * caps.surfaceFormatCount);
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &caps.surfaceFormatCount, caps.surfaceFormats);
+	}
+
+	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &caps.presentModeCount, nullptr);
+	if (caps.presentModeCount != 0)
+	{
+		caps.presentModes = (VkPresentModeKHR*)g_memory_allocate(sizeof(VkPresentModeKHR) * caps.presentModeCount);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &caps.presentModeCount, caps.presentModes);
+	}
+}
+
+static void pickQueueFamilies(vkb_DeviceCaps& caps, bool headless)
+{
+	// NOTE: We look for a queue family suitable to store graphics commands
+	// which is our requirements for a suitable device. The occlusion culler's
+	// pyramid build and cull dispatches, and the compute passes that came after
+	// it, are recorded into the same command buffers as the draws, so it needs
+	// compute too. Vulkan guarantees a family with both if there's one with graphics.
+	caps.graphicsFamily = NullQueueFamily;
+	caps.presentFamily = NullQueueFamily;
+
+	VkQueueFlags requiredFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+	for (uint32 familyi = 0; familyi < caps.queueFamilyCount; familyi++)
+	{
+		if ((caps.queueFamilies[familyi].queueFlags & requiredFlags) == requiredFlags)
+		{
+			caps.graphicsFamily = familyi;
+		}
+
+		if (caps.presentSupport[familyi])
+		{
+			caps.presentFamily = familyi;
+		}
+
+		if (caps.graphicsFamily != NullQueueFamily && caps.presentFamily != NullQueueFamily)
+		{
+			break;
+		}
+	}
+
+	if (headless)
+	{
+		caps.presentFamily = caps.graphicsFamily;
+	}
+}
+
+// ------------ Public Functions ------------
+vkb_DeviceCaps vkb_deviceCaps_query(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, const char* cacheDirectory)
+{
+	vkb_DeviceCaps caps = {};
+	caps.physicalDevice = physicalDevice;
+
+	// Properties are always queried, they're the key for the on-disk cache
+	vkGetPhysicalDeviceProperties(physicalDevice, &caps.properties);
+
+	char cacheFilename[512];
+	if (cacheDirectory != nullptr)
+	{
+		getCacheFilename(caps, cacheDirectory, cacheFilename, sizeof(cacheFilename));
+		caps.loadedFromDisk = loadFromDisk(caps, cacheFilename);
+	}
+
+	if (!caps.loadedFromDisk)
+	{
+		enumerate(caps);
+		if (cacheDirectory != nullptr)
+		{
+			saveToDisk(caps, cacheFilename);
+		}
+	}
+
+	querySurface(caps, surface);
+	pickQueueFamilies(caps, surface == VK_NULL_HANDLE);
+
+	return caps;
+}
+
+void vkb_deviceCaps_refreshSurfaceCapabilities(vkb_DeviceCaps& caps, VkSurfaceKHR surface)
+{
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(caps.physicalDevice, surface, &caps.surfaceCapabilities);
+}
+
+bool vkb_deviceCaps_hasExtension(const vkb_DeviceCaps& caps, const char* extensionName)
+{
+	for (uint32 i = 0; i < caps.extensionCount; i++)
+	{
+		if (strcmp(caps.extensions[i].extensionName, extensionName) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32 vkb_deviceCaps_findMemoryType(const vkb_DeviceCaps& caps, uint32 memoryTypeBits, VkMemoryPropertyFlags properties)
+{
+	for (uint32 i = 0; i < caps.memoryProperties.memoryTypeCount; i++)
+	{
+		if ((memoryTypeBits & (1 << i)) && (caps.memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+bool vkb_deviceCaps_supportsFormatFeatures(const vkb_DeviceCaps& caps, VkFormat format, VkFormatFeatureFlags optimalTilingFeatures)
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(caps.physicalDevice, format, &properties);
+	return (properties.optimalTilingFeatures & optimalTilingFeatures) == optimalTilingFeatures;
+}
+
+void vkb_deviceCaps_free(vkb_DeviceCaps& caps)
+{
+	void* arrays[] = {
+		caps.queueFamilies,
+		caps.extensions,
+		caps.presentSupport,
+		caps.surfaceFormats,
+		caps.presentModes
+	};
+
+	for (void* array : arrays)
+	{
+		if (array != nullptr)
+		{
+			g_memory_free(array);
+		}
+	}
+
+	caps = {};
+}
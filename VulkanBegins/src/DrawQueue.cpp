@@ -0,0 +1,368 @@
+#include "VulkanBegins/DrawQueue.h"
+#include "VulkanBegins/JobSystem.h"
+#include "VulkanBegins/Arena.h"
+#include "VulkanBegins/CommandStream.h"
+
+#include <string.h>
+
+// ------------ Internal structures ------------
+struct RadixPass
+{
+	const vkb_DrawSortEntry* src;
+	vkb_DrawSortEntry* dst;
+	uint32 count;
+	uint32 blockSize;
+	uint32 shift;
+	// radixSize counters per block. Histogram counts, then scatter offsets.
+	uint32* blockCounts;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 radixBits = 8;
+static constexpr uint32 radixSize = 1 << radixBits;
+static constexpr uint32 numRadixPasses = 64 / radixBits;
+// Below this the job overhead is more than the sort
+static constexpr uint32 minParallelCount = 16 * 1024;
+static constexpr uint32 minBlockSize = 4 * 1024;
+
+static constexpr uint32 passShift = 60;
+static constexpr uint32 pipelineShift = 48;
+static constexpr uint32 materialShift = 32;
+static constexpr uint32 meshShift = 16;
+
+// ------------ Internal Functions ------------
+static void histogramBlock(uint32 start, uint32 end, void* userData)
+{
+	RadixPass& pass = *(RadixPass*)userData;
+	uint32* counts = pass.blockCounts + (start / pass.blockSize) * radixSize;
+	for (uint32 i = 0; i < radixSize; i++)
+	{
+		counts[i] = 0;
+	}
+
+	for (uint32 i = start; i < end; i++)
+	{
+		counts[(pass.src[i].key >> pass.shift) & (radixSize - 1)]++;
+	}
+}
+
+static void scatterBlock(uint32 start, uint32 end, void* userData)
+{
+	RadixPass& pass = *(RadixPass*)userData;
+	uint32* offsets = pass.blockCounts + (start / pass.blockSize) * radixSize;
+	for (uint32 i = start; i < end; i++)
+	{
+		uint32 digit = (pass.src[i].key >> pass.shift) & (radixSize - 1);
+		pass.dst[offsets[digit]++] = pass.src[i];
+	}
+}
+
+static void runBlocks(RadixPass& pass, uint32 numBlocks, vkb_JobRangeFn fn)
+{
+	if (numBlocks == 1)
+	{
+		fn(0, pass.count, &pass);
+		return;
+	}
+
+	vkb_JobCounter counter = {};
+	vkb_jobs_parallelFor(pass.count, pass.blockSize, fn, &pass, &counter);
+	vkb_jobs_wait(&counter);
+}
+
+// Returns false if every key has the same digit, in which case nothing moved
+static bool radixPass(RadixPass& pass, uint32 numBlocks)
+{
+	runBlocks(pass, numBlocks, histogramBlock);
+
+	for (uint32 digit = 0; digit < radixSize; digit++)
+	{
+		uint32 total = 0;
+		for (uint32 block = 0; block < numBlocks; block++)
+		{
+			total += pass.blockCounts[block * radixSize + digit];
+		}
+
+		if (total == pass.count)
+		{
+			return false;
+		}
+	}
+
+	// Turn the per block counts into scatter offsets. Walking digits, then blocks
+	// in order keeps the sort stable.
+	uint32 offset = 0;
+	for (uint32 digit = 0; digit < radixSize; digit++)
+	{
+		for (uint32 block = 0; block < numBlocks; block++)
+		{
+			uint32& count = pass.blockCounts[block * radixSize + digit];
+			uint32 blockCount = count;
+			count = offset;
+			offset += blockCount;
+		}
+	}
+
+	runBlocks(pass, numBlocks, scatterBlock);
+	return true;
+}
+
+static uint32 quantizeDepth(float depth)
+{
+	if (!(depth > 0.0f))
+	{
+		return 0;
+	}
+	if (depth >= 1.0f)
+	{
+		return 0xFFFF;
+	}
+
+	return (uint32)(depth * 65535.0f);
+}
+
+// ------------ Public Functions ------------
+uint64 vkb_drawKey_make(uint32 pass, uint32 pipeline, uint32 material, uint32 mesh, float depth)
+{
+	g_logger_assert(pass < (1 << 4) && pipeline < (1 << 12) && material < (1 << 16) && mesh < (1 << 16),
+		"Draw key field out of range (pass %d, pipeline %d, material %d, mesh %d).", pass, pipeline, material, mesh);
+
+	return ((uint64)pass << passShift) |
+		((uint64)pipeline << pipelineShift) |
+		((uint64)material << materialShift) |
+		((uint64)mesh << meshShift) |
+		(uint64)quantizeDepth(depth);
+}
+
+vkb_DrawQueue vkb_drawQueue_create(uint32 initialCapacity)
+{
+	vkb_DrawQueue result = {};
+	result.capacity = initialCapacity > 0 ? initialCapacity : 1;
+	result.count = 0;
+	result.commands = (vkb_DrawCommand*)g_memory_allocate(sizeof(vkb_DrawCommand) * result.capacity);
+	result.entries = (vkb_DrawSortEntry*)g_memory_allocate(sizeof(vkb_DrawSortEntry) * result.capacity);
+	result.sortScratch = (vkb_DrawSortEntry*)g_memory_allocate(sizeof(vkb_DrawSortEntry) * result.capacity);
+	return result;
+}
+
+void vkb_drawQueue_clear(vkb_DrawQueue& queue)
+{
+	queue.count = 0;
+}
+
+void vkb_drawQueue_push(vkb_DrawQueue& queue, uint64 key, const vkb_DrawCommand& command)
+{
+	if (queue.count == queue.capacity)
+	{
+		queue.capacity *= 2;
+		queue.commands = (vkb_DrawCommand*)g_memory_realloc(queue.commands, sizeof(vkb_DrawCommand) * queue.capacity);
+		queue.entries = (vkb_DrawSortEntry*)g_memory_realloc(queue.entries, sizeof(vkb_DrawSortEntry) * queue.capacity);
+		queue.sortScratch = (vkb_DrawSortEntry*)g_memory_realloc(queue.sortScratch, sizeof(vkb_DrawSortEntry) * queue.capacity);
+	}
+
+	queue.commands[queue.count] = command;
+	queue.entries[queue.count].key = key;
+	queue.entries[queue.count].commandIndex = queue.count;
+	queue.count++;
+}
+
+void vkb_drawQueue_sort(vkb_DrawQueue& queue)
+{
+	if (queue.count < 2)
+	{
+		return;
+	}
+
+	uint32 numBlocks = 1;
+	if (queue.count >= minParallelCount)
+	{
+		numBlocks = vkb_jobs_numThreads() * 4;
+		uint32 maxBlocks = queue.count / minBlockSize;
+		numBlocks = numBlocks < maxBlocks ? numBlocks : maxBlocks;
+	}
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+
+	RadixPass pass = {};
+	pass.count = queue.count;
+	pass.blockSize = (queue.count + numBlocks - 1) / numBlocks;
+	numBlocks = (queue.count + pass.blockSize - 1) / pass.blockSize;
+	pass.blockCounts = vkb_arena_allocateArray<uint32>(vkb_scratch_get(), numBlocks * radixSize);
+
+	vkb_DrawSortEntry* src = queue.entries;
+	vkb_DrawSortEntry* dst = queue.sortScratch;
+	for (uint32 i = 0; i < numRadixPasses; i++)
+	{
+		pass.src = src;
+		pass.dst = dst;
+		pass.shift = i * radixBits;
+
+		// Depth and high key bits are often all the same, those passes are skipped
+		if (radixPass(pass, numBlocks))
+		{
+			vkb_DrawSortEntry* temp = src;
+			src = dst;
+			dst = temp;
+		}
+	}
+
+	vkb_scratch_end(scratch);
+
+	// Keep the sorted entries in queue.entries
+	if (src != queue.entries)
+	{
+		queue.sortScratch = queue.entries;
+		queue.entries = src;
+	}
+}
+
+void vkb_drawQueue_record(const vkb_DrawQueue& queue, VkCommandBuffer commandBuffer, vkb_DrawStats* stats)
+{
+	vkb_DrawStats localStats = {};
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+	VkDescriptorSet boundDescriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout pushedLayout = VK_NULL_HANDLE;
+	uint32 pushedConstants[vkb_drawPushConstantCount] = {};
+	VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+	VkDeviceSize boundVertexBufferOffset = 0;
+	VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+	bool capturing = vkb_commandCapture_isActive();
+
+	for (uint32 i = 0; i < queue.count; i++)
+	{
+		const vkb_DrawCommand& draw = queue.commands[queue.entries[i].commandIndex];
+
+		if (draw.pipeline != boundPipeline)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+			boundPipeline = draw.pipeline;
+			localStats.pipelineBinds++;
+			if (capturing)
+			{
+				vkb_commandCapture_bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+			}
+		}
+		else
+		{
+			localStats.pipelineBindsElided++;
+		}
+
+		if (draw.descriptorSet != VK_NULL_HANDLE)
+		{
+			// A set bound with a different layout isn't guaranteed to still be usable
+			if (draw.descriptorSet != boundDescriptorSet || draw.pipelineLayout != boundLayout)
+			{
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipelineLayout, 0, 1, &draw.descriptorSet, 0, nullptr);
+				boundDescriptorSet = draw.descriptorSet;
+				boundLayout = draw.pipelineLayout;
+				localStats.descriptorSetBinds++;
+				if (capturing)
+				{
+					vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipelineLayout, 0, draw.descriptorSet);
+				}
+			}
+			else
+			{
+				localStats.descriptorSetBindsElided++;
+			}
+		}
+
+		if (draw.pushConstantStages != 0)
+		{
+			// Push constants outlive pipeline binds as long as the layout stays the same
+			if (draw.pipelineLayout != pushedLayout || memcmp(draw.pushConstants, pushedConstants, sizeof(pushedConstants)) != 0)
+			{
+				vkCmdPushConstants(commandBuffer, draw.pipelineLayout, draw.pushConstantStages, 0, sizeof(draw.pushConstants), draw.pushConstants);
+				pushedLayout = draw.pipelineLayout;
+				memcpy(pushedConstants, draw.pushConstants, sizeof(pushedConstants));
+				localStats.pushConstantUpdates++;
+				if (capturing)
+				{
+					vkb_commandCapture_pushConstants(draw.pipelineLayout, draw.pushConstantStages, 0, sizeof(draw.pushConstants), draw.pushConstants);
+				}
+			}
+			else
+			{
+				localStats.pushConstantUpdatesElided++;
+			}
+		}
+
+		if (draw.vertexBuffer != VK_NULL_HANDLE)
+		{
+			if (draw.vertexBuffer != boundVertexBuffer || draw.vertexBufferOffset != boundVertexBufferOffset)
+			{
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &draw.vertexBuffer, &draw.vertexBufferOffset);
+				boundVertexBuffer = draw.vertexBuffer;
+				boundVertexBufferOffset = draw.vertexBufferOffset;
+				localStats.vertexBufferBinds++;
+				if (capturing)
+				{
+					vkb_commandCapture_bindVertexBuffer(draw.vertexBuffer, draw.vertexBufferOffset);
+				}
+			}
+			else
+			{
+				localStats.vertexBufferBindsElided++;
+			}
+		}
+
+		if (draw.indexBuffer != VK_NULL_HANDLE)
+		{
+			// Index buffers are 32-bit and bound at offset 0, draws select their range with firstIndex
+			if (draw.indexBuffer != boundIndexBuffer)
+			{
+				vkCmdBindIndexBuffer(commandBuffer, draw.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+				boundIndexBuffer = draw.indexBuffer;
+				localStats.indexBufferBinds++;
+				if (capturing)
+				{
+					vkb_commandCapture_bindIndexBuffer(draw.indexBuffer, 0);
+				}
+			}
+			else
+			{
+				localStats.indexBufferBindsElided++;
+			}
+
+			vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+			if (capturing)
+			{
+				vkb_commandCapture_drawIndexed(draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+			}
+		}
+		else
+		{
+			vkCmdDraw(commandBuffer, draw.vertexCount, draw.instanceCount, draw.firstVertex, draw.firstInstance);
+			if (capturing)
+			{
+				vkb_commandCapture_draw(draw.vertexCount, draw.instanceCount, draw.firstVertex, draw.firstInstance);
+			}
+		}
+		localStats.numDraws++;
+	}
+
+	if (stats != nullptr)
+	{
+		stats->numDraws += localStats.numDraws;
+		stats->pipelineBinds += localStats.pipelineBinds;
+		stats->pipelineBindsElided += localStats.pipelineBindsElided;
+		stats->descriptorSetBinds += localStats.descriptorSetBinds;
+		stats->descriptorSetBindsElided += localStats.descriptorSetBindsElided;
+		stats->pushConstantUpdates += localStats.pushConstantUpdates;
+		stats->pushConstantUpdatesElided += localStats.pushConstantUpdatesElided;
+		stats->vertexBufferBinds += localStats.vertexBufferBinds;
+		stats->vertexBufferBindsElided += localStats.vertexBufferBindsElided;
+		stats->indexBufferBinds += localStats.indexBufferBinds;
+		stats->indexBufferBindsElided += localStats.indexBufferBindsElided;
+	}
+}
+
+void vkb_drawQueue_free(vkb_DrawQueue& queue)
+{
+	g_memory_free(queue.commands);
+	g_memory_free(queue.entries);
+	g_memory_free(queue.sortScratch);
+	queue = {};
+}
@@ -0,0 +1,66 @@
+#include "VulkanBegins/DynamicResolution.h"
+
+#include <math.h>
+
+// ------------ Internal Variables ------------
+// Weight of the newest sample in the smoothed GPU time
+static constexpr float smoothing = 0.2f;
+// Only grow back once there's this much headroom, so the scale doesn't oscillate
+static constexpr float headroom = 0.85f;
+// Frames to let a new scale settle before judging it
+static constexpr uint32 settleFrames = 8;
+static constexpr float scaleStep = 1.0f / 32.0f;
+
+// ------------ Public Functions ------------
+vkb_DynamicResolutionConfig vkb_dynamicResolution_defaultConfig()
+{
+	vkb_DynamicResolutionConfig config = {};
+	config.targetFrameMs = 1000.0f / 60.0f;
+	config.minScale = 0.5f;
+	config.maxScale = 1.0f;
+	return config;
+}
+
+vkb_DynamicResolution vkb_dynamicResolution_create(const vkb_DynamicResolutionConfig& config)
+{
+	vkb_DynamicResolution result = {};
+	result.config = config;
+	result.scale = config.maxScale;
+	result.smoothedGpuMs = 0.0f;
+	result.framesSinceChange = 0;
+	return result;
+}
+
+float vkb_dynamicResolution_update(vkb_DynamicResolution& controller, float gpuFrameMs)
+{
+	const vkb_DynamicResolutionConfig& config = controller.config;
+
+	controller.smoothedGpuMs = controller.smoothedGpuMs == 0.0f
+		? gpuFrameMs
+		: controller.smoothedGpuMs + (gpuFrameMs - controller.smoothedGpuMs) * smoothing;
+
+	controller.framesSinceChange++;
+	if (controller.framesSinceChange < settleFrames)
+	{
+		return controller.scale;
+	}
+
+	// GPU time scales roughly with pixel count, which is the scale squared
+	float desired = controller.scale;
+	if (controller.smoothedGpuMs > config.targetFrameMs ||
+		controller.smoothedGpuMs < config.targetFrameMs * headroom)
+	{
+		desired = controller.scale * sqrtf(config.targetFrameMs * headroom / controller.smoothedGpuMs);
+	}
+
+	desired = floorf(desired / scaleStep + 0.5f) * scaleStep;
+	desired = desired < config.minScale ? config.minScale : (desired > config.maxScale ? config.maxScale : desired);
+
+	if (desired != controller.scale)
+	{
+		controller.scale = desired;
+		controller.framesSinceChange = 0;
+	}
+
+	return controller.scale;
+}
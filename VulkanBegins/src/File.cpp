@@ -41,4 +41,38 @@ void vkb_file_free(vkb_FileContents& fileContents)
 	}
 
 	fileContents.size = 0;
+}
+
+bool vkb_file_write(const char* filename, const void* data, size_t size)
+{
+	FILE* fp = fopen(filename, "wb");
+
+	if (fp == nullptr)
+	{
+		g_logger_error("Could not open file '%s' for writing", filename);
+		return false;
+	}
+
+	size_t written = fwrite(data, 1, size, fp);
+	fclose(fp);
+
+	if (written != size)
+	{
+		g_logger_error("Failed to write %d bytes to '%s'", (int)size, filename);
+		return false;
+	}
+
+	return true;
+}
+
+bool vkb_file_exists(const char* filename)
+{
+	FILE* fp = fopen(filename, "rb");
+	if (fp == nullptr)
+	{
+		return false;
+	}
+
+	fclose(fp);
+	return true;
 }
\ No newline at end of file
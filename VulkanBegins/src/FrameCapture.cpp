@@ -0,0 +1,424 @@
+#include "VulkanBegins/FrameCapture.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/DeviceCaps.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/JobSystem.h"
+#include "VulkanBegins/Arena.h"
+#include "VulkanBegins/File.h"
+
+#include <stdio.h>
+#include <atomic>
+
+#if __has_include(<stb_image_write.h>)
+#include <stb_image_write.h>
+#define VKB_HAS_STB_IMAGE_WRITE 1
+#else
+#define VKB_HAS_STB_IMAGE_WRITE 0
+#endif
+
+// ------------ Internal structures ------------
+enum SlotState : uint32
+{
+	SlotFree,
+	// Copy submitted, waiting for the frame to finish
+	SlotInFlight,
+	// Owned by a write job
+	SlotWriting
+};
+
+struct CaptureSlot
+{
+	vkb_Buffer buffer;
+	VkCommandBuffer commandBuffer;
+	uint32 width;
+	uint32 height;
+	uint64 frameSerial;
+	std::atomic<uint32> state;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 maxRingSize = 8;
+static constexpr uint32 bytesPerPixel = 4;
+
+static bool initialized = false;
+static VkDevice device = VK_NULL_HANDLE;
+static const VkAllocationCallbacks* allocator = nullptr;
+static vkb_Context captureContext;
+static vkb_FrameCaptureConfig captureConfig;
+static uint32 maxCaptureWidth;
+static uint32 maxCaptureHeight;
+static bool swizzleBgra;
+static bool memoryIsCoherent;
+
+static VkCommandPool commandPool = VK_NULL_HANDLE;
+static CaptureSlot slots[maxRingSize];
+static uint32 nextSlot = 0;
+static uint64 framesSeen = 0;
+
+static vkb_JobCounter writeCounter;
+static uint32 numCaptured = 0;
+static uint32 numDropped = 0;
+static std::atomic<uint32> numWritten;
+
+// ------------ Internal Functions ------------
+static void loadPixel(const uint8* pixel, uint8* r, uint8* g, uint8* b)
+{
+	*r = swizzleBgra ? pixel[2] : pixel[0];
+	*g = pixel[1];
+	*b = swizzleBgra ? pixel[0] : pixel[2];
+}
+
+static void writePng(const CaptureSlot& slot, const char* filename)
+{
+#if VKB_HAS_STB_IMAGE_WRITE
+	const uint8* src = (const uint8*)slot.buffer.mapped;
+	uint32 numPixels = slot.width * slot.height;
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	uint8* rgba = vkb_arena_allocateArray<uint8>(vkb_scratch_get(), numPixels * bytesPerPixel);
+	for (uint32 i = 0; i < numPixels; i++)
+	{
+		loadPixel(src + i * bytesPerPixel, &rgba[i * 4 + 0], &rgba[i * 4 + 1], &rgba[i * 4 + 2]);
+		rgba[i * 4 + 3] = 255;
+	}
+
+	if (!stbi_write_png(filename, (int)slot.width, (int)slot.height, 4, rgba, (int)(slot.width * 4)))
+	{
+		g_logger_error("Failed to write frame capture '%s'.", filename);
+	}
+	vkb_scratch_end(scratch);
+#else
+	(void)slot;
+	(void)filename;
+#endif
+}
+
+static uint8 clampToByte(int32 value)
+{
+	return (uint8)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+static void writeYuv420(const CaptureSlot& slot, const char* filename)
+{
+	const uint8* src = (const uint8*)slot.buffer.mapped;
+	uint32 width = slot.width;
+	uint32 height = slot.height;
+	uint32 chromaWidth = (width + 1) / 2;
+	uint32 chromaHeight = (height + 1) / 2;
+	uint32 lumaSize = width * height;
+	uint32 chromaSize = chromaWidth * chromaHeight;
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	uint8* yuv = vkb_arena_allocateArray<uint8>(vkb_scratch_get(), lumaSize + chromaSize * 2);
+	uint8* yPlane = yuv;
+	uint8* uPlane = yuv + lumaSize;
+	uint8* vPlane = uPlane + chromaSize;
+
+	// BT.601 limited range, chroma averaged over each 2x2 block
+	for (uint32 cy = 0; cy < chromaHeight; cy++)
+	{
+		for (uint32 cx = 0; cx < chromaWidth; cx++)
+		{
+			int32 sumR = 0, sumG = 0, sumB = 0, numSamples = 0;
+			for (uint32 dy = 0; dy < 2; dy++)
+			{
+				for (uint32 dx = 0; dx < 2; dx++)
+				{
+					uint32 x = cx * 2 + dx;
+					uint32 y = cy * 2 + dy;
+					if (x >= width || y >= height)
+					{
+						continue;
+					}
+
+					uint8 r, g, b;
+					loadPixel(src + (y * width + x) * bytesPerPixel, &r, &g, &b);
+					yPlane[y * width + x] = clampToByte(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+					sumR += r;
+					sumG += g;
+					sumB += b;
+					numSamples++;
+				}
+			}
+
+			int32 r = sumR / numSamples;
+			int32 g = sumG / numSamples;
+			int32 b = sumB / numSamples;
+			uPlane[cy * chromaWidth + cx] = clampToByte(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+			vPlane[cy * chromaWidth + cx] = clampToByte(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+		}
+	}
+
+	vkb_file_write(filename, yuv, lumaSize + chromaSize * 2);
+	vkb_scratch_end(scratch);
+}
+
+static void writeSlotJob(void* userData)
+{
+	CaptureSlot& slot = *(CaptureSlot*)userData;
+
+	char filename[512];
+	bool png = captureConfig.format == vkb_FrameCaptureFormat::PNG;
+	snprintf(filename, sizeof(filename), "%s/frame_%06llu.%s",
+		captureConfig.outputDirectory,
+		(unsigned long long)slot.frameSerial,
+		png ? "png" : "yuv");
+
+	if (png)
+	{
+		writePng(slot, filename);
+	}
+	else
+	{
+		writeYuv420(slot, filename);
+	}
+
+	numWritten.fetch_add(1, std::memory_order_relaxed);
+	slot.state.store(SlotFree, std::memory_order_release);
+}
+
+static void imageBarrier(VkCommandBuffer commandBuffer, VkImage image,
+	VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+	VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// ------------ Public Functions ------------
+vkb_FrameCaptureConfig vkb_frameCapture_defaultConfig()
+{
+	vkb_FrameCaptureConfig config = {};
+	config.outputDirectory = ".";
+	config.format = VKB_HAS_STB_IMAGE_WRITE ? vkb_FrameCaptureFormat::PNG : vkb_FrameCaptureFormat::YUV420;
+	config.everyNthFrame = 1;
+	config.ringSize = 4;
+	return config;
+}
+
+void vkb_frameCapture_init(const vkb_Context& ctx, const vkb_FrameCaptureConfig& config, uint32 maxWidth, uint32 maxHeight, VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		swizzleBgra = true;
+		break;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		swizzleBgra = false;
+		break;
+	default:
+		g_logger_warning("Frame capture doesn't support image format %d, capture is disabled.", (int)format);
+		return;
+	}
+
+	captureContext = ctx;
+	device = ctx.device;
+	allocator = ctx.allocator;
+	captureConfig = config;
+	captureConfig.everyNthFrame = config.everyNthFrame > 0 ? config.everyNthFrame : 1;
+	captureConfig.ringSize = config.ringSize < 1 ? 1 : (config.ringSize > maxRingSize ? maxRingSize : config.ringSize);
+	maxCaptureWidth = maxWidth;
+	maxCaptureHeight = maxHeight;
+
+	if (captureConfig.format == vkb_FrameCaptureFormat::PNG && !VKB_HAS_STB_IMAGE_WRITE)
+	{
+		g_logger_warning("stb_image_write.h isn't available, capturing frames as YUV420 instead of PNG.");
+		captureConfig.format = vkb_FrameCaptureFormat::YUV420;
+	}
+
+	// Cached memory makes the CPU side reads much faster, it just needs an invalidate
+	VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	if (vkb_deviceCaps_findMemoryType(*ctx.caps, UINT32_MAX, memoryProperties) == UINT32_MAX)
+	{
+		memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	}
+	uint32 memoryType = vkb_deviceCaps_findMemoryType(*ctx.caps, UINT32_MAX, memoryProperties);
+	memoryIsCoherent = (ctx.caps->memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = ctx.graphicsFamily;
+	uint32 res = vkCreateCommandPool(device, &poolInfo, allocator, &commandPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create frame capture command pool.");
+
+	VkDeviceSize bufferSize = (VkDeviceSize)maxWidth * maxHeight * bytesPerPixel;
+	for (uint32 i = 0; i < captureConfig.ringSize; i++)
+	{
+		CaptureSlot& slot = slots[i];
+		slot.buffer = vkb_buffer_create(ctx, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryProperties);
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		res = vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffer);
+		g_logger_assert(res == VK_SUCCESS, "Failed to allocate frame capture command buffer.");
+
+		slot.state.store(SlotFree, std::memory_order_relaxed);
+	}
+
+	nextSlot = 0;
+	framesSeen = 0;
+	numCaptured = 0;
+	numDropped = 0;
+	numWritten.store(0, std::memory_order_relaxed);
+	writeCounter.value.store(0, std::memory_order_relaxed);
+	initialized = true;
+
+	g_logger_info("Capturing every %d frame(s) to '%s' as %s.",
+		captureConfig.everyNthFrame,
+		captureConfig.outputDirectory,
+		captureConfig.format == vkb_FrameCaptureFormat::PNG ? "PNG" : "YUV420");
+}
+
+VkCommandBuffer vkb_frameCapture_record(VkImage image, VkImageLayout imageLayout, VkExtent2D extent, uint64 frameSerial)
+{
+	if (!initialized || (framesSeen++ % captureConfig.everyNthFrame) != 0)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	if (extent.width > maxCaptureWidth || extent.height > maxCaptureHeight)
+	{
+		numDropped++;
+		return VK_NULL_HANDLE;
+	}
+
+	// Never wait for a slot, a dropped capture is better than a dropped frame
+	CaptureSlot& slot = slots[nextSlot];
+	if (slot.state.load(std::memory_order_acquire) != SlotFree)
+	{
+		numDropped++;
+		return VK_NULL_HANDLE;
+	}
+	nextSlot = (nextSlot + 1) % captureConfig.ringSize;
+
+	slot.width = extent.width;
+	slot.height = extent.height;
+	slot.frameSerial = frameSerial;
+	slot.state.store(SlotInFlight, std::memory_order_relaxed);
+	numCaptured++;
+
+	VkCommandBuffer commandBuffer = slot.commandBuffer;
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	uint32 res = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	g_logger_assert(res == VK_SUCCESS, "Failed to begin frame capture command buffer.");
+
+	imageBarrier(commandBuffer, image, imageLayout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { extent.width, extent.height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer.buffer, 1, &region);
+
+	if (imageLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+	{
+		imageBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, imageLayout,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+	}
+
+	VkBufferMemoryBarrier hostBarrier = {};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = slot.buffer.buffer;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+	res = vkEndCommandBuffer(commandBuffer);
+	g_logger_assert(res == VK_SUCCESS, "Failed to end frame capture command buffer.");
+
+	return commandBuffer;
+}
+
+void vkb_frameCapture_collect(uint64 completedSerial)
+{
+	if (!initialized)
+	{
+		return;
+	}
+
+	for (uint32 i = 0; i < captureConfig.ringSize; i++)
+	{
+		CaptureSlot& slot = slots[i];
+		if (slot.state.load(std::memory_order_acquire) != SlotInFlight || slot.frameSerial > completedSerial)
+		{
+			continue;
+		}
+
+		if (!memoryIsCoherent)
+		{
+			VkMappedMemoryRange range = {};
+			range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range.memory = slot.buffer.memory;
+			range.offset = 0;
+			range.size = VK_WHOLE_SIZE;
+			vkInvalidateMappedMemoryRanges(device, 1, &range);
+		}
+
+		slot.state.store(SlotWriting, std::memory_order_relaxed);
+		vkb_jobs_run(writeSlotJob, &slot, &writeCounter);
+	}
+}
+
+vkb_FrameCaptureStats vkb_frameCapture_getStats()
+{
+	vkb_FrameCaptureStats stats = {};
+	stats.numCaptured = numCaptured;
+	stats.numWritten = numWritten.load(std::memory_order_relaxed);
+	stats.numDropped = numDropped;
+	return stats;
+}
+
+void vkb_frameCapture_free()
+{
+	if (!initialized)
+	{
+		return;
+	}
+
+	// The device is idle, so whatever is still in flight is done
+	vkb_frameCapture_collect(UINT64_MAX);
+	vkb_jobs_wait(&writeCounter);
+
+	g_logger_info("Frame capture wrote %d of %d captured frames, %d dropped.",
+		numWritten.load(std::memory_order_relaxed), numCaptured, numDropped);
+
+	for (uint32 i = 0; i < captureConfig.ringSize; i++)
+	{
+		vkb_buffer_free(captureContext, slots[i].buffer);
+	}
+	vkDestroyCommandPool(device, commandPool, allocator);
+	commandPool = VK_NULL_HANDLE;
+	initialized = false;
+}
@@ -0,0 +1,84 @@
+#include "VulkanBegins/FramePacket.h"
+
+// ------------ Internal Variables ------------
+static constexpr uint32 indexMask = 0x3;
+static constexpr uint32 newPacketBit = 0x4;
+
+// ------------ Public Functions ------------
+void vkb_framePacket_init(vkb_FramePacketBuffer& buffer)
+{
+	for (uint32 i = 0; i < 3; i++)
+	{
+		buffer.packets[i] = {};
+	}
+
+	buffer.writeIndex = 0;
+	buffer.middle.store(1, std::memory_order_relaxed);
+	buffer.readIndex = 2;
+	buffer.closed = false;
+}
+
+vkb_FramePacket& vkb_framePacket_beginWrite(vkb_FramePacketBuffer& buffer)
+{
+	return buffer.packets[buffer.writeIndex];
+}
+
+void vkb_framePacket_publish(vkb_FramePacketBuffer& buffer)
+{
+	// Release makes the packet's contents visible before its index is
+	uint32 previous = buffer.middle.exchange(buffer.writeIndex | newPacketBit, std::memory_order_acq_rel);
+	buffer.writeIndex = previous & indexMask;
+
+	// Taking the mutex orders this after a waiting consumer's check, so the
+	// notification can't slip in between its check and its sleep
+	{
+		std::lock_guard<std::mutex> lock(buffer.waitMutex);
+	}
+	buffer.published.notify_one();
+}
+
+void vkb_framePacket_waitTaken(vkb_FramePacketBuffer& buffer)
+{
+	std::unique_lock<std::mutex> lock(buffer.waitMutex);
+	buffer.taken.wait(lock, [&buffer]() { return buffer.closed || !vkb_framePacket_isPending(buffer); });
+}
+
+void vkb_framePacket_close(vkb_FramePacketBuffer& buffer)
+{
+	{
+		std::lock_guard<std::mutex> lock(buffer.waitMutex);
+		buffer.closed = true;
+	}
+	buffer.published.notify_one();
+	buffer.taken.notify_one();
+}
+
+bool vkb_framePacket_isPending(const vkb_FramePacketBuffer& buffer)
+{
+	return (buffer.middle.load(std::memory_order_acquire) & newPacketBit) != 0;
+}
+
+const vkb_FramePacket* vkb_framePacket_acquireLatest(vkb_FramePacketBuffer& buffer)
+{
+	if (!vkb_framePacket_isPending(buffer))
+	{
+		return nullptr;
+	}
+
+	uint32 previous = buffer.middle.exchange(buffer.readIndex, std::memory_order_acq_rel);
+	buffer.readIndex = previous & indexMask;
+
+	// Same as publish, a producer between its check and its sleep can't miss this
+	{
+		std::lock_guard<std::mutex> lock(buffer.waitMutex);
+	}
+	buffer.taken.notify_one();
+	return &buffer.packets[buffer.readIndex];
+}
+
+bool vkb_framePacket_wait(vkb_FramePacketBuffer& buffer)
+{
+	std::unique_lock<std::mutex> lock(buffer.waitMutex);
+	buffer.published.wait(lock, [&buffer]() { return buffer.closed || vkb_framePacket_isPending(buffer); });
+	return !buffer.closed;
+}
@@ -0,0 +1,83 @@
+#include "VulkanBegins/GpuTimer.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/DeviceCaps.h"
+
+// ------------ Public Functions ------------
+vkb_GpuTimer vkb_gpuTimer_create(const vkb_Context& ctx, uint32 numScopes)
+{
+	vkb_GpuTimer result = {};
+	result.numScopes = numScopes;
+
+	uint32 validBits = ctx.caps->queueFamilies[ctx.graphicsFamily].timestampValidBits;
+	result.timestampPeriodNs = ctx.caps->properties.limits.timestampPeriod;
+	if (validBits == 0 || result.timestampPeriodNs <= 0.0f)
+	{
+		g_logger_warning("The graphics queue doesn't support timestamps, GPU timings are unavailable.");
+		return result;
+	}
+	result.timestampMask = validBits >= 64 ? UINT64_MAX : ((uint64)1 << validBits) - 1;
+
+	VkQueryPoolCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	createInfo.queryCount = numScopes * 2;
+
+	uint32 res = vkCreateQueryPool(ctx.device, &createInfo, ctx.allocator, &result.queryPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create timestamp query pool.");
+
+	result.supported = true;
+	return result;
+}
+
+void vkb_gpuTimer_reset(const vkb_GpuTimer& timer, VkCommandBuffer commandBuffer)
+{
+	if (timer.supported)
+	{
+		vkCmdResetQueryPool(commandBuffer, timer.queryPool, 0, timer.numScopes * 2);
+	}
+}
+
+void vkb_gpuTimer_begin(const vkb_GpuTimer& timer, VkCommandBuffer commandBuffer, uint32 scope)
+{
+	if (timer.supported)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timer.queryPool, scope * 2);
+	}
+}
+
+void vkb_gpuTimer_end(const vkb_GpuTimer& timer, VkCommandBuffer commandBuffer, uint32 scope)
+{
+	if (timer.supported)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timer.queryPool, scope * 2 + 1);
+	}
+}
+
+bool vkb_gpuTimer_read(const vkb_Context& ctx, const vkb_GpuTimer& timer, uint32 scope, float* milliseconds)
+{
+	if (!timer.supported)
+	{
+		return false;
+	}
+
+	uint64 timestamps[2];
+	VkResult res = vkGetQueryPoolResults(ctx.device, timer.queryPool, scope * 2, 2,
+		sizeof(timestamps), timestamps, sizeof(uint64), VK_QUERY_RESULT_64_BIT);
+	if (res != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	uint64 elapsed = ((timestamps[1] & timer.timestampMask) - (timestamps[0] & timer.timestampMask)) & timer.timestampMask;
+	*milliseconds = (float)((double)elapsed * timer.timestampPeriodNs / 1000000.0);
+	return true;
+}
+
+void vkb_gpuTimer_free(const vkb_Context& ctx, vkb_GpuTimer& timer)
+{
+	if (timer.supported)
+	{
+		vkDestroyQueryPool(ctx.device, timer.queryPool, ctx.allocator);
+	}
+	timer = {};
+}
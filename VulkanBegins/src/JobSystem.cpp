@@ -0,0 +1,424 @@
+#include "VulkanBegins/JobSystem.h"
+#include "VulkanBegins/Arena.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
+// ------------ Internal structures ------------
+struct Job
+{
+	vkb_JobFn fn;
+	vkb_JobRangeFn rangeFn;
+	void* userData;
+	uint32 start;
+	uint32 end;
+	vkb_JobCounter* counter;
+};
+
+static constexpr uint32 maxThreads = 64;
+// Jobs queued on a full deque run inline instead
+static constexpr uint32 dequeCapacity = 4096;
+
+// Chase-Lev work-stealing deque, following "Correct and Efficient Work-Stealing
+// for Weak Memory Models" (Le et al. 2013)
+struct WorkerDeque
+{
+	alignas(64) std::atomic<int64> top;
+	alignas(64) std::atomic<int64> bottom;
+	Job jobs[dequeCapacity];
+	uint32 stealSeed;
+};
+
+// Returns the calling thread's deque to the pool when the thread exits
+struct ThreadDeque
+{
+	int32 index = -1;
+	uint32 generation = 0;
+
+	~ThreadDeque();
+};
+
+// ------------ Internal Variables ------------
+static WorkerDeque* deques = nullptr;
+// Bit i is set while a thread owns deque i
+static std::atomic<uint64> usedDeques;
+// One past the highest deque ever handed out, thieves look at that many
+static std::atomic<uint32> numDeques;
+static uint32 generation = 0;
+
+static std::thread* workers = nullptr;
+static uint32 numWorkers = 0;
+static std::atomic<bool> running;
+// Workers at or past this index sleep instead of picking up jobs
+static std::atomic<uint32> activeWorkers;
+
+// Idle workers sleep here instead of spinning
+static std::mutex sleepMutex;
+static std::condition_variable sleepCv;
+static std::atomic<uint32> numSleeping;
+static std::atomic<uint32> numQueued;
+
+static thread_local ThreadDeque threadDeque;
+
+// ------------ Internal Functions ------------
+ThreadDeque::~ThreadDeque()
+{
+	// Deques of an earlier vkb_jobs_init were already reclaimed by the next one.
+	// Jobs still queued on it stay stealable and go to the next owner.
+	if (index >= 0 && generation == ::generation && deques != nullptr)
+	{
+		usedDeques.fetch_and(~(1ull << index), std::memory_order_release);
+	}
+}
+
+static uint32 registerThread()
+{
+	if (threadDeque.index < 0 || threadDeque.generation != generation)
+	{
+		// Lowest free deque, so threads that come and go keep reusing the same few
+		uint64 used = usedDeques.load(std::memory_order_relaxed);
+		uint32 index;
+		do
+		{
+			g_logger_assert(used != UINT64_MAX, "More than %d threads submitted jobs at once.", maxThreads);
+			index = 0;
+			while ((used & (1ull << index)) != 0)
+			{
+				index++;
+			}
+		} while (!usedDeques.compare_exchange_weak(used, used | (1ull << index), std::memory_order_acquire, std::memory_order_relaxed));
+
+		uint32 count = numDeques.load(std::memory_order_relaxed);
+		while (count <= index && !numDeques.compare_exchange_weak(count, index + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+		}
+
+		threadDeque.index = (int32)index;
+		threadDeque.generation = generation;
+		deques[index].stealSeed = index * 2654435761u + 1;
+	}
+
+	return (uint32)threadDeque.index;
+}
+
+static bool push(WorkerDeque& deque, const Job& job)
+{
+	int64 b = deque.bottom.load(std::memory_order_relaxed);
+	int64 t = deque.top.load(std::memory_order_acquire);
+	if (b - t >= (int64)dequeCapacity)
+	{
+		return false;
+	}
+
+	deque.jobs[b & (dequeCapacity - 1)] = job;
+	std::atomic_thread_fence(std::memory_order_release);
+	deque.bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+// Taken jobs are copied out, their slot can be reused by the next push
+static bool pop(WorkerDeque& deque, Job* out)
+{
+	int64 b = deque.bottom.load(std::memory_order_relaxed) - 1;
+	deque.bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64 t = deque.top.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		deque.bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	*out = deque.jobs[b & (dequeCapacity - 1)];
+	if (t == b)
+	{
+		// Last job in the deque, race any thieves for it
+		bool won = deque.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		deque.bottom.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+
+	return true;
+}
+
+static bool steal(WorkerDeque& deque, Job* out)
+{
+	int64 t = deque.top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64 b = deque.bottom.load(std::memory_order_acquire);
+
+	if (t >= b)
+	{
+		return false;
+	}
+
+	// Copy before claiming it, once top moves the owner is free to overwrite the slot
+	*out = deque.jobs[t & (dequeCapacity - 1)];
+	return deque.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+static bool findJob(uint32 dequeIndex, Job* out)
+{
+	WorkerDeque& own = deques[dequeIndex];
+	if (pop(own, out))
+	{
+		return true;
+	}
+
+	// Start stealing from a random victim so thieves don't all pile onto the same deque
+	uint32 count = numDeques.load(std::memory_order_acquire);
+	own.stealSeed ^= own.stealSeed << 13;
+	own.stealSeed ^= own.stealSeed >> 17;
+	own.stealSeed ^= own.stealSeed << 5;
+	uint32 start = own.stealSeed % count;
+	for (uint32 i = 0; i < count; i++)
+	{
+		uint32 victim = (start + i) % count;
+		if (victim == dequeIndex)
+		{
+			continue;
+		}
+
+		if (steal(deques[victim], out))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void execute(const Job& job)
+{
+	if (job.rangeFn != nullptr)
+	{
+		job.rangeFn(job.start, job.end, job.userData);
+	}
+	else
+	{
+		job.fn(job.userData);
+	}
+
+	if (job.counter != nullptr)
+	{
+		job.counter->value.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
+
+static void submit(const Job& job)
+{
+	g_logger_assert(deques != nullptr, "Job system used before vkb_jobs_init.");
+
+	if (job.counter != nullptr)
+	{
+		job.counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	WorkerDeque& deque = deques[registerThread()];
+	numQueued.fetch_add(1, std::memory_order_seq_cst);
+	if (!push(deque, job))
+	{
+		numQueued.fetch_sub(1, std::memory_order_relaxed);
+		execute(job);
+		return;
+	}
+
+	if (numSleeping.load(std::memory_order_seq_cst) > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		// An inactive worker woken in place of an active one would go straight
+		// back to sleep and swallow the notification
+		if (activeWorkers.load(std::memory_order_relaxed) < numWorkers)
+		{
+			sleepCv.notify_all();
+		}
+		else
+		{
+			sleepCv.notify_one();
+		}
+	}
+}
+
+static void workerLoop(uint32 workerIndex)
+{
+	uint32 dequeIndex = registerThread();
+	uint32 idleSpins = 0;
+
+	while (running.load(std::memory_order_acquire))
+	{
+		bool active = workerIndex < activeWorkers.load(std::memory_order_acquire);
+		Job job;
+		if (active && findJob(dequeIndex, &job))
+		{
+			numQueued.fetch_sub(1, std::memory_order_relaxed);
+			execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (active && ++idleSpins < 64)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		numSleeping.fetch_add(1, std::memory_order_seq_cst);
+		sleepCv.wait(lock, [workerIndex]() {
+			bool hasWork = numQueued.load(std::memory_order_seq_cst) > 0 && workerIndex < activeWorkers.load(std::memory_order_acquire);
+			return hasWork || !running.load(std::memory_order_acquire);
+			});
+		numSleeping.fetch_sub(1, std::memory_order_seq_cst);
+		idleSpins = 0;
+	}
+
+	vkb_scratch_free();
+}
+
+// ------------ Public Functions ------------
+void vkb_jobs_init(int32 requestedWorkers)
+{
+	g_logger_assert(deques == nullptr, "Job system is already initialized.");
+
+	uint32 workerCount = (uint32)requestedWorkers;
+	if (requestedWorkers < 0)
+	{
+		uint32 hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	// Leave deques for threads that submit jobs without being workers
+	if (workerCount > maxThreads / 2)
+	{
+		workerCount = maxThreads / 2;
+	}
+
+	deques = (WorkerDeque*)g_memory_allocate(sizeof(WorkerDeque) * maxThreads);
+	for (uint32 i = 0; i < maxThreads; i++)
+	{
+		WorkerDeque& deque = deques[i];
+		new(&deque.top)std::atomic<int64>(0);
+		new(&deque.bottom)std::atomic<int64>(0);
+		deque.stealSeed = 1;
+	}
+
+	generation++;
+	usedDeques.store(0, std::memory_order_relaxed);
+	numDeques.store(0, std::memory_order_relaxed);
+	numSleeping.store(0, std::memory_order_relaxed);
+	numQueued.store(0, std::memory_order_relaxed);
+	running.store(true, std::memory_order_release);
+
+	// The initializing thread is always deque 0
+	registerThread();
+
+	numWorkers = workerCount;
+	activeWorkers.store(workerCount, std::memory_order_release);
+	workers = (std::thread*)g_memory_allocate(sizeof(std::thread) * numWorkers);
+	for (uint32 i = 0; i < numWorkers; i++)
+	{
+		new(&workers[i])std::thread(workerLoop, i);
+	}
+}
+
+void vkb_jobs_run(vkb_JobFn fn, void* userData, vkb_JobCounter* counter)
+{
+	Job job = {};
+	job.fn = fn;
+	job.userData = userData;
+	job.counter = counter;
+	submit(job);
+}
+
+void vkb_jobs_parallelFor(uint32 count, uint32 batchSize, vkb_JobRangeFn fn, void* userData, vkb_JobCounter* counter)
+{
+	if (batchSize == 0)
+	{
+		batchSize = 1;
+	}
+
+	for (uint32 start = 0; start < count; start += batchSize)
+	{
+		Job job = {};
+		job.rangeFn = fn;
+		job.userData = userData;
+		job.start = start;
+		job.end = start + batchSize < count ? start + batchSize : count;
+		job.counter = counter;
+		submit(job);
+	}
+}
+
+void vkb_jobs_wait(vkb_JobCounter* counter)
+{
+	while (counter->value.load(std::memory_order_acquire) != 0)
+	{
+		if (!vkb_jobs_runPending())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool vkb_jobs_runPending()
+{
+	Job job;
+	if (!findJob(registerThread(), &job))
+	{
+		return false;
+	}
+
+	numQueued.fetch_sub(1, std::memory_order_relaxed);
+	execute(job);
+	return true;
+}
+
+void vkb_jobs_setActiveWorkers(uint32 count)
+{
+	count = count < numWorkers ? count : numWorkers;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		activeWorkers.store(count, std::memory_order_release);
+	}
+	sleepCv.notify_all();
+}
+
+uint32 vkb_jobs_numThreads()
+{
+	return numWorkers + 1;
+}
+
+uint32 vkb_jobs_threadIndex()
+{
+	return registerThread();
+}
+
+void vkb_jobs_free()
+{
+	if (deques == nullptr)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running.store(false, std::memory_order_release);
+	}
+	sleepCv.notify_all();
+
+	for (uint32 i = 0; i < numWorkers; i++)
+	{
+		workers[i].join();
+		workers[i].~thread();
+	}
+	g_memory_free(workers);
+	workers = nullptr;
+	numWorkers = 0;
+
+	g_memory_free(deques);
+	deques = nullptr;
+}
@@ -0,0 +1,383 @@
+#include "VulkanBegins/LogSink.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+
+// ------------ Internal structures ------------
+static constexpr size_t maxMessageLength = 2048;
+static constexpr size_t maxIdNameLength = 64;
+static constexpr uint32 textHashesPerId = 8;
+
+// One slot of the ring, see Dmitry Vyukov's bounded MPMC queue. A slot is free
+// to write when sequence == position and ready to read when sequence == position + 1.
+struct LogSlot
+{
+	std::atomic<uint64> sequence;
+	vkb_LogSeverity severity;
+	int32 messageId;
+	char messageIdName[maxIdNameLength];
+	char message[maxMessageLength];
+};
+
+// Only ever touched by the sink thread
+struct MessageIdEntry
+{
+	uint64 key;
+	char name[maxIdNameLength];
+	uint64 total;
+	uint64 duplicates;
+	uint64 rateLimited;
+	uint64 rateLimitedThisWindow;
+	uint64 textHashes[textHashesPerId];
+	uint32 numTextHashes;
+	uint32 windowCount;
+	std::chrono::steady_clock::time_point windowStart;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 maxMessagesPerIdPerSecond = 8;
+static constexpr uint32 maxMessagesPerSecond = 64;
+static constexpr uint32 messageIdTableSize = 512;
+
+static const char* sinkName = "";
+static LogSlot* slots = nullptr;
+static uint64 slotMask = 0;
+static std::atomic<uint64> enqueuePos;
+static uint64 dequeuePos = 0;
+
+static std::atomic<bool> sinkRunning;
+static std::thread sinkThread;
+
+static std::atomic<uint64> numPushed;
+static std::atomic<uint64> numDropped;
+static std::atomic<uint64> numDuplicates;
+static std::atomic<uint64> numRateLimited;
+
+static MessageIdEntry* messageIds = nullptr;
+static uint32 globalWindowCount = 0;
+static std::chrono::steady_clock::time_point globalWindowStart;
+
+// ------------ Internal Functions ------------
+static uint64 hashString(const char* str, uint64 hash = 14695981039346656037ull)
+{
+	// FNV-1a
+	for (; *str != '\0'; str++)
+	{
+		hash ^= (uint8)*str;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+static void copyTruncated(char* dst, const char* src, size_t dstSize)
+{
+	if (src == nullptr)
+	{
+		dst[0] = '\0';
+		return;
+	}
+
+	size_t length = strlen(src);
+	if (length >= dstSize)
+	{
+		length = dstSize - 1;
+	}
+	memcpy(dst, src, length);
+	dst[length] = '\0';
+}
+
+static void print(vkb_LogSeverity severity, const char* message)
+{
+	switch (severity)
+	{
+	case vkb_LogSeverity::Error:
+		g_logger_error("%s: \n\t%s", sinkName, message);
+		break;
+	case vkb_LogSeverity::Warning:
+		g_logger_warning("%s: \n\t%s", sinkName, message);
+		break;
+	default:
+		g_logger_log("%s: \n\t%s", sinkName, message);
+		break;
+	}
+}
+
+static MessageIdEntry* findMessageId(int32 messageId, const char* messageIdName)
+{
+	// Some layers report 0 for every message ID, the name is what tells them apart
+	uint64 key = hashString(messageIdName, (uint64)(uint32)messageId * 1099511628211ull) | 1;
+	for (uint32 probe = 0; probe < messageIdTableSize; probe++)
+	{
+		MessageIdEntry& entry = messageIds[(key + probe) & (messageIdTableSize - 1)];
+		if (entry.key == key)
+		{
+			return &entry;
+		}
+
+		if (entry.key == 0)
+		{
+			entry = {};
+			entry.key = key;
+			copyTruncated(entry.name, messageIdName, maxIdNameLength);
+			return &entry;
+		}
+	}
+
+	return nullptr;
+}
+
+static bool isDuplicate(MessageIdEntry& entry, uint64 textHash)
+{
+	uint32 numHashes = entry.numTextHashes < textHashesPerId ? entry.numTextHashes : textHashesPerId;
+	for (uint32 i = 0; i < numHashes; i++)
+	{
+		if (entry.textHashes[i] == textHash)
+		{
+			return true;
+		}
+	}
+
+	entry.textHashes[entry.numTextHashes % textHashesPerId] = textHash;
+	entry.numTextHashes++;
+	return false;
+}
+
+static bool withinRateLimit(MessageIdEntry& entry, std::chrono::steady_clock::time_point now)
+{
+	if (now - globalWindowStart >= std::chrono::seconds(1))
+	{
+		globalWindowStart = now;
+		globalWindowCount = 0;
+	}
+
+	if (now - entry.windowStart >= std::chrono::seconds(1))
+	{
+		if (entry.rateLimitedThisWindow > 0)
+		{
+			g_logger_log("%s: suppressed %llu more '%s' messages.", sinkName, (unsigned long long)entry.rateLimitedThisWindow, entry.name);
+		}
+
+		entry.windowStart = now;
+		entry.windowCount = 0;
+		entry.rateLimitedThisWindow = 0;
+	}
+
+	if (entry.windowCount >= maxMessagesPerIdPerSecond || globalWindowCount >= maxMessagesPerSecond)
+	{
+		return false;
+	}
+
+	entry.windowCount++;
+	globalWindowCount++;
+	return true;
+}
+
+static void processSlot(const LogSlot& slot)
+{
+	MessageIdEntry* entry = findMessageId(slot.messageId, slot.messageIdName);
+	if (entry == nullptr)
+	{
+		// Table is full, nothing left to dedupe against
+		print(slot.severity, slot.message);
+		return;
+	}
+
+	entry->total++;
+	if (isDuplicate(*entry, hashString(slot.message)))
+	{
+		entry->duplicates++;
+		numDuplicates.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	if (!withinRateLimit(*entry, std::chrono::steady_clock::now()))
+	{
+		entry->rateLimited++;
+		entry->rateLimitedThisWindow++;
+		numRateLimited.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	print(slot.severity, slot.message);
+}
+
+static bool popSlot()
+{
+	LogSlot& slot = slots[dequeuePos & slotMask];
+	if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+	{
+		return false;
+	}
+
+	processSlot(slot);
+	slot.sequence.store(dequeuePos + slotMask + 1, std::memory_order_release);
+	dequeuePos++;
+	return true;
+}
+
+static void sinkLoop()
+{
+	while (true)
+	{
+		// Read the flag before draining so nothing pushed before free() is missed
+		bool running = sinkRunning.load(std::memory_order_acquire);
+
+		bool processedAny = false;
+		while (popSlot())
+		{
+			processedAny = true;
+		}
+
+		if (!running)
+		{
+			break;
+		}
+
+		if (!processedAny)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+}
+
+static void printSummary()
+{
+	vkb_LogSinkStats stats = vkb_logSink_getStats();
+	if (stats.numDropped == 0 && stats.numDuplicates == 0 && stats.numRateLimited == 0)
+	{
+		return;
+	}
+
+	g_logger_info("%s: %llu messages, %llu duplicates, %llu rate limited, %llu dropped (ring full).",
+		sinkName,
+		(unsigned long long)stats.numPushed,
+		(unsigned long long)stats.numDuplicates,
+		(unsigned long long)stats.numRateLimited,
+		(unsigned long long)stats.numDropped);
+
+	for (uint32 i = 0; i < messageIdTableSize; i++)
+	{
+		const MessageIdEntry& entry = messageIds[i];
+		if (entry.key != 0 && (entry.duplicates > 0 || entry.rateLimited > 0))
+		{
+			g_logger_info("  %-48s total: %llu, duplicates: %llu, rate limited: %llu",
+				entry.name,
+				(unsigned long long)entry.total,
+				(unsigned long long)entry.duplicates,
+				(unsigned long long)entry.rateLimited);
+		}
+	}
+}
+
+// ------------ Public Functions ------------
+void vkb_logSink_init(const char* name, uint32 capacity)
+{
+	g_logger_assert(slots == nullptr, "Log sink is already initialized.");
+
+	uint64 numSlots = 2;
+	while (numSlots < capacity)
+	{
+		numSlots <<= 1;
+	}
+
+	sinkName = name;
+	slots = (LogSlot*)g_memory_allocate(sizeof(LogSlot) * numSlots);
+	for (uint64 i = 0; i < numSlots; i++)
+	{
+		new(&slots[i].sequence)std::atomic<uint64>(i);
+	}
+	slotMask = numSlots - 1;
+	enqueuePos.store(0, std::memory_order_relaxed);
+	dequeuePos = 0;
+
+	messageIds = (MessageIdEntry*)g_memory_allocate(sizeof(MessageIdEntry) * messageIdTableSize);
+	for (uint32 i = 0; i < messageIdTableSize; i++)
+	{
+		messageIds[i] = {};
+	}
+	globalWindowCount = 0;
+	globalWindowStart = std::chrono::steady_clock::now();
+
+	numPushed.store(0, std::memory_order_relaxed);
+	numDropped.store(0, std::memory_order_relaxed);
+	numDuplicates.store(0, std::memory_order_relaxed);
+	numRateLimited.store(0, std::memory_order_relaxed);
+
+	sinkRunning.store(true, std::memory_order_release);
+	sinkThread = std::thread(sinkLoop);
+}
+
+void vkb_logSink_push(vkb_LogSeverity severity, int32 messageId, const char* messageIdName, const char* message)
+{
+	if (!sinkRunning.load(std::memory_order_acquire))
+	{
+		print(severity, message);
+		return;
+	}
+
+	numPushed.fetch_add(1, std::memory_order_relaxed);
+
+	uint64 pos = enqueuePos.load(std::memory_order_relaxed);
+	LogSlot* slot;
+	while (true)
+	{
+		slot = &slots[pos & slotMask];
+		uint64 sequence = slot->sequence.load(std::memory_order_acquire);
+		int64 diff = (int64)sequence - (int64)pos;
+		if (diff == 0)
+		{
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			// Never block the caller, a full ring drops the message
+			numDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else
+		{
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->severity = severity;
+	slot->messageId = messageId;
+	copyTruncated(slot->messageIdName, messageIdName, maxIdNameLength);
+	copyTruncated(slot->message, message, maxMessageLength);
+	slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+vkb_LogSinkStats vkb_logSink_getStats()
+{
+	vkb_LogSinkStats stats;
+	stats.numPushed = numPushed.load(std::memory_order_relaxed);
+	stats.numDropped = numDropped.load(std::memory_order_relaxed);
+	stats.numDuplicates = numDuplicates.load(std::memory_order_relaxed);
+	stats.numRateLimited = numRateLimited.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void vkb_logSink_free()
+{
+	if (slots == nullptr)
+	{
+		return;
+	}
+
+	sinkRunning.store(false, std::memory_order_release);
+	sinkThread.join();
+
+	printSummary();
+
+	g_memory_free(slots);
+	g_memory_free(messageIds);
+	slots = nullptr;
+	messageIds = nullptr;
+}
@@ -0,0 +1,792 @@
+#include "VulkanBegins/MaterialLibrary.h"
+#include "VulkanBegins/Bindless.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/DeviceCaps.h"
+#include "VulkanBegins/DrawQueue.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/Arena.h"
+#include "VulkanBegins/File.h"
+#include "VulkanBegins/CommandStream.h"
+#include "VulkanBegins/Residency.h"
+#include "VulkanBegins/DeletionQueue.h"
+
+#include <new>
+
+// ------------ Internal structures ------------
+// Matches MaterialParams in material.frag and material_bindless.frag
+struct MaterialParams
+{
+	float tint[4];
+};
+
+// Keys the library's objects are captured under, the layouts and pipelines by binding and the sets by material
+enum CaptureObject : uint32
+{
+	CapturePipelineLayout,
+	CapturePipeline = CapturePipelineLayout + (uint32)vkb_MaterialBinding::Count,
+	CaptureMaterialSet = CapturePipeline + (uint32)vkb_MaterialBinding::Count
+};
+
+// One material's texture, a mip chain that starts firstMip mips below the full
+// size. The residency manager drops mips from the top, or the whole texture,
+// when the memory budget runs out and gives them back once there's room.
+struct MaterialTexture
+{
+	vkb_MaterialLibrary* materials;
+	uint32 material;
+	// VK_NULL_HANDLE while evicted, the fallback texture is bound instead
+	VkImage image;
+	VkImageView view;
+	VkDeviceMemory memory;
+	VkDeviceSize memorySize;
+	uint32 firstMip;
+	vkb_ResidentResource resident;
+	// Rebuilt since the last recordUploads, its mips haven't been filled yet
+	bool pendingFill;
+};
+
+struct vkb_MaterialLibrary
+{
+	uint32 numMaterials;
+
+	VkDevice device;
+	const VkAllocationCallbacks* allocator;
+	// Residency changes rebuild textures outside of any call that passes it in
+	vkb_Context context;
+
+	MaterialTexture* textures;
+	uint32 memoryTypeIndex;
+	// A single texel, sampled in place of evicted textures
+	MaterialTexture fallbackTexture;
+	VkSampler sampler;
+	uint32* pendingFills;
+	uint32 numPendingFills;
+
+	// One MaterialParams per material, paramsStride apart to respect the
+	// storage buffer offset alignment
+	vkb_Buffer paramsBuffer;
+	VkDeviceSize paramsStride;
+
+	// PerMaterialSet
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet* sets;
+
+	// Bindless, nullptr without a heap
+	vkb_BindlessHeap* heap;
+	vkb_BindlessIndex* textureIndices;
+	vkb_BindlessIndex* paramsIndices;
+
+	VkPipelineLayout pipelineLayouts[(uint8)vkb_MaterialBinding::Count];
+	VkPipeline pipelines[(uint8)vkb_MaterialBinding::Count];
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 textureSize = 128;
+static constexpr uint32 numTextureMips = 8;
+static constexpr VkFormat textureFormat = VK_FORMAT_R8G8B8A8_UNORM;
+static constexpr VkClearColorValue fallbackColor = { { 0.5f, 0.5f, 0.5f, 1.0f } };
+
+// ------------ Internal Functions ------------
+static VkShaderModule createShaderModule(const vkb_MaterialLibrary* materials, const vkb_FileContents& bytecode)
+{
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = bytecode.size;
+	createInfo.pCode = (const uint32*)bytecode.data;
+
+	VkShaderModule module;
+	uint32 res = vkCreateShaderModule(materials->device, &createInfo, materials->allocator, &module);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create material shader module.");
+	return module;
+}
+
+// Hue around the color wheel, so neighbouring materials are easy to tell apart
+static VkClearColorValue materialColor(uint32 material, uint32 numMaterials)
+{
+	float hue = (float)material / (float)numMaterials * 6.0f;
+	float fraction = hue - (float)(uint32)hue;
+
+	VkClearColorValue color = {};
+	switch ((uint32)hue % 6)
+	{
+	case 0: color = { { 1.0f, fraction, 0.0f, 1.0f } }; break;
+	case 1: color = { { 1.0f - fraction, 1.0f, 0.0f, 1.0f } }; break;
+	case 2: color = { { 0.0f, 1.0f, fraction, 1.0f } }; break;
+	case 3: color = { { 0.0f, 1.0f - fraction, 1.0f, 1.0f } }; break;
+	case 4: color = { { fraction, 0.0f, 1.0f, 1.0f } }; break;
+	default: color = { { 1.0f, 0.0f, 1.0f - fraction, 1.0f } }; break;
+	}
+	return color;
+}
+
+// Every other material can be evicted first
+static vkb_StreamingPriority materialPriority(uint32 material)
+{
+	return material % 2 == 0 ? vkb_StreamingPriority::Normal : vkb_StreamingPriority::Low;
+}
+
+// Creates the texture's image with mips firstMip and below, in its own allocation so
+// it can be rebuilt on its own. Its contents are undefined until recordFills.
+static void createTexture(vkb_MaterialLibrary* materials, MaterialTexture& texture, uint32 firstMip, vkb_StreamingPriority priority)
+{
+	uint32 size = textureSize >> firstMip;
+
+	VkImageCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	createInfo.imageType = VK_IMAGE_TYPE_2D;
+	createInfo.format = textureFormat;
+	createInfo.extent = { size, size, 1 };
+	createInfo.mipLevels = numTextureMips - firstMip;
+	createInfo.arrayLayers = 1;
+	createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	uint32 res = vkCreateImage(materials->device, &createInfo, materials->allocator, &texture.image);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create material texture.");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(materials->device, texture.image, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = vkb_deviceCaps_findMemoryType(*materials->context.caps, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	res = vkb_residency_allocateMemory(materials->context, allocInfo, priority, &texture.memory);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate material texture memory.");
+	vkBindImageMemory(materials->device, texture.image, texture.memory, 0);
+	materials->memoryTypeIndex = allocInfo.memoryTypeIndex;
+	texture.memorySize = allocInfo.allocationSize;
+	texture.firstMip = firstMip;
+
+	VkImageViewCreateInfo viewCreateInfo = {};
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.image = texture.image;
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = textureFormat;
+	viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewCreateInfo.subresourceRange.levelCount = createInfo.mipLevels;
+	viewCreateInfo.subresourceRange.layerCount = 1;
+	res = vkCreateImageView(materials->device, &viewCreateInfo, materials->allocator, &texture.view);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create material texture view.");
+}
+
+// Residency changes happen between frames, once everything that could have read
+// the texture has finished, so nothing has to wait on a later frame
+static void destroyTexture(vkb_MaterialLibrary* materials, MaterialTexture& texture)
+{
+	if (texture.image == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE_VIEW, texture.view, 0);
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE, texture.image, 0);
+	vkb_residency_freeMemory(texture.memory, texture.memorySize, materials->memoryTypeIndex, 0);
+	texture.image = VK_NULL_HANDLE;
+	texture.view = VK_NULL_HANDLE;
+	texture.memory = VK_NULL_HANDLE;
+	texture.memorySize = 0;
+}
+
+// Points the material's descriptor set and heap slot at view
+static void bindTextureView(vkb_MaterialLibrary* materials, uint32 material, VkImageView view)
+{
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = materials->sampler;
+	imageInfo.imageView = view;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = materials->sets[material];
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(materials->device, 1, &write, 0, nullptr);
+
+	if (materials->heap != nullptr)
+	{
+		vkb_bindlessHeap_releaseTexture(materials->heap, materials->textureIndices[material], 0);
+		materials->textureIndices[material] = vkb_bindlessHeap_addTexture(materials->heap, view, materials->sampler);
+		g_logger_assert(materials->textureIndices[material] != vkb_invalidBindlessIndex, "The bindless heap ran out of texture slots.");
+	}
+}
+
+// Rebuilds the texture with only mips firstResidentMip and below, or binds the
+// fallback in its place when that's none of them. The new mips are filled by
+// the next recordUploads.
+static VkDeviceSize changeTextureResidency(uint32 firstResidentMip, void* userData)
+{
+	MaterialTexture& texture = *(MaterialTexture*)userData;
+	vkb_MaterialLibrary* materials = texture.materials;
+	destroyTexture(materials, texture);
+	texture.firstMip = firstResidentMip;
+	if (firstResidentMip >= numTextureMips)
+	{
+		bindTextureView(materials, texture.material, materials->fallbackTexture.view);
+		return 0;
+	}
+
+	createTexture(materials, texture, firstResidentMip, materialPriority(texture.material));
+	bindTextureView(materials, texture.material, texture.view);
+	if (!texture.pendingFill)
+	{
+		materials->pendingFills[materials->numPendingFills++] = texture.material;
+		texture.pendingFill = true;
+	}
+	return texture.memorySize;
+}
+
+static void createTextures(vkb_MaterialLibrary* materials)
+{
+	for (uint32 i = 0; i < materials->numMaterials; i++)
+	{
+		MaterialTexture& texture = materials->textures[i];
+		texture = {};
+		texture.materials = materials;
+		texture.material = i;
+		createTexture(materials, texture, 0, materialPriority(i));
+
+		vkb_ResidentResourceDesc residentDesc = {};
+		residentDesc.priority = materialPriority(i);
+		residentDesc.memoryTypeIndex = materials->memoryTypeIndex;
+		residentDesc.numMips = numTextureMips;
+		residentDesc.fullSize = texture.memorySize;
+		residentDesc.changeResidency = changeTextureResidency;
+		residentDesc.userData = &texture;
+		texture.resident = vkb_residency_register(residentDesc);
+	}
+
+	// Always resident, it's what evicted materials fall back to
+	materials->fallbackTexture = {};
+	materials->fallbackTexture.materials = materials;
+	createTexture(materials, materials->fallbackTexture, numTextureMips - 1, vkb_StreamingPriority::Critical);
+
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	uint32 res = vkCreateSampler(materials->device, &samplerCreateInfo, materials->allocator, &materials->sampler);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create material sampler.");
+}
+
+// Clears every mip of the given textures to their material's color and leaves
+// them ready to sample. Evicted ones are skipped.
+static void recordFills(vkb_MaterialLibrary* materials, VkCommandBuffer commandBuffer, MaterialTexture* const* textures, uint32 numTextures)
+{
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	VkImageMemoryBarrier* barriers = vkb_arena_allocateArray<VkImageMemoryBarrier>(vkb_scratch_get(), numTextures);
+	MaterialTexture** filled = vkb_arena_allocateArray<MaterialTexture*>(vkb_scratch_get(), numTextures);
+	uint32 numFilled = 0;
+
+	for (uint32 i = 0; i < numTextures; i++)
+	{
+		if (textures[i]->image == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		VkImageMemoryBarrier& barrier = barriers[numFilled];
+		barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = textures[i]->image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = numTextureMips - textures[i]->firstMip;
+		barrier.subresourceRange.layerCount = 1;
+		filled[numFilled++] = textures[i];
+	}
+
+	if (numFilled > 0)
+	{
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, numFilled, barriers);
+
+		for (uint32 i = 0; i < numFilled; i++)
+		{
+			// Every mip is the same flat color, so one clear covers the chain
+			VkClearColorValue color = filled[i] == &materials->fallbackTexture ? fallbackColor : materialColor(filled[i]->material, materials->numMaterials);
+			vkCmdClearColorImage(commandBuffer, barriers[i].image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &barriers[i].subresourceRange);
+
+			barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, nullptr, 0, nullptr, numFilled, barriers);
+	}
+
+	vkb_scratch_end(scratch);
+}
+
+// Fills every texture and the fallback and waits for it
+static void fillTextures(const vkb_Context& ctx, vkb_MaterialLibrary* materials)
+{
+	VkCommandPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolCreateInfo.queueFamilyIndex = ctx.graphicsFamily;
+
+	VkCommandPool commandPool;
+	uint32 res = vkCreateCommandPool(materials->device, &poolCreateInfo, materials->allocator, &commandPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create material command pool.");
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	res = vkAllocateCommandBuffers(materials->device, &allocInfo, &commandBuffer);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate material command buffer.");
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	MaterialTexture** textures = vkb_arena_allocateArray<MaterialTexture*>(vkb_scratch_get(), materials->numMaterials + 1);
+	for (uint32 i = 0; i < materials->numMaterials; i++)
+	{
+		textures[i] = &materials->textures[i];
+	}
+	textures[materials->numMaterials] = &materials->fallbackTexture;
+	recordFills(materials, commandBuffer, textures, materials->numMaterials + 1);
+	vkb_scratch_end(scratch);
+
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	res = vkQueueSubmit(ctx.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	g_logger_assert(res == VK_SUCCESS, "Failed to submit the material texture clears.");
+	vkQueueWaitIdle(ctx.graphicsQueue);
+
+	vkDestroyCommandPool(materials->device, commandPool, materials->allocator);
+}
+
+static void createParams(const vkb_Context& ctx, vkb_MaterialLibrary* materials)
+{
+	VkDeviceSize alignment = ctx.caps->properties.limits.minStorageBufferOffsetAlignment;
+	materials->paramsStride = (sizeof(MaterialParams) + alignment - 1) / alignment * alignment;
+	materials->paramsBuffer = vkb_buffer_create(ctx, materials->paramsStride * materials->numMaterials,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	// Every other material is darker, so a wrong params index shows
+	for (uint32 i = 0; i < materials->numMaterials; i++)
+	{
+		float brightness = i % 2 == 0 ? 1.0f : 0.6f;
+		MaterialParams* params = (MaterialParams*)((uint8*)materials->paramsBuffer.mapped + materials->paramsStride * i);
+		*params = { { brightness, brightness, brightness, 1.0f } };
+	}
+}
+
+static void createMaterialSets(vkb_MaterialLibrary* materials)
+{
+	VkDescriptorSetLayoutBinding bindings[2] = {};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.bindingCount = 2;
+	setLayoutCreateInfo.pBindings = bindings;
+
+	uint32 res = vkCreateDescriptorSetLayout(materials->device, &setLayoutCreateInfo, materials->allocator, &materials->setLayout);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create material descriptor set layout.");
+
+	VkDescriptorPoolSize poolSizes[2] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = materials->numMaterials;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = materials->numMaterials;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = materials->numMaterials;
+	poolCreateInfo.poolSizeCount = 2;
+	poolCreateInfo.pPoolSizes = poolSizes;
+
+	res = vkCreateDescriptorPool(materials->device, &poolCreateInfo, materials->allocator, &materials->descriptorPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create material descriptor pool.");
+
+	for (uint32 i = 0; i < materials->numMaterials; i++)
+	{
+		VkDescriptorSetAllocateInfo setAllocInfo = {};
+		setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		setAllocInfo.descriptorPool = materials->descriptorPool;
+		setAllocInfo.descriptorSetCount = 1;
+		setAllocInfo.pSetLayouts = &materials->setLayout;
+		res = vkAllocateDescriptorSets(materials->device, &setAllocInfo, &materials->sets[i]);
+		g_logger_assert(res == VK_SUCCESS, "Failed to allocate a material descriptor set.");
+
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.sampler = materials->sampler;
+		imageInfo.imageView = materials->textures[i].view;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = materials->paramsBuffer.buffer;
+		bufferInfo.offset = materials->paramsStride * i;
+		bufferInfo.range = sizeof(MaterialParams);
+
+		VkWriteDescriptorSet writes[2] = {};
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].dstSet = materials->sets[i];
+		writes[0].dstBinding = 0;
+		writes[0].descriptorCount = 1;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].pImageInfo = &imageInfo;
+		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[1].dstSet = materials->sets[i];
+		writes[1].dstBinding = 1;
+		writes[1].descriptorCount = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[1].pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets(materials->device, 2, writes, 0, nullptr);
+	}
+
+	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &materials->setLayout;
+
+	res = vkCreatePipelineLayout(materials->device, &layoutCreateInfo, materials->allocator, &materials->pipelineLayouts[(uint8)vkb_MaterialBinding::PerMaterialSet]);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create material pipeline layout.");
+}
+
+static void addToHeap(vkb_MaterialLibrary* materials)
+{
+	for (uint32 i = 0; i < materials->numMaterials; i++)
+	{
+		materials->textureIndices[i] = vkb_bindlessHeap_addTexture(materials->heap, materials->textures[i].view, materials->sampler);
+		materials->paramsIndices[i] = vkb_bindlessHeap_addBuffer(materials->heap, materials->paramsBuffer.buffer, materials->paramsStride * i, sizeof(MaterialParams));
+		g_logger_assert(materials->textureIndices[i] != vkb_invalidBindlessIndex && materials->paramsIndices[i] != vkb_invalidBindlessIndex,
+			"The bindless heap is too small for %d materials.", materials->numMaterials);
+	}
+
+	// The texture and params indices, see material_bindless.frag
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(uint32) * vkb_drawPushConstantCount;
+
+	VkDescriptorSetLayout heapLayout = vkb_bindlessHeap_getSetLayout(materials->heap);
+	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &heapLayout;
+	layoutCreateInfo.pushConstantRangeCount = 1;
+	layoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	uint32 res = vkCreatePipelineLayout(materials->device, &layoutCreateInfo, materials->allocator, &materials->pipelineLayouts[(uint8)vkb_MaterialBinding::Bindless]);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create bindless material pipeline layout.");
+}
+
+static void createPipelines(vkb_MaterialLibrary* materials, const vkb_MaterialLibraryDesc& desc)
+{
+	VkShaderModule vertModule = createShaderModule(materials, *desc.vertShader);
+	VkShaderModule fragModules[(uint8)vkb_MaterialBinding::Count] = {};
+	fragModules[(uint8)vkb_MaterialBinding::PerMaterialSet] = createShaderModule(materials, *desc.fragShader);
+	if (materials->heap != nullptr)
+	{
+		fragModules[(uint8)vkb_MaterialBinding::Bindless] = createShaderModule(materials, *desc.bindlessFragShader);
+	}
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].pName = "main";
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
+	dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateInfo.dynamicStateCount = 2;
+	dynamicStateInfo.pDynamicStates = dynamicStates;
+
+	VkPipelineViewportStateCreateInfo viewportInfo = {};
+	viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportInfo.viewportCount = 1;
+	viewportInfo.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterInfo = {};
+	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterInfo.lineWidth = 1.0f;
+	rasterInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo = {};
+	multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleInfo.minSampleShading = 1.0f;
+
+	// Same depth state as the scene's pipeline, the triangles don't overlap
+	VkPipelineDepthStencilStateCreateInfo depthStencilInfo = {};
+	depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilInfo.depthTestEnable = VK_TRUE;
+	depthStencilInfo.depthWriteEnable = VK_TRUE;
+	depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT |
+		VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo blendInfo = {};
+	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blendInfo.attachmentCount = 1;
+	blendInfo.pAttachments = &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	createInfo.stageCount = 2;
+	createInfo.pStages = shaderStages;
+	createInfo.pVertexInputState = &vertexInputInfo;
+	createInfo.pInputAssemblyState = &inputAssembly;
+	createInfo.pViewportState = &viewportInfo;
+	createInfo.pRasterizationState = &rasterInfo;
+	createInfo.pMultisampleState = &multisampleInfo;
+	createInfo.pDepthStencilState = &depthStencilInfo;
+	createInfo.pColorBlendState = &blendInfo;
+	createInfo.pDynamicState = &dynamicStateInfo;
+	createInfo.renderPass = desc.renderPass;
+	createInfo.subpass = 0;
+	createInfo.basePipelineIndex = -1;
+
+	for (uint8 binding = 0; binding < (uint8)vkb_MaterialBinding::Count; binding++)
+	{
+		if (fragModules[binding] == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		shaderStages[1].module = fragModules[binding];
+		createInfo.layout = materials->pipelineLayouts[binding];
+		uint32 res = vkCreateGraphicsPipelines(materials->device, desc.pipelineCache, 1, &createInfo, materials->allocator, &materials->pipelines[binding]);
+		g_logger_assert(res == VK_SUCCESS, "Failed to create material pipeline.");
+
+		vkDestroyShaderModule(materials->device, fragModules[binding], materials->allocator);
+	}
+	vkDestroyShaderModule(materials->device, vertModule, materials->allocator);
+}
+
+// ------------ Public Functions ------------
+vkb_MaterialLibrary* vkb_materialLibrary_create(const vkb_Context& ctx, const vkb_MaterialLibraryDesc& desc)
+{
+	g_logger_assert(desc.vertShader->data != nullptr && desc.fragShader->data != nullptr, "Missing material shader bytecode.");
+	g_logger_assert(desc.bindlessHeap == nullptr || desc.bindlessFragShader->data != nullptr, "Missing bindless material shader bytecode.");
+	g_logger_assert(desc.numMaterials > 0, "A material library needs at least one material.");
+
+	vkb_MaterialLibrary* materials = (vkb_MaterialLibrary*)g_memory_allocate(sizeof(vkb_MaterialLibrary));
+	new(materials)vkb_MaterialLibrary();
+	materials->numMaterials = desc.numMaterials;
+	materials->device = ctx.device;
+	materials->allocator = ctx.allocator;
+	materials->context = ctx;
+	materials->heap = desc.bindlessHeap;
+
+	materials->textures = (MaterialTexture*)g_memory_allocate(sizeof(MaterialTexture) * desc.numMaterials);
+	materials->pendingFills = (uint32*)g_memory_allocate(sizeof(uint32) * desc.numMaterials);
+	materials->numPendingFills = 0;
+	materials->sets = (VkDescriptorSet*)g_memory_allocate(sizeof(VkDescriptorSet) * desc.numMaterials);
+
+	createTextures(materials);
+	fillTextures(ctx, materials);
+	createParams(ctx, materials);
+	createMaterialSets(materials);
+	if (materials->heap != nullptr)
+	{
+		materials->textureIndices = (vkb_BindlessIndex*)g_memory_allocate(sizeof(vkb_BindlessIndex) * desc.numMaterials);
+		materials->paramsIndices = (vkb_BindlessIndex*)g_memory_allocate(sizeof(vkb_BindlessIndex) * desc.numMaterials);
+		addToHeap(materials);
+	}
+	createPipelines(materials, desc);
+
+	for (uint8 binding = 0; binding < (uint8)vkb_MaterialBinding::Count; binding++)
+	{
+		if (materials->pipelines[binding] != VK_NULL_HANDLE)
+		{
+			vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, materials->pipelineLayouts[binding], vkb_captureKey(vkb_CaptureOwner::MaterialLibrary, CapturePipelineLayout + binding));
+			vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE, materials->pipelines[binding], vkb_captureKey(vkb_CaptureOwner::MaterialLibrary, CapturePipeline + binding));
+		}
+	}
+	for (uint32 i = 0; i < materials->numMaterials; i++)
+	{
+		vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, materials->sets[i], vkb_captureKey(vkb_CaptureOwner::MaterialLibrary, CaptureMaterialSet + i));
+	}
+
+	return materials;
+}
+
+bool vkb_materialLibrary_supportsBinding(const vkb_MaterialLibrary* materials, vkb_MaterialBinding binding)
+{
+	return materials->pipelines[(uint8)binding] != VK_NULL_HANDLE;
+}
+
+VkPipelineLayout vkb_materialLibrary_getPipelineLayout(const vkb_MaterialLibrary* materials, vkb_MaterialBinding binding)
+{
+	return materials->pipelineLayouts[(uint8)binding];
+}
+
+void vkb_materialLibrary_pushDraws(const vkb_MaterialLibrary* materials, vkb_DrawQueue& queue, vkb_MaterialBinding binding, uint32 numDraws, uint32 numMaterials)
+{
+	g_logger_assert(vkb_materialLibrary_supportsBinding(materials, binding), "Material binding %d isn't supported.", (int)binding);
+	numMaterials = numMaterials < materials->numMaterials ? numMaterials : materials->numMaterials;
+	numMaterials = numMaterials > 0 ? numMaterials : 1;
+	bool bindless = binding == vkb_MaterialBinding::Bindless;
+
+	vkb_DrawCommand draw = {};
+	draw.pipeline = materials->pipelines[(uint8)binding];
+	draw.pipelineLayout = materials->pipelineLayouts[(uint8)binding];
+	draw.pushConstantStages = bindless ? VK_SHADER_STAGE_FRAGMENT_BIT : 0;
+	draw.vertexCount = 3;
+	draw.instanceCount = 1;
+
+	for (uint32 drawi = 0; drawi < numDraws; drawi++)
+	{
+		uint32 material = drawi % numMaterials;
+		if (bindless)
+		{
+			// The heap is bound once for the whole frame
+			draw.pushConstants[0] = materials->textureIndices[material];
+			draw.pushConstants[1] = materials->paramsIndices[material];
+		}
+		else
+		{
+			draw.descriptorSet = materials->sets[material];
+		}
+		// The draw index places the triangle, see material.vert
+		draw.firstInstance = drawi;
+
+		uint64 key = vkb_drawKey_make(0, (uint32)binding, material, 0, 0.0f);
+		vkb_drawQueue_push(queue, key, draw);
+	}
+}
+
+void vkb_materialLibrary_recordUploads(vkb_MaterialLibrary* materials, VkCommandBuffer commandBuffer)
+{
+	if (materials->numPendingFills == 0)
+	{
+		return;
+	}
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	MaterialTexture** textures = vkb_arena_allocateArray<MaterialTexture*>(vkb_scratch_get(), materials->numPendingFills);
+	for (uint32 i = 0; i < materials->numPendingFills; i++)
+	{
+		textures[i] = &materials->textures[materials->pendingFills[i]];
+		textures[i]->pendingFill = false;
+	}
+	recordFills(materials, commandBuffer, textures, materials->numPendingFills);
+	materials->numPendingFills = 0;
+	vkb_scratch_end(scratch);
+}
+
+void vkb_materialLibrary_markUsed(const vkb_MaterialLibrary* materials, uint32 numMaterials, uint64 frameIndex)
+{
+	numMaterials = numMaterials < materials->numMaterials ? numMaterials : materials->numMaterials;
+	for (uint32 i = 0; i < numMaterials; i++)
+	{
+		vkb_residency_markUsed(materials->textures[i].resident, frameIndex);
+	}
+}
+
+uint32 vkb_materialLibrary_getNumMaterials(const vkb_MaterialLibrary* materials)
+{
+	return materials->numMaterials;
+}
+
+void vkb_materialLibrary_free(const vkb_Context& ctx, vkb_MaterialLibrary* materials)
+{
+	for (uint8 binding = 0; binding < (uint8)vkb_MaterialBinding::Count; binding++)
+	{
+		if (materials->pipelines[binding] != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(ctx.device, materials->pipelines[binding], ctx.allocator);
+		}
+		if (materials->pipelineLayouts[binding] != VK_NULL_HANDLE)
+		{
+			vkDestroyPipelineLayout(ctx.device, materials->pipelineLayouts[binding], ctx.allocator);
+		}
+	}
+
+	if (materials->heap != nullptr)
+	{
+		// Nothing is in flight, so the slots can be reused right away
+		for (uint32 i = 0; i < materials->numMaterials; i++)
+		{
+			vkb_bindlessHeap_releaseTexture(materials->heap, materials->textureIndices[i], 0);
+			vkb_bindlessHeap_releaseBuffer(materials->heap, materials->paramsIndices[i], 0);
+		}
+		vkb_bindlessHeap_collect(materials->heap, 0);
+		g_memory_free(materials->textureIndices);
+		g_memory_free(materials->paramsIndices);
+	}
+
+	vkDestroyDescriptorPool(ctx.device, materials->descriptorPool, ctx.allocator);
+	vkDestroyDescriptorSetLayout(ctx.device, materials->setLayout, ctx.allocator);
+	vkb_buffer_free(ctx, materials->paramsBuffer);
+
+	vkDestroySampler(ctx.device, materials->sampler, ctx.allocator);
+	for (uint32 i = 0; i < materials->numMaterials; i++)
+	{
+		vkb_residency_unregister(materials->textures[i].resident);
+		destroyTexture(materials, materials->textures[i]);
+	}
+	destroyTexture(materials, materials->fallbackTexture);
+
+	g_memory_free(materials->textures);
+	g_memory_free(materials->pendingFills);
+	g_memory_free(materials->sets);
+
+	materials->~vkb_MaterialLibrary();
+	g_memory_free(materials);
+}
@@ -0,0 +1,155 @@
+#include "VulkanBegins/Mesh.h"
+#include "VulkanBegins/File.h"
+
+#include <math.h>
+#include <string.h>
+
+// ------------ Internal structures ------------
+// File layout: header, LOD table, vertices, indices
+struct MeshFileHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint32 numVertices;
+	uint32 numIndices;
+	uint32 numLods;
+	float boundsCenter[3];
+	float boundsRadius;
+};
+
+// ------------ Internal Variables ------------
+// "VKBM"
+static constexpr uint32 meshFileMagic = 0x4D424B56;
+static constexpr uint32 meshFileVersion = 1;
+
+// ------------ Public Functions ------------
+vkb_MeshData vkb_mesh_create(uint32 numVertices, uint32 numIndices)
+{
+	vkb_MeshData mesh = {};
+	mesh.vertices = (vkb_MeshVertex*)g_memory_allocate(sizeof(vkb_MeshVertex) * numVertices);
+	mesh.numVertices = numVertices;
+	mesh.indices = (uint32*)g_memory_allocate(sizeof(uint32) * numIndices);
+	mesh.numIndices = numIndices;
+	return mesh;
+}
+
+void vkb_mesh_computeBounds(vkb_MeshData& mesh)
+{
+	if (mesh.numVertices == 0)
+	{
+		mesh.boundsCenter[0] = mesh.boundsCenter[1] = mesh.boundsCenter[2] = 0.0f;
+		mesh.boundsRadius = 0.0f;
+		return;
+	}
+
+	// Centered on the box, which is never more than sqrt(3) times the optimal radius
+	float min[3] = { mesh.vertices[0].position[0], mesh.vertices[0].position[1], mesh.vertices[0].position[2] };
+	float max[3] = { min[0], min[1], min[2] };
+	for (uint32 i = 1; i < mesh.numVertices; i++)
+	{
+		for (uint32 axis = 0; axis < 3; axis++)
+		{
+			float value = mesh.vertices[i].position[axis];
+			min[axis] = value < min[axis] ? value : min[axis];
+			max[axis] = value > max[axis] ? value : max[axis];
+		}
+	}
+
+	float radiusSquared = 0.0f;
+	for (uint32 axis = 0; axis < 3; axis++)
+	{
+		mesh.boundsCenter[axis] = (min[axis] + max[axis]) * 0.5f;
+	}
+	for (uint32 i = 0; i < mesh.numVertices; i++)
+	{
+		float dx = mesh.vertices[i].position[0] - mesh.boundsCenter[0];
+		float dy = mesh.vertices[i].position[1] - mesh.boundsCenter[1];
+		float dz = mesh.vertices[i].position[2] - mesh.boundsCenter[2];
+		float distanceSquared = dx * dx + dy * dy + dz * dz;
+		radiusSquared = distanceSquared > radiusSquared ? distanceSquared : radiusSquared;
+	}
+	mesh.boundsRadius = sqrtf(radiusSquared);
+}
+
+bool vkb_mesh_write(const char* filename, const vkb_MeshData& mesh)
+{
+	MeshFileHeader header = {};
+	header.magic = meshFileMagic;
+	header.version = meshFileVersion;
+	header.numVertices = mesh.numVertices;
+	header.numIndices = mesh.numIndices;
+	header.numLods = mesh.numLods;
+	memcpy(header.boundsCenter, mesh.boundsCenter, sizeof(header.boundsCenter));
+	header.boundsRadius = mesh.boundsRadius;
+
+	size_t lodsSize = sizeof(vkb_MeshLod) * mesh.numLods;
+	size_t verticesSize = sizeof(vkb_MeshVertex) * mesh.numVertices;
+	size_t indicesSize = sizeof(uint32) * mesh.numIndices;
+	size_t fileSize = sizeof(header) + lodsSize + verticesSize + indicesSize;
+
+	uint8* data = (uint8*)g_memory_allocate(fileSize);
+	uint8* cursor = data;
+	memcpy(cursor, &header, sizeof(header));
+	cursor += sizeof(header);
+	memcpy(cursor, mesh.lods, lodsSize);
+	cursor += lodsSize;
+	memcpy(cursor, mesh.vertices, verticesSize);
+	cursor += verticesSize;
+	memcpy(cursor, mesh.indices, indicesSize);
+
+	bool result = vkb_file_write(filename, data, fileSize);
+	g_memory_free(data);
+	return result;
+}
+
+bool vkb_mesh_read(const char* filename, vkb_MeshData* mesh)
+{
+	*mesh = {};
+	if (!vkb_file_exists(filename))
+	{
+		g_logger_error("Mesh '%s' doesn't exist.", filename);
+		return false;
+	}
+
+	vkb_FileContents contents = vkb_file_read(filename);
+	MeshFileHeader header = {};
+	bool valid = contents.size >= sizeof(header);
+	if (valid)
+	{
+		memcpy(&header, contents.data, sizeof(header));
+		valid = header.magic == meshFileMagic && header.version == meshFileVersion && header.numLods <= vkb_maxMeshLods;
+	}
+
+	size_t lodsSize = sizeof(vkb_MeshLod) * header.numLods;
+	size_t verticesSize = sizeof(vkb_MeshVertex) * header.numVertices;
+	size_t indicesSize = sizeof(uint32) * header.numIndices;
+	valid = valid && contents.size == sizeof(header) + lodsSize + verticesSize + indicesSize;
+	if (!valid)
+	{
+		g_logger_error("'%s' isn't a version %d mesh file.", filename, meshFileVersion);
+		vkb_file_free(contents);
+		return false;
+	}
+
+	*mesh = vkb_mesh_create(header.numVertices, header.numIndices);
+	mesh->numLods = header.numLods;
+	memcpy(mesh->boundsCenter, header.boundsCenter, sizeof(mesh->boundsCenter));
+	mesh->boundsRadius = header.boundsRadius;
+
+	const uint8* cursor = contents.data + sizeof(header);
+	memcpy(mesh->lods, cursor, lodsSize);
+	cursor += lodsSize;
+	memcpy(mesh->vertices, cursor, verticesSize);
+	cursor += verticesSize;
+	memcpy(mesh->indices, cursor, indicesSize);
+
+	vkb_file_free(contents);
+	return true;
+}
+
+void vkb_mesh_free(vkb_MeshData& mesh)
+{
+	g_memory_free(mesh.vertices);
+	g_memory_free(mesh.indices);
+	mesh = {};
+}
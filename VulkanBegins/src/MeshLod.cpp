@@ -0,0 +1,116 @@
+#include "VulkanBegins/MeshLod.h"
+#include "VulkanBegins/Transforms.h"
+#include "VulkanBegins/DrawQueue.h"
+#include "VulkanBegins/Arena.h"
+
+#include <math.h>
+#include <string.h>
+
+// ------------ Internal Variables ------------
+// Closer than this counts as inside the bounds, which always gets LOD 0
+static constexpr float minLodDistance = 1e-4f;
+
+// ------------ Public Functions ------------
+float vkb_meshLod_projectionScale(const vkb_MeshLodView& view)
+{
+	return view.viewportHeight / (2.0f * tanf(view.fovY * 0.5f));
+}
+
+uint32 vkb_meshLod_select(const vkb_MeshData& mesh, float distance, float scale, float projectionScale, float maxPixelError)
+{
+	if (distance <= minLodDistance)
+	{
+		return 0;
+	}
+
+	// Errors only grow with the LOD, so the first one over the limit ends the search
+	float pixelsPerUnit = scale * projectionScale / distance;
+	uint32 lod = 0;
+	while (lod + 1 < mesh.numLods && mesh.lods[lod + 1].error * pixelsPerUnit <= maxPixelError)
+	{
+		lod++;
+	}
+	return lod;
+}
+
+void vkb_meshLod_bucketInstances(const vkb_MeshData& mesh, const vkb_TransformSystem& transforms, const vkb_MeshLodView& view, uint32* instanceOrder, uint32* lodOffsets, vkb_MeshLodStats* stats)
+{
+	vkb_meshLod_bucketSubset(mesh, transforms, nullptr, transforms.count, view, instanceOrder, lodOffsets, stats);
+}
+
+void vkb_meshLod_bucketSubset(const vkb_MeshData& mesh, const vkb_TransformSystem& transforms, const uint32* subset, uint32 subsetCount, const vkb_MeshLodView& view, uint32* instanceOrder, uint32* lodOffsets, vkb_MeshLodStats* stats)
+{
+	vkb_ArenaMarker marker = vkb_scratch_begin();
+	uint8* instanceLods = vkb_arena_allocateArray<uint8>(vkb_scratch_get(), subsetCount);
+
+	float projectionScale = vkb_meshLod_projectionScale(view);
+	uint32 counts[vkb_maxMeshLods] = {};
+	for (uint32 subseti = 0; subseti < subsetCount; subseti++)
+	{
+		uint32 i = subset != nullptr ? subset[subseti] : subseti;
+		float scale = fmaxf(fabsf(transforms.scaleX[i]), fmaxf(fabsf(transforms.scaleY[i]), fabsf(transforms.scaleZ[i])));
+
+		// Bounds center rotated and scaled into world space
+		glm::quat rotation(transforms.rotationW[i], transforms.rotationX[i], transforms.rotationY[i], transforms.rotationZ[i]);
+		glm::vec3 localCenter(
+			mesh.boundsCenter[0] * transforms.scaleX[i],
+			mesh.boundsCenter[1] * transforms.scaleY[i],
+			mesh.boundsCenter[2] * transforms.scaleZ[i]);
+		glm::vec3 center = glm::vec3(transforms.positionX[i], transforms.positionY[i], transforms.positionZ[i]) + rotation * localCenter;
+
+		glm::vec3 toCamera = center - view.cameraPosition;
+		float distance = sqrtf(toCamera.x * toCamera.x + toCamera.y * toCamera.y + toCamera.z * toCamera.z) - mesh.boundsRadius * scale;
+		uint32 lod = vkb_meshLod_select(mesh, distance, scale, projectionScale, view.maxPixelError);
+		instanceLods[subseti] = (uint8)lod;
+		counts[lod]++;
+	}
+
+	// Counting sort keeps instances in subset order within each LOD
+	lodOffsets[0] = 0;
+	for (uint32 lod = 0; lod < vkb_maxMeshLods; lod++)
+	{
+		lodOffsets[lod + 1] = lodOffsets[lod] + counts[lod];
+	}
+
+	uint32 cursors[vkb_maxMeshLods];
+	memcpy(cursors, lodOffsets, sizeof(cursors));
+	for (uint32 subseti = 0; subseti < subsetCount; subseti++)
+	{
+		instanceOrder[cursors[instanceLods[subseti]]++] = subset != nullptr ? subset[subseti] : subseti;
+	}
+
+	if (stats)
+	{
+		*stats = {};
+		stats->numInstances = subsetCount;
+		for (uint32 lod = 0; lod < mesh.numLods; lod++)
+		{
+			stats->instancesPerLod[lod] = counts[lod];
+			stats->trianglesDrawn += (uint64)counts[lod] * (mesh.lods[lod].indexCount / 3);
+		}
+		stats->trianglesFullDetail = mesh.numLods > 0 ? (uint64)subsetCount * (mesh.lods[0].indexCount / 3) : 0;
+	}
+
+	vkb_scratch_end(marker);
+}
+
+void vkb_meshLod_pushDraws(vkb_DrawQueue& queue, const vkb_MeshData& mesh, const uint32* lodOffsets, const vkb_DrawCommand& drawTemplate, uint32 pass, uint32 pipeline, uint32 material, uint32 meshKey)
+{
+	g_logger_assert(drawTemplate.indexBuffer != VK_NULL_HANDLE, "LOD draws have to be indexed.");
+
+	for (uint32 lod = 0; lod < mesh.numLods; lod++)
+	{
+		uint32 numInstances = lodOffsets[lod + 1] - lodOffsets[lod];
+		if (numInstances == 0)
+		{
+			continue;
+		}
+
+		vkb_DrawCommand draw = drawTemplate;
+		draw.indexCount = mesh.lods[lod].indexCount;
+		draw.firstIndex = mesh.lods[lod].firstIndex;
+		draw.instanceCount = numInstances;
+		draw.firstInstance = lodOffsets[lod];
+		vkb_drawQueue_push(queue, vkb_drawKey_make(pass, pipeline, material, meshKey * vkb_maxMeshLods + lod, 0.0f), draw);
+	}
+}
@@ -0,0 +1,538 @@
+#include "VulkanBegins/MeshSimplify.h"
+#include "VulkanBegins/Mesh.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// ------------ Internal structures ------------
+// Symmetric 4x4 matrix of summed squared plane distances, plus the area the
+// planes were weighted by so the error can be turned back into a distance
+struct Quadric
+{
+	double a00, a01, a02, a03;
+	double a11, a12, a13;
+	double a22, a23;
+	double a33;
+	double weight;
+};
+
+enum class VertexKind : uint8
+{
+	Manifold,
+	// On an open edge, only collapses along it
+	Border,
+	// Shares its position with one other vertex across an attribute seam, the
+	// two only collapse along the seam and together
+	Seam,
+	// Where seams meet or reach an open edge, never collapses
+	Locked
+};
+
+struct Collapse
+{
+	// Both are vertex indices, from is always its own position's representative
+	uint32 from;
+	uint32 to;
+	double cost;
+};
+
+// ------------ Internal Variables ------------
+// Open edges are held in place by a plane perpendicular to their triangle,
+// weighted heavier than the surface so silhouettes survive longer
+static constexpr double borderWeight = 10.0;
+// Cosine of the largest rotation a triangle's normal is allowed in one collapse
+static constexpr double minNormalCosine = 0.2;
+
+// ------------ Internal Functions ------------
+static void quadric_addPlane(Quadric& q, double a, double b, double c, double d, double weight)
+{
+	q.a00 += a * a * weight;
+	q.a01 += a * b * weight;
+	q.a02 += a * c * weight;
+	q.a03 += a * d * weight;
+	q.a11 += b * b * weight;
+	q.a12 += b * c * weight;
+	q.a13 += b * d * weight;
+	q.a22 += c * c * weight;
+	q.a23 += c * d * weight;
+	q.a33 += d * d * weight;
+	q.weight += weight;
+}
+
+static void quadric_add(Quadric& dst, const Quadric& src)
+{
+	dst.a00 += src.a00;
+	dst.a01 += src.a01;
+	dst.a02 += src.a02;
+	dst.a03 += src.a03;
+	dst.a11 += src.a11;
+	dst.a12 += src.a12;
+	dst.a13 += src.a13;
+	dst.a22 += src.a22;
+	dst.a23 += src.a23;
+	dst.a33 += src.a33;
+	dst.weight += src.weight;
+}
+
+static double quadric_evaluate(const Quadric& q, const float* p)
+{
+	double x = p[0];
+	double y = p[1];
+	double z = p[2];
+	double result =
+		q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+		2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+		2.0 * (q.a03 * x + q.a13 * y + q.a23 * z) +
+		q.a33;
+	return fabs(result);
+}
+
+static void triangleNormal(const float* p0, const float* p1, const float* p2, double* normal)
+{
+	double e0[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+	double e1[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2] };
+	normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+	normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+	normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+
+static uint64 edgeKey(uint32 a, uint32 b)
+{
+	return a < b ? ((uint64)a << 32) | b : ((uint64)b << 32) | a;
+}
+
+// Edges only one triangle uses, looked up in the sorted list of every triangle's edges
+static bool isBorderEdge(const uint64* sortedEdges, uint32 numEdges, uint32 a, uint32 b)
+{
+	uint64 key = edgeKey(a, b);
+	const uint64* first = std::lower_bound(sortedEdges, sortedEdges + numEdges, key);
+	return first != sortedEdges + numEdges && *first == key && (first + 1 == sortedEdges + numEdges || first[1] != key);
+}
+
+// Points every vertex at the first vertex with the same position, and links the
+// vertices sharing a position into a ring through wedges
+static void weldPositions(const vkb_MeshVertex* vertices, uint32 numVertices, uint32* weld, uint32* wedges, VertexKind* kinds)
+{
+	uint32* order = (uint32*)g_memory_allocate(sizeof(uint32) * numVertices);
+	for (uint32 i = 0; i < numVertices; i++)
+	{
+		order[i] = i;
+	}
+	std::sort(order, order + numVertices, [vertices](uint32 a, uint32 b)
+		{
+			const float* pa = vertices[a].position;
+			const float* pb = vertices[b].position;
+			if (pa[0] != pb[0]) return pa[0] < pb[0];
+			if (pa[1] != pb[1]) return pa[1] < pb[1];
+			if (pa[2] != pb[2]) return pa[2] < pb[2];
+			return a < b;
+		});
+
+	uint32 groupStart = 0;
+	while (groupStart < numVertices)
+	{
+		const float* position = vertices[order[groupStart]].position;
+		uint32 groupEnd = groupStart + 1;
+		while (groupEnd < numVertices && memcmp(vertices[order[groupEnd]].position, position, sizeof(float) * 3) == 0)
+		{
+			groupEnd++;
+		}
+
+		// Two vertices are the two sides of a seam, more are a corner where seams meet
+		uint32 numWedges = groupEnd - groupStart;
+		VertexKind kind = numWedges == 1 ? VertexKind::Manifold : (numWedges == 2 ? VertexKind::Seam : VertexKind::Locked);
+		for (uint32 i = groupStart; i < groupEnd; i++)
+		{
+			weld[order[i]] = order[groupStart];
+			wedges[order[i]] = order[i + 1 < groupEnd ? i + 1 : groupStart];
+			kinds[order[i]] = kind;
+		}
+		groupStart = groupEnd;
+	}
+
+	g_memory_free(order);
+}
+
+// Rejects collapses that would turn any remaining triangle around from over
+static bool collapseFlipsTriangle(const vkb_MeshVertex* vertices, const uint32* weld, const uint32* indices, const uint32* adjacency, uint32 numAdjacent, uint32 from, uint32 to, uint32* numRemoved)
+{
+	*numRemoved = 0;
+	for (uint32 i = 0; i < numAdjacent; i++)
+	{
+		const uint32* triangle = indices + adjacency[i] * 3;
+		if (weld[triangle[0]] == weld[to] || weld[triangle[1]] == weld[to] || weld[triangle[2]] == weld[to])
+		{
+			(*numRemoved)++;
+			continue;
+		}
+
+		const float* before[3];
+		const float* after[3];
+		for (uint32 corner = 0; corner < 3; corner++)
+		{
+			before[corner] = vertices[triangle[corner]].position;
+			after[corner] = weld[triangle[corner]] == from ? vertices[to].position : before[corner];
+		}
+
+		double n0[3];
+		double n1[3];
+		triangleNormal(before[0], before[1], before[2], n0);
+		triangleNormal(after[0], after[1], after[2], n1);
+		double dot = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+		double lengths = sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) * (n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+		if (dot <= minNormalCosine * lengths)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Finds the vertex each of from's vertices merges into, the one of toWeld's it
+// shares triangles with. Fails if one shares triangles with several of them,
+// which would drag it across a seam, or if a seam vertex shares none or the
+// same one as the other side, which is a collapse off the seam.
+static bool findCollapseTargets(const uint32* weld, const uint32* wedges, const uint32* indices, const uint32* adjacency, uint32 numAdjacent, uint32 from, uint32 toWeld, uint32* targets)
+{
+	targets[0] = UINT32_MAX;
+	targets[1] = UINT32_MAX;
+	for (uint32 i = 0; i < numAdjacent; i++)
+	{
+		const uint32* triangle = indices + adjacency[i] * 3;
+		uint32 fromVertex = UINT32_MAX;
+		uint32 toVertex = UINT32_MAX;
+		for (uint32 corner = 0; corner < 3; corner++)
+		{
+			if (weld[triangle[corner]] == from)
+			{
+				fromVertex = triangle[corner];
+			}
+			else if (weld[triangle[corner]] == toWeld)
+			{
+				toVertex = triangle[corner];
+			}
+		}
+		if (toVertex == UINT32_MAX)
+		{
+			continue;
+		}
+
+		uint32& target = targets[fromVertex == from ? 0 : 1];
+		if (target != UINT32_MAX && target != toVertex)
+		{
+			return false;
+		}
+		target = toVertex;
+	}
+
+	if (targets[0] == UINT32_MAX)
+	{
+		return false;
+	}
+	return wedges[from] == from || (targets[1] != UINT32_MAX && targets[1] != targets[0]);
+}
+
+// ------------ Public Functions ------------
+uint32 vkb_meshSimplify_run(uint32* dstIndices, const uint32* indices, uint32 numIndices, const vkb_MeshVertex* vertices, uint32 numVertices, uint32 targetIndexCount, float* error)
+{
+	memcpy(dstIndices, indices, sizeof(uint32) * numIndices);
+	*error = 0.0f;
+	if (numIndices <= targetIndexCount || numVertices == 0)
+	{
+		return numIndices;
+	}
+
+	uint32* weld = (uint32*)g_memory_allocate(sizeof(uint32) * numVertices);
+	uint32* wedges = (uint32*)g_memory_allocate(sizeof(uint32) * numVertices);
+	VertexKind* kinds = (VertexKind*)g_memory_allocate(sizeof(VertexKind) * numVertices);
+	weldPositions(vertices, numVertices, weld, wedges, kinds);
+
+	uint32 numEdges = numIndices;
+	uint64* edges = (uint64*)g_memory_allocate(sizeof(uint64) * numEdges);
+	for (uint32 i = 0; i < numIndices; i += 3)
+	{
+		for (uint32 corner = 0; corner < 3; corner++)
+		{
+			edges[i + corner] = edgeKey(weld[indices[i + corner]], weld[indices[i + (corner + 1) % 3]]);
+		}
+	}
+	std::sort(edges, edges + numEdges);
+
+	// Quadrics live on each position's representative
+	Quadric* quadrics = (Quadric*)g_memory_allocate(sizeof(Quadric) * numVertices);
+	memset(quadrics, 0, sizeof(Quadric) * numVertices);
+	for (uint32 i = 0; i < numIndices; i += 3)
+	{
+		const float* p[3] = {
+			vertices[indices[i]].position,
+			vertices[indices[i + 1]].position,
+			vertices[indices[i + 2]].position
+		};
+		double normal[3];
+		triangleNormal(p[0], p[1], p[2], normal);
+		double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length == 0.0)
+		{
+			continue;
+		}
+		normal[0] /= length;
+		normal[1] /= length;
+		normal[2] /= length;
+
+		double d = -(normal[0] * p[0][0] + normal[1] * p[0][1] + normal[2] * p[0][2]);
+		double area = length * 0.5;
+		for (uint32 corner = 0; corner < 3; corner++)
+		{
+			quadric_addPlane(quadrics[weld[indices[i + corner]]], normal[0], normal[1], normal[2], d, area);
+		}
+
+		for (uint32 corner = 0; corner < 3; corner++)
+		{
+			uint32 a = weld[indices[i + corner]];
+			uint32 b = weld[indices[i + (corner + 1) % 3]];
+			if (!isBorderEdge(edges, numEdges, a, b))
+			{
+				continue;
+			}
+
+			const float* pa = p[corner];
+			const float* pb = p[(corner + 1) % 3];
+			double edge[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+			double perpendicular[3] = {
+				edge[1] * normal[2] - edge[2] * normal[1],
+				edge[2] * normal[0] - edge[0] * normal[2],
+				edge[0] * normal[1] - edge[1] * normal[0]
+			};
+			double edgeLength = sqrt(edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+			if (edgeLength == 0.0)
+			{
+				continue;
+			}
+			perpendicular[0] /= edgeLength;
+			perpendicular[1] /= edgeLength;
+			perpendicular[2] /= edgeLength;
+
+			double perpendicularD = -(perpendicular[0] * pa[0] + perpendicular[1] * pa[1] + perpendicular[2] * pa[2]);
+			double weight = edgeLength * edgeLength * borderWeight;
+			quadric_addPlane(quadrics[a], perpendicular[0], perpendicular[1], perpendicular[2], perpendicularD, weight);
+			quadric_addPlane(quadrics[b], perpendicular[0], perpendicular[1], perpendicular[2], perpendicularD, weight);
+
+			// A seam that reaches an open edge pins it there
+			if (kinds[a] != VertexKind::Locked)
+			{
+				kinds[a] = kinds[a] == VertexKind::Manifold ? VertexKind::Border : VertexKind::Locked;
+			}
+			if (kinds[b] != VertexKind::Locked)
+			{
+				kinds[b] = kinds[b] == VertexKind::Manifold ? VertexKind::Border : VertexKind::Locked;
+			}
+		}
+	}
+
+	uint32* remap = (uint32*)g_memory_allocate(sizeof(uint32) * numVertices);
+	uint32* adjacencyOffsets = (uint32*)g_memory_allocate(sizeof(uint32) * (numVertices + 1));
+	uint32* adjacency = (uint32*)g_memory_allocate(sizeof(uint32) * numIndices);
+	bool* touched = (bool*)g_memory_allocate(sizeof(bool) * numVertices);
+	Collapse* collapses = (Collapse*)g_memory_allocate(sizeof(Collapse) * numIndices * 2);
+
+	double maxCost = 0.0;
+	uint32 indexCount = numIndices;
+	while (indexCount > targetIndexCount)
+	{
+		// Triangles around each position, rebuilt every pass
+		memset(adjacencyOffsets, 0, sizeof(uint32) * (numVertices + 1));
+		for (uint32 i = 0; i < indexCount; i++)
+		{
+			adjacencyOffsets[weld[dstIndices[i]] + 1]++;
+		}
+		for (uint32 i = 0; i < numVertices; i++)
+		{
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		}
+		for (uint32 i = 0; i < indexCount; i++)
+		{
+			adjacency[adjacencyOffsets[weld[dstIndices[i]]]++] = i / 3;
+		}
+		for (uint32 i = numVertices; i > 0; i--)
+		{
+			adjacencyOffsets[i] = adjacencyOffsets[i - 1];
+		}
+		adjacencyOffsets[0] = 0;
+
+		uint32 numCollapses = 0;
+		for (uint32 i = 0; i < indexCount; i += 3)
+		{
+			for (uint32 corner = 0; corner < 6; corner++)
+			{
+				// Both directions of all 3 edges
+				uint32 from = dstIndices[i + corner % 3];
+				uint32 to = dstIndices[i + (corner / 3 + corner + 1) % 3];
+				uint32 fromWeld = weld[from];
+				uint32 toWeld = weld[to];
+				if (kinds[fromWeld] == VertexKind::Locked || fromWeld == toWeld)
+				{
+					continue;
+				}
+				if (kinds[fromWeld] == VertexKind::Border && (kinds[toWeld] == VertexKind::Manifold || !isBorderEdge(edges, numEdges, fromWeld, toWeld)))
+				{
+					continue;
+				}
+				if (kinds[fromWeld] == VertexKind::Seam && kinds[toWeld] != VertexKind::Seam && kinds[toWeld] != VertexKind::Locked)
+				{
+					continue;
+				}
+
+				const Quadric& q0 = quadrics[fromWeld];
+				const Quadric& q1 = quadrics[toWeld];
+				double weight = q0.weight + q1.weight;
+				double cost = quadric_evaluate(q0, vertices[to].position) + quadric_evaluate(q1, vertices[to].position);
+				collapses[numCollapses++] = { fromWeld, to, weight > 0.0 ? cost / weight : 0.0 };
+			}
+		}
+		std::sort(collapses, collapses + numCollapses, [](const Collapse& a, const Collapse& b)
+			{
+				return a.cost < b.cost;
+			});
+
+		for (uint32 i = 0; i < numVertices; i++)
+		{
+			remap[i] = i;
+			touched[i] = false;
+		}
+
+		// Greedy in cost order. Everything around a collapse is left alone for the
+		// rest of the pass so the adjacency the flip check reads stays valid.
+		uint32 trianglesToRemove = (indexCount - targetIndexCount + 2) / 3;
+		uint32 trianglesRemoved = 0;
+		uint32 numApplied = 0;
+		for (uint32 i = 0; i < numCollapses && trianglesRemoved < trianglesToRemove; i++)
+		{
+			const Collapse& collapse = collapses[i];
+			uint32 toWeld = weld[collapse.to];
+			if (touched[collapse.from] || touched[toWeld])
+			{
+				continue;
+			}
+
+			const uint32* around = adjacency + adjacencyOffsets[collapse.from];
+			uint32 numAround = adjacencyOffsets[collapse.from + 1] - adjacencyOffsets[collapse.from];
+			uint32 targets[2];
+			if (!findCollapseTargets(weld, wedges, dstIndices, around, numAround, collapse.from, toWeld, targets))
+			{
+				continue;
+			}
+			uint32 numRemoved = 0;
+			if (collapseFlipsTriangle(vertices, weld, dstIndices, around, numAround, collapse.from, collapse.to, &numRemoved))
+			{
+				continue;
+			}
+
+			for (uint32 triangle = 0; triangle < numAround; triangle++)
+			{
+				for (uint32 corner = 0; corner < 3; corner++)
+				{
+					touched[weld[dstIndices[around[triangle] * 3 + corner]]] = true;
+				}
+			}
+
+			// A seam's other vertex follows along its side of the seam
+			remap[collapse.from] = targets[0];
+			if (wedges[collapse.from] != collapse.from)
+			{
+				remap[wedges[collapse.from]] = targets[1];
+			}
+			quadric_add(quadrics[toWeld], quadrics[collapse.from]);
+			maxCost = collapse.cost > maxCost ? collapse.cost : maxCost;
+			trianglesRemoved += numRemoved;
+			numApplied++;
+		}
+
+		if (numApplied == 0)
+		{
+			break;
+		}
+
+		uint32 newIndexCount = 0;
+		for (uint32 i = 0; i < indexCount; i += 3)
+		{
+			uint32 a = remap[dstIndices[i]];
+			uint32 b = remap[dstIndices[i + 1]];
+			uint32 c = remap[dstIndices[i + 2]];
+			if (weld[a] == weld[b] || weld[b] == weld[c] || weld[a] == weld[c])
+			{
+				continue;
+			}
+			dstIndices[newIndexCount++] = a;
+			dstIndices[newIndexCount++] = b;
+			dstIndices[newIndexCount++] = c;
+		}
+		indexCount = newIndexCount;
+	}
+
+	*error = (float)sqrt(maxCost);
+
+	g_memory_free(collapses);
+	g_memory_free(touched);
+	g_memory_free(adjacency);
+	g_memory_free(adjacencyOffsets);
+	g_memory_free(remap);
+	g_memory_free(quadrics);
+	g_memory_free(edges);
+	g_memory_free(kinds);
+	g_memory_free(wedges);
+	g_memory_free(weld);
+
+	return indexCount;
+}
+
+void vkb_meshSimplify_generateLods(vkb_MeshData& mesh, uint32 maxLods, float reductionRatio, uint32 minTriangles)
+{
+	g_logger_assert(reductionRatio > 0.0f && reductionRatio < 1.0f, "LOD reduction ratio has to be between 0 and 1, got %2.3f.", reductionRatio);
+	maxLods = maxLods < vkb_maxMeshLods ? maxLods : vkb_maxMeshLods;
+
+	uint32 baseIndexCount = mesh.numIndices;
+	uint32* lodIndices = (uint32*)g_memory_allocate(sizeof(uint32) * baseIndexCount);
+	uint32* chain = (uint32*)g_memory_allocate(sizeof(uint32) * baseIndexCount);
+	memcpy(chain, mesh.indices, sizeof(uint32) * baseIndexCount);
+	uint32 chainSize = baseIndexCount;
+
+	mesh.lods[0] = { 0, baseIndexCount, 0.0f };
+	mesh.numLods = 1;
+
+	while (mesh.numLods < maxLods)
+	{
+		const vkb_MeshLod& previous = mesh.lods[mesh.numLods - 1];
+		uint32 previousTriangles = previous.indexCount / 3;
+		if (previousTriangles <= minTriangles)
+		{
+			break;
+		}
+
+		uint32 targetTriangles = (uint32)((float)previousTriangles * reductionRatio);
+		targetTriangles = targetTriangles > minTriangles ? targetTriangles : minTriangles;
+
+		float error = 0.0f;
+		uint32 indexCount = vkb_meshSimplify_run(lodIndices, mesh.indices, baseIndexCount, mesh.vertices, mesh.numVertices, targetTriangles * 3, &error);
+
+		// Not worth a LOD if it barely saves anything, simplification is stuck
+		if ((float)indexCount > (float)previous.indexCount * 0.9f)
+		{
+			break;
+		}
+
+		chain = (uint32*)g_memory_realloc(chain, sizeof(uint32) * (chainSize + indexCount));
+		memcpy(chain + chainSize, lodIndices, sizeof(uint32) * indexCount);
+
+		// Later LODs are never reported as more accurate than earlier ones
+		mesh.lods[mesh.numLods] = { chainSize, indexCount, error > previous.error ? error : previous.error };
+		mesh.numLods++;
+		chainSize += indexCount;
+	}
+
+	g_memory_free(lodIndices);
+	g_memory_free(mesh.indices);
+	mesh.indices = chain;
+	mesh.numIndices = chainSize;
+}
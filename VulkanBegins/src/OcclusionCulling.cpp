@@ -0,0 +1,776 @@
+#include "VulkanBegins/OcclusionCulling.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/DeviceCaps.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/DeletionQueue.h"
+#include "VulkanBegins/File.h"
+#include "VulkanBegins/CommandStream.h"
+
+#include <string.h>
+#include <new>
+
+// ------------ Internal structures ------------
+// Matches Stats in occlusion_cull.comp
+enum StatSlot : uint32
+{
+	StatDrawnEarly,
+	StatDrawnLate,
+	StatOccluded,
+	StatOutsideFrustum,
+
+	StatCount
+};
+
+// Keys the culler's objects are captured under, the level sets follow the last one
+enum CaptureObject : uint32
+{
+	CaptureCullPipeline,
+	CaptureCullLayout,
+	CaptureDownsamplePipeline,
+	CaptureDownsampleLayout,
+	CaptureInstanceSet,
+	CaptureVisibilityBuffer,
+	CaptureDrawArgsBuffer,
+	CaptureStatsBuffer,
+	CaptureCullSet,
+	CaptureLevelSet
+};
+
+// Matches Params in hiz_downsample.comp
+struct DownsampleParams
+{
+	int32 srcSize[2];
+	int32 dstSize[2];
+};
+
+// Matches Params in occlusion_cull.comp
+struct CullParams
+{
+	glm::mat4 viewProj;
+	float pyramidSize[2];
+	uint32 numInstances;
+	uint32 phase;
+	uint32 maxInstances;
+	uint32 numLevels;
+};
+
+struct HiZPyramid
+{
+	VkImage image;
+	VkDeviceMemory memory;
+	VkImageView view;
+	VkImageView levelViews[vkb_maxHiZLevels];
+	uint32 width;
+	uint32 height;
+	uint32 numLevels;
+
+	// The level sets and the cull set point at the pyramid's views, so they're
+	// allocated and retired along with it
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet levelSets[vkb_maxHiZLevels];
+	VkDescriptorSet cullSet;
+	VkExtent2D depthExtent;
+};
+
+struct vkb_OcclusionCuller
+{
+	uint32 maxInstances;
+	uint32 numInstances;
+	uint32 vertexCount;
+
+	VkDevice device;
+	const VkAllocationCallbacks* allocator;
+	VkQueue queue;
+	VkCommandPool commandPool;
+
+	VkSampler sampler;
+	VkDescriptorSetLayout downsampleSetLayout;
+	VkPipelineLayout downsampleLayout;
+	VkPipeline downsamplePipeline;
+	VkDescriptorSetLayout cullSetLayout;
+	VkPipelineLayout cullLayout;
+	VkPipeline cullPipeline;
+
+	vkb_Buffer instanceBuffer;
+	// Per instance, bit 0 is visible last frame and bit 1 drawn by this frame's early phase
+	vkb_Buffer visibilityBuffer;
+	// Early phase ids from 0, late phase ids from maxInstances
+	vkb_Buffer culledInstanceBuffer;
+	// Two VkDrawIndirectCommands, early then late
+	vkb_Buffer drawArgsBuffer;
+	vkb_Buffer statsBuffer;
+
+	VkDescriptorPool instancePool;
+	VkDescriptorSet instanceSet;
+
+	HiZPyramid pyramid;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 cullGroupSize = 64;
+static constexpr uint32 downsampleGroupSize = 8;
+
+// ------------ Internal Functions ------------
+static uint32 previousPowerOfTwo(uint32 value)
+{
+	uint32 result = 1;
+	while (result * 2 <= value)
+	{
+		result *= 2;
+	}
+	return result;
+}
+
+static VkShaderModule createShaderModule(const vkb_OcclusionCuller* culler, const vkb_FileContents& bytecode)
+{
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = bytecode.size;
+	createInfo.pCode = (const uint32*)bytecode.data;
+
+	VkShaderModule module;
+	uint32 res = vkCreateShaderModule(culler->device, &createInfo, culler->allocator, &module);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create occlusion culling shader module.");
+	return module;
+}
+
+static VkDescriptorSetLayout createSetLayout(const vkb_OcclusionCuller* culler, const VkDescriptorType* types, uint32 numBindings)
+{
+	VkDescriptorSetLayoutBinding bindings[8] = {};
+	for (uint32 i = 0; i < numBindings; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = types[i];
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	createInfo.bindingCount = numBindings;
+	createInfo.pBindings = bindings;
+
+	VkDescriptorSetLayout layout;
+	uint32 res = vkCreateDescriptorSetLayout(culler->device, &createInfo, culler->allocator, &layout);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create occlusion culling descriptor set layout.");
+	return layout;
+}
+
+static void createComputePipeline(const vkb_OcclusionCuller* culler, const vkb_FileContents& bytecode, VkDescriptorSetLayout setLayout,
+	uint32 pushConstantSize, VkPipelineCache pipelineCache, VkPipelineLayout* layout, VkPipeline* pipeline)
+{
+	VkPushConstantRange pushConstants = {};
+	pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstants.offset = 0;
+	pushConstants.size = pushConstantSize;
+
+	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &setLayout;
+	layoutCreateInfo.pushConstantRangeCount = 1;
+	layoutCreateInfo.pPushConstantRanges = &pushConstants;
+
+	uint32 res = vkCreatePipelineLayout(culler->device, &layoutCreateInfo, culler->allocator, layout);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create occlusion culling pipeline layout.");
+
+	VkShaderModule module = createShaderModule(culler, bytecode);
+
+	VkComputePipelineCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	createInfo.stage.module = module;
+	createInfo.stage.pName = "main";
+	createInfo.layout = *layout;
+	createInfo.basePipelineIndex = -1;
+
+	res = vkCreateComputePipelines(culler->device, pipelineCache, 1, &createInfo, culler->allocator, pipeline);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create occlusion culling pipeline.");
+
+	vkDestroyShaderModule(culler->device, module, culler->allocator);
+}
+
+static VkImageView createPyramidView(const vkb_OcclusionCuller* culler, VkImage image, uint32 baseLevel, uint32 numLevels)
+{
+	VkImageViewCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	createInfo.image = image;
+	createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	createInfo.format = VK_FORMAT_R32_SFLOAT;
+	createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	createInfo.subresourceRange.baseMipLevel = baseLevel;
+	createInfo.subresourceRange.levelCount = numLevels;
+	createInfo.subresourceRange.baseArrayLayer = 0;
+	createInfo.subresourceRange.layerCount = 1;
+
+	VkImageView view;
+	uint32 res = vkCreateImageView(culler->device, &createInfo, culler->allocator, &view);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create Hi-Z pyramid view.");
+	return view;
+}
+
+// Only used on create and when the depth target changes, waits for the queue
+static VkCommandBuffer beginImmediateCommands(const vkb_OcclusionCuller* culler)
+{
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = culler->commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	uint32 res = vkAllocateCommandBuffers(culler->device, &allocInfo, &commandBuffer);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate occlusion culling command buffer.");
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	return commandBuffer;
+}
+
+static void submitImmediateCommands(const vkb_OcclusionCuller* culler, VkCommandBuffer commandBuffer)
+{
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	uint32 res = vkQueueSubmit(culler->queue, 1, &submitInfo, VK_NULL_HANDLE);
+	g_logger_assert(res == VK_SUCCESS, "Failed to submit occlusion culling commands.");
+	vkQueueWaitIdle(culler->queue);
+
+	vkFreeCommandBuffers(culler->device, culler->commandPool, 1, &commandBuffer);
+}
+
+static void createPyramid(const vkb_Context& ctx, vkb_OcclusionCuller* culler, VkImageView depthView, VkExtent2D depthExtent)
+{
+	HiZPyramid& pyramid = culler->pyramid;
+	pyramid = {};
+	pyramid.depthExtent = depthExtent;
+
+	// Rounding down means a base texel covers at most 3x3 depth texels, and every
+	// level after that is exactly half the size of the one before
+	pyramid.width = previousPowerOfTwo(depthExtent.width);
+	pyramid.height = previousPowerOfTwo(depthExtent.height);
+	uint32 largest = pyramid.width > pyramid.height ? pyramid.width : pyramid.height;
+	pyramid.numLevels = 1;
+	while ((1u << pyramid.numLevels) <= largest && pyramid.numLevels < vkb_maxHiZLevels)
+	{
+		pyramid.numLevels++;
+	}
+
+	VkImageCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	createInfo.imageType = VK_IMAGE_TYPE_2D;
+	createInfo.format = VK_FORMAT_R32_SFLOAT;
+	createInfo.extent = { pyramid.width, pyramid.height, 1 };
+	createInfo.mipLevels = pyramid.numLevels;
+	createInfo.arrayLayers = 1;
+	createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	uint32 res = vkCreateImage(culler->device, &createInfo, culler->allocator, &pyramid.image);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create Hi-Z pyramid.");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(culler->device, pyramid.image, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = vkb_deviceCaps_findMemoryType(*ctx.caps, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g_logger_assert(allocInfo.memoryTypeIndex != UINT32_MAX, "No device local memory for the Hi-Z pyramid.");
+
+	res = vkAllocateMemory(culler->device, &allocInfo, culler->allocator, &pyramid.memory);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate Hi-Z pyramid memory.");
+	vkBindImageMemory(culler->device, pyramid.image, pyramid.memory, 0);
+
+	pyramid.view = createPyramidView(culler, pyramid.image, 0, pyramid.numLevels);
+	for (uint32 level = 0; level < pyramid.numLevels; level++)
+	{
+		pyramid.levelViews[level] = createPyramidView(culler, pyramid.image, level, 1);
+	}
+
+	VkDescriptorPoolSize poolSizes[3] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = pyramid.numLevels + 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = pyramid.numLevels;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = StatCount + 1;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = pyramid.numLevels + 1;
+	poolCreateInfo.poolSizeCount = 3;
+	poolCreateInfo.pPoolSizes = poolSizes;
+
+	res = vkCreateDescriptorPool(culler->device, &poolCreateInfo, culler->allocator, &pyramid.descriptorPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create Hi-Z descriptor pool.");
+
+	VkDescriptorSetLayout levelLayouts[vkb_maxHiZLevels];
+	for (uint32 level = 0; level < pyramid.numLevels; level++)
+	{
+		levelLayouts[level] = culler->downsampleSetLayout;
+	}
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = pyramid.descriptorPool;
+	setAllocInfo.descriptorSetCount = pyramid.numLevels;
+	setAllocInfo.pSetLayouts = levelLayouts;
+	res = vkAllocateDescriptorSets(culler->device, &setAllocInfo, pyramid.levelSets);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate Hi-Z descriptor sets.");
+
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &culler->cullSetLayout;
+	res = vkAllocateDescriptorSets(culler->device, &setAllocInfo, &pyramid.cullSet);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate occlusion culling descriptor set.");
+
+	// A recreated pyramid's sets take over the keys of the retired one's
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, pyramid.cullSet, vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureCullSet));
+	for (uint32 level = 0; level < pyramid.numLevels; level++)
+	{
+		vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, pyramid.levelSets[level], vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureLevelSet + level));
+	}
+
+	// Level 0 reads the depth buffer, every other level reads the one before it
+	VkDescriptorImageInfo srcInfos[vkb_maxHiZLevels] = {};
+	VkDescriptorImageInfo dstInfos[vkb_maxHiZLevels] = {};
+	VkWriteDescriptorSet writes[vkb_maxHiZLevels * 2 + StatCount + 2] = {};
+	uint32 numWrites = 0;
+	for (uint32 level = 0; level < pyramid.numLevels; level++)
+	{
+		srcInfos[level].sampler = culler->sampler;
+		srcInfos[level].imageView = level == 0 ? depthView : pyramid.levelViews[level - 1];
+		srcInfos[level].imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+		dstInfos[level].imageView = pyramid.levelViews[level];
+		dstInfos[level].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet& srcWrite = writes[numWrites++];
+		srcWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		srcWrite.dstSet = pyramid.levelSets[level];
+		srcWrite.dstBinding = 0;
+		srcWrite.descriptorCount = 1;
+		srcWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		srcWrite.pImageInfo = &srcInfos[level];
+
+		VkWriteDescriptorSet& dstWrite = writes[numWrites++];
+		dstWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		dstWrite.dstSet = pyramid.levelSets[level];
+		dstWrite.dstBinding = 1;
+		dstWrite.descriptorCount = 1;
+		dstWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		dstWrite.pImageInfo = &dstInfos[level];
+	}
+
+	const vkb_Buffer* cullBuffers[] = {
+		&culler->instanceBuffer,
+		&culler->visibilityBuffer,
+		&culler->culledInstanceBuffer,
+		&culler->drawArgsBuffer,
+		&culler->statsBuffer
+	};
+	constexpr uint32 numCullBuffers = sizeof(cullBuffers) / sizeof(cullBuffers[0]);
+	VkDescriptorBufferInfo bufferInfos[numCullBuffers] = {};
+	for (uint32 i = 0; i < numCullBuffers; i++)
+	{
+		bufferInfos[i].buffer = cullBuffers[i]->buffer;
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet& write = writes[numWrites++];
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = pyramid.cullSet;
+		write.dstBinding = i;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &bufferInfos[i];
+	}
+
+	VkDescriptorImageInfo pyramidInfo = {};
+	pyramidInfo.sampler = culler->sampler;
+	pyramidInfo.imageView = pyramid.view;
+	pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkWriteDescriptorSet& pyramidWrite = writes[numWrites++];
+	pyramidWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	pyramidWrite.dstSet = pyramid.cullSet;
+	pyramidWrite.dstBinding = numCullBuffers;
+	pyramidWrite.descriptorCount = 1;
+	pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidWrite.pImageInfo = &pyramidInfo;
+
+	vkUpdateDescriptorSets(culler->device, numWrites, writes, 0, nullptr);
+
+	// The pyramid stays in the general layout for its whole life. Starting out
+	// at the far plane means nothing is occluded until it has been built once.
+	VkCommandBuffer commandBuffer = beginImmediateCommands(culler);
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = pyramid.image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = pyramid.numLevels;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkClearColorValue farPlane = {};
+	farPlane.float32[0] = 1.0f;
+	vkCmdClearColorImage(commandBuffer, pyramid.image, VK_IMAGE_LAYOUT_GENERAL, &farPlane, 1, &barrier.subresourceRange);
+
+	submitImmediateCommands(culler, commandBuffer);
+}
+
+static void retirePyramid(HiZPyramid& pyramid, uint64 retireValue)
+{
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_DESCRIPTOR_POOL, pyramid.descriptorPool, retireValue);
+	for (uint32 level = 0; level < pyramid.numLevels; level++)
+	{
+		vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE_VIEW, pyramid.levelViews[level], retireValue);
+	}
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE_VIEW, pyramid.view, retireValue);
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_IMAGE, pyramid.image, retireValue);
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_DEVICE_MEMORY, pyramid.memory, retireValue);
+	pyramid = {};
+}
+
+static void destroyPyramid(const vkb_OcclusionCuller* culler, HiZPyramid& pyramid)
+{
+	vkDestroyDescriptorPool(culler->device, pyramid.descriptorPool, culler->allocator);
+	for (uint32 level = 0; level < pyramid.numLevels; level++)
+	{
+		vkDestroyImageView(culler->device, pyramid.levelViews[level], culler->allocator);
+	}
+	vkDestroyImageView(culler->device, pyramid.view, culler->allocator);
+	vkDestroyImage(culler->device, pyramid.image, culler->allocator);
+	vkFreeMemory(culler->device, pyramid.memory, culler->allocator);
+	pyramid = {};
+}
+
+static void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+{
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_pipelineBarrier(srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+// ------------ Public Functions ------------
+vkb_OcclusionCuller* vkb_occlusionCuller_create(const vkb_Context& ctx, const vkb_OcclusionCullerDesc& desc, VkImageView depthView, VkExtent2D depthExtent)
+{
+	g_logger_assert(desc.downsampleShader->data != nullptr && desc.cullShader->data != nullptr, "Missing occlusion culling shader bytecode.");
+
+	vkb_OcclusionCuller* culler = (vkb_OcclusionCuller*)g_memory_allocate(sizeof(vkb_OcclusionCuller));
+	new(culler)vkb_OcclusionCuller();
+
+	culler->maxInstances = desc.maxInstances;
+	culler->numInstances = 0;
+	culler->vertexCount = desc.vertexCount;
+	culler->device = ctx.device;
+	culler->allocator = ctx.allocator;
+	culler->queue = ctx.graphicsQueue;
+
+	VkCommandPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolCreateInfo.queueFamilyIndex = ctx.graphicsFamily;
+	uint32 res = vkCreateCommandPool(culler->device, &poolCreateInfo, culler->allocator, &culler->commandPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create occlusion culling command pool.");
+
+	// Texels are only ever fetched, nearest and clamped keeps the sampler valid for both depth and the pyramid
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.maxLod = (float)vkb_maxHiZLevels;
+	res = vkCreateSampler(culler->device, &samplerCreateInfo, culler->allocator, &culler->sampler);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create Hi-Z sampler.");
+
+	VkDescriptorType downsampleTypes[] = {
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+	};
+	culler->downsampleSetLayout = createSetLayout(culler, downsampleTypes, 2);
+	createComputePipeline(culler, *desc.downsampleShader, culler->downsampleSetLayout, sizeof(DownsampleParams), desc.pipelineCache,
+		&culler->downsampleLayout, &culler->downsamplePipeline);
+
+	VkDescriptorType cullTypes[] = {
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+	};
+	culler->cullSetLayout = createSetLayout(culler, cullTypes, 6);
+	createComputePipeline(culler, *desc.cullShader, culler->cullSetLayout, sizeof(CullParams), desc.pipelineCache,
+		&culler->cullLayout, &culler->cullPipeline);
+
+	VkDeviceSize instanceIdsSize = sizeof(uint32) * desc.maxInstances;
+	culler->instanceBuffer = vkb_buffer_create(ctx, sizeof(vkb_OcclusionInstance) * desc.maxInstances,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	culler->visibilityBuffer = vkb_buffer_create(ctx, instanceIdsSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	culler->culledInstanceBuffer = vkb_buffer_create(ctx, instanceIdsSize * 2,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	culler->drawArgsBuffer = vkb_buffer_create(ctx, sizeof(VkDrawIndirectCommand) * 2,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	culler->statsBuffer = vkb_buffer_create(ctx, sizeof(uint32) * StatCount,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	memset(culler->statsBuffer.mapped, 0, sizeof(uint32) * StatCount);
+
+	VkDescriptorPoolSize instancePoolSize = {};
+	instancePoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	instancePoolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo instancePoolCreateInfo = {};
+	instancePoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	instancePoolCreateInfo.maxSets = 1;
+	instancePoolCreateInfo.poolSizeCount = 1;
+	instancePoolCreateInfo.pPoolSizes = &instancePoolSize;
+	res = vkCreateDescriptorPool(culler->device, &instancePoolCreateInfo, culler->allocator, &culler->instancePool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create occlusion culling descriptor pool.");
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = culler->instancePool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &desc.instanceSetLayout;
+	res = vkAllocateDescriptorSets(culler->device, &setAllocInfo, &culler->instanceSet);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate the culled instance descriptor set.");
+
+	VkDescriptorBufferInfo culledInstancesInfo = {};
+	culledInstancesInfo.buffer = culler->culledInstanceBuffer.buffer;
+	culledInstancesInfo.offset = 0;
+	culledInstancesInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = culler->instanceSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &culledInstancesInfo;
+	vkUpdateDescriptorSets(culler->device, 1, &write, 0, nullptr);
+
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE, culler->cullPipeline, vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureCullPipeline));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, culler->cullLayout, vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureCullLayout));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE, culler->downsamplePipeline, vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureDownsamplePipeline));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, culler->downsampleLayout, vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureDownsampleLayout));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, culler->instanceSet, vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureInstanceSet));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_BUFFER, culler->visibilityBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureVisibilityBuffer));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_BUFFER, culler->drawArgsBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureDrawArgsBuffer));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_BUFFER, culler->statsBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::OcclusionCuller, CaptureStatsBuffer));
+
+	VkCommandBuffer commandBuffer = beginImmediateCommands(culler);
+	vkCmdFillBuffer(commandBuffer, culler->visibilityBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+	submitImmediateCommands(culler, commandBuffer);
+
+	createPyramid(ctx, culler, depthView, depthExtent);
+
+	return culler;
+}
+
+void vkb_occlusionCuller_setInstances(const vkb_Context& ctx, vkb_OcclusionCuller* culler, const vkb_OcclusionInstance* instances, uint32 numInstances)
+{
+	g_logger_assert(numInstances <= culler->maxInstances, "%d instances don't fit in an occlusion culler made for %d.", numInstances, culler->maxInstances);
+
+	vkb_staging_upload(ctx, culler->instanceBuffer, 0, instances, sizeof(vkb_OcclusionInstance) * numInstances);
+
+	// NOTE: Nothing is drawn early the first frame, the late phase finds what's visible
+	VkDeviceSize visibilitySize = sizeof(uint32) * numInstances;
+	uint32* visibility = (uint32*)g_memory_allocate(visibilitySize);
+	memset(visibility, 0, visibilitySize);
+	vkb_staging_upload(ctx, culler->visibilityBuffer, 0, visibility, visibilitySize);
+	g_memory_free(visibility);
+
+	culler->numInstances = numInstances;
+}
+
+void vkb_occlusionCuller_setDepthTarget(const vkb_Context& ctx, vkb_OcclusionCuller* culler, VkImageView depthView, VkExtent2D depthExtent, uint64 retireValue)
+{
+	retirePyramid(culler->pyramid, retireValue);
+	createPyramid(ctx, culler, depthView, depthExtent);
+}
+
+void vkb_occlusionCuller_recordCull(vkb_OcclusionCuller* culler, VkCommandBuffer commandBuffer, vkb_OcclusionPhase phase, const glm::mat4& viewProj)
+{
+	bool capturing = vkb_commandCapture_isActive();
+	if (phase == vkb_OcclusionPhase::Early)
+	{
+		// Last frame's draws have to be done with the args and ids, and its late
+		// phase's visibility has to be visible to this one
+		memoryBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		VkDrawIndirectCommand drawArgs[2] = {};
+		drawArgs[0].vertexCount = culler->vertexCount;
+		drawArgs[1].vertexCount = culler->vertexCount;
+		drawArgs[1].firstInstance = culler->maxInstances;
+		vkCmdUpdateBuffer(commandBuffer, culler->drawArgsBuffer.buffer, 0, sizeof(drawArgs), drawArgs);
+		vkCmdFillBuffer(commandBuffer, culler->statsBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+		if (capturing)
+		{
+			vkb_commandCapture_cmdUpdateBuffer(culler->drawArgsBuffer.buffer, 0, sizeof(drawArgs), drawArgs);
+			vkb_commandCapture_fillBuffer(culler->statsBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+		}
+
+		memoryBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+	}
+
+	CullParams params = {};
+	params.viewProj = viewProj;
+	params.pyramidSize[0] = (float)culler->pyramid.width;
+	params.pyramidSize[1] = (float)culler->pyramid.height;
+	params.numInstances = culler->numInstances;
+	params.phase = (uint32)phase;
+	params.maxInstances = culler->maxInstances;
+	params.numLevels = culler->pyramid.numLevels;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culler->cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culler->cullLayout, 0, 1, &culler->pyramid.cullSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, culler->cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+	vkCmdDispatch(commandBuffer, (culler->numInstances + cullGroupSize - 1) / cullGroupSize, 1, 1);
+	if (capturing)
+	{
+		vkb_commandCapture_bindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, culler->cullPipeline);
+		vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, culler->cullLayout, 0, culler->pyramid.cullSet);
+		vkb_commandCapture_pushConstants(culler->cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+		vkb_commandCapture_dispatch((culler->numInstances + cullGroupSize - 1) / cullGroupSize, 1, 1);
+	}
+
+	VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+	VkAccessFlags dstAccess = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	if (phase == vkb_OcclusionPhase::Late)
+	{
+		// The stats are final once the late phase is done
+		dstStages |= VK_PIPELINE_STAGE_HOST_BIT;
+		dstAccess |= VK_ACCESS_HOST_READ_BIT;
+	}
+	memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, dstStages, dstAccess);
+}
+
+void vkb_occlusionCuller_recordDraw(vkb_OcclusionCuller* culler, VkCommandBuffer commandBuffer, vkb_OcclusionPhase phase, VkPipelineLayout pipelineLayout)
+{
+	VkDeviceSize argsOffset = phase == vkb_OcclusionPhase::Early ? 0 : sizeof(VkDrawIndirectCommand);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &culler->instanceSet, 0, nullptr);
+	vkCmdDrawIndirect(commandBuffer, culler->drawArgsBuffer.buffer, argsOffset, 1, sizeof(VkDrawIndirectCommand));
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, culler->instanceSet);
+		vkb_commandCapture_drawIndirect(culler->drawArgsBuffer.buffer, argsOffset, 1, sizeof(VkDrawIndirectCommand));
+	}
+}
+
+void vkb_occlusionCuller_recordBuildPyramid(vkb_OcclusionCuller* culler, VkCommandBuffer commandBuffer)
+{
+	const HiZPyramid& pyramid = culler->pyramid;
+
+	// The early cull has to be done reading last frame's pyramid before it's overwritten. The
+	// depth buffer's transition is covered by the render pass's outgoing dependency.
+	memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culler->downsamplePipeline);
+	bool capturing = vkb_commandCapture_isActive();
+	if (capturing)
+	{
+		vkb_commandCapture_bindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, culler->downsamplePipeline);
+	}
+
+	uint32 srcWidth = pyramid.depthExtent.width;
+	uint32 srcHeight = pyramid.depthExtent.height;
+	for (uint32 level = 0; level < pyramid.numLevels; level++)
+	{
+		uint32 dstWidth = pyramid.width >> level;
+		uint32 dstHeight = pyramid.height >> level;
+		dstWidth = dstWidth > 0 ? dstWidth : 1;
+		dstHeight = dstHeight > 0 ? dstHeight : 1;
+
+		DownsampleParams params = {};
+		params.srcSize[0] = (int32)srcWidth;
+		params.srcSize[1] = (int32)srcHeight;
+		params.dstSize[0] = (int32)dstWidth;
+		params.dstSize[1] = (int32)dstHeight;
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culler->downsampleLayout, 0, 1, &pyramid.levelSets[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, culler->downsampleLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+		vkCmdDispatch(commandBuffer, (dstWidth + downsampleGroupSize - 1) / downsampleGroupSize, (dstHeight + downsampleGroupSize - 1) / downsampleGroupSize, 1);
+		if (capturing)
+		{
+			vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, culler->downsampleLayout, 0, pyramid.levelSets[level]);
+			vkb_commandCapture_pushConstants(culler->downsampleLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+			vkb_commandCapture_dispatch((dstWidth + downsampleGroupSize - 1) / downsampleGroupSize, (dstHeight + downsampleGroupSize - 1) / downsampleGroupSize, 1);
+		}
+
+		// Each level reads the previous one, and the last barrier publishes the
+		// whole pyramid to the late cull
+		memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+}
+
+vkb_OcclusionStats vkb_occlusionCuller_readStats(const vkb_OcclusionCuller* culler)
+{
+	const uint32* counters = (const uint32*)culler->statsBuffer.mapped;
+
+	vkb_OcclusionStats stats = {};
+	stats.numInstances = culler->numInstances;
+	stats.numDrawnEarly = counters[StatDrawnEarly];
+	stats.numDrawnLate = counters[StatDrawnLate];
+	stats.numOccluded = counters[StatOccluded];
+	stats.numOutsideFrustum = counters[StatOutsideFrustum];
+	return stats;
+}
+
+void vkb_occlusionCuller_free(const vkb_Context& ctx, vkb_OcclusionCuller* culler)
+{
+	destroyPyramid(culler, culler->pyramid);
+
+	vkDestroyDescriptorPool(culler->device, culler->instancePool, culler->allocator);
+	vkb_buffer_free(ctx, culler->instanceBuffer);
+	vkb_buffer_free(ctx, culler->visibilityBuffer);
+	vkb_buffer_free(ctx, culler->culledInstanceBuffer);
+	vkb_buffer_free(ctx, culler->drawArgsBuffer);
+	vkb_buffer_free(ctx, culler->statsBuffer);
+
+	vkDestroyPipeline(culler->device, culler->cullPipeline, culler->allocator);
+	vkDestroyPipelineLayout(culler->device, culler->cullLayout, culler->allocator);
+	vkDestroyDescriptorSetLayout(culler->device, culler->cullSetLayout, culler->allocator);
+	vkDestroyPipeline(culler->device, culler->downsamplePipeline, culler->allocator);
+	vkDestroyPipelineLayout(culler->device, culler->downsampleLayout, culler->allocator);
+	vkDestroyDescriptorSetLayout(culler->device, culler->downsampleSetLayout, culler->allocator);
+	vkDestroySampler(culler->device, culler->sampler, culler->allocator);
+	vkDestroyCommandPool(culler->device, culler->commandPool, culler->allocator);
+
+	culler->~vkb_OcclusionCuller();
+	g_memory_free(culler);
+}
@@ -0,0 +1,648 @@
+#include "VulkanBegins/ParticleSystem.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/GpuTimer.h"
+#include "VulkanBegins/File.h"
+#include "VulkanBegins/CommandStream.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <new>
+
+// ------------ Internal structures ------------
+// Matches ParticleParams in particles.comp and particle.vert
+struct ParticleParams
+{
+	// maxParticles, particles to emit this frame, random seed
+	uint32 counts[4];
+	// Emitter position, then spread
+	float emitterPosition[4];
+	// Emitter velocity, then lifetime
+	float emitterVelocity[4];
+	// Gravity, then the frame's delta time
+	float gravity[4];
+	// tan of half the field of view in x and y, near and far distance
+	float projection[4];
+	// Particle size, lifetime jitter
+	float sprite[4];
+};
+
+// Matches Counters in particles.comp and particle.vert. Starts with the
+// indirect arguments so the draw and the simulate dispatch can read them in place.
+struct ParticleCounters
+{
+	VkDrawIndirectCommand draw;
+	VkDispatchIndirectCommand simulate;
+	int32 numFree;
+	// Alive list this frame's particles are appended to
+	uint32 current;
+	// Size of the other alive list, the one being simulated
+	uint32 numToSimulate;
+	uint32 numEmitted;
+	uint32 numDied;
+};
+
+// constant_id 0 of particles.comp
+enum ParticleStage : uint32
+{
+	StageReset,
+	StagePrepare,
+	StageEmit,
+	StageSimulate,
+
+	StageCount
+};
+
+enum TimerScope : uint32
+{
+	TimerSimulate,
+	TimerDraw,
+
+	TimerScopeCount
+};
+
+// Keys the system's objects are captured under, the compute pipelines follow the last one by stage
+enum CaptureObject : uint32
+{
+	CapturePipelineLayout,
+	CaptureDrawPipeline,
+	CaptureParticleSet,
+	CaptureParamsBuffer,
+	CaptureCounterBuffer,
+	CaptureStatsBuffer,
+	CaptureComputePipeline
+};
+
+struct vkb_ParticleSystem
+{
+	uint32 maxParticles;
+	uint32 maxEmitPerFrame;
+	vkb_ParticleEmitterDesc emitter;
+	// Fractional particles carried over to the next frame's emission
+	float emitRemainder;
+	uint32 frame;
+
+	VkDevice device;
+	const VkAllocationCallbacks* allocator;
+
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline computePipelines[StageCount];
+	VkPipeline drawPipeline;
+
+	// Written by the CPU every frame
+	vkb_Buffer paramsBuffer;
+	// Structure of arrays, one element per particle
+	vkb_Buffer positionBuffer;
+	vkb_Buffer velocityBuffer;
+	// Free particle indices, used as a stack
+	vkb_Buffer deadListBuffer;
+	// Two lists of alive particle indices back to back, simulated from one into the other
+	vkb_Buffer aliveListBuffer;
+	vkb_Buffer counterBuffer;
+	// Copy of the counters for the host to read
+	vkb_Buffer statsBuffer;
+
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet particleSet;
+
+	vkb_GpuTimer timer;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 groupSize = 64;
+static constexpr uint32 numBindings = 6;
+// Frames longer than this are simulated as if they weren't, so a hitch doesn't fling everything
+static constexpr float maxDeltaTime = 0.1f;
+
+// ------------ Internal Functions ------------
+static void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+{
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_pipelineBarrier(srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+static void bindComputeStage(vkb_ParticleSystem* particles, VkCommandBuffer commandBuffer, ParticleStage stage)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particles->computePipelines[stage]);
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_bindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, particles->computePipelines[stage]);
+	}
+}
+
+static VkShaderModule createShaderModule(const vkb_ParticleSystem* particles, const vkb_FileContents& bytecode)
+{
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = bytecode.size;
+	createInfo.pCode = (const uint32*)bytecode.data;
+
+	VkShaderModule module;
+	uint32 res = vkCreateShaderModule(particles->device, &createInfo, particles->allocator, &module);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create particle shader module.");
+	return module;
+}
+
+static void createSetLayout(vkb_ParticleSystem* particles)
+{
+	// The draw reads the same set as the compute passes
+	VkDescriptorSetLayoutBinding bindings[numBindings] = {};
+	for (uint32 i = 0; i < numBindings; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	createInfo.bindingCount = numBindings;
+	createInfo.pBindings = bindings;
+
+	uint32 res = vkCreateDescriptorSetLayout(particles->device, &createInfo, particles->allocator, &particles->setLayout);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create particle descriptor set layout.");
+
+	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &particles->setLayout;
+
+	res = vkCreatePipelineLayout(particles->device, &layoutCreateInfo, particles->allocator, &particles->pipelineLayout);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create particle pipeline layout.");
+}
+
+static void createComputePipelines(vkb_ParticleSystem* particles, const vkb_ParticleSystemDesc& desc)
+{
+	VkShaderModule module = createShaderModule(particles, *desc.computeShader);
+
+	// Every stage is the same shader specialized on its stage
+	uint32 stages[StageCount];
+	VkSpecializationMapEntry mapEntries[StageCount] = {};
+	VkSpecializationInfo specializations[StageCount] = {};
+	VkComputePipelineCreateInfo createInfos[StageCount] = {};
+	for (uint32 i = 0; i < StageCount; i++)
+	{
+		stages[i] = i;
+		mapEntries[i].constantID = 0;
+		mapEntries[i].offset = 0;
+		mapEntries[i].size = sizeof(uint32);
+
+		specializations[i].mapEntryCount = 1;
+		specializations[i].pMapEntries = &mapEntries[i];
+		specializations[i].dataSize = sizeof(uint32);
+		specializations[i].pData = &stages[i];
+
+		createInfos[i].sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		createInfos[i].stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		createInfos[i].stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		createInfos[i].stage.module = module;
+		createInfos[i].stage.pName = "main";
+		createInfos[i].stage.pSpecializationInfo = &specializations[i];
+		createInfos[i].layout = particles->pipelineLayout;
+		createInfos[i].basePipelineIndex = -1;
+	}
+
+	uint32 res = vkCreateComputePipelines(particles->device, desc.pipelineCache, StageCount, createInfos, particles->allocator, particles->computePipelines);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create particle compute pipelines.");
+
+	vkDestroyShaderModule(particles->device, module, particles->allocator);
+}
+
+static void createDrawPipeline(vkb_ParticleSystem* particles, const vkb_ParticleSystemDesc& desc)
+{
+	VkShaderModule vertModule = createShaderModule(particles, *desc.vertShader);
+	VkShaderModule fragModule = createShaderModule(particles, *desc.fragShader);
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragModule;
+	shaderStages[1].pName = "main";
+
+	// Quads are built from gl_VertexIndex and the particle from gl_InstanceIndex
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
+	dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateInfo.dynamicStateCount = 2;
+	dynamicStateInfo.pDynamicStates = dynamicStates;
+
+	VkPipelineViewportStateCreateInfo viewportInfo = {};
+	viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportInfo.viewportCount = 1;
+	viewportInfo.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterInfo = {};
+	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterInfo.lineWidth = 1.0f;
+	rasterInfo.cullMode = VK_CULL_MODE_NONE;
+	rasterInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo = {};
+	multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleInfo.minSampleShading = 1.0f;
+
+	// Additive, so the particles don't have to be sorted
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT |
+		VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo blendInfo = {};
+	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blendInfo.attachmentCount = 1;
+	blendInfo.pAttachments = &colorBlendAttachment;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilInfo = {};
+	depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilInfo.depthTestEnable = VK_TRUE;
+	depthStencilInfo.depthWriteEnable = VK_FALSE;
+	depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	VkGraphicsPipelineCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	createInfo.stageCount = 2;
+	createInfo.pStages = shaderStages;
+	createInfo.pVertexInputState = &vertexInputInfo;
+	createInfo.pInputAssemblyState = &inputAssembly;
+	createInfo.pViewportState = &viewportInfo;
+	createInfo.pRasterizationState = &rasterInfo;
+	createInfo.pMultisampleState = &multisampleInfo;
+	createInfo.pDepthStencilState = &depthStencilInfo;
+	createInfo.pColorBlendState = &blendInfo;
+	createInfo.pDynamicState = &dynamicStateInfo;
+	createInfo.layout = particles->pipelineLayout;
+	createInfo.renderPass = desc.renderPass;
+	createInfo.subpass = 0;
+	createInfo.basePipelineIndex = -1;
+
+	uint32 res = vkCreateGraphicsPipelines(particles->device, desc.pipelineCache, 1, &createInfo, particles->allocator, &particles->drawPipeline);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create particle draw pipeline.");
+
+	vkDestroyShaderModule(particles->device, vertModule, particles->allocator);
+	vkDestroyShaderModule(particles->device, fragModule, particles->allocator);
+}
+
+static void createParticleSet(vkb_ParticleSystem* particles)
+{
+	VkDescriptorPoolSize poolSizes[2] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = numBindings - 1;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = 2;
+	poolCreateInfo.pPoolSizes = poolSizes;
+
+	uint32 res = vkCreateDescriptorPool(particles->device, &poolCreateInfo, particles->allocator, &particles->descriptorPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create particle descriptor pool.");
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = particles->descriptorPool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &particles->setLayout;
+	res = vkAllocateDescriptorSets(particles->device, &setAllocInfo, &particles->particleSet);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate the particle descriptor set.");
+
+	// Binding order of particles.comp
+	const vkb_Buffer* buffers[numBindings] = {
+		&particles->paramsBuffer,
+		&particles->positionBuffer,
+		&particles->velocityBuffer,
+		&particles->deadListBuffer,
+		&particles->aliveListBuffer,
+		&particles->counterBuffer
+	};
+
+	VkDescriptorBufferInfo bufferInfos[numBindings] = {};
+	VkWriteDescriptorSet writes[numBindings] = {};
+	for (uint32 i = 0; i < numBindings; i++)
+	{
+		bufferInfos[i].buffer = buffers[i]->buffer;
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = particles->particleSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(particles->device, numBindings, writes, 0, nullptr);
+}
+
+// Fills the dead list with every particle and sets up the indirect arguments
+static void resetParticles(const vkb_Context& ctx, vkb_ParticleSystem* particles)
+{
+	VkCommandPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolCreateInfo.queueFamilyIndex = ctx.graphicsFamily;
+
+	VkCommandPool commandPool;
+	uint32 res = vkCreateCommandPool(particles->device, &poolCreateInfo, particles->allocator, &commandPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create particle command pool.");
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	res = vkAllocateCommandBuffers(particles->device, &allocInfo, &commandBuffer);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate particle command buffer.");
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particles->computePipelines[StageReset]);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particles->pipelineLayout, 0, 1, &particles->particleSet, 0, nullptr);
+	vkCmdDispatch(commandBuffer, (particles->maxParticles + groupSize - 1) / groupSize, 1, 1);
+
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	res = vkQueueSubmit(ctx.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	g_logger_assert(res == VK_SUCCESS, "Failed to submit particle reset.");
+	vkQueueWaitIdle(ctx.graphicsQueue);
+
+	vkDestroyCommandPool(particles->device, commandPool, particles->allocator);
+}
+
+// ------------ Public Functions ------------
+vkb_ParticleSystem* vkb_particleSystem_create(const vkb_Context& ctx, const vkb_ParticleSystemDesc& desc)
+{
+	g_logger_assert(desc.computeShader->data != nullptr && desc.vertShader->data != nullptr && desc.fragShader->data != nullptr,
+		"Missing particle shader bytecode.");
+	g_logger_assert(desc.maxParticles > 0 && desc.maxEmitPerFrame > 0, "A particle system needs room for at least one particle.");
+
+	vkb_ParticleSystem* particles = (vkb_ParticleSystem*)g_memory_allocate(sizeof(vkb_ParticleSystem));
+	new(particles)vkb_ParticleSystem();
+
+	particles->maxParticles = desc.maxParticles;
+	particles->maxEmitPerFrame = desc.maxEmitPerFrame;
+	particles->emitter = desc.emitter;
+	particles->emitRemainder = 0.0f;
+	particles->frame = 0;
+	particles->device = ctx.device;
+	particles->allocator = ctx.allocator;
+
+	createSetLayout(particles);
+	createComputePipelines(particles, desc);
+	createDrawPipeline(particles, desc);
+
+	VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	particles->paramsBuffer = vkb_buffer_create(ctx, sizeof(ParticleParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible);
+	// The per particle ones count against the memory budget
+	particles->positionBuffer = vkb_buffer_createResident(ctx, sizeof(float) * 4 * desc.maxParticles,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	particles->velocityBuffer = vkb_buffer_createResident(ctx, sizeof(float) * 4 * desc.maxParticles,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	particles->deadListBuffer = vkb_buffer_createResident(ctx, sizeof(uint32) * desc.maxParticles,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	particles->aliveListBuffer = vkb_buffer_createResident(ctx, sizeof(uint32) * 2 * desc.maxParticles,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	particles->counterBuffer = vkb_buffer_create(ctx, sizeof(ParticleCounters),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	particles->statsBuffer = vkb_buffer_create(ctx, sizeof(ParticleCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible);
+	memset(particles->paramsBuffer.mapped, 0, sizeof(ParticleParams));
+	memset(particles->statsBuffer.mapped, 0, sizeof(ParticleCounters));
+
+	// The reset only reads maxParticles
+	ParticleParams params = {};
+	params.counts[0] = desc.maxParticles;
+	memcpy(particles->paramsBuffer.mapped, &params, sizeof(params));
+
+	createParticleSet(particles);
+	resetParticles(ctx, particles);
+
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, particles->pipelineLayout, vkb_captureKey(vkb_CaptureOwner::ParticleSystem, CapturePipelineLayout));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE, particles->drawPipeline, vkb_captureKey(vkb_CaptureOwner::ParticleSystem, CaptureDrawPipeline));
+	for (uint32 stage = 0; stage < StageCount; stage++)
+	{
+		vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE, particles->computePipelines[stage], vkb_captureKey(vkb_CaptureOwner::ParticleSystem, CaptureComputePipeline + stage));
+	}
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, particles->particleSet, vkb_captureKey(vkb_CaptureOwner::ParticleSystem, CaptureParticleSet));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_BUFFER, particles->counterBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::ParticleSystem, CaptureCounterBuffer));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_BUFFER, particles->statsBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::ParticleSystem, CaptureStatsBuffer));
+	vkb_commandCapture_trackBuffer(particles->paramsBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::ParticleSystem, CaptureParamsBuffer),
+		sizeof(ParticleParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, particles->paramsBuffer.mapped);
+
+	particles->timer = vkb_gpuTimer_create(ctx, TimerScopeCount);
+
+	return particles;
+}
+
+void vkb_particleSystem_update(vkb_ParticleSystem* particles, float deltaTime, const vkb_ParticleView& view)
+{
+	deltaTime = deltaTime < maxDeltaTime ? deltaTime : maxDeltaTime;
+	deltaTime = deltaTime > 0.0f ? deltaTime : 0.0f;
+
+	// Whatever doesn't fit in this frame's emission is dropped rather than
+	// carried over, so a long frame doesn't turn into a burst
+	float toEmit = particles->emitter.emissionRate * deltaTime + particles->emitRemainder;
+	uint32 emitCount = (uint32)toEmit;
+	particles->emitRemainder = toEmit - (float)emitCount;
+	if (emitCount > particles->maxEmitPerFrame)
+	{
+		emitCount = particles->maxEmitPerFrame;
+		particles->emitRemainder = 0.0f;
+	}
+
+	const vkb_ParticleEmitterDesc& emitter = particles->emitter;
+	ParticleParams params = {};
+	params.counts[0] = particles->maxParticles;
+	params.counts[1] = emitCount;
+	params.counts[2] = particles->frame++;
+	memcpy(params.emitterPosition, emitter.position, sizeof(emitter.position));
+	params.emitterPosition[3] = emitter.spread;
+	memcpy(params.emitterVelocity, emitter.velocity, sizeof(emitter.velocity));
+	params.emitterVelocity[3] = emitter.lifetime;
+	memcpy(params.gravity, emitter.gravity, sizeof(emitter.gravity));
+	params.gravity[3] = deltaTime;
+	params.projection[0] = view.tanHalfFovX;
+	params.projection[1] = view.tanHalfFovY;
+	params.projection[2] = view.nearZ;
+	params.projection[3] = view.farZ;
+	params.sprite[0] = emitter.size;
+	params.sprite[1] = emitter.lifetimeJitter;
+	memcpy(particles->paramsBuffer.mapped, &params, sizeof(params));
+	vkb_commandCapture_updateBuffer(particles->paramsBuffer.buffer, 0, &params, sizeof(params));
+}
+
+void vkb_particleSystem_recordSimulate(vkb_ParticleSystem* particles, VkCommandBuffer commandBuffer)
+{
+	vkb_gpuTimer_reset(particles->timer, commandBuffer);
+	vkb_gpuTimer_begin(particles->timer, commandBuffer, TimerSimulate);
+
+	// Last frame's draw and stats copy have to be done with the lists and counters
+	memoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0);
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particles->pipelineLayout, 0, 1, &particles->particleSet, 0, nullptr);
+	bool capturing = vkb_commandCapture_isActive();
+	if (capturing)
+	{
+		vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, particles->pipelineLayout, 0, particles->particleSet);
+	}
+
+	bindComputeStage(particles, commandBuffer, StagePrepare);
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+	if (capturing)
+	{
+		vkb_commandCapture_dispatch(1, 1, 1);
+	}
+	memoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	bindComputeStage(particles, commandBuffer, StageEmit);
+	vkCmdDispatch(commandBuffer, (particles->maxEmitPerFrame + groupSize - 1) / groupSize, 1, 1);
+	if (capturing)
+	{
+		vkb_commandCapture_dispatch((particles->maxEmitPerFrame + groupSize - 1) / groupSize, 1, 1);
+	}
+
+	// Emit pops the dead list and simulate pushes onto it, they can't overlap
+	memoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+
+	bindComputeStage(particles, commandBuffer, StageSimulate);
+	vkCmdDispatchIndirect(commandBuffer, particles->counterBuffer.buffer, offsetof(ParticleCounters, simulate));
+	if (capturing)
+	{
+		vkb_commandCapture_dispatchIndirect(particles->counterBuffer.buffer, offsetof(ParticleCounters, simulate));
+	}
+
+	memoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+
+	VkBufferCopy copy = {};
+	copy.size = sizeof(ParticleCounters);
+	vkCmdCopyBuffer(commandBuffer, particles->counterBuffer.buffer, particles->statsBuffer.buffer, 1, &copy);
+	if (capturing)
+	{
+		vkb_commandCapture_copyBuffer(particles->counterBuffer.buffer, particles->statsBuffer.buffer, copy);
+	}
+	memoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+
+	vkb_gpuTimer_end(particles->timer, commandBuffer, TimerSimulate);
+}
+
+void vkb_particleSystem_recordDraw(vkb_ParticleSystem* particles, VkCommandBuffer commandBuffer)
+{
+	vkb_gpuTimer_begin(particles->timer, commandBuffer, TimerDraw);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, particles->drawPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, particles->pipelineLayout, 0, 1, &particles->particleSet, 0, nullptr);
+	vkCmdDrawIndirect(commandBuffer, particles->counterBuffer.buffer, offsetof(ParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, particles->drawPipeline);
+		vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, particles->pipelineLayout, 0, particles->particleSet);
+		vkb_commandCapture_drawIndirect(particles->counterBuffer.buffer, offsetof(ParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+	}
+	vkb_gpuTimer_end(particles->timer, commandBuffer, TimerDraw);
+}
+
+void vkb_particleSystem_markUsed(const vkb_ParticleSystem* particles, uint64 frameIndex)
+{
+	vkb_residency_markUsed(particles->positionBuffer.residentResource, frameIndex);
+	vkb_residency_markUsed(particles->velocityBuffer.residentResource, frameIndex);
+	vkb_residency_markUsed(particles->deadListBuffer.residentResource, frameIndex);
+	vkb_residency_markUsed(particles->aliveListBuffer.residentResource, frameIndex);
+}
+
+vkb_ParticleStats vkb_particleSystem_readStats(const vkb_Context& ctx, const vkb_ParticleSystem* particles)
+{
+	ParticleCounters counters;
+	memcpy(&counters, particles->statsBuffer.mapped, sizeof(counters));
+
+	vkb_ParticleStats stats = {};
+	stats.numAlive = counters.draw.instanceCount;
+	stats.numFree = counters.numFree > 0 ? (uint32)counters.numFree : 0;
+	stats.numEmitted = counters.numEmitted;
+	stats.numDied = counters.numDied;
+	stats.timingSupported = vkb_gpuTimer_read(ctx, particles->timer, TimerSimulate, &stats.simulateMs) &&
+		vkb_gpuTimer_read(ctx, particles->timer, TimerDraw, &stats.drawMs);
+	return stats;
+}
+
+void vkb_particleSystem_free(const vkb_Context& ctx, vkb_ParticleSystem* particles)
+{
+	vkb_gpuTimer_free(ctx, particles->timer);
+	vkDestroyDescriptorPool(particles->device, particles->descriptorPool, particles->allocator);
+
+	vkb_commandCapture_untrackBuffer(particles->paramsBuffer.buffer);
+	vkb_buffer_free(ctx, particles->paramsBuffer);
+	vkb_buffer_free(ctx, particles->positionBuffer);
+	vkb_buffer_free(ctx, particles->velocityBuffer);
+	vkb_buffer_free(ctx, particles->deadListBuffer);
+	vkb_buffer_free(ctx, particles->aliveListBuffer);
+	vkb_buffer_free(ctx, particles->counterBuffer);
+	vkb_buffer_free(ctx, particles->statsBuffer);
+
+	for (uint32 i = 0; i < StageCount; i++)
+	{
+		vkDestroyPipeline(particles->device, particles->computePipelines[i], particles->allocator);
+	}
+	vkDestroyPipeline(particles->device, particles->drawPipeline, particles->allocator);
+	vkDestroyPipelineLayout(particles->device, particles->pipelineLayout, particles->allocator);
+	vkDestroyDescriptorSetLayout(particles->device, particles->setLayout, particles->allocator);
+
+	particles->~vkb_ParticleSystem();
+	g_memory_free(particles);
+}
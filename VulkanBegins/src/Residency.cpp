@@ -0,0 +1,454 @@
+#include "VulkanBegins/Residency.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/DeviceCaps.h"
+#include "VulkanBegins/Arena.h"
+#include "VulkanBegins/DeletionQueue.h"
+
+#include <algorithm>
+#include <atomic>
+
+// ------------ Internal structures ------------
+struct ResidentResource
+{
+	vkb_ResidentResourceDesc desc;
+	uint32 heapIndex;
+	uint32 firstResidentMip;
+	VkDeviceSize residentSize;
+	uint64 lastUsedFrame;
+	bool alive;
+	// Next free slot while not alive
+	uint32 nextFree;
+};
+
+// ------------ Internal Variables ------------
+// Budget and usage reported by the driver lag behind our frees by a few frames
+// (deferred deletion, driver bookkeeping), so after changing a heap's residency
+// we don't judge it again until this many frames have passed
+static constexpr uint32 settleFrames = 3;
+
+static vkb_ResidencyConfig config;
+static const vkb_DeviceCaps* caps = nullptr;
+static PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+static bool memoryPriorityEnabled = false;
+
+static std::atomic<uint64> trackedUsage[VK_MAX_MEMORY_HEAPS];
+static vkb_ResidencyHeapStats heaps[VK_MAX_MEMORY_HEAPS];
+static uint64 nextJudgedFrame[VK_MAX_MEMORY_HEAPS];
+// 0 when the heap's budget isn't capped, see vkb_residency_setBudgetLimit
+static VkDeviceSize budgetLimits[VK_MAX_MEMORY_HEAPS];
+// Set once a heap is stuck over budget, so it's reported once instead of every
+// time it's judged. Cleared when the heap is back under budget.
+static bool reportedOverBudget[VK_MAX_MEMORY_HEAPS];
+static uint32 numHeaps = 0;
+
+static ResidentResource* resources = nullptr;
+static uint32 numSlots = 0;
+static uint32 slotCapacity = 0;
+static uint32 firstFreeSlot = vkb_nullResidentResource;
+static uint32 numAlive = 0;
+
+static uint32 numMipsDropped = 0;
+static uint32 numMipsRestored = 0;
+
+// ------------ Internal Functions ------------
+static float toMemoryPriority(vkb_StreamingPriority priority)
+{
+	switch (priority)
+	{
+	case vkb_StreamingPriority::Low:
+		return 0.25f;
+	case vkb_StreamingPriority::Normal:
+		return 0.5f;
+	case vkb_StreamingPriority::High:
+		return 0.75f;
+	case vkb_StreamingPriority::Critical:
+		return 1.0f;
+	}
+
+	return 0.5f;
+}
+
+// Each mip is roughly a quarter of the one above it, so dropping the top mip of
+// a full chain frees about three quarters of it
+static VkDeviceSize estimateSize(const ResidentResource& resource, uint32 firstResidentMip)
+{
+	if (firstResidentMip >= resource.desc.numMips)
+	{
+		return 0;
+	}
+
+	uint32 shift = firstResidentMip * 2;
+	return shift < 64 ? resource.desc.fullSize >> shift : 0;
+}
+
+static void applyBudgetLimits()
+{
+	for (uint32 i = 0; i < numHeaps; i++)
+	{
+		if (budgetLimits[i] != 0 && budgetLimits[i] < heaps[i].budget)
+		{
+			heaps[i].budget = budgetLimits[i];
+		}
+	}
+}
+
+static void refreshBudgets()
+{
+	if (getMemoryProperties2 != nullptr)
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+		VkPhysicalDeviceMemoryProperties2KHR properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		properties.pNext = &budgetProperties;
+		getMemoryProperties2(caps->physicalDevice, &properties);
+
+		for (uint32 i = 0; i < numHeaps; i++)
+		{
+			heaps[i].usage = budgetProperties.heapUsage[i];
+			heaps[i].budget = budgetProperties.heapBudget[i];
+		}
+		applyBudgetLimits();
+		return;
+	}
+
+	for (uint32 i = 0; i < numHeaps; i++)
+	{
+		heaps[i].usage = trackedUsage[i].load(std::memory_order_relaxed);
+		heaps[i].budget = (VkDeviceSize)((double)heaps[i].size * config.fallbackBudget);
+	}
+	applyBudgetLimits();
+}
+
+static void setFirstResidentMip(ResidentResource& resource, uint32 firstResidentMip)
+{
+	resource.residentSize = resource.desc.changeResidency(firstResidentMip, resource.desc.userData);
+	resource.firstResidentMip = firstResidentMip;
+}
+
+// Drops a mip at a time from the least important, least recently used
+// resources first, going around again until enough has been freed
+static void evict(uint32 heapIndex, VkDeviceSize bytesNeeded)
+{
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	uint32* candidates = vkb_arena_allocateArray<uint32>(vkb_scratch_get(), numSlots);
+	uint32 numCandidates = 0;
+	for (uint32 i = 0; i < numSlots; i++)
+	{
+		const ResidentResource& resource = resources[i];
+		if (resource.alive && resource.heapIndex == heapIndex &&
+			resource.desc.priority != vkb_StreamingPriority::Critical &&
+			resource.firstResidentMip < resource.desc.numMips)
+		{
+			candidates[numCandidates++] = i;
+		}
+	}
+
+	std::sort(candidates, candidates + numCandidates, [](uint32 a, uint32 b)
+	{
+		if (resources[a].desc.priority != resources[b].desc.priority)
+		{
+			return resources[a].desc.priority < resources[b].desc.priority;
+		}
+		return resources[a].lastUsedFrame < resources[b].lastUsedFrame;
+	});
+
+	VkDeviceSize freed = 0;
+	bool progress = true;
+	while (freed < bytesNeeded && progress)
+	{
+		progress = false;
+		for (uint32 i = 0; i < numCandidates && freed < bytesNeeded; i++)
+		{
+			ResidentResource& resource = resources[candidates[i]];
+			if (resource.firstResidentMip >= resource.desc.numMips)
+			{
+				continue;
+			}
+
+			VkDeviceSize before = resource.residentSize;
+			setFirstResidentMip(resource, resource.firstResidentMip + 1);
+			freed += before > resource.residentSize ? before - resource.residentSize : 0;
+			numMipsDropped++;
+			progress = true;
+		}
+	}
+
+	vkb_scratch_end(scratch);
+
+	if (freed < bytesNeeded && !reportedOverBudget[heapIndex])
+	{
+		g_logger_warning("Memory heap %d is over budget by %d MB with nothing left to evict.", heapIndex, (int)((bytesNeeded - freed) / (1024 * 1024)));
+		reportedOverBudget[heapIndex] = true;
+	}
+}
+
+// Gives recently used resources one mip back each, most important first, for as
+// long as the estimated growth fits in the room left
+static void restore(uint32 heapIndex, VkDeviceSize room, uint64 frameIndex)
+{
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	uint32* candidates = vkb_arena_allocateArray<uint32>(vkb_scratch_get(), numSlots);
+	uint32 numCandidates = 0;
+	for (uint32 i = 0; i < numSlots; i++)
+	{
+		const ResidentResource& resource = resources[i];
+		if (resource.alive && resource.heapIndex == heapIndex && resource.firstResidentMip > 0 &&
+			resource.lastUsedFrame + config.restoreWindowFrames >= frameIndex)
+		{
+			candidates[numCandidates++] = i;
+		}
+	}
+
+	std::sort(candidates, candidates + numCandidates, [](uint32 a, uint32 b)
+	{
+		if (resources[a].desc.priority != resources[b].desc.priority)
+		{
+			return resources[a].desc.priority > resources[b].desc.priority;
+		}
+		return resources[a].lastUsedFrame > resources[b].lastUsedFrame;
+	});
+
+	for (uint32 i = 0; i < numCandidates; i++)
+	{
+		ResidentResource& resource = resources[candidates[i]];
+		VkDeviceSize restoredSize = estimateSize(resource, resource.firstResidentMip - 1);
+		VkDeviceSize growth = restoredSize > resource.residentSize ? restoredSize - resource.residentSize : 0;
+		if (growth > room)
+		{
+			continue;
+		}
+
+		VkDeviceSize before = resource.residentSize;
+		setFirstResidentMip(resource, resource.firstResidentMip - 1);
+		VkDeviceSize actualGrowth = resource.residentSize > before ? resource.residentSize - before : 0;
+		room = actualGrowth < room ? room - actualGrowth : 0;
+		numMipsRestored++;
+	}
+
+	vkb_scratch_end(scratch);
+}
+
+// ------------ Public Functions ------------
+vkb_ResidencyConfig vkb_residency_defaultConfig()
+{
+	vkb_ResidencyConfig result = {};
+	result.targetUsage = 0.9f;
+	result.restoreBelow = 0.75f;
+	// Leaves room for other processes and allocations we don't know about
+	result.fallbackBudget = 0.8f;
+	result.restoreWindowFrames = 60;
+	return result;
+}
+
+void vkb_residency_init(const vkb_Context& ctx, const vkb_ResidencyConfig& residencyConfig)
+{
+	config = residencyConfig;
+	caps = ctx.caps;
+	memoryPriorityEnabled = ctx.memoryPriorityEnabled;
+
+	getMemoryProperties2 = nullptr;
+	if (ctx.memoryBudgetEnabled)
+	{
+		getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(ctx.instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+	}
+	if (getMemoryProperties2 == nullptr)
+	{
+		g_logger_info("VK_EXT_memory_budget isn't available, assuming %d%% of each memory heap is usable.", (int)(config.fallbackBudget * 100.0f));
+	}
+
+	numHeaps = caps->memoryProperties.memoryHeapCount;
+	for (uint32 i = 0; i < numHeaps; i++)
+	{
+		trackedUsage[i].store(0, std::memory_order_relaxed);
+		heaps[i] = {};
+		heaps[i].size = caps->memoryProperties.memoryHeaps[i].size;
+		nextJudgedFrame[i] = 0;
+		budgetLimits[i] = 0;
+		reportedOverBudget[i] = false;
+	}
+	refreshBudgets();
+
+	slotCapacity = 64;
+	resources = (ResidentResource*)g_memory_allocate(sizeof(ResidentResource) * slotCapacity);
+	numSlots = 0;
+	firstFreeSlot = vkb_nullResidentResource;
+	numAlive = 0;
+	numMipsDropped = 0;
+	numMipsRestored = 0;
+}
+
+VkResult vkb_residency_allocateMemory(const vkb_Context& ctx, const VkMemoryAllocateInfo& allocInfo, vkb_StreamingPriority priority, VkDeviceMemory* memory)
+{
+	VkMemoryAllocateInfo info = allocInfo;
+	VkMemoryPriorityAllocateInfoEXT priorityInfo = {};
+	if (memoryPriorityEnabled)
+	{
+		priorityInfo.sType = VK_STRUCTURE_TYPE_MEMORY_PRIORITY_ALLOCATE_INFO_EXT;
+		priorityInfo.pNext = info.pNext;
+		priorityInfo.priority = toMemoryPriority(priority);
+		info.pNext = &priorityInfo;
+	}
+
+	VkResult result = vkAllocateMemory(ctx.device, &info, ctx.allocator, memory);
+	if (result == VK_SUCCESS)
+	{
+		uint32 heapIndex = caps->memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+		trackedUsage[heapIndex].fetch_add(allocInfo.allocationSize, std::memory_order_relaxed);
+	}
+
+	return result;
+}
+
+void vkb_residency_freeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32 memoryTypeIndex, uint64 retireValue)
+{
+	vkb_deletionQueue_push(VK_OBJECT_TYPE_DEVICE_MEMORY, memory, retireValue);
+
+	uint32 heapIndex = caps->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	trackedUsage[heapIndex].fetch_sub(size, std::memory_order_relaxed);
+}
+
+vkb_ResidentResource vkb_residency_register(const vkb_ResidentResourceDesc& desc)
+{
+	g_logger_assert((desc.changeResidency != nullptr || desc.priority == vkb_StreamingPriority::Critical) && desc.numMips > 0,
+		"Resident resources need a residency callback and at least one mip.");
+	g_logger_assert(desc.memoryTypeIndex < caps->memoryProperties.memoryTypeCount, "Invalid memory type %d.", desc.memoryTypeIndex);
+
+	uint32 slot = firstFreeSlot;
+	if (slot != vkb_nullResidentResource)
+	{
+		firstFreeSlot = resources[slot].nextFree;
+	}
+	else
+	{
+		if (numSlots == slotCapacity)
+		{
+			slotCapacity *= 2;
+			resources = (ResidentResource*)g_memory_realloc(resources, sizeof(ResidentResource) * slotCapacity);
+		}
+		slot = numSlots++;
+	}
+
+	ResidentResource& resource = resources[slot];
+	resource = {};
+	resource.desc = desc;
+	resource.heapIndex = caps->memoryProperties.memoryTypes[desc.memoryTypeIndex].heapIndex;
+	resource.firstResidentMip = 0;
+	resource.residentSize = desc.fullSize;
+	resource.lastUsedFrame = 0;
+	resource.alive = true;
+	resource.nextFree = vkb_nullResidentResource;
+	numAlive++;
+
+	return slot;
+}
+
+void vkb_residency_unregister(vkb_ResidentResource resource)
+{
+	g_logger_assert(resource < numSlots && resources[resource].alive, "Unregistering an unknown resident resource %d.", resource);
+
+	resources[resource].alive = false;
+	resources[resource].nextFree = firstFreeSlot;
+	firstFreeSlot = resource;
+	numAlive--;
+}
+
+void vkb_residency_markUsed(vkb_ResidentResource resource, uint64 frameIndex)
+{
+	resources[resource].lastUsedFrame = frameIndex;
+}
+
+uint32 vkb_residency_getFirstResidentMip(vkb_ResidentResource resource)
+{
+	return resources[resource].firstResidentMip;
+}
+
+void vkb_residency_update(uint64 frameIndex)
+{
+	refreshBudgets();
+
+	for (uint32 i = 0; i < numHeaps; i++)
+	{
+		if (frameIndex < nextJudgedFrame[i])
+		{
+			continue;
+		}
+
+		const vkb_ResidencyHeapStats& heap = heaps[i];
+		VkDeviceSize target = (VkDeviceSize)((double)heap.budget * config.targetUsage);
+		VkDeviceSize restoreLimit = (VkDeviceSize)((double)heap.budget * config.restoreBelow);
+		if (heap.usage > heap.budget)
+		{
+			evict(i, heap.usage - target);
+			nextJudgedFrame[i] = frameIndex + settleFrames;
+			continue;
+		}
+
+		reportedOverBudget[i] = false;
+		if (heap.usage < restoreLimit)
+		{
+			uint32 restoredBefore = numMipsRestored;
+			restore(i, restoreLimit - heap.usage, frameIndex);
+			if (numMipsRestored != restoredBefore)
+			{
+				nextJudgedFrame[i] = frameIndex + settleFrames;
+			}
+		}
+	}
+}
+
+vkb_ResidencyStats vkb_residency_getStats()
+{
+	vkb_ResidencyStats stats = {};
+	for (uint32 i = 0; i < numHeaps; i++)
+	{
+		stats.heaps[i] = heaps[i];
+	}
+	stats.numHeaps = numHeaps;
+	stats.budgetFromDriver = getMemoryProperties2 != nullptr;
+	stats.numResources = numAlive;
+
+	for (uint32 i = 0; i < numSlots; i++)
+	{
+		const ResidentResource& resource = resources[i];
+		if (!resource.alive)
+		{
+			continue;
+		}
+
+		if (resource.firstResidentMip >= resource.desc.numMips)
+		{
+			stats.numEvicted++;
+		}
+		else if (resource.firstResidentMip > 0)
+		{
+			stats.numDowngraded++;
+		}
+	}
+
+	stats.numMipsDropped = numMipsDropped;
+	stats.numMipsRestored = numMipsRestored;
+	return stats;
+}
+
+void vkb_residency_setBudgetLimit(uint32 heapIndex, VkDeviceSize limit)
+{
+	g_logger_assert(heapIndex < numHeaps, "Invalid memory heap %d.", heapIndex);
+	budgetLimits[heapIndex] = limit;
+	// Judged again on the next update instead of waiting out a settle
+	nextJudgedFrame[heapIndex] = 0;
+}
+
+void vkb_residency_free()
+{
+	g_logger_assert(numAlive == 0, "Residency manager freed with %d resources still registered.", numAlive);
+
+	g_memory_free(resources);
+	resources = nullptr;
+	numSlots = 0;
+	slotCapacity = 0;
+	firstFreeSlot = vkb_nullResidentResource;
+	caps = nullptr;
+	getMemoryProperties2 = nullptr;
+}
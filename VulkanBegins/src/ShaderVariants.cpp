@@ -0,0 +1,141 @@
+#include "VulkanBegins/ShaderVariants.h"
+#include "VulkanBegins/CommandStream.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/DeletionQueue.h"
+
+#include <chrono>
+#include <mutex>
+#include <new>
+
+// ------------ Internal structures ------------
+struct ShaderVariant
+{
+	uint32 features;
+	VkPipeline pipeline;
+};
+
+struct vkb_ShaderVariantCache
+{
+	const char* name;
+	uint32 numFeatures;
+	vkb_PipelineVariantCreateFn createFn;
+	void* userData;
+
+	// NOTE: Only the combinations that get drawn are ever in here, which is a
+	// handful, so a linear search beats anything fancier
+	std::mutex mutex;
+	ShaderVariant* variants;
+	uint32 numVariants;
+	uint32 capacity;
+
+	uint32 numHits;
+	uint32 numMisses;
+	float compileMs;
+};
+
+// ------------ Public Functions ------------
+void vkb_shaderVariant_makeSpecialization(uint32 numFeatures, uint32 features, vkb_ShaderSpecialization* specialization)
+{
+	g_logger_assert(numFeatures <= vkb_maxShaderFeatures, "Too many shader features (%d), at most %d are supported.", numFeatures, vkb_maxShaderFeatures);
+
+	for (uint32 i = 0; i < numFeatures; i++)
+	{
+		specialization->entries[i].constantID = i;
+		specialization->entries[i].offset = i * sizeof(VkBool32);
+		specialization->entries[i].size = sizeof(VkBool32);
+		specialization->values[i] = (features & (1u << i)) ? VK_TRUE : VK_FALSE;
+	}
+
+	specialization->info.mapEntryCount = numFeatures;
+	specialization->info.pMapEntries = specialization->entries;
+	specialization->info.dataSize = numFeatures * sizeof(VkBool32);
+	specialization->info.pData = specialization->values;
+}
+
+vkb_ShaderVariantCache* vkb_shaderVariantCache_create(const char* name, uint32 numFeatures, vkb_PipelineVariantCreateFn createFn, void* userData)
+{
+	g_logger_assert(numFeatures <= vkb_maxShaderFeatures, "Too many shader features (%d) for '%s'.", numFeatures, name);
+
+	vkb_ShaderVariantCache* cache = (vkb_ShaderVariantCache*)g_memory_allocate(sizeof(vkb_ShaderVariantCache));
+	new(cache)vkb_ShaderVariantCache();
+
+	cache->name = name;
+	cache->numFeatures = numFeatures;
+	cache->createFn = createFn;
+	cache->userData = userData;
+	cache->capacity = 8;
+	cache->variants = (ShaderVariant*)g_memory_allocate(sizeof(ShaderVariant) * cache->capacity);
+	cache->numVariants = 0;
+
+	return cache;
+}
+
+VkPipeline vkb_shaderVariantCache_get(vkb_ShaderVariantCache* cache, uint32 features)
+{
+	g_logger_assert(cache->numFeatures == vkb_maxShaderFeatures || (features >> cache->numFeatures) == 0,
+		"Variant 0x%x of '%s' uses features it doesn't declare.", features, cache->name);
+
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	for (uint32 i = 0; i < cache->numVariants; i++)
+	{
+		if (cache->variants[i].features == features)
+		{
+			cache->numHits++;
+			return cache->variants[i].pipeline;
+		}
+	}
+
+	// Compiling under the lock means two threads asking for the same new
+	// variant don't both compile it
+	auto start = std::chrono::steady_clock::now();
+	vkb_ShaderSpecialization specialization;
+	vkb_shaderVariant_makeSpecialization(cache->numFeatures, features, &specialization);
+	VkPipeline pipeline = cache->createFn(specialization.info, cache->userData);
+	cache->compileMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	cache->numMisses++;
+	// Captures name variants by their features, replays create them through their own cache
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE, pipeline, vkb_captureKey(vkb_CaptureOwner::ShaderVariants, features));
+
+	if (cache->numVariants == cache->capacity)
+	{
+		cache->capacity *= 2;
+		cache->variants = (ShaderVariant*)g_memory_realloc(cache->variants, sizeof(ShaderVariant) * cache->capacity);
+	}
+	cache->variants[cache->numVariants++] = { features, pipeline };
+
+	return pipeline;
+}
+
+void vkb_shaderVariantCache_retireAll(vkb_ShaderVariantCache* cache, uint64 retireValue)
+{
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	for (uint32 i = 0; i < cache->numVariants; i++)
+	{
+		vkb_deletionQueue_push(VK_OBJECT_TYPE_PIPELINE, cache->variants[i].pipeline, retireValue);
+	}
+	cache->numVariants = 0;
+}
+
+vkb_ShaderVariantStats vkb_shaderVariantCache_getStats(vkb_ShaderVariantCache* cache)
+{
+	std::lock_guard<std::mutex> lock(cache->mutex);
+
+	vkb_ShaderVariantStats stats = {};
+	stats.numVariants = cache->numVariants;
+	stats.numHits = cache->numHits;
+	stats.numMisses = cache->numMisses;
+	stats.compileMs = cache->compileMs;
+	return stats;
+}
+
+void vkb_shaderVariantCache_free(const vkb_Context& ctx, vkb_ShaderVariantCache* cache)
+{
+	for (uint32 i = 0; i < cache->numVariants; i++)
+	{
+		vkDestroyPipeline(ctx.device, cache->variants[i].pipeline, ctx.allocator);
+	}
+
+	g_memory_free(cache->variants);
+	cache->~vkb_ShaderVariantCache();
+	g_memory_free(cache);
+}
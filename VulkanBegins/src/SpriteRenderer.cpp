@@ -0,0 +1,810 @@
+#include "VulkanBegins/SpriteRenderer.h"
+#include "VulkanBegins/AtlasPacker.h"
+#include "VulkanBegins/Context.h"
+#include "VulkanBegins/DeviceCaps.h"
+#include "VulkanBegins/Buffer.h"
+#include "VulkanBegins/Arena.h"
+#include "VulkanBegins/File.h"
+#include "VulkanBegins/CommandStream.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+// ------------ Internal structures ------------
+// Matches the vertex inputs of sprite.vert
+struct SpriteVertex
+{
+	float position[2];
+	float uv[2];
+	uint32 color;
+};
+
+// Keys the renderer's objects are captured under. The pipelines follow CaptureBlendPipeline by
+// blend mode, and every atlas takes two keys from CaptureAtlas on, its image then its set.
+enum CaptureObject : uint32
+{
+	CapturePipelineLayout,
+	CaptureStagingBuffer,
+	CaptureVertexBuffer,
+	CaptureIndexBuffer,
+	CaptureBlendPipeline,
+	CaptureAtlas = CaptureBlendPipeline + (uint32)vkb_SpriteBlend::Count
+};
+
+// Matches the push constants of sprite.vert
+struct SpritePushConstants
+{
+	// 2 / target size, takes pixels to normalized device coordinates
+	float pixelToNdc[2];
+};
+
+struct Atlas
+{
+	VkImage image;
+	VkDeviceMemory memory;
+	uint32 memoryTypeIndex;
+	VkDeviceSize memorySize;
+	vkb_ResidentResource resident;
+	VkImageView view;
+	VkDescriptorSet set;
+	vkb_AtlasPacker packer;
+	// False until the first upload moves it out of VK_IMAGE_LAYOUT_UNDEFINED
+	bool initialized;
+};
+
+struct SpriteImage
+{
+	uint32 atlas;
+	uint32 x;
+	uint32 y;
+	uint32 width;
+	uint32 height;
+	// Min and max uv, inset half a texel so filtering never reaches a neighbour
+	float uvRect[4];
+	bool resident;
+	// Copy of the pixels until they're uploaded
+	uint8* pendingPixels;
+};
+
+struct vkb_SpriteRenderer
+{
+	uint32 atlasSize;
+	uint32 maxAtlases;
+	uint32 maxImages;
+	uint32 maxSpritesPerFrame;
+
+	VkDevice device;
+	const VkAllocationCallbacks* allocator;
+
+	VkSampler sampler;
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipelines[(uint8)vkb_SpriteBlend::Count];
+
+	Atlas* atlases;
+	uint32 numAtlases;
+
+	SpriteImage* images;
+	uint32 numImages;
+	// FIFO of images waiting for upload, a ring of maxImages
+	vkb_SpriteImageId* pendingUploads;
+	uint32 firstPending;
+	uint32 numPending;
+
+	vkb_Buffer stagingBuffer;
+	VkDeviceSize stagingOffset;
+
+	// Streamed every frame, four vertices per sprite
+	vkb_Buffer vertexBuffer;
+	// Six indices per sprite, never changes
+	vkb_Buffer indexBuffer;
+
+	vkb_Sprite* frameSprites;
+	uint32 numFrameSprites;
+
+	vkb_SpriteStats stats;
+};
+
+// ------------ Internal Variables ------------
+static constexpr VkFormat atlasFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+// ------------ Internal Functions ------------
+static VkShaderModule createShaderModule(const vkb_SpriteRenderer* sprites, const vkb_FileContents& bytecode)
+{
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = bytecode.size;
+	createInfo.pCode = (const uint32*)bytecode.data;
+
+	VkShaderModule module;
+	uint32 res = vkCreateShaderModule(sprites->device, &createInfo, sprites->allocator, &module);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create sprite shader module.");
+	return module;
+}
+
+static void createLayouts(vkb_SpriteRenderer* sprites)
+{
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.maxLod = 0.0f;
+
+	uint32 res = vkCreateSampler(sprites->device, &samplerCreateInfo, sprites->allocator, &sprites->sampler);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create sprite sampler.");
+
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.bindingCount = 1;
+	setLayoutCreateInfo.pBindings = &binding;
+
+	res = vkCreateDescriptorSetLayout(sprites->device, &setLayoutCreateInfo, sprites->allocator, &sprites->setLayout);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create sprite descriptor set layout.");
+
+	// One set per atlas
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = sprites->maxAtlases;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = sprites->maxAtlases;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+
+	res = vkCreateDescriptorPool(sprites->device, &poolCreateInfo, sprites->allocator, &sprites->descriptorPool);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create sprite descriptor pool.");
+
+	VkPushConstantRange pushConstants = {};
+	pushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstants.offset = 0;
+	pushConstants.size = sizeof(SpritePushConstants);
+
+	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &sprites->setLayout;
+	layoutCreateInfo.pushConstantRangeCount = 1;
+	layoutCreateInfo.pPushConstantRanges = &pushConstants;
+
+	res = vkCreatePipelineLayout(sprites->device, &layoutCreateInfo, sprites->allocator, &sprites->pipelineLayout);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create sprite pipeline layout.");
+}
+
+// One pipeline per blend mode, they only differ in their blend state
+static void createPipelines(vkb_SpriteRenderer* sprites, const vkb_SpriteRendererDesc& desc)
+{
+	VkShaderModule vertModule = createShaderModule(sprites, *desc.vertShader);
+	VkShaderModule fragModule = createShaderModule(sprites, *desc.fragShader);
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragModule;
+	shaderStages[1].pName = "main";
+
+	VkVertexInputBindingDescription vertexBinding = {};
+	vertexBinding.binding = 0;
+	vertexBinding.stride = sizeof(SpriteVertex);
+	vertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	VkVertexInputAttributeDescription vertexAttributes[3] = {};
+	vertexAttributes[0].location = 0;
+	vertexAttributes[0].format = VK_FORMAT_R32G32_SFLOAT;
+	vertexAttributes[0].offset = offsetof(SpriteVertex, position);
+	vertexAttributes[1].location = 1;
+	vertexAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+	vertexAttributes[1].offset = offsetof(SpriteVertex, uv);
+	vertexAttributes[2].location = 2;
+	vertexAttributes[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+	vertexAttributes[2].offset = offsetof(SpriteVertex, color);
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.pVertexBindingDescriptions = &vertexBinding;
+	vertexInputInfo.vertexAttributeDescriptionCount = 3;
+	vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
+	dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateInfo.dynamicStateCount = 2;
+	dynamicStateInfo.pDynamicStates = dynamicStates;
+
+	VkPipelineViewportStateCreateInfo viewportInfo = {};
+	viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportInfo.viewportCount = 1;
+	viewportInfo.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterInfo = {};
+	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterInfo.lineWidth = 1.0f;
+	rasterInfo.cullMode = VK_CULL_MODE_NONE;
+	rasterInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo = {};
+	multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleInfo.minSampleShading = 1.0f;
+
+	// Overlays go on top of everything
+	VkPipelineDepthStencilStateCreateInfo depthStencilInfo = {};
+	depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilInfo.depthTestEnable = VK_FALSE;
+	depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT |
+		VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo blendInfo = {};
+	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blendInfo.attachmentCount = 1;
+	blendInfo.pAttachments = &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	createInfo.stageCount = 2;
+	createInfo.pStages = shaderStages;
+	createInfo.pVertexInputState = &vertexInputInfo;
+	createInfo.pInputAssemblyState = &inputAssembly;
+	createInfo.pViewportState = &viewportInfo;
+	createInfo.pRasterizationState = &rasterInfo;
+	createInfo.pMultisampleState = &multisampleInfo;
+	createInfo.pDepthStencilState = &depthStencilInfo;
+	createInfo.pColorBlendState = &blendInfo;
+	createInfo.pDynamicState = &dynamicStateInfo;
+	createInfo.layout = sprites->pipelineLayout;
+	createInfo.renderPass = desc.renderPass;
+	createInfo.subpass = 0;
+	createInfo.basePipelineIndex = -1;
+
+	for (uint8 blend = 0; blend < (uint8)vkb_SpriteBlend::Count; blend++)
+	{
+		bool additive = blend == (uint8)vkb_SpriteBlend::Additive;
+		colorBlendAttachment.dstColorBlendFactor = additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		colorBlendAttachment.dstAlphaBlendFactor = additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+
+		uint32 res = vkCreateGraphicsPipelines(sprites->device, desc.pipelineCache, 1, &createInfo, sprites->allocator, &sprites->pipelines[blend]);
+		g_logger_assert(res == VK_SUCCESS, "Failed to create sprite pipeline.");
+	}
+
+	vkDestroyShaderModule(sprites->device, vertModule, sprites->allocator);
+	vkDestroyShaderModule(sprites->device, fragModule, sprites->allocator);
+}
+
+static bool addAtlas(const vkb_Context& ctx, vkb_SpriteRenderer* sprites)
+{
+	if (sprites->numAtlases == sprites->maxAtlases)
+	{
+		return false;
+	}
+
+	Atlas& atlas = sprites->atlases[sprites->numAtlases];
+	atlas = {};
+
+	VkImageCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	createInfo.imageType = VK_IMAGE_TYPE_2D;
+	createInfo.format = atlasFormat;
+	createInfo.extent = { sprites->atlasSize, sprites->atlasSize, 1 };
+	createInfo.mipLevels = 1;
+	createInfo.arrayLayers = 1;
+	createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	uint32 res = vkCreateImage(sprites->device, &createInfo, sprites->allocator, &atlas.image);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create sprite atlas.");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(sprites->device, atlas.image, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = vkb_deviceCaps_findMemoryType(*ctx.caps, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	// Atlases can't be rebuilt once their images are uploaded, so they're never evicted
+	res = vkb_residency_allocateMemory(ctx, allocInfo, vkb_StreamingPriority::Critical, &atlas.memory);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate sprite atlas memory.");
+	vkBindImageMemory(sprites->device, atlas.image, atlas.memory, 0);
+	atlas.memoryTypeIndex = allocInfo.memoryTypeIndex;
+	atlas.memorySize = allocInfo.allocationSize;
+
+	vkb_ResidentResourceDesc residentDesc = {};
+	residentDesc.priority = vkb_StreamingPriority::Critical;
+	residentDesc.memoryTypeIndex = allocInfo.memoryTypeIndex;
+	residentDesc.numMips = 1;
+	residentDesc.fullSize = allocInfo.allocationSize;
+	atlas.resident = vkb_residency_register(residentDesc);
+
+	VkImageViewCreateInfo viewCreateInfo = {};
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.image = atlas.image;
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = atlasFormat;
+	viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewCreateInfo.subresourceRange.levelCount = 1;
+	viewCreateInfo.subresourceRange.layerCount = 1;
+	res = vkCreateImageView(sprites->device, &viewCreateInfo, sprites->allocator, &atlas.view);
+	g_logger_assert(res == VK_SUCCESS, "Failed to create sprite atlas view.");
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = sprites->descriptorPool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &sprites->setLayout;
+	res = vkAllocateDescriptorSets(sprites->device, &setAllocInfo, &atlas.set);
+	g_logger_assert(res == VK_SUCCESS, "Failed to allocate sprite atlas descriptor set.");
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sprites->sampler;
+	imageInfo.imageView = atlas.view;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = atlas.set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(sprites->device, 1, &write, 0, nullptr);
+
+	uint32 atlasKey = CaptureAtlas + sprites->numAtlases * 2;
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_IMAGE, atlas.image, vkb_captureKey(vkb_CaptureOwner::SpriteRenderer, atlasKey));
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, atlas.set, vkb_captureKey(vkb_CaptureOwner::SpriteRenderer, atlasKey + 1));
+
+	atlas.packer = vkb_atlasPacker_create(sprites->atlasSize, sprites->atlasSize);
+	atlas.initialized = false;
+	sprites->numAtlases++;
+	return true;
+}
+
+static void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	if (vkb_commandCapture_isActive())
+	{
+		vkb_commandCapture_pipelineBarrier(srcStages, dstStages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+}
+
+// ------------ Public Functions ------------
+vkb_SpriteRenderer* vkb_spriteRenderer_create(const vkb_Context& ctx, const vkb_SpriteRendererDesc& desc)
+{
+	g_logger_assert(desc.vertShader->data != nullptr && desc.fragShader->data != nullptr, "Missing sprite shader bytecode.");
+	g_logger_assert(desc.atlasSize > 0 && desc.maxAtlases > 0 && desc.maxImages > 0 && desc.maxSpritesPerFrame > 0,
+		"A sprite renderer needs room for at least one atlas, image and sprite.");
+
+	vkb_SpriteRenderer* sprites = (vkb_SpriteRenderer*)g_memory_allocate(sizeof(vkb_SpriteRenderer));
+	new(sprites)vkb_SpriteRenderer();
+
+	sprites->atlasSize = desc.atlasSize;
+	sprites->maxAtlases = desc.maxAtlases;
+	sprites->maxImages = desc.maxImages;
+	sprites->maxSpritesPerFrame = desc.maxSpritesPerFrame;
+	sprites->device = ctx.device;
+	sprites->allocator = ctx.allocator;
+
+	createLayouts(sprites);
+	createPipelines(sprites, desc);
+
+	sprites->atlases = (Atlas*)g_memory_allocate(sizeof(Atlas) * desc.maxAtlases);
+	sprites->numAtlases = 0;
+	sprites->images = (SpriteImage*)g_memory_allocate(sizeof(SpriteImage) * desc.maxImages);
+	sprites->numImages = 0;
+	sprites->pendingUploads = (vkb_SpriteImageId*)g_memory_allocate(sizeof(vkb_SpriteImageId) * desc.maxImages);
+	sprites->firstPending = 0;
+	sprites->numPending = 0;
+	sprites->frameSprites = (vkb_Sprite*)g_memory_allocate(sizeof(vkb_Sprite) * desc.maxSpritesPerFrame);
+	sprites->numFrameSprites = 0;
+
+	// With one frame in flight the streamed buffers can be written in place, the GPU is done with them by then
+	VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	sprites->stagingBuffer = vkb_buffer_create(ctx, desc.uploadBytesPerFrame, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostVisible);
+	sprites->stagingOffset = 0;
+	sprites->vertexBuffer = vkb_buffer_create(ctx, sizeof(SpriteVertex) * 4 * desc.maxSpritesPerFrame, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, hostVisible);
+	sprites->indexBuffer = vkb_buffer_create(ctx, sizeof(uint32) * 6 * desc.maxSpritesPerFrame, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, hostVisible);
+
+	// Two triangles per quad, corners in the order they're written in recordDraw
+	uint32* indices = (uint32*)sprites->indexBuffer.mapped;
+	for (uint32 i = 0; i < desc.maxSpritesPerFrame; i++)
+	{
+		uint32 first = i * 4;
+		indices[i * 6 + 0] = first + 0;
+		indices[i * 6 + 1] = first + 1;
+		indices[i * 6 + 2] = first + 2;
+		indices[i * 6 + 3] = first + 0;
+		indices[i * 6 + 4] = first + 2;
+		indices[i * 6 + 5] = first + 3;
+	}
+
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, sprites->pipelineLayout, vkb_captureKey(vkb_CaptureOwner::SpriteRenderer, CapturePipelineLayout));
+	for (uint8 blend = 0; blend < (uint8)vkb_SpriteBlend::Count; blend++)
+	{
+		vkb_commandCapture_registerObject(VK_OBJECT_TYPE_PIPELINE, sprites->pipelines[blend], vkb_captureKey(vkb_CaptureOwner::SpriteRenderer, CaptureBlendPipeline + blend));
+	}
+	// The indices never change, a replay builds the same ones
+	vkb_commandCapture_registerObject(VK_OBJECT_TYPE_BUFFER, sprites->indexBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::SpriteRenderer, CaptureIndexBuffer));
+	vkb_commandCapture_trackBuffer(sprites->stagingBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::SpriteRenderer, CaptureStagingBuffer),
+		sprites->stagingBuffer.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sprites->stagingBuffer.mapped);
+	vkb_commandCapture_trackBuffer(sprites->vertexBuffer.buffer, vkb_captureKey(vkb_CaptureOwner::SpriteRenderer, CaptureVertexBuffer),
+		sprites->vertexBuffer.size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sprites->vertexBuffer.mapped);
+
+	sprites->stats = {};
+	return sprites;
+}
+
+vkb_SpriteImageId vkb_spriteRenderer_addImage(const vkb_Context& ctx, vkb_SpriteRenderer* sprites, const uint8* pixels, uint32 width, uint32 height)
+{
+	VkDeviceSize numBytes = (VkDeviceSize)width * height * 4;
+	if (sprites->numImages == sprites->maxImages || width > sprites->atlasSize || height > sprites->atlasSize ||
+		numBytes > sprites->stagingBuffer.size)
+	{
+		g_logger_warning("Sprite image of %dx%d doesn't fit, it was skipped.", width, height);
+		return vkb_invalidSpriteImage;
+	}
+
+	// Earlier atlases first, a new one only once none of them has room
+	uint32 x = 0;
+	uint32 y = 0;
+	uint32 atlasIndex = 0;
+	for (; atlasIndex < sprites->numAtlases; atlasIndex++)
+	{
+		if (vkb_atlasPacker_pack(sprites->atlases[atlasIndex].packer, width, height, &x, &y))
+		{
+			break;
+		}
+	}
+	if (atlasIndex == sprites->numAtlases)
+	{
+		if (!addAtlas(ctx, sprites) || !vkb_atlasPacker_pack(sprites->atlases[atlasIndex].packer, width, height, &x, &y))
+		{
+			g_logger_warning("Every sprite atlas is full, a %dx%d image was skipped.", width, height);
+			return vkb_invalidSpriteImage;
+		}
+	}
+
+	vkb_SpriteImageId id = sprites->numImages++;
+	SpriteImage& image = sprites->images[id];
+	image.atlas = atlasIndex;
+	image.x = x;
+	image.y = y;
+	image.width = width;
+	image.height = height;
+	float texel = 1.0f / (float)sprites->atlasSize;
+	image.uvRect[0] = ((float)x + 0.5f) * texel;
+	image.uvRect[1] = ((float)y + 0.5f) * texel;
+	image.uvRect[2] = ((float)(x + width) - 0.5f) * texel;
+	image.uvRect[3] = ((float)(y + height) - 0.5f) * texel;
+	image.resident = false;
+	image.pendingPixels = (uint8*)g_memory_allocate((size_t)numBytes);
+	memcpy(image.pendingPixels, pixels, (size_t)numBytes);
+
+	sprites->pendingUploads[(sprites->firstPending + sprites->numPending) % sprites->maxImages] = id;
+	sprites->numPending++;
+	return id;
+}
+
+void vkb_spriteRenderer_beginFrame(vkb_SpriteRenderer* sprites)
+{
+	sprites->numFrameSprites = 0;
+	sprites->stagingOffset = 0;
+}
+
+void vkb_spriteRenderer_draw(vkb_SpriteRenderer* sprites, const vkb_Sprite& sprite)
+{
+	if (sprites->numFrameSprites < sprites->maxSpritesPerFrame)
+	{
+		sprites->frameSprites[sprites->numFrameSprites++] = sprite;
+	}
+}
+
+void vkb_spriteRenderer_recordUploads(vkb_SpriteRenderer* sprites, VkCommandBuffer commandBuffer)
+{
+	if (sprites->numPending == 0)
+	{
+		return;
+	}
+
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	VkBufferImageCopy* regions = vkb_arena_allocateArray<VkBufferImageCopy>(vkb_scratch_get(), sprites->numPending);
+	uint32* regionAtlases = vkb_arena_allocateArray<uint32>(vkb_scratch_get(), sprites->numPending);
+	bool* atlasTouched = vkb_arena_allocateArray<bool>(vkb_scratch_get(), sprites->numAtlases);
+	memset(atlasTouched, 0, sizeof(bool) * sprites->numAtlases);
+
+	// Oldest first, until the staging buffer runs out. The rest wait for the next frame.
+	uint32 numRegions = 0;
+	while (sprites->numPending > 0)
+	{
+		SpriteImage& image = sprites->images[sprites->pendingUploads[sprites->firstPending]];
+		VkDeviceSize numBytes = (VkDeviceSize)image.width * image.height * 4;
+		if (sprites->stagingOffset + numBytes > sprites->stagingBuffer.size)
+		{
+			break;
+		}
+
+		memcpy((uint8*)sprites->stagingBuffer.mapped + sprites->stagingOffset, image.pendingPixels, (size_t)numBytes);
+		vkb_commandCapture_updateBuffer(sprites->stagingBuffer.buffer, sprites->stagingOffset, image.pendingPixels, numBytes);
+		g_memory_free(image.pendingPixels);
+		image.pendingPixels = nullptr;
+		image.resident = true;
+
+		VkBufferImageCopy& region = regions[numRegions];
+		region = {};
+		region.bufferOffset = sprites->stagingOffset;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { (int32)image.x, (int32)image.y, 0 };
+		region.imageExtent = { image.width, image.height, 1 };
+		regionAtlases[numRegions] = image.atlas;
+		atlasTouched[image.atlas] = true;
+		numRegions++;
+
+		sprites->stats.uploadedBytes += numBytes;
+		// Copies out of a buffer have to start on a texel, 4 bytes keeps every one aligned
+		sprites->stagingOffset = (sprites->stagingOffset + numBytes + 3) & ~(VkDeviceSize)3;
+		sprites->firstPending = (sprites->firstPending + 1) % sprites->maxImages;
+		sprites->numPending--;
+	}
+
+	for (uint32 atlasIndex = 0; atlasIndex < sprites->numAtlases; atlasIndex++)
+	{
+		if (!atlasTouched[atlasIndex])
+		{
+			continue;
+		}
+
+		// A fresh atlas has nothing to keep, the rest keep every image uploaded so far
+		Atlas& atlas = sprites->atlases[atlasIndex];
+		VkImageLayout oldLayout = atlas.initialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		imageBarrier(commandBuffer, atlas.image, oldLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+		for (uint32 i = 0; i < numRegions; i++)
+		{
+			if (regionAtlases[i] == atlasIndex)
+			{
+				vkCmdCopyBufferToImage(commandBuffer, sprites->stagingBuffer.buffer, atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &regions[i]);
+				if (vkb_commandCapture_isActive())
+				{
+					vkb_commandCapture_copyBufferToImage(sprites->stagingBuffer.buffer, atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions[i]);
+				}
+			}
+		}
+
+		imageBarrier(commandBuffer, atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		atlas.initialized = true;
+	}
+
+	vkb_scratch_end(scratch);
+}
+
+void vkb_spriteRenderer_recordDraw(vkb_SpriteRenderer* sprites, VkCommandBuffer commandBuffer, VkExtent2D targetExtent)
+{
+	vkb_SpriteStats& stats = sprites->stats;
+	stats.numSprites = sprites->numFrameSprites;
+	stats.drawsBeforeBatching = 0;
+	stats.drawsAfterBatching = 0;
+	stats.numNotResident = 0;
+	stats.numAtlases = sprites->numAtlases;
+	stats.numPendingUploads = sprites->numPending;
+	if (sprites->numFrameSprites == 0)
+	{
+		return;
+	}
+
+	// Layer, then blend mode, then atlas, then submission order so batches keep it
+	vkb_ArenaMarker scratch = vkb_scratch_begin();
+	uint64* keys = vkb_arena_allocateArray<uint64>(vkb_scratch_get(), sprites->numFrameSprites);
+	uint32 numKeys = 0;
+	for (uint32 i = 0; i < sprites->numFrameSprites; i++)
+	{
+		const vkb_Sprite& sprite = sprites->frameSprites[i];
+		if (sprite.image >= sprites->numImages || !sprites->images[sprite.image].resident)
+		{
+			stats.numNotResident++;
+			continue;
+		}
+
+		keys[numKeys++] = ((uint64)sprite.layer << 56) |
+			((uint64)sprite.blend << 48) |
+			((uint64)sprites->images[sprite.image].atlas << 32) |
+			i;
+	}
+	std::sort(keys, keys + numKeys);
+	stats.drawsBeforeBatching = numKeys;
+
+	SpritePushConstants pushConstants = {};
+	pushConstants.pixelToNdc[0] = 2.0f / (float)targetExtent.width;
+	pushConstants.pixelToNdc[1] = 2.0f / (float)targetExtent.height;
+
+	VkDeviceSize vertexOffset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &sprites->vertexBuffer.buffer, &vertexOffset);
+	vkCmdBindIndexBuffer(commandBuffer, sprites->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	bool capturing = vkb_commandCapture_isActive();
+	if (capturing)
+	{
+		vkb_commandCapture_bindVertexBuffer(sprites->vertexBuffer.buffer, vertexOffset);
+		vkb_commandCapture_bindIndexBuffer(sprites->indexBuffer.buffer, 0);
+	}
+
+	SpriteVertex* vertices = (SpriteVertex*)sprites->vertexBuffer.mapped;
+	uint32 boundBlend = UINT32_MAX;
+	uint32 boundAtlas = UINT32_MAX;
+	uint32 batchStart = 0;
+	for (uint32 i = 0; i <= numKeys; i++)
+	{
+		// Flush the batch when the state changes, and once more past the end
+		uint32 blend = i < numKeys ? (uint32)((keys[i] >> 48) & 0xFF) : UINT32_MAX;
+		uint32 atlas = i < numKeys ? (uint32)((keys[i] >> 32) & 0xFFFF) : UINT32_MAX;
+		if (i > batchStart && (blend != boundBlend || atlas != boundAtlas))
+		{
+			vkCmdDrawIndexed(commandBuffer, (i - batchStart) * 6, 1, batchStart * 6, 0, 0);
+			if (capturing)
+			{
+				vkb_commandCapture_drawIndexed((i - batchStart) * 6, 1, batchStart * 6, 0, 0);
+			}
+			stats.drawsAfterBatching++;
+			batchStart = i;
+		}
+		if (i == numKeys)
+		{
+			break;
+		}
+
+		if (blend != boundBlend)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, sprites->pipelines[blend]);
+			if (capturing)
+			{
+				vkb_commandCapture_bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, sprites->pipelines[blend]);
+			}
+			if (boundBlend == UINT32_MAX)
+			{
+				vkCmdPushConstants(commandBuffer, sprites->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+				if (capturing)
+				{
+					vkb_commandCapture_pushConstants(sprites->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+				}
+			}
+			boundBlend = blend;
+		}
+		if (atlas != boundAtlas)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, sprites->pipelineLayout, 0, 1, &sprites->atlases[atlas].set, 0, nullptr);
+			if (capturing)
+			{
+				vkb_commandCapture_bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, sprites->pipelineLayout, 0, sprites->atlases[atlas].set);
+			}
+			boundAtlas = atlas;
+		}
+
+		const vkb_Sprite& sprite = sprites->frameSprites[(uint32)keys[i]];
+		const float* uv = sprites->images[sprite.image].uvRect;
+		float x0 = sprite.position[0];
+		float y0 = sprite.position[1];
+		float x1 = x0 + sprite.size[0];
+		float y1 = y0 + sprite.size[1];
+
+		SpriteVertex* quad = vertices + i * 4;
+		quad[0] = { { x0, y0 }, { uv[0], uv[1] }, sprite.color };
+		quad[1] = { { x1, y0 }, { uv[2], uv[1] }, sprite.color };
+		quad[2] = { { x1, y1 }, { uv[2], uv[3] }, sprite.color };
+		quad[3] = { { x0, y1 }, { uv[0], uv[3] }, sprite.color };
+	}
+	vkb_commandCapture_updateBuffer(sprites->vertexBuffer.buffer, 0, vertices, sizeof(SpriteVertex) * 4 * numKeys);
+
+	vkb_scratch_end(scratch);
+}
+
+void vkb_spriteRenderer_markUsed(const vkb_SpriteRenderer* sprites, uint64 frameIndex)
+{
+	for (uint32 i = 0; i < sprites->numAtlases; i++)
+	{
+		vkb_residency_markUsed(sprites->atlases[i].resident, frameIndex);
+	}
+}
+
+vkb_SpriteStats vkb_spriteRenderer_getStats(const vkb_SpriteRenderer* sprites)
+{
+	return sprites->stats;
+}
+
+void vkb_spriteRenderer_free(const vkb_Context& ctx, vkb_SpriteRenderer* sprites)
+{
+	for (uint32 i = 0; i < sprites->numImages; i++)
+	{
+		if (sprites->images[i].pendingPixels != nullptr)
+		{
+			g_memory_free(sprites->images[i].pendingPixels);
+		}
+	}
+
+	for (uint32 i = 0; i < sprites->numAtlases; i++)
+	{
+		Atlas& atlas = sprites->atlases[i];
+		vkDestroyImageView(sprites->device, atlas.view, sprites->allocator);
+		vkDestroyImage(sprites->device, atlas.image, sprites->allocator);
+		vkb_residency_unregister(atlas.resident);
+		vkb_residency_freeMemory(atlas.memory, atlas.memorySize, atlas.memoryTypeIndex, 0);
+		vkb_atlasPacker_free(atlas.packer);
+	}
+
+	vkb_commandCapture_untrackBuffer(sprites->stagingBuffer.buffer);
+	vkb_commandCapture_untrackBuffer(sprites->vertexBuffer.buffer);
+	vkb_buffer_free(ctx, sprites->stagingBuffer);
+	vkb_buffer_free(ctx, sprites->vertexBuffer);
+	vkb_buffer_free(ctx, sprites->indexBuffer);
+
+	for (uint8 blend = 0; blend < (uint8)vkb_SpriteBlend::Count; blend++)
+	{
+		vkDestroyPipeline(sprites->device, sprites->pipelines[blend], sprites->allocator);
+	}
+	vkDestroyPipelineLayout(sprites->device, sprites->pipelineLayout, sprites->allocator);
+	vkDestroyDescriptorPool(sprites->device, sprites->descriptorPool, sprites->allocator);
+	vkDestroyDescriptorSetLayout(sprites->device, sprites->setLayout, sprites->allocator);
+	vkDestroySampler(sprites->device, sprites->sampler, sprites->allocator);
+
+	g_memory_free(sprites->frameSprites);
+	g_memory_free(sprites->pendingUploads);
+	g_memory_free(sprites->images);
+	g_memory_free(sprites->atlases);
+
+	sprites->~vkb_SpriteRenderer();
+	g_memory_free(sprites);
+}
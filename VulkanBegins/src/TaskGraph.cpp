@@ -0,0 +1,302 @@
+#include "VulkanBegins/TaskGraph.h"
+#include "VulkanBegins/JobSystem.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <thread>
+
+// ------------ Internal structures ------------
+static constexpr uint32 maxDependencies = 16;
+
+struct TaskNode
+{
+	vkb_TaskGraph* graph;
+	const char* name;
+	vkb_TaskFn fn;
+	void* userData;
+	bool mainThreadOnly;
+
+	uint32 dependencies[maxDependencies];
+	uint32 numDependencies;
+	uint32 dependents[maxDependencies];
+	uint32 numDependents;
+	uint32 remainingDependencies;
+
+	// Timeline, in microseconds since the start of the run
+	uint64 startUs;
+	uint64 endUs;
+	uint32 threadIndex;
+};
+
+struct vkb_TaskGraph
+{
+	const char* name;
+	TaskNode* tasks;
+	uint32 numTasks;
+	uint32 maxTasks;
+	uint32 numThreads;
+	uint64 totalUs;
+
+	// Run state. Main thread tasks wait in readyMainQueue, everything else is
+	// handed straight to the job system.
+	std::mutex mutex;
+	uint32* readyMainQueue;
+	uint32 numReadyMain;
+	uint32 numInFlight;
+	uint32 numFinished;
+	// Bumped outside the lock once a task is completely done with the graph
+	std::atomic<uint32> numCompleted;
+	std::chrono::steady_clock::time_point startTime;
+};
+
+// ------------ Internal Functions ------------
+static uint64 microsecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return (uint64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void runTask(vkb_TaskGraph* graph, uint32 taskIndex);
+
+static void taskJob(void* userData)
+{
+	TaskNode* task = (TaskNode*)userData;
+	runTask(task->graph, (uint32)(task - task->graph->tasks));
+}
+
+static void runTask(vkb_TaskGraph* graph, uint32 taskIndex)
+{
+	TaskNode& task = graph->tasks[taskIndex];
+	task.threadIndex = vkb_jobs_threadIndex();
+	task.startUs = microsecondsSince(graph->startTime);
+	task.fn(task.userData);
+	task.endUs = microsecondsSince(graph->startTime);
+
+	uint32 ready[maxDependencies];
+	uint32 numReady = 0;
+	{
+		std::lock_guard<std::mutex> lock(graph->mutex);
+		for (uint32 i = 0; i < task.numDependents; i++)
+		{
+			TaskNode& dependent = graph->tasks[task.dependents[i]];
+			dependent.remainingDependencies--;
+			if (dependent.remainingDependencies == 0)
+			{
+				if (dependent.mainThreadOnly)
+				{
+					graph->readyMainQueue[graph->numReadyMain++] = task.dependents[i];
+				}
+				else
+				{
+					ready[numReady++] = task.dependents[i];
+				}
+				graph->numInFlight++;
+			}
+		}
+
+		graph->numInFlight--;
+		graph->numFinished++;
+		g_logger_assert(graph->numFinished == graph->numTasks || graph->numInFlight > 0,
+			"Task graph '%s' has a dependency cycle.", graph->name);
+	}
+
+	for (uint32 i = 0; i < numReady; i++)
+	{
+		vkb_jobs_run(taskJob, &graph->tasks[ready[i]], nullptr);
+	}
+
+	// Last thing this touches, vkb_taskGraph_run may return as soon as it sees the final count
+	graph->numCompleted.fetch_add(1, std::memory_order_release);
+}
+
+// ------------ Public Functions ------------
+vkb_TaskGraph* vkb_taskGraph_create(const char* name, uint32 maxTasks)
+{
+	vkb_TaskGraph* graph = (vkb_TaskGraph*)g_memory_allocate(sizeof(vkb_TaskGraph));
+	new(graph)vkb_TaskGraph();
+
+	graph->name = name;
+	graph->tasks = (TaskNode*)g_memory_allocate(sizeof(TaskNode) * maxTasks);
+	graph->readyMainQueue = (uint32*)g_memory_allocate(sizeof(uint32) * maxTasks);
+	graph->maxTasks = maxTasks;
+	graph->numTasks = 0;
+
+	return graph;
+}
+
+uint32 vkb_taskGraph_addTask(vkb_TaskGraph* graph, const char* name, vkb_TaskFn fn, void* userData, bool mainThreadOnly)
+{
+	g_logger_assert(graph->numTasks < graph->maxTasks, "Task graph '%s' is full.", graph->name);
+
+	TaskNode& task = graph->tasks[graph->numTasks];
+	task = {};
+	task.graph = graph;
+	task.name = name;
+	task.fn = fn;
+	task.userData = userData;
+	task.mainThreadOnly = mainThreadOnly;
+
+	return graph->numTasks++;
+}
+
+void vkb_taskGraph_addDependency(vkb_TaskGraph* graph, uint32 task, uint32 dependsOn)
+{
+	g_logger_assert(task < graph->numTasks && dependsOn < graph->numTasks, "Invalid task index.");
+
+	TaskNode& node = graph->tasks[task];
+	TaskNode& dependency = graph->tasks[dependsOn];
+	g_logger_assert(node.numDependencies < maxDependencies && dependency.numDependents < maxDependencies,
+		"Too many dependencies between '%s' and '%s'.", node.name, dependency.name);
+
+	node.dependencies[node.numDependencies++] = dependsOn;
+	dependency.dependents[dependency.numDependents++] = task;
+}
+
+void vkb_taskGraph_run(vkb_TaskGraph* graph)
+{
+	graph->numThreads = vkb_jobs_numThreads();
+	graph->numReadyMain = 0;
+	graph->numInFlight = 0;
+	graph->numFinished = 0;
+	graph->numCompleted.store(0, std::memory_order_relaxed);
+	graph->startTime = std::chrono::steady_clock::now();
+
+	for (uint32 i = 0; i < graph->numTasks; i++)
+	{
+		TaskNode& task = graph->tasks[i];
+		task.remainingDependencies = task.numDependencies;
+		if (task.numDependencies == 0)
+		{
+			graph->numInFlight++;
+		}
+	}
+	g_logger_assert(graph->numTasks == 0 || graph->numInFlight > 0, "Task graph '%s' has a dependency cycle.", graph->name);
+
+	for (uint32 i = 0; i < graph->numTasks; i++)
+	{
+		TaskNode& task = graph->tasks[i];
+		if (task.numDependencies == 0)
+		{
+			if (task.mainThreadOnly)
+			{
+				graph->readyMainQueue[graph->numReadyMain++] = i;
+			}
+			else
+			{
+				vkb_jobs_run(taskJob, &task, nullptr);
+			}
+		}
+	}
+
+	// The calling thread runs main thread tasks and helps out with everything else
+	while (graph->numCompleted.load(std::memory_order_acquire) < graph->numTasks)
+	{
+		uint32 mainTask = UINT32_MAX;
+		{
+			std::lock_guard<std::mutex> lock(graph->mutex);
+			if (graph->numReadyMain > 0)
+			{
+				mainTask = graph->readyMainQueue[--graph->numReadyMain];
+			}
+		}
+
+		if (mainTask != UINT32_MAX)
+		{
+			runTask(graph, mainTask);
+		}
+		else if (!vkb_jobs_runPending())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	graph->totalUs = microsecondsSince(graph->startTime);
+}
+
+void vkb_taskGraph_logTimeline(const vkb_TaskGraph* graph)
+{
+	g_logger_info("Task graph '%s' finished in %.2fms on %d threads:", graph->name, graph->totalUs / 1000.0f, graph->numThreads);
+
+	uint64 serialUs = 0;
+	uint32 lastTask = 0;
+	for (uint32 i = 0; i < graph->numTasks; i++)
+	{
+		const TaskNode& task = graph->tasks[i];
+		g_logger_info("  [thread %d] %8.2fms -> %8.2fms (%7.2fms) %s",
+			task.threadIndex,
+			task.startUs / 1000.0f,
+			task.endUs / 1000.0f,
+			(task.endUs - task.startUs) / 1000.0f,
+			task.name);
+
+		serialUs += task.endUs - task.startUs;
+		if (task.endUs > graph->tasks[lastTask].endUs)
+		{
+			lastTask = i;
+		}
+	}
+
+	g_logger_info("  Serial time would have been %.2fms.", serialUs / 1000.0f);
+
+	// Walk back through whichever dependency finished last to find the critical path
+	if (graph->numTasks > 0)
+	{
+		g_logger_info("  Critical path (latest finishing task first):");
+		uint32 current = lastTask;
+		while (true)
+		{
+			const TaskNode& task = graph->tasks[current];
+			g_logger_info("    %s (%.2fms)", task.name, (task.endUs - task.startUs) / 1000.0f);
+			if (task.numDependencies == 0)
+			{
+				break;
+			}
+
+			uint32 latest = task.dependencies[0];
+			for (uint32 i = 1; i < task.numDependencies; i++)
+			{
+				if (graph->tasks[task.dependencies[i]].endUs > graph->tasks[latest].endUs)
+				{
+					latest = task.dependencies[i];
+				}
+			}
+			current = latest;
+		}
+	}
+}
+
+void vkb_taskGraph_writeTimeline(const vkb_TaskGraph* graph, const char* filename)
+{
+	FILE* fp = fopen(filename, "wb");
+	if (fp == nullptr)
+	{
+		g_logger_error("Could not open file '%s'", filename);
+		return;
+	}
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	for (uint32 i = 0; i < graph->numTasks; i++)
+	{
+		const TaskNode& task = graph->tasks[i];
+		fprintf(fp, "  {\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":0,\"tid\":%u}%s\n",
+			task.name,
+			graph->name,
+			(unsigned long long)task.startUs,
+			(unsigned long long)(task.endUs - task.startUs),
+			task.threadIndex,
+			i + 1 < graph->numTasks ? "," : "");
+	}
+	fprintf(fp, "]}\n");
+
+	fclose(fp);
+}
+
+void vkb_taskGraph_free(vkb_TaskGraph* graph)
+{
+	g_memory_free(graph->tasks);
+	g_memory_free(graph->readyMainQueue);
+	graph->~vkb_TaskGraph();
+	g_memory_free(graph);
+}
@@ -0,0 +1,443 @@
+#include "VulkanBegins/Transforms.h"
+#include "VulkanBegins/JobSystem.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define VKB_TRANSFORMS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define VKB_TRANSFORMS_X86 0
+#endif
+
+// MSVC lets any function use AVX intrinsics, GCC and Clang need them opted in
+// per function so the rest of the binary still runs on SSE-only CPUs. Every
+// CPU with AVX2 also has FMA3, the kernel uses both.
+#if VKB_TRANSFORMS_X86 && !defined(_MSC_VER)
+#define VKB_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define VKB_TARGET_AVX2
+#endif
+
+// ------------ Internal structures ------------
+struct InstancesJob
+{
+	const vkb_TransformSystem* transforms;
+	const glm::mat4* viewProj;
+	vkb_InstanceData* dst;
+	vkb_TransformKernel kernel;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint32 numSoaArrays = 10;
+static constexpr uint32 capacityGranularity = 8;
+
+// ------------ Internal Functions ------------
+static void computeInstanceScalar(const vkb_TransformSystem& t, uint32 i, const glm::mat4& viewProj, vkb_InstanceData& dst)
+{
+	float x = t.rotationX[i];
+	float y = t.rotationY[i];
+	float z = t.rotationZ[i];
+	float w = t.rotationW[i];
+	float xx = x * x, yy = y * y, zz = z * z;
+	float xy = x * y, xz = x * z, yz = y * z;
+	float wx = w * x, wy = w * y, wz = w * z;
+
+	// world = translate * rotate * scale, m[column][row]
+	float m[4][4];
+	m[0][0] = (1.0f - 2.0f * (yy + zz)) * t.scaleX[i];
+	m[0][1] = (2.0f * (xy + wz)) * t.scaleX[i];
+	m[0][2] = (2.0f * (xz - wy)) * t.scaleX[i];
+	m[0][3] = 0.0f;
+	m[1][0] = (2.0f * (xy - wz)) * t.scaleY[i];
+	m[1][1] = (1.0f - 2.0f * (xx + zz)) * t.scaleY[i];
+	m[1][2] = (2.0f * (yz + wx)) * t.scaleY[i];
+	m[1][3] = 0.0f;
+	m[2][0] = (2.0f * (xz + wy)) * t.scaleZ[i];
+	m[2][1] = (2.0f * (yz - wx)) * t.scaleZ[i];
+	m[2][2] = (1.0f - 2.0f * (xx + yy)) * t.scaleZ[i];
+	m[2][3] = 0.0f;
+	m[3][0] = t.positionX[i];
+	m[3][1] = t.positionY[i];
+	m[3][2] = t.positionZ[i];
+	m[3][3] = 1.0f;
+
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			dst.world[col][row] = m[col][row];
+			dst.worldViewProj[col][row] =
+				viewProj[0][row] * m[col][0] +
+				viewProj[1][row] * m[col][1] +
+				viewProj[2][row] * m[col][2] +
+				viewProj[3][row] * m[col][3];
+		}
+	}
+}
+
+static void computeRangeScalar(const vkb_TransformSystem& t, uint32 start, uint32 end, const glm::mat4& viewProj, vkb_InstanceData* dst)
+{
+	for (uint32 i = start; i < end; i++)
+	{
+		computeInstanceScalar(t, i, viewProj, dst[i]);
+	}
+}
+
+#if VKB_TRANSFORMS_X86
+// Transposes one matrix column held across 4 objects and stores it into each object's matrix
+static inline void storeColumnSSE(__m128 c0, __m128 c1, __m128 c2, __m128 c3, float* dst0, float* dst1, float* dst2, float* dst3)
+{
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	_mm_storeu_ps(dst0, c0);
+	_mm_storeu_ps(dst1, c1);
+	_mm_storeu_ps(dst2, c2);
+	_mm_storeu_ps(dst3, c3);
+}
+
+static uint32 computeRangeSSE(const vkb_TransformSystem& t, uint32 count, const glm::mat4& viewProj, vkb_InstanceData* dst)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	__m128 vp[4][4];
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			vp[col][row] = _mm_set1_ps(viewProj[col][row]);
+		}
+	}
+
+	uint32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(t.rotationX + i);
+		__m128 y = _mm_loadu_ps(t.rotationY + i);
+		__m128 z = _mm_loadu_ps(t.rotationZ + i);
+		__m128 w = _mm_loadu_ps(t.rotationW + i);
+		__m128 sx = _mm_loadu_ps(t.scaleX + i);
+		__m128 sy = _mm_loadu_ps(t.scaleY + i);
+		__m128 sz = _mm_loadu_ps(t.scaleZ + i);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		__m128 m[4][4];
+		m[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+		m[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+		m[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+		m[0][3] = zero;
+		m[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+		m[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+		m[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+		m[1][3] = zero;
+		m[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+		m[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+		m[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+		m[2][3] = zero;
+		m[3][0] = _mm_loadu_ps(t.positionX + i);
+		m[3][1] = _mm_loadu_ps(t.positionY + i);
+		m[3][2] = _mm_loadu_ps(t.positionZ + i);
+		m[3][3] = one;
+
+		for (int col = 0; col < 4; col++)
+		{
+			__m128 wvp[4];
+			for (int row = 0; row < 4; row++)
+			{
+				// The world matrix's bottom row is (0, 0, 0, 1), skip the zero terms
+				wvp[row] = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(vp[0][row], m[col][0]), _mm_mul_ps(vp[1][row], m[col][1])),
+					_mm_mul_ps(vp[2][row], m[col][2]));
+				if (col == 3)
+				{
+					wvp[row] = _mm_add_ps(wvp[row], vp[3][row]);
+				}
+			}
+
+			storeColumnSSE(m[col][0], m[col][1], m[col][2], m[col][3],
+				&dst[i + 0].world[col][0], &dst[i + 1].world[col][0], &dst[i + 2].world[col][0], &dst[i + 3].world[col][0]);
+			storeColumnSSE(wvp[0], wvp[1], wvp[2], wvp[3],
+				&dst[i + 0].worldViewProj[col][0], &dst[i + 1].worldViewProj[col][0], &dst[i + 2].worldViewProj[col][0], &dst[i + 3].worldViewProj[col][0]);
+		}
+	}
+
+	return i;
+}
+
+// Same as storeColumnSSE for 8 objects, without leaving AVX encoding
+VKB_TARGET_AVX2 static inline void storeColumnAVX2(__m256 c0, __m256 c1, __m256 c2, __m256 c3, vkb_InstanceData* dst, size_t memberOffset, int col)
+{
+	__m256 t0 = _mm256_unpacklo_ps(c0, c1);
+	__m256 t1 = _mm256_unpackhi_ps(c0, c1);
+	__m256 t2 = _mm256_unpacklo_ps(c2, c3);
+	__m256 t3 = _mm256_unpackhi_ps(c2, c3);
+
+	// Lower lane holds objects 0-3, upper lane objects 4-7
+	__m256 objects[4];
+	objects[0] = _mm256_shuffle_ps(t0, t2, 0x44);
+	objects[1] = _mm256_shuffle_ps(t0, t2, 0xEE);
+	objects[2] = _mm256_shuffle_ps(t1, t3, 0x44);
+	objects[3] = _mm256_shuffle_ps(t1, t3, 0xEE);
+
+	for (int j = 0; j < 4; j++)
+	{
+		float* lo = (float*)((uint8*)&dst[j] + memberOffset) + col * 4;
+		float* hi = (float*)((uint8*)&dst[j + 4] + memberOffset) + col * 4;
+		_mm_storeu_ps(lo, _mm256_castps256_ps128(objects[j]));
+		_mm_storeu_ps(hi, _mm256_extractf128_ps(objects[j], 1));
+	}
+}
+
+VKB_TARGET_AVX2 static uint32 computeRangeAVX2(const vkb_TransformSystem& t, uint32 count, const glm::mat4& viewProj, vkb_InstanceData* dst)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	__m256 vp[4][4];
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			vp[col][row] = _mm256_set1_ps(viewProj[col][row]);
+		}
+	}
+
+	uint32 i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(t.rotationX + i);
+		__m256 y = _mm256_loadu_ps(t.rotationY + i);
+		__m256 z = _mm256_loadu_ps(t.rotationZ + i);
+		__m256 w = _mm256_loadu_ps(t.rotationW + i);
+		__m256 sx = _mm256_loadu_ps(t.scaleX + i);
+		__m256 sy = _mm256_loadu_ps(t.scaleY + i);
+		__m256 sz = _mm256_loadu_ps(t.scaleZ + i);
+
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+		__m256 m[4][4];
+		// 1 - 2 * (a + b) and 2 * (a +- b) folded into one FMA each
+		m[0][0] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), sx);
+		m[0][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+		m[0][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+		m[0][3] = zero;
+		m[1][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+		m[1][1] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), sy);
+		m[1][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+		m[1][3] = zero;
+		m[2][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+		m[2][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+		m[2][2] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), sz);
+		m[2][3] = zero;
+		m[3][0] = _mm256_loadu_ps(t.positionX + i);
+		m[3][1] = _mm256_loadu_ps(t.positionY + i);
+		m[3][2] = _mm256_loadu_ps(t.positionZ + i);
+		m[3][3] = one;
+
+		for (int col = 0; col < 4; col++)
+		{
+			__m256 wvp[4];
+			for (int row = 0; row < 4; row++)
+			{
+				// The translation column starts from viewProj's instead of zero
+				__m256 acc = col == 3 ? vp[3][row] : zero;
+				acc = _mm256_fmadd_ps(vp[0][row], m[col][0], acc);
+				acc = _mm256_fmadd_ps(vp[1][row], m[col][1], acc);
+				wvp[row] = _mm256_fmadd_ps(vp[2][row], m[col][2], acc);
+			}
+
+			storeColumnAVX2(m[col][0], m[col][1], m[col][2], m[col][3], dst + i, offsetof(vkb_InstanceData, world), col);
+			storeColumnAVX2(wvp[0], wvp[1], wvp[2], wvp[3], dst + i, offsetof(vkb_InstanceData, worldViewProj), col);
+		}
+	}
+
+	return i;
+}
+
+static bool cpuSupportsAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// The OS also has to save the YMM registers on context switches
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	bool fma = (info[2] & (1 << 12)) != 0;
+	if (!osxsave || !avx || !fma || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+static vkb_TransformKernel resolveKernel(vkb_TransformKernel kernel)
+{
+	if (kernel == vkb_TransformKernel::Best)
+	{
+		if (vkb_transforms_isKernelSupported(vkb_TransformKernel::AVX2))
+		{
+			return vkb_TransformKernel::AVX2;
+		}
+
+		return vkb_transforms_isKernelSupported(vkb_TransformKernel::SSE) ? vkb_TransformKernel::SSE : vkb_TransformKernel::Scalar;
+	}
+
+	g_logger_assert(vkb_transforms_isKernelSupported(kernel), "Transform kernel %d isn't supported on this CPU.", (int)kernel);
+	return kernel;
+}
+
+static void computeInstancesJob(uint32 start, uint32 end, void* userData)
+{
+	const InstancesJob& job = *(const InstancesJob*)userData;
+	const vkb_TransformSystem& t = *job.transforms;
+
+	// View of just this batch, so the kernels can keep working from index 0
+	vkb_TransformSystem batch = {};
+	batch.positionX = t.positionX + start;
+	batch.positionY = t.positionY + start;
+	batch.positionZ = t.positionZ + start;
+	batch.rotationX = t.rotationX + start;
+	batch.rotationY = t.rotationY + start;
+	batch.rotationZ = t.rotationZ + start;
+	batch.rotationW = t.rotationW + start;
+	batch.scaleX = t.scaleX + start;
+	batch.scaleY = t.scaleY + start;
+	batch.scaleZ = t.scaleZ + start;
+	batch.count = end - start;
+	batch.capacity = end - start;
+
+	vkb_transforms_computeInstances(batch, *job.viewProj, job.dst + start, job.kernel);
+}
+
+// ------------ Public Functions ------------
+vkb_TransformSystem vkb_transforms_create(uint32 capacity)
+{
+	vkb_TransformSystem result = {};
+	result.capacity = (capacity + capacityGranularity - 1) / capacityGranularity * capacityGranularity;
+	result.count = 0;
+
+	float* memory = (float*)g_memory_allocate(sizeof(float) * result.capacity * numSoaArrays);
+	float** arrays[numSoaArrays] = {
+		&result.positionX, &result.positionY, &result.positionZ,
+		&result.rotationX, &result.rotationY, &result.rotationZ, &result.rotationW,
+		&result.scaleX, &result.scaleY, &result.scaleZ
+	};
+	for (uint32 i = 0; i < numSoaArrays; i++)
+	{
+		*arrays[i] = memory + i * result.capacity;
+	}
+
+	return result;
+}
+
+uint32 vkb_transforms_add(vkb_TransformSystem& transforms, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	g_logger_assert(transforms.count < transforms.capacity, "Transform system is full (%d transforms).", transforms.capacity);
+
+	uint32 index = transforms.count++;
+	vkb_transforms_set(transforms, index, position, rotation, scale);
+	return index;
+}
+
+void vkb_transforms_set(vkb_TransformSystem& transforms, uint32 index, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	transforms.positionX[index] = position.x;
+	transforms.positionY[index] = position.y;
+	transforms.positionZ[index] = position.z;
+	transforms.rotationX[index] = rotation.x;
+	transforms.rotationY[index] = rotation.y;
+	transforms.rotationZ[index] = rotation.z;
+	transforms.rotationW[index] = rotation.w;
+	transforms.scaleX[index] = scale.x;
+	transforms.scaleY[index] = scale.y;
+	transforms.scaleZ[index] = scale.z;
+}
+
+void vkb_transforms_computeInstances(const vkb_TransformSystem& transforms, const glm::mat4& viewProj, vkb_InstanceData* dst, vkb_TransformKernel kernel)
+{
+	uint32 done = 0;
+	switch (resolveKernel(kernel))
+	{
+#if VKB_TRANSFORMS_X86
+	case vkb_TransformKernel::AVX2:
+		done = computeRangeAVX2(transforms, transforms.count, viewProj, dst);
+		break;
+	case vkb_TransformKernel::SSE:
+		done = computeRangeSSE(transforms, transforms.count, viewProj, dst);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	// Whatever doesn't fill a full SIMD batch
+	computeRangeScalar(transforms, done, transforms.count, viewProj, dst);
+}
+
+void vkb_transforms_computeInstancesParallel(const vkb_TransformSystem& transforms, const glm::mat4& viewProj, vkb_InstanceData* dst, vkb_TransformKernel kernel, uint32 batchSize)
+{
+	// Keep batches whole SIMD widths so only the very last one hits the scalar tail
+	batchSize = (batchSize + capacityGranularity - 1) / capacityGranularity * capacityGranularity;
+
+	InstancesJob job;
+	job.transforms = &transforms;
+	job.viewProj = &viewProj;
+	job.dst = dst;
+	job.kernel = kernel;
+
+	vkb_JobCounter counter = {};
+	vkb_jobs_parallelFor(transforms.count, batchSize, computeInstancesJob, &job, &counter);
+	vkb_jobs_wait(&counter);
+}
+
+bool vkb_transforms_isKernelSupported(vkb_TransformKernel kernel)
+{
+	switch (kernel)
+	{
+	case vkb_TransformKernel::Scalar:
+	case vkb_TransformKernel::Best:
+		return true;
+#if VKB_TRANSFORMS_X86
+	case vkb_TransformKernel::SSE:
+		// SSE2 is part of x86-64
+		return true;
+	case vkb_TransformKernel::AVX2:
+	{
+		static bool supported = cpuSupportsAVX2();
+		return supported;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+void vkb_transforms_free(vkb_TransformSystem& transforms)
+{
+	if (transforms.positionX != nullptr)
+	{
+		g_memory_free(transforms.positionX);
+	}
+
+	transforms = {};
+}
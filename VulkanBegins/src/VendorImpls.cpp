@@ -1,2 +1,7 @@
 #define GABE_CPP_UTILS_IMPL
-#include "cppUtils/cppUtils.hpp";
\ No newline at end of file
+#include "cppUtils/cppUtils.hpp"
+
+#if __has_include(<stb_image_write.h>)
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#endif
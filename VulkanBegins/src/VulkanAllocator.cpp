@@ -0,0 +1,328 @@
+#include "VulkanBegins/VulkanAllocator.h"
+
+#include <mutex>
+
+// ------------ Internal structures ------------
+// Every allocation handed to the driver is preceded by this header, pfnFree and
+// pfnReallocation only give us the pointer back
+struct AllocationHeader
+{
+	uint32 size;
+	uint32 offsetFromBlock;
+	uint8 scope;
+	uint8 sizeClass;
+	uint8 padding[6];
+};
+static_assert(sizeof(AllocationHeader) == 16, "Allocation header must keep 16 byte alignment.");
+
+struct PoolChunk
+{
+	PoolChunk* next;
+};
+
+struct FreeSlot
+{
+	FreeSlot* next;
+};
+
+struct SizeClassPool
+{
+	uint32 slotSize;
+	FreeSlot* freeList;
+	PoolChunk* chunks;
+};
+
+// ------------ Internal Variables ------------
+static constexpr uint8 NotPooled = 0xFF;
+static constexpr size_t maxPooledAlignment = 16;
+static constexpr size_t poolChunkSize = 64 * 1024;
+static constexpr uint32 numSizeClasses = 5;
+static constexpr uint32 sizeClassSlotSizes[numSizeClasses] = { 64, 128, 256, 512, 1024 };
+static constexpr uint32 numScopes = 5;
+
+static const char* scopeNames[numScopes] = {
+	"Command",
+	"Object",
+	"Cache",
+	"Device",
+	"Instance"
+};
+
+static std::mutex allocatorMutex;
+static SizeClassPool pools[numSizeClasses] = {
+	{ sizeClassSlotSizes[0], nullptr, nullptr },
+	{ sizeClassSlotSizes[1], nullptr, nullptr },
+	{ sizeClassSlotSizes[2], nullptr, nullptr },
+	{ sizeClassSlotSizes[3], nullptr, nullptr },
+	{ sizeClassSlotSizes[4], nullptr, nullptr }
+};
+static vkb_VulkanAllocatorStats stats = {};
+
+// ------------ Internal Functions ------------
+static void* VKAPI_PTR allocationFunction(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope);
+static void* VKAPI_PTR reallocationFunction(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope);
+static void VKAPI_PTR freeFunction(void* pUserData, void* pMemory);
+static void VKAPI_PTR internalAllocationNotification(void* pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope);
+static void VKAPI_PTR internalFreeNotification(void* pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope);
+
+static const VkAllocationCallbacks allocationCallbacks = {
+	nullptr,
+	allocationFunction,
+	reallocationFunction,
+	freeFunction,
+	internalAllocationNotification,
+	internalFreeNotification
+};
+
+static inline size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + (alignment - 1)) & ~(alignment - 1);
+}
+
+static uint8 findSizeClass(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (scope != VK_SYSTEM_ALLOCATION_SCOPE_COMMAND || alignment > maxPooledAlignment)
+	{
+		return NotPooled;
+	}
+
+	for (uint8 i = 0; i < numSizeClasses; i++)
+	{
+		if (size + sizeof(AllocationHeader) <= sizeClassSlotSizes[i])
+		{
+			return i;
+		}
+	}
+
+	return NotPooled;
+}
+
+static uint8* allocateSlot(SizeClassPool& pool)
+{
+	if (pool.freeList == nullptr)
+	{
+		// Carve a new chunk into slots. Slots are 16 byte aligned so the header
+		// leaves the user pointer 16 byte aligned too.
+		uint8* chunkMemory = (uint8*)g_memory_allocate(poolChunkSize);
+		if (chunkMemory == nullptr)
+		{
+			return nullptr;
+		}
+
+		PoolChunk* chunk = (PoolChunk*)chunkMemory;
+		chunk->next = pool.chunks;
+		pool.chunks = chunk;
+
+		uint8* slotStart = (uint8*)alignUp((size_t)(chunkMemory + sizeof(PoolChunk)), maxPooledAlignment);
+		uint8* chunkEnd = chunkMemory + poolChunkSize;
+		for (uint8* slot = slotStart; slot + pool.slotSize <= chunkEnd; slot += pool.slotSize)
+		{
+			FreeSlot* freeSlot = (FreeSlot*)slot;
+			freeSlot->next = pool.freeList;
+			pool.freeList = freeSlot;
+		}
+	}
+
+	FreeSlot* slot = pool.freeList;
+	pool.freeList = slot->next;
+	return (uint8*)slot;
+}
+
+static void* allocateLocked(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (alignment < alignof(AllocationHeader))
+	{
+		alignment = alignof(AllocationHeader);
+	}
+
+	uint8 sizeClass = findSizeClass(size, alignment, scope);
+
+	uint8* block = nullptr;
+	uint8* memory = nullptr;
+	if (sizeClass != NotPooled)
+	{
+		block = allocateSlot(pools[sizeClass]);
+		memory = block + sizeof(AllocationHeader);
+	}
+	else
+	{
+		block = (uint8*)g_memory_allocate(size + alignment + sizeof(AllocationHeader));
+		if (block != nullptr)
+		{
+			memory = (uint8*)alignUp((size_t)(block + sizeof(AllocationHeader)), alignment);
+		}
+	}
+
+	if (block == nullptr)
+	{
+		return nullptr;
+	}
+
+	AllocationHeader* header = ((AllocationHeader*)memory) - 1;
+	header->size = (uint32)size;
+	header->offsetFromBlock = (uint32)(memory - block);
+	header->scope = (uint8)scope;
+	header->sizeClass = sizeClass;
+
+	vkb_VulkanAllocatorScopeStats& scopeStats = stats.scopes[scope];
+	scopeStats.numAllocations++;
+	scopeStats.numPooledAllocations += sizeClass != NotPooled ? 1 : 0;
+	scopeStats.liveAllocations++;
+	scopeStats.liveBytes += size;
+	scopeStats.totalBytes += size;
+	if (scopeStats.liveBytes > scopeStats.peakBytes)
+	{
+		scopeStats.peakBytes = scopeStats.liveBytes;
+	}
+
+	return memory;
+}
+
+static void freeLocked(void* memory)
+{
+	AllocationHeader* header = ((AllocationHeader*)memory) - 1;
+	uint8* block = (uint8*)memory - header->offsetFromBlock;
+
+	vkb_VulkanAllocatorScopeStats& scopeStats = stats.scopes[header->scope];
+	scopeStats.numFrees++;
+	scopeStats.liveAllocations--;
+	scopeStats.liveBytes -= header->size;
+
+	if (header->sizeClass != NotPooled)
+	{
+		SizeClassPool& pool = pools[header->sizeClass];
+		FreeSlot* slot = (FreeSlot*)block;
+		slot->next = pool.freeList;
+		pool.freeList = slot;
+	}
+	else
+	{
+		g_memory_free(block);
+	}
+}
+
+static void* VKAPI_PTR allocationFunction(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+	if (size == 0)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+	return allocateLocked(size, alignment, allocationScope);
+}
+
+static void* VKAPI_PTR reallocationFunction(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+
+	if (pOriginal == nullptr)
+	{
+		return size != 0 ? allocateLocked(size, alignment, allocationScope) : nullptr;
+	}
+
+	if (size == 0)
+	{
+		freeLocked(pOriginal);
+		return nullptr;
+	}
+
+	// The spec requires the new allocation to keep the original scope and alignment
+	AllocationHeader* header = ((AllocationHeader*)pOriginal) - 1;
+	size_t originalSize = header->size;
+	void* newMemory = allocateLocked(size, alignment, (VkSystemAllocationScope)header->scope);
+	if (newMemory == nullptr)
+	{
+		return nullptr;
+	}
+
+	memcpy(newMemory, pOriginal, originalSize < size ? originalSize : size);
+	stats.scopes[header->scope].numReallocations++;
+	freeLocked(pOriginal);
+
+	return newMemory;
+}
+
+static void VKAPI_PTR freeFunction(void* pUserData, void* pMemory)
+{
+	if (pMemory == nullptr)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+	freeLocked(pMemory);
+}
+
+static void VKAPI_PTR internalAllocationNotification(void* pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope)
+{
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+	stats.numInternalAllocations++;
+	stats.liveInternalBytes += size;
+}
+
+static void VKAPI_PTR internalFreeNotification(void* pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope)
+{
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+	stats.liveInternalBytes -= size;
+}
+
+// ------------ Public Functions ------------
+const VkAllocationCallbacks* vkb_vulkanAllocator_get()
+{
+	return &allocationCallbacks;
+}
+
+vkb_VulkanAllocatorStats vkb_vulkanAllocator_getStats()
+{
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+	return stats;
+}
+
+void vkb_vulkanAllocator_dumpStats()
+{
+	vkb_VulkanAllocatorStats snapshot = vkb_vulkanAllocator_getStats();
+
+	g_logger_info("Vulkan driver host allocations:");
+	for (uint32 scope = 0; scope < numScopes; scope++)
+	{
+		const vkb_VulkanAllocatorScopeStats& scopeStats = snapshot.scopes[scope];
+		g_logger_info("  %-8s allocs: %llu (pooled: %llu), reallocs: %llu, frees: %llu, total: %llu bytes, peak: %llu bytes",
+			scopeNames[scope],
+			(unsigned long long)scopeStats.numAllocations,
+			(unsigned long long)scopeStats.numPooledAllocations,
+			(unsigned long long)scopeStats.numReallocations,
+			(unsigned long long)scopeStats.numFrees,
+			(unsigned long long)scopeStats.totalBytes,
+			(unsigned long long)scopeStats.peakBytes);
+
+		if (scopeStats.liveAllocations > 0)
+		{
+			g_logger_warning("  %-8s still has %llu live allocations (%llu bytes) that the driver never freed.",
+				scopeNames[scope],
+				(unsigned long long)scopeStats.liveAllocations,
+				(unsigned long long)scopeStats.liveBytes);
+		}
+	}
+
+	g_logger_info("  Internal allocations reported by the driver: %llu", (unsigned long long)snapshot.numInternalAllocations);
+}
+
+void vkb_vulkanAllocator_free()
+{
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+
+	for (uint32 i = 0; i < numSizeClasses; i++)
+	{
+		PoolChunk* chunk = pools[i].chunks;
+		while (chunk != nullptr)
+		{
+			PoolChunk* next = chunk->next;
+			g_memory_free(chunk);
+			chunk = next;
+		}
+
+		pools[i].chunks = nullptr;
+		pools[i].freeList = nullptr;
+	}
+}
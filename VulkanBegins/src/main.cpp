@@ -1,14 +1,26 @@
 #include <cppUtils/cppUtils.hpp>
 #include "VulkanBegins/App.h"
+#include "VulkanBegins/VulkanAllocator.h"
+#include "VulkanBegins/JobSystem.h"
 
 int main()
 {
+#ifdef _DEBUG
+    // Leak tracking pads and records every allocation, so keep it out of release builds
     g_memory_init(true, 1024);
+#else
+    g_memory_init(false);
+#endif
+    vkb_jobs_init();
 
     vkb_app_init();
     vkb_app_run();
     vkb_app_free();
 
+    vkb_jobs_free();
+
+    vkb_vulkanAllocator_dumpStats();
+    vkb_vulkanAllocator_free();
     g_memory_dumpMemoryLeaks();
 
     return 0;
@@ -1,3 +1,14 @@
 glslc shader.vert -o bin/vert.spv
 glslc shader.frag -o bin/frag.spv
+glslc hiz_downsample.comp -o bin/hiz_downsample.spv
+glslc occlusion_cull.comp -o bin/occlusion_cull.spv
+glslc light_cull.comp -o bin/light_cull.spv
+glslc particles.comp -o bin/particles.spv
+glslc particle.vert -o bin/particle_vert.spv
+glslc particle.frag -o bin/particle_frag.spv
+glslc sprite.vert -o bin/sprite_vert.spv
+glslc sprite.frag -o bin/sprite_frag.spv
+glslc material.vert -o bin/material_vert.spv
+glslc material.frag -o bin/material_frag.spv
+glslc material_bindless.frag -o bin/material_bindless_frag.spv
 pause
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 450
+
+// A material bound the classic way, one descriptor set per material
+
+layout(set = 0, binding = 0) uniform sampler2D materialTexture;
+layout(set = 0, binding = 1) readonly buffer MaterialParams
+{
+    vec4 tint;
+};
+
+layout(location = 0) in vec2 fragUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    outColor = vec4(texture(materialTexture, fragUv).rgb * tint.rgb, 1.0);
+}
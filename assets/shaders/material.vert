@@ -0,0 +1,30 @@
+#version 450
+
+// One small triangle per draw, placed on a grid by its first instance so the
+// draws of a material test don't stack on top of each other
+
+const uint gridSize = 128;
+
+layout(location = 0) out vec2 fragUv;
+
+vec2 positions[3] = vec2[](
+    vec2(0.0, -0.5),
+    vec2(0.5, 0.5),
+    vec2(-0.5, 0.5)
+);
+
+vec2 uvs[3] = vec2[](
+    vec2(0.5, 0.0),
+    vec2(1.0, 1.0),
+    vec2(0.0, 1.0)
+);
+
+void main()
+{
+    uint cell = uint(gl_InstanceIndex) % (gridSize * gridSize);
+    vec2 cellOrigin = vec2(cell % gridSize, cell / gridSize) + 0.5;
+    vec2 position = (positions[gl_VertexIndex] + cellOrigin) * (2.0 / float(gridSize)) - 1.0;
+
+    gl_Position = vec4(position, 0.0, 1.0);
+    fragUv = uvs[gl_VertexIndex];
+}
@@ -0,0 +1,29 @@
+#version 450
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+// The same material as material.frag, reached through the bindless heap (see
+// Bindless.h). The indices are push constants, so they're uniform across the
+// draw and don't need nonuniformEXT.
+
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+layout(set = 0, binding = 1) readonly buffer MaterialParams
+{
+    vec4 tint;
+} materialParams[];
+
+layout(push_constant) uniform Material
+{
+    uint textureIndex;
+    uint paramsIndex;
+};
+
+layout(location = 0) in vec2 fragUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    vec3 albedo = texture(textures[textureIndex], fragUv).rgb;
+    outColor = vec4(albedo * materialParams[paramsIndex].tint.rgb, 1.0);
+}
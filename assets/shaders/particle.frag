@@ -0,0 +1,17 @@
+#version 450
+
+layout(location = 0) in vec2 fragCorner;
+layout(location = 1) in vec3 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    // Round, soft edged sprites, blended additively
+    float falloff = 1.0 - dot(fragCorner, fragCorner);
+    if (falloff <= 0.0)
+    {
+        discard;
+    }
+    outColor = vec4(fragColor * falloff, 0.0);
+}
@@ -0,0 +1,58 @@
+#version 450
+
+// Draws the current alive list of particles.comp as camera facing quads, one
+// instance per particle. Positions are in view space.
+
+layout(set = 0, binding = 0) uniform ParticleParams
+{
+    uvec4 counts;
+    vec4 emitterPosition;
+    vec4 emitterVelocity;
+    vec4 gravity;
+    // tan of half the field of view in x and y, near and far distance
+    vec4 projection;
+    vec4 sprite;
+};
+layout(set = 0, binding = 1) readonly buffer Positions { vec4 positions[]; };
+layout(set = 0, binding = 2) readonly buffer Velocities { vec4 velocities[]; };
+layout(set = 0, binding = 4) readonly buffer AliveLists { uint aliveLists[]; };
+layout(set = 0, binding = 5) readonly buffer Counters
+{
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    uint simulateGroupsX;
+    uint simulateGroupsY;
+    uint simulateGroupsZ;
+    int numFree;
+    uint current;
+};
+
+layout(location = 0) out vec2 fragCorner;
+layout(location = 1) out vec3 fragColor;
+
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main()
+{
+    uint particle = aliveLists[current * counts.x + uint(gl_InstanceIndex)];
+    vec4 position = positions[particle];
+    float life = clamp(position.w / velocities[particle].w, 0.0, 1.0);
+
+    vec2 corner = corners[gl_VertexIndex];
+    vec3 viewPos = position.xyz + vec3(corner * sprite.x * (1.0 - 0.5 * life), 0.0);
+
+    // Same projection as the lit scene in shader.vert, Vulkan's y points down
+    float nearZ = projection.z;
+    float farZ = projection.w;
+    float depth = -viewPos.z;
+    gl_Position = vec4(viewPos.x / projection.x, -viewPos.y / projection.y, (depth - nearZ) * farZ / (farZ - nearZ), depth);
+
+    fragCorner = corner;
+    // Hot to cool over the particle's life, faded out towards its end
+    fragColor = mix(vec3(1.0, 0.6, 0.2), vec3(0.2, 0.3, 1.0), life) * (1.0 - life) * 0.25;
+}
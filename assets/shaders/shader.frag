@@ -1,10 +1,86 @@
 #version 450
 
+// Feature toggles, set per pipeline variant. The ids match vkb_ShaderFeature.
+layout(constant_id = 2) const bool useFog = false;
+layout(constant_id = 5) const bool useClusteredLighting = false;
+
+// Lights binned by light_cull.comp, see ClusteredLighting.h
+struct PointLight
+{
+    vec4 positionRadius;
+    vec4 colorIntensity;
+};
+
+layout(set = 1, binding = 0) uniform ClusterParams
+{
+    uvec4 gridSize;
+    // Tile size in pixels, then the depth slice scale and bias
+    vec4 tileAndSlice;
+    vec4 depthAndFov;
+    vec4 viewport;
+    uvec4 limits;
+};
+layout(set = 1, binding = 1) readonly buffer Lights { PointLight lights[]; };
+layout(set = 1, binding = 2) readonly buffer LightGrid { uvec2 lightGrid[]; };
+layout(set = 1, binding = 3) readonly buffer LightIndices { uint lightIndices[]; };
+
+// The scene viewport's height in pixels, pushed by App.cpp
+layout(push_constant) uniform FogParams
+{
+    float viewportHeight;
+};
+
 layout(location = 0) in vec3 fragColor;
+layout(location = 2) in vec3 fragViewPosition;
 
 layout(location = 0) out vec4 outColor;
 
+const vec3 fogColor = vec3(0.6, 0.65, 0.7);
+const vec3 ambientLight = vec3(0.05);
+
+vec3 clusteredLighting(vec3 position)
+{
+    // Face normal, turned towards the camera
+    vec3 normal = normalize(cross(dFdy(position), dFdx(position)));
+
+    uint slice = uint(max(log(-position.z) * tileAndSlice.z + tileAndSlice.w, 0.0));
+    uvec3 cluster = min(uvec3(uvec2(gl_FragCoord.xy / tileAndSlice.xy), slice), gridSize.xyz - 1);
+    uvec2 lightRange = lightGrid[(cluster.z * gridSize.y + cluster.y) * gridSize.x + cluster.x];
+
+    vec3 lighting = ambientLight;
+    for (uint i = 0; i < lightRange.y; i++)
+    {
+        PointLight light = lights[lightIndices[lightRange.x + i]];
+        vec3 toLight = light.positionRadius.xyz - position;
+        float distanceSquared = dot(toLight, toLight);
+        float radiusSquared = light.positionRadius.w * light.positionRadius.w;
+        if (distanceSquared >= radiusSquared)
+        {
+            continue;
+        }
+
+        // Smooth falloff that reaches zero exactly at the radius
+        float falloff = 1.0 - distanceSquared / radiusSquared;
+        float diffuse = max(dot(normal, toLight * inversesqrt(max(distanceSquared, 1e-8))), 0.0);
+        lighting += light.colorIntensity.rgb * light.colorIntensity.a * falloff * falloff * diffuse;
+    }
+    return lighting;
+}
+
 void main() 
 {
-    outColor = vec4(fragColor, 1.0);
+    vec3 color = fragColor;
+    if (useClusteredLighting)
+    {
+        color *= clusteredLighting(fragViewPosition);
+    }
+
+    if (useFog)
+    {
+        // Flat geometry has no depth to speak of, so fade with screen height
+        float fogAmount = clamp(gl_FragCoord.y / viewportHeight, 0.0, 1.0) * 0.6;
+        color = mix(color, fogColor, fogAmount);
+    }
+
+    outColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -1,6 +1,59 @@
 #version 450
 
+// Feature toggles, set per pipeline variant. The ids match vkb_ShaderFeature.
+layout(constant_id = 0) const bool useVertexColor = true;
+layout(constant_id = 3) const bool useInstancing = false;
+layout(constant_id = 4) const bool useCulledInstances = false;
+layout(constant_id = 5) const bool useClusteredLighting = false;
+layout(constant_id = 6) const bool useMeshVertices = false;
+
+// Ids of the instances to draw: the ones that survived occlusion culling (see
+// OcclusionCulling.h), or the ones the scene's BVH found in the frustum,
+// grouped by LOD when the scene mesh is drawn
+layout(set = 0, binding = 0) readonly buffer CulledInstances
+{
+    uint culledInstances[];
+};
+
+// Matrices of every instance in the scene, see Transforms.h. The scene's world
+// space is view space, the camera sits at the origin.
+struct InstanceData
+{
+    mat4 world;
+    mat4 worldViewProj;
+};
+
+layout(set = 2, binding = 0) readonly buffer SceneInstances
+{
+    InstanceData instances[];
+};
+
+// The scene mesh's vkb_MeshVertex array, pulled by index: position, normal, uv
+const uint meshVertexFloats = 8;
+layout(set = 2, binding = 1) readonly buffer MeshVertices
+{
+    float meshVertices[];
+};
+
+// Projection the light clusters were built for, see ClusteredLighting.h
+layout(set = 1, binding = 0) uniform ClusterParams
+{
+    uvec4 gridSize;
+    vec4 tileAndSlice;
+    // Near, far, tan of half the field of view in x and y
+    vec4 depthAndFov;
+    vec4 viewport;
+    uvec4 limits;
+};
+
+// Where the lit scene lies in view space, matches the light placement in App.cpp
+const float floorHeight = 1.5;
+const float floorNear = 2.0;
+const float floorDepth = 30.0;
+const float floorHalfWidth = 12.0;
+
 layout(location = 0) out vec3 fragColor;
+layout(location = 2) out vec3 fragViewPosition;
 
 vec2 positions[3] = vec2[](
     vec2(0.0, -0.5),
@@ -16,6 +69,45 @@ vec3 colors[3] = vec3[](
 
 void main() 
 {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    // Mesh draws are indexed, gl_VertexIndex is the vertex the index points at
+    uint meshVertex = uint(gl_VertexIndex) * meshVertexFloats;
+    vec2 position = useMeshVertices ? vec2(0.0) : positions[gl_VertexIndex];
+    gl_Position = vec4(position, 0.0, 1.0);
+    fragViewPosition = vec3(0.0);
+    if (useInstancing)
+    {
+        uint instance = useCulledInstances ? culledInstances[gl_InstanceIndex] : uint(gl_InstanceIndex);
+
+        // The triangle points up in the scene, where y is up
+        vec4 localPosition = vec4(position.x, -position.y, 0.0, 1.0);
+        if (useMeshVertices)
+        {
+            localPosition = vec4(meshVertices[meshVertex], meshVertices[meshVertex + 1], meshVertices[meshVertex + 2], 1.0);
+        }
+        gl_Position = instances[instance].worldViewProj * localPosition;
+        fragViewPosition = (instances[instance].world * localPosition).xyz;
+    }
+    else if (useClusteredLighting)
+    {
+        // Lights need depth to spread over, so the flat scene becomes a floor
+        // below the camera with the top of the screen furthest away
+        vec3 viewPosition = vec3(position.x * floorHalfWidth, -floorHeight, -(floorNear + (1.0 - position.y) * 0.5 * floorDepth));
+        float nearZ = depthAndFov.x;
+        float farZ = depthAndFov.y;
+        float depth = -viewPosition.z;
+        gl_Position = vec4(
+            viewPosition.x / depthAndFov.z,
+            -viewPosition.y / depthAndFov.w,
+            (depth - nearZ) * farZ / (farZ - nearZ),
+            depth);
+        fragViewPosition = viewPosition;
+    }
+    if (useMeshVertices)
+    {
+        // Meshes have no vertex colors, their normals stand in
+        vec3 normal = vec3(meshVertices[meshVertex + 3], meshVertices[meshVertex + 4], meshVertices[meshVertex + 5]);
+        fragColor = useVertexColor ? normal * 0.5 + 0.5 : vec3(1.0);
+        return;
+    }
+    fragColor = useVertexColor ? colors[gl_VertexIndex] : vec3(1.0);
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 450
+
+// Sprites in pixels with the origin at the top left, see SpriteRenderer.h
+
+layout(push_constant) uniform SpriteParams
+{
+    // 2 / target size
+    vec2 pixelToNdc;
+};
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUv;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 fragUv;
+layout(location = 1) out vec4 fragColor;
+
+void main()
+{
+    // Vulkan's NDC y already points down, like pixels do
+    gl_Position = vec4(inPosition * pixelToNdc - 1.0, 0.0, 1.0);
+    fragUv = inUv;
+    fragColor = inColor;
+}
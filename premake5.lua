@@ -12,11 +12,53 @@ workspace "VulkanBegins"
 -- This is a helper variable, to concatenate the sys-arch
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
+-- Every shader and the binary the renderer loads it from, keep in step with
+-- assets/shaders/compile.bat
+shaderBinaries = {
+    { "shader.vert", "vert.spv" },
+    { "shader.frag", "frag.spv" },
+    { "hiz_downsample.comp", "hiz_downsample.spv" },
+    { "occlusion_cull.comp", "occlusion_cull.spv" },
+    { "light_cull.comp", "light_cull.spv" },
+    { "particles.comp", "particles.spv" },
+    { "particle.vert", "particle_vert.spv" },
+    { "particle.frag", "particle_frag.spv" },
+    { "sprite.vert", "sprite_vert.spv" },
+    { "sprite.frag", "sprite_frag.spv" },
+    { "material.vert", "material_vert.spv" },
+    { "material.frag", "material_frag.spv" },
+    { "material_bindless.frag", "material_bindless_frag.spv" }
+}
+
+-- Compiles assets/shaders into assets/shaders/bin with the SDK's glslc. The
+-- renderer's features turn themselves off when their binary is missing, so
+-- everything that runs the renderer depends on this.
+project "Shaders"
+    kind "Utility"
+
+    files {
+        "assets/shaders/*.vert",
+        "assets/shaders/*.frag",
+        "assets/shaders/*.comp"
+    }
+
+    for _, shader in ipairs(shaderBinaries) do
+        filter { "files:assets/shaders/" .. shader[1] }
+            buildmessage("Compiling " .. shader[1])
+            -- ICKY: Same hardcoded SDK as the include paths below
+            buildcommands {
+                '"C:/VulkanSDK/1.3.216.0/Bin/glslc.exe" "%{file.abspath}" -o "%{wks.location}/assets/shaders/bin/' .. shader[2] .. '"'
+            }
+            buildoutputs { "%{wks.location}/assets/shaders/bin/" .. shader[2] }
+    end
+    filter {}
+
 project "VulkanBegins"
     kind "ConsoleApp"
     language "C++"
     cppdialect "C++17"
     staticruntime "on"
+    dependson "Shaders"
 
     targetdir("bin/" .. outputdir .. "/%{prj.name}")
     objdir("bin-int/" .. outputdir .. "/%{prj.name}")
@@ -65,6 +107,176 @@ project "VulkanBegins"
             "_RELEASE"
         }
 
+project "Benchmarks"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    staticruntime "on"
+    dependson "Shaders"
+
+    targetdir("bin/" .. outputdir .. "/%{prj.name}")
+    objdir("bin-int/" .. outputdir .. "/%{prj.name}")
+
+    -- Builds the renderer's own sources so scenarios run the real code paths,
+    -- only the app's entry point is swapped out
+    files {
+        "Benchmarks/src/**.cpp",
+        "Benchmarks/include/**.h",
+        "VulkanBegins/src/**.cpp",
+        "VulkanBegins/include/**.h"
+    }
+
+    removefiles {
+        "VulkanBegins/src/main.cpp"
+    }
+
+    includedirs {
+        "Benchmarks/include",
+        "VulkanBegins/include",
+        "VulkanBegins/vendor/GLFW/include",
+        "VulkanBegins/vendor/cppUtils/single_include/",
+        "VulkanBegins/vendor/glm/",
+        "VulkanBegins/vendor/stb/",
+        -- SUPER ICKY: See note in VulkanBegins
+        "C:/VulkanSDK/1.3.216.0/Include"
+    }
+
+    -- Run from the repository root so assets/ and Benchmarks/baseline.json resolve
+    debugdir "."
+
+    systemversion "latest"
+    defines  { "_CRT_SECURE_NO_WARNINGS" }
+
+    links {
+        "GLFW",
+        "vulkan-1.lib"
+    }
+
+    libdirs {
+        "C:/VulkanSDK/1.3.216.0/Lib"
+    }
+
+    filter { "configurations:Debug" }
+        buildoptions "/MTd"
+        runtime "Debug"
+        symbols "on"
+
+    filter { "configurations:Release" }
+        buildoptions "/MT"
+        runtime "Release"
+        optimize "on"
+
+        defines {
+            "_RELEASE"
+        }
+
+project "Replay"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    staticruntime "on"
+    dependson "Shaders"
+
+    targetdir("bin/" .. outputdir .. "/%{prj.name}")
+    objdir("bin-int/" .. outputdir .. "/%{prj.name}")
+
+    -- Replays command captures through the renderer itself, only the app's
+    -- entry point is swapped out
+    files {
+        "Replay/src/**.cpp",
+        "VulkanBegins/src/**.cpp",
+        "VulkanBegins/include/**.h"
+    }
+
+    removefiles {
+        "VulkanBegins/src/main.cpp"
+    }
+
+    includedirs {
+        "VulkanBegins/include",
+        "VulkanBegins/vendor/GLFW/include",
+        "VulkanBegins/vendor/cppUtils/single_include/",
+        "VulkanBegins/vendor/glm/",
+        "VulkanBegins/vendor/stb/",
+        -- SUPER ICKY: See note in VulkanBegins
+        "C:/VulkanSDK/1.3.216.0/Include"
+    }
+
+    -- Run from the repository root so assets/ resolves
+    debugdir "."
+
+    systemversion "latest"
+    defines  { "_CRT_SECURE_NO_WARNINGS" }
+
+    links {
+        "GLFW",
+        "vulkan-1.lib"
+    }
+
+    libdirs {
+        "C:/VulkanSDK/1.3.216.0/Lib"
+    }
+
+    filter { "configurations:Debug" }
+        buildoptions "/MTd"
+        runtime "Debug"
+        symbols "on"
+
+    filter { "configurations:Release" }
+        buildoptions "/MT"
+        runtime "Release"
+        optimize "on"
+
+        defines {
+            "_RELEASE"
+        }
+
+project "MeshConverter"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    staticruntime "on"
+
+    targetdir("bin/" .. outputdir .. "/%{prj.name}")
+    objdir("bin-int/" .. outputdir .. "/%{prj.name}")
+
+    -- Offline tool, only the mesh format and simplifier are shared with the renderer
+    files {
+        "MeshConverter/src/**.cpp",
+        "VulkanBegins/src/File.cpp",
+        "VulkanBegins/src/Mesh.cpp",
+        "VulkanBegins/src/MeshSimplify.cpp",
+        "VulkanBegins/src/VendorImpls.cpp",
+        "VulkanBegins/include/VulkanBegins/File.h",
+        "VulkanBegins/include/VulkanBegins/Mesh.h",
+        "VulkanBegins/include/VulkanBegins/MeshSimplify.h"
+    }
+
+    includedirs {
+        "VulkanBegins/include",
+        "VulkanBegins/vendor/cppUtils/single_include/",
+        "VulkanBegins/vendor/stb/"
+    }
+
+    debugdir "."
+
+    systemversion "latest"
+    defines  { "_CRT_SECURE_NO_WARNINGS" }
+
+    filter { "configurations:Debug" }
+        buildoptions "/MTd"
+        runtime "Debug"
+        symbols "on"
+
+    filter { "configurations:Release" }
+        buildoptions "/MT"
+        runtime "Release"
+        optimize "on"
+
+        defines {
+            "_RELEASE"
+        }
+
 project "GLFW"
     kind "StaticLib"
     language "C++"